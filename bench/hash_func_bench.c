@@ -0,0 +1,168 @@
+#include <hash_table.h>
+#include <time.h>
+
+#define DEFAULT_KEYS 1000000
+#define LONG_KEY_PAD 80
+#define FLOOD_BLOCKS 12
+#define MAX_CHAIN_BUCKET 8
+
+static const char *func_names[] = {"wy", "sip", "poly31"};
+static volatile uint64_t sink = 0;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief builds n keys sharing the "tenant:NNNN:" prefix, padded out to
+ *        long keys when pad is non-zero
+ *
+ * @param n number of keys
+ * @param pad number of filler bytes inserted after the prefix
+ *
+ * @return array of n heap allocated keys
+ */
+static char **make_keys(uint32_t n, int pad)
+{
+    char **keys = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        char buffer[192] = {0};
+        snprintf(buffer, sizeof(buffer), "tenant:%04u:%.*s%u", x % 1000, pad,
+                 "................................................................"
+                 "................................................................",
+                 x);
+        keys[x] = strdup(buffer);
+    }
+    return keys;
+}
+
+/**
+ * @brief builds 2^FLOOD_BLOCKS keys out of "Aa" and "BB" blocks, which all
+ *        collide under the multiply by 31 hash
+ *
+ * @return array of heap allocated keys
+ */
+static char **make_flood_keys(void)
+{
+    uint32_t n = 1U << FLOOD_BLOCKS;
+    char **keys = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        keys[x] = (char *)calloc(2 * FLOOD_BLOCKS + 1, 1);
+        for (uint32_t block = 0; block < FLOOD_BLOCKS; block++)
+        {
+            memcpy(keys[x] + 2 * block, ((x >> block) & 1) ? "BB" : "Aa", 2);
+        }
+    }
+    return keys;
+}
+
+static void free_keys(char **keys, uint32_t n)
+{
+    for (uint32_t x = 0; x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+}
+
+/**
+ * @brief hashes, inserts and looks up every key with one hash family and
+ *        prints throughput and the resulting chain length distribution
+ *
+ * @param func hash family
+ * @param keys keys to use
+ * @param n number of keys
+ */
+static void run(hash_func_t func, char **keys, uint32_t n)
+{
+    hash_table_opts_t opts = {.hash_func = func};
+    hash_table_t *table = hash_table_init_ex(n, NULL, &opts);
+    uint64_t histogram[MAX_CHAIN_BUCKET + 1] = {0};
+    uint32_t longest = 0;
+    int value = 1;
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < n; x++)
+    {
+        sink += table->hash(keys[x], strlen(keys[x]), table->seed);
+    }
+    double hashed = now_seconds();
+    for (uint32_t x = 0; x < n; x++)
+    {
+        hash_table_add(table, &value, keys[x]);
+    }
+    double added = now_seconds();
+    for (uint32_t x = 0; x < n; x++)
+    {
+        sink += (NULL != hash_table_lookup(table, keys[x]));
+    }
+    double looked_up = now_seconds();
+
+    for (uint32_t x = 0; x < table->size; x++)
+    {
+        uint32_t length = 0;
+        for (node_t *current = table->table[x]; NULL != current;
+             current = current->next)
+        {
+            length++;
+        }
+        histogram[length < MAX_CHAIN_BUCKET ? length : MAX_CHAIN_BUCKET]++;
+        longest = length > longest ? length : longest;
+    }
+
+    printf("%-7s %12.0f %12.0f %12.0f %8u |", func_names[func],
+           n / (hashed - start), n / (added - hashed),
+           n / (looked_up - added), longest);
+    for (int x = 0; x <= MAX_CHAIN_BUCKET; x++)
+    {
+        printf(" %5.1f%%", 100.0 * histogram[x] / table->size);
+    }
+    printf("\n");
+
+    hash_table_destroy(&table);
+}
+
+static void run_all(const char *title, char **keys, uint32_t n)
+{
+    printf("\n%s (%u keys)\n", title, n);
+    printf("%-7s %12s %12s %12s %8s | chain length share of buckets: "
+           "0 1 2 3 4 5 6 7 8+\n",
+           "hash", "hash/s", "add/s", "lookup/s", "longest");
+    for (hash_func_t func = HASH_FUNC_WY; func <= HASH_FUNC_POLY31; func++)
+    {
+        run(func, keys, n);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = DEFAULT_KEYS;
+    char **keys = NULL;
+
+    if (argc > 1)
+    {
+        n = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+
+    keys = make_keys(n, 0);
+    run_all("short prefixed keys", keys, n);
+    free_keys(keys, n);
+
+    keys = make_keys(n, LONG_KEY_PAD);
+    run_all("long prefixed keys", keys, n);
+    free_keys(keys, n);
+
+    keys = make_flood_keys();
+    run_all("crafted poly31 collisions", keys, 1U << FLOOD_BLOCKS);
+    free_keys(keys, 1U << FLOOD_BLOCKS);
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <hash_map_u64.h>
+#include <hash_table.h>
+#include <time.h>
+
+#define DEFAULT_KEYS (1U << 20)
+
+static volatile uint64_t sink = 0;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief sparse 64 bit ids, the way database or snowflake ids look
+ */
+static uint64_t *make_ids(uint32_t n)
+{
+    uint64_t *ids = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+
+    for (uint32_t x = 0; NULL != ids && x < n; x++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        ids[x] = state;
+    }
+    return ids;
+}
+
+/**
+ * @brief every id once, in an order unrelated to insertion order
+ */
+static uint64_t *make_probes(const uint64_t *ids, uint32_t n)
+{
+    uint64_t *probes = (uint64_t *)malloc(n * sizeof(uint64_t));
+
+    for (uint32_t x = 0; NULL != probes && x < n; x++)
+    {
+        probes[x] = ids[(x * 7919ULL) % n];
+    }
+    return probes;
+}
+
+/**
+ * @brief inserts and then looks up every id through the string table, the
+ *        way callers did before: formatting each id into a key first
+ */
+static void run_string_table(const uint64_t *ids, const uint64_t *probes,
+                             uint32_t n, double *insert, double *lookup)
+{
+    hash_table_t *table = hash_table_init(n, NULL);
+    char key[32] = {0};
+    uint64_t found = 0;
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < n; x++)
+    {
+        snprintf(key, sizeof(key), "%llu", (unsigned long long)ids[x]);
+        hash_table_add(table, (void *)&ids[x], key);
+    }
+    *insert = n / (now_seconds() - start);
+
+    start = now_seconds();
+    for (uint32_t x = 0; x < n; x++)
+    {
+        snprintf(key, sizeof(key), "%llu", (unsigned long long)probes[x]);
+        found += NULL != hash_table_lookup(table, key);
+    }
+    *lookup = n / (now_seconds() - start);
+    sink += found;
+
+    hash_table_destroy(&table);
+}
+
+/**
+ * @brief inserts and then looks up every id through hash_map_u64
+ */
+static void run_u64_map(const uint64_t *ids, const uint64_t *probes,
+                        uint32_t n, double *insert, double *lookup)
+{
+    hash_map_u64_t *map = hash_map_u64_init(n);
+    uint64_t value = 0;
+    uint64_t found = 0;
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < n; x++)
+    {
+        hash_map_u64_put(map, ids[x], x);
+    }
+    *insert = n / (now_seconds() - start);
+
+    start = now_seconds();
+    for (uint32_t x = 0; x < n; x++)
+    {
+        found += SUCCESS == hash_map_u64_get(map, probes[x], &value);
+    }
+    *lookup = n / (now_seconds() - start);
+    sink += found + value;
+
+    hash_map_u64_destroy(&map);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = DEFAULT_KEYS;
+    double string_insert = 0;
+    double string_lookup = 0;
+    double map_insert = 0;
+    double map_lookup = 0;
+
+    if (argc > 1)
+    {
+        n = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (0 == n)
+    {
+        n = DEFAULT_KEYS;
+    }
+
+    uint64_t *ids = make_ids(n);
+    uint64_t *probes = make_probes(ids, n);
+    run_string_table(ids, probes, n, &string_insert, &string_lookup);
+    run_u64_map(ids, probes, n, &map_insert, &map_lookup);
+
+    printf("%u random 64 bit ids\n", n);
+    printf("%-28s %14s %14s\n", "", "insert/s", "lookup/s");
+    printf("%-28s %14.0f %14.0f\n", "snprintf + hash_table", string_insert,
+           string_lookup);
+    printf("%-28s %14.0f %14.0f\n", "hash_map_u64", map_insert, map_lookup);
+    printf("%-28s %13.1fx %13.1fx\n", "speedup", map_insert / string_insert,
+           map_lookup / string_lookup);
+
+    free(probes);
+    free(ids);
+    return 0;
+}
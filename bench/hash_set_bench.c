@@ -0,0 +1,173 @@
+#include <hash_set.h>
+#include <hash_table.h>
+#include <time.h>
+
+#define DEFAULT_KEYS 1000000
+
+static int value = 1;
+
+/**
+ * @brief a table being intersected with another one through a scan
+ *
+ * @param other     table every scanned key is looked up in
+ * @param out       table receiving the shared keys
+ */
+typedef struct table_pair_t
+{
+    hash_table_t *other;
+    hash_table_t *out;
+} table_pair_t;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void keep_shared(const char *key, uint32_t len, void *data,
+                        void *context)
+{
+    table_pair_t *pair = (table_pair_t *)context;
+
+    (void)data;
+    if (NULL != hash_table_lookup_n(pair->other, key, len))
+    {
+        hash_table_add_n(pair->out, &value, key, len);
+    }
+}
+
+static void keep_missing(const char *key, uint32_t len, void *data,
+                         void *context)
+{
+    table_pair_t *pair = (table_pair_t *)context;
+
+    (void)data;
+    if (NULL == hash_table_lookup_n(pair->other, key, len))
+    {
+        hash_table_add_n(pair->out, &value, key, len);
+    }
+}
+
+static void keep_all(const char *key, uint32_t len, void *data,
+                     void *context)
+{
+    table_pair_t *pair = (table_pair_t *)context;
+
+    (void)data;
+    hash_table_add_n(pair->out, &value, key, len);
+}
+
+/**
+ * @brief calls callback for every entry of a table
+ */
+static void scan_all(hash_table_t *table, HASH_SCAN_F callback,
+                     void *context)
+{
+    uint64_t cursor = 0;
+
+    do
+    {
+        cursor = hash_table_scan(table, cursor, UINT32_MAX, callback,
+                                 context);
+    } while (0 != cursor);
+}
+
+/**
+ * @brief times one operation on tables used as sets, the way callers
+ *        built it before hash_set_t
+ */
+static double table_op(hash_table_t *a, hash_table_t *b, int op)
+{
+    double start = now_seconds();
+    table_pair_t pair = {b, NULL};
+
+    if (0 == op)
+    {
+        pair.out = hash_table_init(a->count, NULL);
+        scan_all(a, keep_shared, &pair);
+    }
+    else if (1 == op)
+    {
+        pair.out = hash_table_init(a->count + b->count, NULL);
+        scan_all(a, keep_all, &pair);
+        pair.other = a;
+        scan_all(b, keep_missing, &pair);
+    }
+    else
+    {
+        pair.out = hash_table_init(a->count, NULL);
+        scan_all(a, keep_missing, &pair);
+    }
+    double elapsed = now_seconds() - start;
+
+    hash_table_destroy(&pair.out);
+    return elapsed;
+}
+
+/**
+ * @brief times one operation on hash_set_t sets
+ */
+static double set_op(hash_set_t *a, hash_set_t *b, int op)
+{
+    double start = now_seconds();
+    hash_set_t *out = 0 == op ? hash_set_intersection(a, b) :
+                      1 == op ? hash_set_union(a, b) :
+                                hash_set_difference(a, b);
+    double elapsed = now_seconds() - start;
+
+    hash_set_destroy(&out);
+    return elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *names[] = {"intersection", "union", "difference"};
+    uint32_t n = DEFAULT_KEYS;
+    char key[64] = {0};
+    hash_table_stats_t stats = {0};
+
+    if (argc > 1)
+    {
+        n = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+
+    hash_table_t *table_a = hash_table_init(n, NULL);
+    hash_table_t *table_b = hash_table_init(n, NULL);
+    hash_set_t *set_a = hash_set_init(n);
+    hash_set_t *set_b = hash_set_init(n);
+    for (uint32_t x = 0; x < n; x++)
+    {
+        snprintf(key, sizeof(key), "user:%u", x);
+        hash_table_add(table_a, &value, key);
+        hash_set_add(set_a, key);
+        snprintf(key, sizeof(key), "user:%u", x + n / 2);
+        hash_table_add(table_b, &value, key);
+        hash_set_add(set_b, key);
+    }
+
+    printf("two sets of %u keys sharing %u\n", n, n - n / 2);
+    printf("%-13s %12s %12s\n", "operation", "table ms", "hash_set ms");
+    for (int op = 0; op < 3; op++)
+    {
+        printf("%-13s %12.1f %12.1f\n", names[op],
+               table_op(table_a, table_b, op) * 1e3,
+               set_op(set_a, set_b, op) * 1e3);
+    }
+    hash_table_stats(table_a, &stats);
+    printf("%-13s %12.0f %12.0f\n", "bytes/key",
+           (double)stats.bytes_used / n,
+           (double)(set_a->capacity * (sizeof(hash_set_slot_t) + 1) +
+                    set_a->live_bytes) /
+               n);
+
+    hash_table_destroy(&table_a);
+    hash_table_destroy(&table_b);
+    hash_set_destroy(&set_a);
+    hash_set_destroy(&set_b);
+
+    return 0;
+}
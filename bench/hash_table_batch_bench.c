@@ -0,0 +1,143 @@
+#include <hash_table.h>
+#include <time.h>
+
+#define DEFAULT_MAX_KEYS (1U << 22)
+#define MIN_KEYS (1U << 12)
+#define LOOKUPS (1U << 21)
+
+static const char *engine_names[] = {"chained", "swiss", "robin",
+                                     "cuckoo"};
+static const uint32_t batch_sizes[] = {32, 256};
+static volatile uint64_t sink = 0;
+static int value = 1;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static char **make_keys(uint32_t n)
+{
+    char **keys = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        char buffer[64] = {0};
+        snprintf(buffer, sizeof(buffer), "route:%u", x);
+        keys[x] = strdup(buffer);
+    }
+    return keys;
+}
+
+static void free_keys(char **keys, uint32_t n)
+{
+    for (uint32_t x = 0; x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+}
+
+/**
+ * @brief picks LOOKUPS keys at random out of the first n, so consecutive
+ *        lookups touch unrelated buckets
+ */
+static char **make_probes(char **keys, uint32_t n)
+{
+    char **probes = (char **)malloc(LOOKUPS * sizeof(char *));
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    for (uint32_t x = 0; NULL != probes && x < LOOKUPS; x++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        probes[x] = keys[(state >> 32) % n];
+    }
+    return probes;
+}
+
+/**
+ * @brief fills a table with n keys and prints lookup throughput of a
+ *        hash_table_lookup loop against hash_table_lookup_batch
+ */
+static void run(hash_engine_t engine, char **keys, uint32_t n)
+{
+    hash_table_opts_t opts = {.engine = engine};
+    hash_table_t *table = hash_table_init_ex(n, NULL, &opts);
+    char **probes = make_probes(keys, n);
+    void **out = (void **)malloc(LOOKUPS * sizeof(void *));
+    uint64_t found = 0;
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        hash_table_add(table, &value, keys[x]);
+    }
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < LOOKUPS; x++)
+    {
+        found += NULL != hash_table_lookup(table, probes[x]);
+    }
+    double single = LOOKUPS / (now_seconds() - start);
+    printf("%-8s %10u %12.0f", engine_names[engine], n, single);
+
+    for (size_t size = 0; size < sizeof(batch_sizes) / sizeof(batch_sizes[0]);
+         size++)
+    {
+        start = now_seconds();
+        for (uint32_t x = 0; x < LOOKUPS; x += batch_sizes[size])
+        {
+            hash_table_lookup_batch(table, probes + x, batch_sizes[size],
+                                    out + x);
+        }
+        double batched = LOOKUPS / (now_seconds() - start);
+        for (uint32_t x = 0; x < LOOKUPS; x++)
+        {
+            found += NULL != out[x];
+        }
+        printf(" %12.0f %6.2fx", batched, batched / single);
+    }
+    printf("\n");
+    sink += found;
+
+    free(out);
+    free(probes);
+    hash_table_destroy(&table);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t max_keys = DEFAULT_MAX_KEYS;
+    char **keys = NULL;
+
+    if (argc > 1)
+    {
+        max_keys = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (max_keys < MIN_KEYS)
+    {
+        max_keys = MIN_KEYS;
+    }
+
+    keys = make_keys(max_keys);
+    printf("%u random lookups per run, table sizes grow past the last level "
+           "cache\n",
+           LOOKUPS);
+    printf("%-8s %10s %12s %12s %7s %12s %7s\n", "engine", "keys",
+           "lookup/s", "batch32/s", "gain", "batch256/s", "gain");
+    for (int engine = HASH_ENGINE_CHAINED; engine <= HASH_ENGINE_CUCKOO;
+         engine++)
+    {
+        for (uint32_t n = MIN_KEYS; n <= max_keys; n *= 8)
+        {
+            run((hash_engine_t)engine, keys, n);
+        }
+    }
+    free_keys(keys, max_keys);
+
+    return 0;
+}
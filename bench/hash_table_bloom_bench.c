@@ -0,0 +1,111 @@
+#include <hash_table.h>
+#include <time.h>
+
+#define DEFAULT_KEYS (1U << 20)
+#define LOOKUPS (1U << 22)
+#define MISS_PERCENT 80
+
+static const char *engine_names[] = {"chained", "swiss", "robin",
+                                     "cuckoo"};
+static volatile uint64_t sink = 0;
+static int value = 1;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief builds LOOKUPS random probe keys, MISS_PERCENT of them absent
+ *        from a table holding "user:0" to "user:<n - 1>"
+ */
+static char **make_probes(uint32_t n)
+{
+    char **probes = (char **)malloc(LOOKUPS * sizeof(char *));
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    for (uint32_t x = 0; NULL != probes && x < LOOKUPS; x++)
+    {
+        char buffer[64] = {0};
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        snprintf(buffer, sizeof(buffer), "%s:%u",
+                 (state & 0xffff) % 100 < MISS_PERCENT ? "guest" : "user",
+                 (uint32_t)((state >> 32) % n));
+        probes[x] = strdup(buffer);
+    }
+    return probes;
+}
+
+/**
+ * @brief times the probes against a table of n keys with and without a
+ *        bloom filter in front
+ */
+static void run(hash_engine_t engine, char **probes, uint32_t n,
+                double fp_rate)
+{
+    hash_table_opts_t opts = {.engine = engine, .bloom_fp_rate = fp_rate};
+    hash_table_t *table = hash_table_init_ex(n, NULL, &opts);
+    hash_table_stats_t stats = {0};
+    char key[64] = {0};
+    uint64_t found = 0;
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        snprintf(key, sizeof(key), "user:%u", x);
+        hash_table_add(table, &value, key);
+    }
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < LOOKUPS; x++)
+    {
+        found += NULL != hash_table_lookup(table, probes[x]);
+    }
+    double elapsed = now_seconds() - start;
+    hash_table_stats(table, &stats);
+    printf("%-8s %8g %12.0f %9.1f %8.2f %9.1f%%\n", engine_names[engine],
+           fp_rate, LOOKUPS / elapsed, 1e9 * elapsed / LOOKUPS,
+           stats.mean_probes, 100.0 * stats.filtered / stats.lookups);
+    sink += found;
+
+    hash_table_destroy(&table);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t keys = DEFAULT_KEYS;
+    char **probes = NULL;
+
+    if (argc > 1)
+    {
+        keys = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (0 == keys)
+    {
+        keys = DEFAULT_KEYS;
+    }
+
+    probes = make_probes(keys);
+    printf("%u lookups on %u keys, %d%% of them misses\n", LOOKUPS, keys,
+           MISS_PERCENT);
+    printf("%-8s %8s %12s %9s %8s %10s\n", "engine", "fp_rate", "lookup/s",
+           "ns", "probes", "filtered");
+    for (int engine = HASH_ENGINE_CHAINED; engine <= HASH_ENGINE_CUCKOO;
+         engine++)
+    {
+        run((hash_engine_t)engine, probes, keys, 0);
+        run((hash_engine_t)engine, probes, keys, 0.01);
+    }
+    for (uint32_t x = 0; x < LOOKUPS; x++)
+    {
+        free(probes[x]);
+    }
+    free(probes);
+
+    return 0;
+}
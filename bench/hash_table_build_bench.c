@@ -0,0 +1,89 @@
+#include <hash_table.h>
+#include <time.h>
+
+#define DEFAULT_KEYS (1U << 22)
+
+static int value = 1;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief prints how long a load of n keys took and destroys the table
+ */
+static void report(const char *name, hash_table_t *table, double elapsed,
+                   uint32_t n)
+{
+    printf("%-22s %10.1f %12.0f %8s\n", name, elapsed * 1e3, n / elapsed,
+           NULL != table && n == table->count ? "ok" : "FAILED");
+    hash_table_destroy(&table);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = DEFAULT_KEYS;
+    uint32_t max_threads = 8;
+    char key[64] = {0};
+    char name[32] = {0};
+
+    if (argc > 1)
+    {
+        n = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2)
+    {
+        max_threads = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+
+    char **keys = (char **)malloc(n * sizeof(char *));
+    void **values = (void **)malloc(n * sizeof(void *));
+    for (uint32_t x = 0; NULL != keys && NULL != values && x < n; x++)
+    {
+        snprintf(key, sizeof(key), "dataset:row:%u", x);
+        keys[x] = strdup(key);
+        values[x] = &value;
+    }
+
+    printf("%u keys loaded\n", n);
+    printf("%-22s %10s %12s %8s\n", "load", "ms", "keys/s", "");
+
+    double start = now_seconds();
+    hash_table_t *table = hash_table_init(1, NULL);
+    for (uint32_t x = 0; x < n; x++)
+    {
+        hash_table_add(table, values[x], keys[x]);
+    }
+    report("hash_table_add", table, now_seconds() - start, n);
+
+    start = now_seconds();
+    table = hash_table_init(n, NULL);
+    for (uint32_t x = 0; x < n; x++)
+    {
+        hash_table_add(table, values[x], keys[x]);
+    }
+    report("hash_table_add presized", table, now_seconds() - start, n);
+
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        start = now_seconds();
+        table = hash_table_build(keys, values, n, NULL, NULL, threads);
+        snprintf(name, sizeof(name), "hash_table_build x%u", threads);
+        report(name, table, now_seconds() - start, n);
+    }
+
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+    free(values);
+
+    return 0;
+}
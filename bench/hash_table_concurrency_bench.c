@@ -0,0 +1,204 @@
+#include <hash_table.h>
+#include <pthread.h>
+#include <time.h>
+
+#define DEFAULT_KEYS 100000
+#define DEFAULT_OPS 1000000
+#define MAX_THREADS 64
+#define WRITE_KEYS 1024
+
+/**
+ * @brief a table shared by the benchmark threads
+ *
+ * @param table     the table
+ * @param global    wraps every call in one mutex when set, the way a table
+ *                  without a sync mode has to be shared
+ * @param lock      the global mutex
+ */
+typedef struct shared_table_t
+{
+    hash_table_t *table;
+    int global;
+    pthread_mutex_t lock;
+} shared_table_t;
+
+/**
+ * @brief work handed to one benchmark thread
+ *
+ * @param shared        table being benchmarked
+ * @param keys          prefilled keys the reads look up
+ * @param n             number of prefilled keys
+ * @param id            thread number, picks the keys the writes toggle
+ * @param ops           number of operations to run
+ * @param write_percent share of operations that are writes
+ */
+typedef struct worker_t
+{
+    shared_table_t *shared;
+    char **keys;
+    uint32_t n;
+    uint32_t id;
+    uint32_t ops;
+    uint32_t write_percent;
+} worker_t;
+
+static volatile uint64_t sink = 0;
+static int value = 1;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static char **make_keys(uint32_t n)
+{
+    char **keys = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        char buffer[64] = {0};
+        snprintf(buffer, sizeof(buffer), "session:%u", x);
+        keys[x] = strdup(buffer);
+    }
+    return keys;
+}
+
+static void free_keys(char **keys, uint32_t n)
+{
+    for (uint32_t x = 0; x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+}
+
+/**
+ * @brief runs the read/write mix: reads look up a prefilled key, writes
+ *        remove one of the thread's own keys if present and add it otherwise
+ */
+static void *worker_run(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    shared_table_t *shared = worker->shared;
+    uint64_t state = 0x9e3779b97f4a7c15ULL * (worker->id + 1);
+    uint64_t found = 0;
+    char key[64] = {0};
+
+    for (uint32_t x = 0; x < worker->ops; x++)
+    {
+        // xorshift keeps the key choice cheap and independent per thread
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        if (shared->global)
+        {
+            pthread_mutex_lock(&shared->lock);
+        }
+        if (state % 100 < worker->write_percent)
+        {
+            snprintf(key, sizeof(key), "writer:%u:%u", worker->id,
+                     (uint32_t)(state >> 32) % WRITE_KEYS);
+            if (SUCCESS != hash_table_remove(shared->table, key))
+            {
+                hash_table_add(shared->table, &value, key);
+            }
+        }
+        else
+        {
+            found += NULL != hash_table_lookup(
+                                 shared->table,
+                                 worker->keys[(state >> 32) % worker->n]);
+        }
+        if (shared->global)
+        {
+            pthread_mutex_unlock(&shared->lock);
+        }
+    }
+    sink += found;
+
+    return NULL;
+}
+
+/**
+ * @brief prefills a table, runs the mix on the given number of threads and
+ *        returns the combined throughput in operations per second
+ */
+static double run(hash_sync_t sync, uint32_t threads, uint32_t write_percent,
+                  char **keys, uint32_t n, uint32_t ops)
+{
+    hash_table_opts_t opts = {.sync = sync};
+    shared_table_t shared = {.global = HASH_SYNC_NONE == sync};
+    pthread_t handles[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+
+    shared.table = hash_table_init_ex(n, NULL, &opts);
+    pthread_mutex_init(&shared.lock, NULL);
+    for (uint32_t x = 0; x < n; x++)
+    {
+        hash_table_add(shared.table, &value, keys[x]);
+    }
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        workers[x] = (worker_t){&shared, keys, n, x, ops / threads,
+                                write_percent};
+        pthread_create(&handles[x], NULL, worker_run, &workers[x]);
+    }
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        pthread_join(handles[x], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    pthread_mutex_destroy(&shared.lock);
+    hash_table_destroy(&shared.table);
+
+    return (ops / threads) * threads / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t max_threads = 8;
+    uint32_t n = DEFAULT_KEYS;
+    uint32_t ops = DEFAULT_OPS;
+    uint32_t mixes[] = {5, 50};
+    char **keys = NULL;
+
+    if (argc > 1)
+    {
+        max_threads = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2)
+    {
+        ops = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if (0 == max_threads || max_threads > MAX_THREADS)
+    {
+        max_threads = MAX_THREADS;
+    }
+
+    keys = make_keys(n);
+    for (uint32_t mix = 0; mix < sizeof(mixes) / sizeof(mixes[0]); mix++)
+    {
+        printf("\n%u/%u read/write mix (%u keys, %u operations)\n",
+               100 - mixes[mix], mixes[mix], n, ops);
+        printf("%-8s %14s %14s %14s\n", "threads", "global ops/s",
+               "striped ops/s", "rcu ops/s");
+        for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+        {
+            printf("%-8u %14.0f %14.0f %14.0f\n", threads,
+                   run(HASH_SYNC_NONE, threads, mixes[mix], keys, n, ops),
+                   run(HASH_SYNC_STRIPED, threads, mixes[mix], keys, n, ops),
+                   run(HASH_SYNC_RCU, threads, mixes[mix], keys, n, ops));
+        }
+    }
+    free_keys(keys, n);
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <hash_table.h>
+#include <time.h>
+
+#define DEFAULT_KEYS (1U << 20)
+#define LOOKUPS (1U << 20)
+
+static const char *engine_names[] = {"chained", "swiss", "robin",
+                                     "cuckoo"};
+static volatile uint64_t sink = 0;
+
+/**
+ * @brief nanoseconds elapsed on the monotonic clock
+ */
+static uint64_t now_nanoseconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static char **make_keys(uint32_t n)
+{
+    char **keys = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        char buffer[64] = {0};
+        snprintf(buffer, sizeof(buffer), "session:%u", x);
+        keys[x] = strdup(buffer);
+    }
+    return keys;
+}
+
+static void free_keys(char **keys, uint32_t n)
+{
+    for (uint32_t x = 0; x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t left = *(const uint64_t *)a;
+    uint64_t right = *(const uint64_t *)b;
+    return (left > right) - (left < right);
+}
+
+/**
+ * @brief fills a table to 90% of its slots, times every lookup on its own
+ *        and prints the median and tail latencies
+ */
+static void run(hash_engine_t engine, char **keys, uint32_t n)
+{
+    hash_table_opts_t opts = {.engine = engine};
+    hash_table_t *table = hash_table_init_ex(n, NULL, &opts);
+    uint64_t *samples = (uint64_t *)malloc(LOOKUPS * sizeof(uint64_t));
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint32_t filled = n - n / 10;
+    uint32_t max_probe = 0;
+    uint64_t found = 0;
+
+    for (uint32_t x = 0; x < filled; x++)
+    {
+        hash_table_add(table, keys, keys[x]);
+    }
+
+    for (uint32_t x = 0; x < LOOKUPS; x++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint64_t start = now_nanoseconds();
+        found += NULL != hash_table_lookup(table, keys[(state >> 32) % n]);
+        samples[x] = now_nanoseconds() - start;
+    }
+    sink += found;
+    qsort(samples, LOOKUPS, sizeof(uint64_t), compare_u64);
+
+    printf("%-8s %10u %8lu %8lu %8lu %8lu", engine_names[engine], filled,
+           (unsigned long)samples[LOOKUPS / 2],
+           (unsigned long)samples[LOOKUPS - LOOKUPS / 100],
+           (unsigned long)samples[LOOKUPS - LOOKUPS / 1000],
+           (unsigned long)samples[LOOKUPS - 1]);
+    if (SUCCESS == hash_table_probe_stats(table, &max_probe, NULL))
+    {
+        printf(" %9u", max_probe);
+    }
+    printf("\n");
+
+    free(samples);
+    hash_table_destroy(&table);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = DEFAULT_KEYS;
+    char **keys = NULL;
+
+    if (argc > 1)
+    {
+        n = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (0 == n)
+    {
+        n = DEFAULT_KEYS;
+    }
+
+    keys = make_keys(n);
+    printf("%u single lookups, about 10%% of them misses, latency in ns\n",
+           LOOKUPS);
+    printf("%-8s %10s %8s %8s %8s %8s %9s\n", "engine", "keys", "p50",
+           "p99", "p99.9", "max", "max probe");
+    for (int engine = HASH_ENGINE_CHAINED; engine <= HASH_ENGINE_CUCKOO;
+         engine++)
+    {
+        run((hash_engine_t)engine, keys, n);
+    }
+    free_keys(keys, n);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <hash_table.h>
+#include <time.h>
+
+#define DEFAULT_KEYS (1U << 22)
+#define LOOKUPS (1U << 20)
+
+static volatile uint64_t sink = 0;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static char **make_keys(uint32_t n)
+{
+    char **keys = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        char buffer[64] = {0};
+        snprintf(buffer, sizeof(buffer), "account:%u", x);
+        keys[x] = strdup(buffer);
+    }
+    return keys;
+}
+
+static void free_keys(char **keys, uint32_t n)
+{
+    for (uint32_t x = 0; x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+}
+
+/**
+ * @brief times LOOKUPS random lookups and returns lookups per second
+ */
+static double time_lookups(hash_table_t *table, char **keys, uint32_t n)
+{
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    uint64_t found = 0;
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < LOOKUPS; x++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        found += NULL != hash_table_lookup(table, keys[(state >> 32) % n]);
+    }
+    double elapsed = now_seconds() - start;
+    sink += found;
+
+    return LOOKUPS / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = DEFAULT_KEYS;
+    const char *path = "hash_table_snapshot_bench.snapshot";
+    uint64_t *values = NULL;
+    char **keys = NULL;
+
+    if (argc > 1)
+    {
+        n = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2)
+    {
+        path = argv[2];
+    }
+    if (0 == n)
+    {
+        n = DEFAULT_KEYS;
+    }
+
+    keys = make_keys(n);
+    values = (uint64_t *)malloc(n * sizeof(uint64_t));
+    for (uint32_t x = 0; x < n; x++)
+    {
+        values[x] = x;
+    }
+
+    double start = now_seconds();
+    hash_table_t *table = hash_table_init(n, NULL);
+    for (uint32_t x = 0; x < n; x++)
+    {
+        hash_table_add(table, &values[x], keys[x]);
+    }
+    double rebuild = now_seconds() - start;
+
+    start = now_seconds();
+    int saved = hash_table_save(table, path, sizeof(uint64_t));
+    double save = now_seconds() - start;
+
+    start = now_seconds();
+    hash_table_t *mapped = hash_table_open_mapped(path);
+    double open = now_seconds() - start;
+
+    if (SUCCESS != saved || NULL == mapped)
+    {
+        fprintf(stderr, "could not save or map %s\n", path);
+    }
+    else
+    {
+        printf("%u keys, snapshot at %s\n", n, path);
+        printf("%-28s %10.3f s\n", "rebuild with hash_table_add", rebuild);
+        printf("%-28s %10.3f s\n", "hash_table_save", save);
+        printf("%-28s %10.6f s\n", "hash_table_open_mapped", open);
+        // the first pass pays the page faults of a cold start
+        printf("%-28s %10.0f lookup/s\n", "mapped, first pass",
+               time_lookups(mapped, keys, n));
+        printf("%-28s %10.0f lookup/s\n", "mapped, warm",
+               time_lookups(mapped, keys, n));
+        printf("%-28s %10.0f lookup/s\n", "rebuilt table",
+               time_lookups(table, keys, n));
+    }
+
+    hash_table_destroy(&mapped);
+    hash_table_destroy(&table);
+    remove(path);
+    free(values);
+    free_keys(keys, n);
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <hash_table_wal.h>
+#include <time.h>
+
+#define DEFAULT_KEYS 1000000
+#define DEFAULT_COMMIT_KEYS 20000
+#define MAX_THREADS 64
+
+/**
+ * @brief work handed to one benchmark thread
+ *
+ * @param wal       log to add through
+ * @param keys      keys to add
+ * @param first     first key of the thread
+ * @param last      one past the last key of the thread
+ */
+typedef struct worker_t
+{
+    hash_table_wal_t *wal;
+    char **keys;
+    uint32_t first;
+    uint32_t last;
+} worker_t;
+
+static const char *path = "hash_table_wal_bench.log";
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void *add_keys(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+
+    for (uint32_t x = worker->first; x < worker->last; x++)
+    {
+        hash_table_wal_add(worker->wal, &worker->keys[x], worker->keys[x]);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief adds n keys through a fresh log from the given number of threads,
+ *        optionally compacting all along, and prints the throughput
+ */
+static void run(const char *name, wal_fsync_t fsync, char **keys, uint32_t n,
+                uint32_t threads, int compact)
+{
+    pthread_t ids[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    hash_table_t *table = hash_table_init(n, NULL);
+    hash_table_wal_opts_t opts = {.fsync = fsync,
+                                  .value_size = sizeof(char *)};
+    hash_table_wal_t *wal = NULL;
+    uint32_t compactions = 0;
+
+    remove(path);
+    wal = hash_table_wal_open(path, table, &opts);
+    if (NULL == wal)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        hash_table_destroy(&table);
+        return;
+    }
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        workers[x] = (worker_t){wal, keys,
+                                (uint32_t)((uint64_t)n * x / threads),
+                                (uint32_t)((uint64_t)n * (x + 1) / threads)};
+        pthread_create(&ids[x], NULL, add_keys, &workers[x]);
+    }
+    for (uint32_t x = 0; compact && x < 4; x++)
+    {
+        compactions += SUCCESS == hash_table_wal_compact(wal);
+    }
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        pthread_join(ids[x], NULL);
+    }
+    hash_table_wal_sync(wal);
+    double elapsed = now_seconds() - start;
+
+    printf("%-20s %7u %12.0f %11u\n", name, threads, n / elapsed,
+           compactions);
+    hash_table_wal_close(&wal);
+    hash_table_destroy(&table);
+    remove(path);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = DEFAULT_KEYS;
+    uint32_t commit_n = DEFAULT_COMMIT_KEYS;
+    uint32_t max_threads = 8;
+    char buffer[64] = {0};
+
+    if (argc > 1)
+    {
+        n = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2)
+    {
+        max_threads = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if (0 == max_threads || max_threads > MAX_THREADS)
+    {
+        max_threads = MAX_THREADS;
+    }
+    if (commit_n > n)
+    {
+        commit_n = n;
+    }
+
+    char **keys = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        snprintf(buffer, sizeof(buffer), "session:%u:user", x);
+        keys[x] = strdup(buffer);
+    }
+
+    printf("%u keys, %u for commit fsync\n", n, commit_n);
+    printf("%-20s %7s %12s %11s\n", "fsync", "threads", "adds/s",
+           "compactions");
+    run("none", WAL_FSYNC_NONE, keys, n, 1, 0);
+    run("interval", WAL_FSYNC_INTERVAL, keys, n, 1, 0);
+    run("interval+compaction", WAL_FSYNC_INTERVAL, keys, n, 1, 1);
+    // commit fsync pays one fsync per group of concurrent adds
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        run("commit", WAL_FSYNC_COMMIT, keys, commit_n, threads, 0);
+    }
+
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+
+    return 0;
+}
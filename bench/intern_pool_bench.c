@@ -0,0 +1,152 @@
+#include <intern_pool.h>
+#include <time.h>
+
+#define DEFAULT_TOKENS 4000000
+#define DISTINCT 4096
+#define MAX_THREADS 64
+
+/**
+ * @brief work handed to one benchmark thread
+ *
+ * @param pool      pool to intern into
+ * @param tokens    strings to intern
+ * @param first     first token of the thread
+ * @param last      one past the last token of the thread
+ */
+typedef struct worker_t
+{
+    intern_pool_t *pool;
+    char **tokens;
+    uint32_t first;
+    uint32_t last;
+} worker_t;
+
+static volatile uint64_t sink = 0;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void *intern_tokens(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+
+    for (uint32_t x = worker->first; x < worker->last; x++)
+    {
+        intern_pool_intern(worker->pool, worker->tokens[x],
+                           strlen(worker->tokens[x]));
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief interns every token from the given number of threads and prints
+ *        the throughput
+ */
+static void run(const char *name, int shared, char **tokens, uint32_t n,
+                uint32_t threads)
+{
+    pthread_t ids[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    intern_pool_t *pool = intern_pool_init(DISTINCT, shared);
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        workers[x] = (worker_t){pool, tokens,
+                                (uint32_t)((uint64_t)n * x / threads),
+                                (uint32_t)((uint64_t)n * (x + 1) / threads)};
+        pthread_create(&ids[x], NULL, intern_tokens, &workers[x]);
+    }
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        pthread_join(ids[x], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("%-16s %7u %12.0f\n", name, threads, n / elapsed);
+    intern_pool_destroy(&pool);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = DEFAULT_TOKENS;
+    uint32_t max_threads = 8;
+    char buffer[64] = {0};
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    uint64_t equal = 0;
+
+    if (argc > 1)
+    {
+        n = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2)
+    {
+        max_threads = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if (0 == max_threads || max_threads > MAX_THREADS)
+    {
+        max_threads = MAX_THREADS;
+    }
+
+    // every token is a separate copy of one of DISTINCT strings
+    char **tokens = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != tokens && x < n; x++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        snprintf(buffer, sizeof(buffer), "segment:audience:%u",
+                 (uint32_t)(state % DISTINCT));
+        tokens[x] = strdup(buffer);
+    }
+
+    printf("%u tokens of %u distinct strings\n", n, DISTINCT);
+    printf("%-16s %7s %12s\n", "pool", "threads", "interns/s");
+    run("private", 0, tokens, n, 1);
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        run("shared", 1, tokens, n, threads);
+    }
+
+    // comparing neighbouring tokens: strcmp on the copies, then pointer
+    // compares on their canonical strings
+    intern_pool_t *pool = intern_pool_init(DISTINCT, 0);
+    const char **interned = (const char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != interned && x < n; x++)
+    {
+        interned[x] = intern_pool_intern(pool, tokens[x], strlen(tokens[x]));
+    }
+    double start = now_seconds();
+    for (uint32_t x = 1; x < n; x++)
+    {
+        equal += 0 == strcmp(tokens[x - 1], tokens[x]);
+    }
+    double by_strcmp = now_seconds() - start;
+    start = now_seconds();
+    for (uint32_t x = 1; x < n; x++)
+    {
+        equal += interned[x - 1] == interned[x];
+    }
+    double by_pointer = now_seconds() - start;
+    sink = equal;
+    printf("equality: strcmp %.1f ms, pointer %.1f ms\n", by_strcmp * 1e3,
+           by_pointer * 1e3);
+
+    free(interned);
+    intern_pool_destroy(&pool);
+    for (uint32_t x = 0; NULL != tokens && x < n; x++)
+    {
+        free(tokens[x]);
+    }
+    free(tokens);
+
+    return 0;
+}
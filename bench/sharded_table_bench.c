@@ -0,0 +1,183 @@
+#include <sharded_table.h>
+#include <time.h>
+
+#define DEFAULT_KEYS 2000000
+#define MAX_THREADS 64
+
+/**
+ * @brief the ways of sharing an ingest between threads that are compared
+ */
+typedef enum ingest_t
+{
+    INGEST_STRIPED,
+    INGEST_LOCKED,
+    INGEST_PRIVATE
+} ingest_t;
+
+static const char *ingest_names[] = {"striped table", "locked shards",
+                                     "private+merge"};
+
+/**
+ * @brief work handed to one benchmark thread
+ *
+ * @param striped   table shared through HASH_SYNC_STRIPED
+ * @param sharded   sharded table
+ * @param ingest    which of the two is used, and how
+ * @param keys      keys to add
+ * @param id        thread number, adds every key whose index it matches
+ *                  modulo threads
+ * @param threads   number of threads
+ * @param n         number of keys
+ */
+typedef struct worker_t
+{
+    hash_table_t *striped;
+    sharded_table_t *sharded;
+    ingest_t ingest;
+    char **keys;
+    uint32_t id;
+    uint32_t threads;
+    uint32_t n;
+} worker_t;
+
+static int value = 1;
+
+/**
+ * @brief seconds elapsed on the monotonic clock
+ */
+static double now_seconds(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static char **make_keys(uint32_t n)
+{
+    char **keys = (char **)malloc(n * sizeof(char *));
+    for (uint32_t x = 0; NULL != keys && x < n; x++)
+    {
+        char buffer[64] = {0};
+        snprintf(buffer, sizeof(buffer), "event:%u", x);
+        keys[x] = strdup(buffer);
+    }
+    return keys;
+}
+
+static void free_keys(char **keys, uint32_t n)
+{
+    for (uint32_t x = 0; x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+}
+
+static void *ingest(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+
+    for (uint32_t x = worker->id; x < worker->n; x += worker->threads)
+    {
+        switch (worker->ingest)
+        {
+        case INGEST_STRIPED:
+            hash_table_add(worker->striped, &value, worker->keys[x]);
+            break;
+        case INGEST_LOCKED:
+            sharded_table_add(worker->sharded, &value, worker->keys[x]);
+            break;
+        case INGEST_PRIVATE:
+            sharded_table_add_local(worker->sharded, worker->id, &value,
+                                    worker->keys[x]);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief adds n keys from the given number of threads and prints the
+ *        throughput, counting the merge of a private ingest
+ */
+static void run(ingest_t mode, char **keys, uint32_t n, uint32_t threads)
+{
+    pthread_t ids[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    hash_table_opts_t opts = {.sync = HASH_SYNC_STRIPED};
+    hash_table_t *striped = NULL;
+    sharded_table_t *sharded = NULL;
+    double merge = 0;
+
+    if (INGEST_STRIPED == mode)
+    {
+        striped = hash_table_init_ex(n, NULL, &opts);
+    }
+    else
+    {
+        sharded = sharded_table_init(threads, n, NULL,
+                                     INGEST_PRIVATE == mode ?
+                                         SHARD_MODE_PRIVATE :
+                                         SHARD_MODE_LOCKED,
+                                     NULL);
+    }
+
+    double start = now_seconds();
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        workers[x] = (worker_t){striped, sharded, mode, keys, x, threads, n};
+        pthread_create(&ids[x], NULL, ingest, &workers[x]);
+    }
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        pthread_join(ids[x], NULL);
+    }
+    if (INGEST_PRIVATE == mode)
+    {
+        merge = now_seconds();
+        sharded_table_merge(sharded, threads);
+        merge = now_seconds() - merge;
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("%-14s %7u %12.0f %9.3f\n", ingest_names[mode], threads,
+           n / elapsed, merge);
+
+    hash_table_destroy(&striped);
+    sharded_table_destroy(&sharded);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = DEFAULT_KEYS;
+    uint32_t max_threads = 8;
+    char **keys = NULL;
+
+    if (argc > 1)
+    {
+        max_threads = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2)
+    {
+        n = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if (0 == max_threads || max_threads > MAX_THREADS)
+    {
+        max_threads = MAX_THREADS;
+    }
+
+    keys = make_keys(n);
+    printf("%u keys added, one shard per thread\n", n);
+    printf("%-14s %7s %12s %9s\n", "ingest", "threads", "adds/s", "merge s");
+    for (int mode = INGEST_STRIPED; mode <= INGEST_PRIVATE; mode++)
+    {
+        for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+        {
+            run((ingest_t)mode, keys, n, threads);
+        }
+    }
+    free_keys(keys, n);
+
+    return 0;
+}
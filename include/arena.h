@@ -0,0 +1,141 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SUCCESS 0
+#define FAILURE 1
+
+/**
+ * @brief structure of an arena chunk
+ *
+ * @param next      pointer to the previously filled chunk
+ * @param size      number of usable bytes in the chunk
+ * @param used      number of bytes handed out so far
+ * @param bytes     the chunk memory
+ */
+typedef struct arena_chunk_t
+{
+    struct arena_chunk_t *next;
+    size_t size;
+    size_t used;
+    _Alignas(16) unsigned char bytes[];
+} arena_chunk_t;
+
+/**
+ * @brief structure of an arena_t object
+ *
+ * A bump allocator: allocations are carved out of the current chunk and a
+ * new chunk is chained in front once it runs out. Individual allocations
+ * are never freed; arena_clear releases everything at once in O(chunks).
+ *
+ * @param head          chunk currently being filled
+ * @param chunk_size    usable bytes per chunk
+ * @param allocated     total bytes held in chunks
+ */
+typedef struct arena_t
+{
+    arena_chunk_t *head;
+    size_t chunk_size;
+    size_t allocated;
+} arena_t;
+
+/**
+ * @brief structure of a slab_t object
+ *
+ * Hands out fixed size objects from arena chunks. Freed objects are kept on
+ * a free list threaded through their first bytes and handed out again
+ * before the arena is bumped.
+ *
+ * @param arena         arena the objects are carved from
+ * @param object_size   size of each object, rounded up to hold a pointer
+ * @param free_list     most recently freed object
+ */
+typedef struct slab_t
+{
+    arena_t *arena;
+    size_t object_size;
+    void *free_list;
+} slab_t;
+
+/**
+ * @brief creates a new arena
+ *
+ * @param chunk_size usable bytes per chunk
+ * @return pointer to allocated arena on success, NULL on failure
+ */
+arena_t *arena_init(size_t chunk_size);
+
+/**
+ * @brief allocates size bytes aligned to 16 bytes
+ *
+ * Requests larger than the chunk size get a dedicated chunk.
+ *
+ * @param arena arena to allocate from
+ * @param size number of bytes
+ * @return pointer to the memory on success, NULL on failure
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * @brief releases every allocation, keeping one chunk for reuse
+ *
+ * @param arena arena to clear
+ * @return 0 on success, non-zero value on failure
+ */
+int arena_clear(arena_t *arena);
+
+/**
+ * @brief destroys an arena and all of its chunks
+ *
+ * @param arena_addr pointer to arena pointer
+ * @return 0 on success, non-zero value on failure
+ */
+int arena_destroy(arena_t **arena_addr);
+
+/**
+ * @brief creates a new slab
+ *
+ * @param object_size size of each object
+ * @param objects_per_chunk number of objects carved from each chunk
+ * @return pointer to allocated slab on success, NULL on failure
+ */
+slab_t *slab_init(size_t object_size, uint32_t objects_per_chunk);
+
+/**
+ * @brief allocates one object, reusing freed objects first
+ *
+ * @param slab slab to allocate from
+ * @return pointer to the object on success, NULL on failure
+ */
+void *slab_alloc(slab_t *slab);
+
+/**
+ * @brief returns an object to the slab's free list
+ *
+ * @param slab slab the object was allocated from
+ * @param object object to free
+ */
+void slab_free(slab_t *slab, void *object);
+
+/**
+ * @brief releases every object at once
+ *
+ * @param slab slab to clear
+ * @return 0 on success, non-zero value on failure
+ */
+int slab_clear(slab_t *slab);
+
+/**
+ * @brief destroys a slab and all of its chunks
+ *
+ * @param slab_addr pointer to slab pointer
+ * @return 0 on success, non-zero value on failure
+ */
+int slab_destroy(slab_t **slab_addr);
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef _BLOOM_H
+#define _BLOOM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hash_func.h>
+
+#define SUCCESS 0
+#define FAILURE 1
+
+/**
+ * @brief number of 64 bit words in a bloom filter block, one cache line
+ */
+#define BLOOM_BLOCK_WORDS 8
+
+/**
+ * @brief most bits a bloom filter sets per key
+ */
+#define BLOOM_MAX_HASHES 16
+
+/**
+ * @brief one cache line of a bloom filter
+ *
+ * @param words the 512 bits of the block
+ */
+typedef struct bloom_block_t
+{
+    uint64_t words[BLOOM_BLOCK_WORDS];
+} __attribute__((aligned(64))) bloom_block_t;
+
+/**
+ * @brief structure of a bloom_t object
+ *
+ * A blocked bloom filter: the high half of a key's 64 bit hash picks one
+ * cache line sized block and the low half picks the bits set inside it, so
+ * adding or testing a key touches a single cache line however many bits
+ * it sets. Keys are never removed; a filter over a changing set is rebuilt
+ * from the keys still present.
+ *
+ * The size is chosen for capacity keys at fp_rate false positives; adding
+ * more keys keeps every answer for a present key correct but raises the
+ * false positive rate.
+ *
+ * @param blocks        the filter blocks
+ * @param block_count   number of blocks
+ * @param hashes        bits set per key
+ * @param capacity      number of keys the filter was sized for
+ * @param count         number of keys added, counting repeats
+ * @param fp_rate       false positive rate the filter was sized for
+ * @param seed          random seed used by bloom_add and bloom_contains
+ */
+typedef struct bloom_t
+{
+    bloom_block_t *blocks;
+    uint32_t block_count;
+    uint32_t hashes;
+    uint32_t capacity;
+    uint32_t count;
+    double fp_rate;
+    uint64_t seed[2];
+} bloom_t;
+
+/**
+ * @brief initializes a bloom filter
+ *
+ * @param capacity number of keys to size the filter for
+ * @param fp_rate target false positive rate, above 0 and below 1
+ *
+ * @return bloom_t pointer to allocated filter, NULL on failure or when
+ *         fp_rate is out of range
+ */
+bloom_t *bloom_init(uint32_t capacity, double fp_rate);
+
+/**
+ * @brief adds a key to the filter by its 64 bit hash
+ *
+ * @param bloom pointer to filter address
+ * @param hash well mixed 64 bit hash of the key
+ */
+void bloom_add_hash(bloom_t *bloom, uint64_t hash);
+
+/**
+ * @brief tests a key against the filter by its 64 bit hash
+ *
+ * @param bloom pointer to filter address
+ * @param hash well mixed 64 bit hash of the key
+ *
+ * @return 0 when the key was never added, non-zero when it may have been
+ */
+int bloom_contains_hash(const bloom_t *bloom, uint64_t hash);
+
+/**
+ * @brief adds a key of len bytes to the filter
+ *
+ * @param bloom pointer to filter address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return int exit code
+ */
+int bloom_add(bloom_t *bloom, const void *key, size_t len);
+
+/**
+ * @brief tests a key of len bytes against the filter
+ *
+ * @param bloom pointer to filter address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return 0 when the key was never added, non-zero when it may have been
+ */
+int bloom_contains(const bloom_t *bloom, const void *key, size_t len);
+
+/**
+ * @brief removes every key from the filter
+ *
+ * @param bloom pointer to filter address
+ *
+ * @return int exit code
+ */
+int bloom_clear(bloom_t *bloom);
+
+/**
+ * @brief destroys the filter
+ *
+ * @param bloom_addr pointer to filter address
+ *
+ * @return int exit code
+ */
+int bloom_destroy(bloom_t **bloom_addr);
+
+#endif
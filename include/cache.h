@@ -0,0 +1,305 @@
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <hash_table.h>
+
+/**
+ * @brief which entry a full cache evicts
+ *
+ * @param CACHE_POLICY_LRU  the least recently used entry
+ * @param CACHE_POLICY_SLRU segmented LRU: new entries start on probation
+ *                          and move to a protected segment, holding up to
+ *                          4/5 of the capacity, when they are hit again.
+ *                          Probation is evicted first, so a scan of keys
+ *                          read once cannot flush the entries in use
+ * @param CACHE_POLICY_LFU  the least frequently used entry, the least
+ *                          recently used one among equally frequent ones
+ */
+typedef enum cache_policy_t
+{
+    CACHE_POLICY_LRU,
+    CACHE_POLICY_SLRU,
+    CACHE_POLICY_LFU
+} cache_policy_t;
+
+/**
+ * @brief A function pointer called for every entry a cache evicts to make
+ *        room. It receives the evicted data and takes over freeing it.
+ *
+ * @param key key bytes of the entry, NUL terminated
+ * @param len number of bytes in key
+ * @param data data stored at key
+ * @param context pointer set in cache_opts_t
+ */
+typedef void (*CACHE_EVICT_F)(const char *key, uint32_t len, void *data,
+                              void *context);
+
+/**
+ * @brief options accepted by cache_init_ex; zero values select defaults
+ *
+ * @param policy    eviction policy, defaults to CACHE_POLICY_LRU
+ * @param max_bytes limit on the sum of the sizes given to cache_put, 0
+ *                  for no limit
+ * @param on_evict  called for every evicted entry; when NULL evicted data
+ *                  is freed with the cache's customfree
+ * @param context   pointer passed through to on_evict
+ */
+typedef struct cache_opts_t
+{
+    cache_policy_t policy;
+    size_t max_bytes;
+    CACHE_EVICT_F on_evict;
+    void *context;
+} cache_opts_t;
+
+/**
+ * @brief structure of a cache entry, linked into its recency list
+ *
+ * @param prev      more recently used neighbour
+ * @param next      less recently used neighbour
+ * @param freq      frequency list the entry is on, CACHE_POLICY_LFU only
+ * @param data      saved data pointer
+ * @param bytes     size given for data by cache_put
+ * @param segment   0 on probation, 1 protected, CACHE_POLICY_SLRU only
+ * @param key_len   number of bytes in key
+ * @param key       copy of the key, NUL terminated, used to drop the entry
+ *                  from the index when it is evicted
+ */
+typedef struct cache_entry_t
+{
+    struct cache_entry_t *prev;
+    struct cache_entry_t *next;
+    struct cache_freq_t *freq;
+    void *data;
+    size_t bytes;
+    uint32_t segment;
+    uint32_t key_len;
+    char key[];
+} cache_entry_t;
+
+/**
+ * @brief a doubly linked list of cache entries, most recent first
+ *
+ * @param head  most recently used entry
+ * @param tail  least recently used entry
+ * @param count number of entries
+ * @param bytes sum of the sizes of the entries
+ */
+typedef struct cache_list_t
+{
+    cache_entry_t *head;
+    cache_entry_t *tail;
+    uint32_t count;
+    size_t bytes;
+} cache_list_t;
+
+/**
+ * @brief the entries of a CACHE_POLICY_LFU cache used equally often
+ *
+ * @param prev      list of the next lower frequency
+ * @param next      list of the next higher frequency
+ * @param frequency number of times each entry was put or hit
+ * @param entries   the entries, most recent first
+ */
+typedef struct cache_freq_t
+{
+    struct cache_freq_t *prev;
+    struct cache_freq_t *next;
+    uint64_t frequency;
+    cache_list_t entries;
+} cache_freq_t;
+
+/**
+ * @brief counters reported by cache_stats
+ *
+ * @param count     number of entries
+ * @param bytes     sum of the sizes of the entries
+ * @param hits      cache_get calls that found their key
+ * @param misses    cache_get calls that did not
+ * @param evictions entries evicted to make room
+ */
+typedef struct cache_stats_t
+{
+    uint32_t count;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} cache_stats_t;
+
+/**
+ * @brief structure of a cache_t object
+ *
+ * A hash_table_t maps every key to its cache_entry_t, and the entries are
+ * linked into doubly linked lists ordered by recency, so a get, put or
+ * eviction unlinks and relinks one entry instead of walking a list. LFU
+ * caches keep one list per frequency, ordered by frequency, and move an
+ * entry to the next list on every hit.
+ *
+ * Entries are owned by the cache: data replaced by cache_put, removed or
+ * cleared is freed with the customfree the cache was created with, and
+ * evicted data as well unless on_evict is set. Not thread safe.
+ *
+ * @param index         hash_table_t of key to cache_entry_t, its customfree
+ *                      frees the data
+ * @param policy        eviction policy
+ * @param max_entries   limit on the number of entries, 0 for no limit
+ * @param max_bytes     limit on the sum of the entry sizes, 0 for no limit
+ * @param count         number of entries
+ * @param bytes         sum of the entry sizes
+ * @param segments      recency lists; LRU uses the first, SLRU the first
+ *                      for probation and the second for protected entries
+ * @param lowest        list of the lowest frequency, CACHE_POLICY_LFU only
+ * @param on_evict      called for every evicted entry, may be NULL
+ * @param context       pointer passed through to on_evict
+ * @param hits          cache_get calls that found their key
+ * @param misses        cache_get calls that did not
+ * @param evictions     entries evicted to make room
+ */
+typedef struct cache_t
+{
+    hash_table_t *index;
+    cache_policy_t policy;
+    uint32_t max_entries;
+    size_t max_bytes;
+    uint32_t count;
+    size_t bytes;
+    cache_list_t segments[2];
+    cache_freq_t *lowest;
+    CACHE_EVICT_F on_evict;
+    void *context;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} cache_t;
+
+/**
+ * @brief initializes an LRU cache holding up to max_entries entries
+ *
+ * @param max_entries number of entries to keep
+ * @param customfree pointer to the user defined free function
+ *
+ * @return cache_t pointer to allocated cache, NULL on failure
+ */
+cache_t *cache_init(uint32_t max_entries, FREE_F customfree);
+
+/**
+ * @brief initializes a cache with the given options
+ *
+ * @param max_entries number of entries to keep, 0 for no limit
+ * @param customfree pointer to the user defined free function
+ * @param opts cache options, NULL selects every default
+ *
+ * @return cache_t pointer to allocated cache, NULL on failure or when
+ *         neither an entry nor a byte limit is set
+ */
+cache_t *cache_init_ex(uint32_t max_entries, FREE_F customfree,
+                       const cache_opts_t *opts);
+
+/**
+ * @brief looks up key and marks its entry as used
+ *
+ * @param cache pointer to cache address
+ * @param key key for data being searched for
+ *
+ * @return data stored at key, NULL when missing
+ */
+void *cache_get(cache_t *cache, char *key);
+
+/**
+ * @brief looks up a key of len bytes and marks its entry as used
+ *
+ * @param cache pointer to cache address
+ * @param key key bytes for data being searched for
+ * @param len number of bytes in key
+ *
+ * @return data stored at key, NULL when missing
+ */
+void *cache_get_n(cache_t *cache, const void *key, size_t len);
+
+/**
+ * @brief stores data at key, freeing the data it replaces, and evicts
+ *        entries until the cache is back within its limits
+ *
+ * @param cache pointer to cache address
+ * @param data data to be stored at that key value, not NULL
+ * @param key key for data to be stored at
+ * @param bytes size charged against max_bytes for data
+ *
+ * @return int exit code, FAILURE when bytes alone exceeds max_bytes
+ */
+int cache_put(cache_t *cache, void *data, char *key, size_t bytes);
+
+/**
+ * @brief stores data at a key of len bytes, see cache_put
+ *
+ * @param cache pointer to cache address
+ * @param data data to be stored at that key value, not NULL
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ * @param bytes size charged against max_bytes for data
+ *
+ * @return int exit code
+ */
+int cache_put_n(cache_t *cache, void *data, const void *key, size_t len,
+                size_t bytes);
+
+/**
+ * @brief removes key and frees its data
+ *
+ * @param cache pointer to cache address
+ * @param key key of data to be removed
+ *
+ * @return int exit code, FAILURE when key is not present
+ */
+int cache_remove(cache_t *cache, char *key);
+
+/**
+ * @brief removes a key of len bytes and frees its data
+ *
+ * @param cache pointer to cache address
+ * @param key key bytes of data to be removed
+ * @param len number of bytes in key
+ *
+ * @return int exit code, FAILURE when key is not present
+ */
+int cache_remove_n(cache_t *cache, const void *key, size_t len);
+
+/**
+ * @brief evicts the entry the cache's policy would evict next
+ *
+ * @param cache pointer to cache address
+ *
+ * @return int exit code, FAILURE when the cache is empty
+ */
+int cache_evict(cache_t *cache);
+
+/**
+ * @brief reports the size and counters of a cache
+ *
+ * @param cache pointer to cache address
+ * @param out receives the counters
+ *
+ * @return int exit code
+ */
+int cache_stats(cache_t *cache, cache_stats_t *out);
+
+/**
+ * @brief removes every entry, freeing its data, and keeps the counters
+ *
+ * @param cache pointer to cache address
+ *
+ * @return int exit code
+ */
+int cache_clear(cache_t *cache);
+
+/**
+ * @brief destroys the cache, freeing the data of every entry
+ *
+ * @param cache_addr pointer to cache address
+ *
+ * @return int exit code
+ */
+int cache_destroy(cache_t **cache_addr);
+
+#endif
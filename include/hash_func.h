@@ -0,0 +1,82 @@
+#ifndef _HASH_FUNC_H
+#define _HASH_FUNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief hash function families selectable through hash_table_opts_t
+ *
+ * @param HASH_FUNC_WY      fast 64 bit word-at-a-time hash in the wyhash
+ *                          family, seeded
+ * @param HASH_FUNC_SIP     keyed SipHash-2-4, resistant to collision
+ *                          flooding as long as the seed stays secret
+ * @param HASH_FUNC_POLY31  the original byte-at-a-time multiply by 31 hash,
+ *                          unseeded, kept for comparison
+ */
+typedef enum hash_func_t
+{
+    HASH_FUNC_WY,
+    HASH_FUNC_SIP,
+    HASH_FUNC_POLY31
+} hash_func_t;
+
+/**
+ * @brief A pointer to a 64 bit hash function over len bytes of key, keyed
+ *        by a 128 bit seed
+ *
+ */
+typedef uint64_t (*HASH_F)(const void *key, size_t len,
+                           const uint64_t seed[2]);
+
+/**
+ * @brief wyhash style hash, reading the key 8 bytes at a time and mixing
+ *        with 64x64->128 bit multiplies
+ *
+ * @param key bytes to hash
+ * @param len number of bytes in key
+ * @param seed 128 bit seed
+ *
+ * @return 64 bit hash
+ */
+uint64_t hash_func_wy(const void *key, size_t len, const uint64_t seed[2]);
+
+/**
+ * @brief SipHash-2-4 keyed by seed
+ *
+ * @param key bytes to hash
+ * @param len number of bytes in key
+ * @param seed 128 bit secret key
+ *
+ * @return 64 bit hash
+ */
+uint64_t hash_func_sip(const void *key, size_t len, const uint64_t seed[2]);
+
+/**
+ * @brief multiply by 31 polynomial hash, the seed is ignored
+ *
+ * @param key bytes to hash
+ * @param len number of bytes in key
+ * @param seed unused
+ *
+ * @return 32 bit hash widened to 64 bits
+ */
+uint64_t hash_func_poly31(const void *key, size_t len, const uint64_t seed[2]);
+
+/**
+ * @brief returns the function implementing a hash family
+ *
+ * @param func hash family
+ *
+ * @return HASH_F pointer, NULL for an unknown family
+ */
+HASH_F hash_func_get(hash_func_t func);
+
+/**
+ * @brief fills seed with random bytes from the operating system
+ *
+ * @param seed 128 bit seed to fill
+ */
+void hash_func_random_seed(uint64_t seed[2]);
+
+#endif
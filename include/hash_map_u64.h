@@ -0,0 +1,143 @@
+#ifndef _HASH_MAP_U64_H
+#define _HASH_MAP_U64_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SUCCESS 0
+#define FAILURE 1
+
+/**
+ * @brief structure of a hash_map_u64_t slot
+ *
+ * @param key   key of the slot, 0 marks an empty slot
+ * @param value value stored at key
+ */
+typedef struct hash_map_u64_entry_t
+{
+    uint64_t key;
+    uint64_t value;
+} hash_map_u64_entry_t;
+
+/**
+ * @brief structure of a hash_map_u64_t object
+ *
+ * A map from 64 bit keys to 64 bit values kept inline in one flat array
+ * of slots, so adding a key never allocates and a lookup compares integers
+ * instead of hashing and comparing strings. Keys are scrambled with a
+ * seeded integer mixer and placed by linear probing; removing a key shifts
+ * the keys after it back instead of leaving a tombstone. Key 0 marks empty
+ * slots, so it is stored beside the array. The array doubles once it is
+ * 3/4 full.
+ *
+ * @param entries   the slots
+ * @param capacity  number of slots, a power of two
+ * @param count     number of keys stored, including key 0
+ * @param seed      random seed mixed into every key
+ * @param has_zero  non-zero when key 0 is stored
+ * @param zero      value stored at key 0
+ */
+typedef struct hash_map_u64_t
+{
+    hash_map_u64_entry_t *entries;
+    uint32_t capacity;
+    uint32_t count;
+    uint64_t seed;
+    int has_zero;
+    uint64_t zero;
+} hash_map_u64_t;
+
+/**
+ * @brief initializes an integer keyed map
+ *
+ * @param size number of keys to reserve room for
+ *
+ * @return hash_map_u64_t pointer to allocated map, NULL on failure
+ */
+hash_map_u64_t *hash_map_u64_init(uint32_t size);
+
+/**
+ * @brief stores value at key, replacing the value already stored there
+ *
+ * @param map pointer to map address
+ * @param key key to store value at
+ * @param value value to store
+ *
+ * @return int exit code
+ */
+int hash_map_u64_put(hash_map_u64_t *map, uint64_t key, uint64_t value);
+
+/**
+ * @brief looks up the value stored at key
+ *
+ * @param map pointer to map address
+ * @param key key being searched for
+ * @param value receives the value stored at key, may be NULL
+ *
+ * @return SUCCESS when key is present, FAILURE otherwise
+ */
+int hash_map_u64_get(hash_map_u64_t *map, uint64_t key, uint64_t *value);
+
+/**
+ * @brief returns the value slot of key, adding key with value in the same
+ *        probe when it is not present
+ *
+ * The slot stays valid until the map is next changed, so counters and
+ * accumulators can be updated in place with a single probe.
+ *
+ * @param map pointer to map address
+ * @param key key being searched for
+ * @param value value to store when key is not present
+ *
+ * @return pointer to the value stored at key, NULL on failure
+ */
+uint64_t *hash_map_u64_get_or_insert(hash_map_u64_t *map, uint64_t key,
+                                     uint64_t value);
+
+/**
+ * @brief removes key from the map
+ *
+ * @param map pointer to map address
+ * @param key key to remove
+ * @param value receives the value that was stored at key, may be NULL
+ *
+ * @return SUCCESS when key was removed, FAILURE when it was not present
+ */
+int hash_map_u64_remove(hash_map_u64_t *map, uint64_t key, uint64_t *value);
+
+/**
+ * @brief steps through every key of the map in slot order
+ *
+ * The map must not change between calls.
+ *
+ * @param map pointer to map address
+ * @param cursor 0 to start, then passed back unchanged
+ * @param key receives the next key
+ * @param value receives the value stored at it, may be NULL
+ *
+ * @return SUCCESS while a key was returned, FAILURE once every key was
+ */
+int hash_map_u64_next(hash_map_u64_t *map, uint64_t *cursor, uint64_t *key,
+                      uint64_t *value);
+
+/**
+ * @brief removes every key but keeps the slot array
+ *
+ * @param map pointer to map address
+ *
+ * @return int exit code
+ */
+int hash_map_u64_clear(hash_map_u64_t *map);
+
+/**
+ * @brief destroys the map
+ *
+ * @param map_addr pointer to map address
+ *
+ * @return int exit code
+ */
+int hash_map_u64_destroy(hash_map_u64_t **map_addr);
+
+#endif
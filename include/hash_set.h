@@ -0,0 +1,223 @@
+#ifndef _HASH_SET_H
+#define _HASH_SET_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hash_func.h>
+
+#define SUCCESS 0
+#define FAILURE 1
+
+/**
+ * @brief key arena of a set, see arena.h
+ */
+struct arena_t;
+
+/**
+ * @brief structure of a hash_set_t slot
+ *
+ * @param key   key bytes, NUL terminated, owned by the set's arena
+ * @param len   number of bytes in key
+ * @param hash  low 32 bits of the key's hash, which pick its group and
+ *              control byte, so the set never hashes a stored key again
+ */
+typedef struct hash_set_slot_t
+{
+    const char *key;
+    uint32_t len;
+    uint32_t hash;
+} hash_set_slot_t;
+
+/**
+ * @brief structure of a hash_set_t object
+ *
+ * A set of byte string keys laid out like the swiss engine of hash_table_t,
+ * without a data pointer: one control byte per slot holds 7 bits of the key
+ * hash, and a group of 16 control bytes is compared against a key with one
+ * SSE2 instruction where available. Each 16 byte slot keeps the key, its
+ * length and its hash.
+ *
+ * Every set of a process hashes with the same random seed, so the set
+ * operations probe one set with the hashes stored in the other and never
+ * hash a key. Key bytes are copied into an arena; removed keys are only
+ * reclaimed once they outweigh the live ones, when the arena is rebuilt.
+ * Not thread safe.
+ *
+ * @param ctrl          control bytes, one per slot
+ * @param slots         the slots
+ * @param capacity      number of slots, a power of two multiple of 16
+ * @param count         number of keys
+ * @param growth_left   empty slots that may still be filled before the set
+ *                      has to be rebuilt
+ * @param keys          arena holding the key bytes
+ * @param live_bytes    arena bytes used by the keys in the set
+ * @param dead_bytes    arena bytes left behind by removed keys
+ */
+typedef struct hash_set_t
+{
+    int8_t *ctrl;
+    hash_set_slot_t *slots;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t growth_left;
+    struct arena_t *keys;
+    size_t live_bytes;
+    size_t dead_bytes;
+} hash_set_t;
+
+/**
+ * @brief initializes a set
+ *
+ * @param size number of keys to reserve room for
+ *
+ * @return hash_set_t pointer to allocated set, NULL on failure
+ */
+hash_set_t *hash_set_init(uint32_t size);
+
+/**
+ * @brief adds key to the set
+ *
+ * @param set pointer to set address
+ * @param key key to add
+ *
+ * @return SUCCESS when key was added, FAILURE when it was already present
+ *         or on failure
+ */
+int hash_set_add(hash_set_t *set, char *key);
+
+/**
+ * @brief adds a key of len bytes to the set
+ *
+ * @param set pointer to set address
+ * @param key key bytes to add
+ * @param len number of bytes in key
+ *
+ * @return SUCCESS when key was added, FAILURE when it was already present
+ *         or on failure
+ */
+int hash_set_add_n(hash_set_t *set, const void *key, size_t len);
+
+/**
+ * @brief tests whether key is in the set
+ *
+ * @param set pointer to set address
+ * @param key key being searched for
+ *
+ * @return non-zero when key is present
+ */
+int hash_set_contains(const hash_set_t *set, char *key);
+
+/**
+ * @brief tests whether a key of len bytes is in the set
+ *
+ * @param set pointer to set address
+ * @param key key bytes being searched for
+ * @param len number of bytes in key
+ *
+ * @return non-zero when key is present
+ */
+int hash_set_contains_n(const hash_set_t *set, const void *key, size_t len);
+
+/**
+ * @brief removes key from the set
+ *
+ * @param set pointer to set address
+ * @param key key to remove
+ *
+ * @return SUCCESS when key was removed, FAILURE when it was not present
+ */
+int hash_set_remove(hash_set_t *set, char *key);
+
+/**
+ * @brief removes a key of len bytes from the set
+ *
+ * @param set pointer to set address
+ * @param key key bytes to remove
+ * @param len number of bytes in key
+ *
+ * @return SUCCESS when key was removed, FAILURE when it was not present
+ */
+int hash_set_remove_n(hash_set_t *set, const void *key, size_t len);
+
+/**
+ * @brief steps through every key of the set in slot order
+ *
+ * The set must not change between calls.
+ *
+ * @param set pointer to set address
+ * @param cursor 0 to start, then passed back unchanged
+ * @param key receives the next key, owned by the set
+ * @param len receives the number of bytes in key, may be NULL
+ *
+ * @return SUCCESS while a key was returned, FAILURE once every key was
+ */
+int hash_set_next(const hash_set_t *set, uint64_t *cursor, const char **key,
+                  uint32_t *len);
+
+/**
+ * @brief builds the union of two sets
+ *
+ * The result is sized for both sets up front; the larger set is copied
+ * slot by slot without comparing keys and only the smaller one is probed.
+ *
+ * @param a first set
+ * @param b second set
+ *
+ * @return hash_set_t pointer to a new set, NULL on failure
+ */
+hash_set_t *hash_set_union(const hash_set_t *a, const hash_set_t *b);
+
+/**
+ * @brief builds the intersection of two sets
+ *
+ * Walks the smaller set and probes the larger one.
+ *
+ * @param a first set
+ * @param b second set
+ *
+ * @return hash_set_t pointer to a new set, NULL on failure
+ */
+hash_set_t *hash_set_intersection(const hash_set_t *a, const hash_set_t *b);
+
+/**
+ * @brief builds the keys of a that are not in b
+ *
+ * @param a set keys are taken from
+ * @param b set of keys to leave out
+ *
+ * @return hash_set_t pointer to a new set, NULL on failure
+ */
+hash_set_t *hash_set_difference(const hash_set_t *a, const hash_set_t *b);
+
+/**
+ * @brief counts the keys two sets share without building their
+ *        intersection
+ *
+ * @param a first set
+ * @param b second set
+ *
+ * @return number of shared keys, 0 when either set is NULL
+ */
+uint32_t hash_set_intersection_count(const hash_set_t *a, const hash_set_t *b);
+
+/**
+ * @brief removes every key but keeps the slot array
+ *
+ * @param set pointer to set address
+ *
+ * @return int exit code
+ */
+int hash_set_clear(hash_set_t *set);
+
+/**
+ * @brief destroys the set
+ *
+ * @param set_addr pointer to set address
+ *
+ * @return int exit code
+ */
+int hash_set_destroy(hash_set_t **set_addr);
+
+#endif
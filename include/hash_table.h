@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <hash_func.h>
 
 #define SUCCESS 0
 #define FAILURE 1
@@ -21,20 +22,198 @@
  */
 typedef void (*FREE_F)(void *data);
 
+/**
+ * @brief A function pointer called by hash_table_scan for every entry it
+ *        visits. It must not call back into the table being scanned.
+ *
+ * @param key key bytes of the entry, NUL terminated
+ * @param len number of bytes in key
+ * @param data data stored at key
+ * @param context pointer passed to hash_table_scan
+ */
+typedef void (*HASH_SCAN_F)(const char *key, uint32_t len, void *data,
+                            void *context);
+
+/**
+ * @brief keys shorter than this many bytes are stored inside their node_t
+ *
+ */
+#define HASH_TABLE_INLINE_KEY 24
+
 /**
  * @brief structure of a node_t object
  *
- * @param key       pointer to the saved keyvalue string
- * @param data      saved data pointer
- * @param next      pointer to next node_t
+ * The full key hash and length are kept next to the key so chain walks can
+ * reject most nodes without touching the key bytes. Short keys are copied
+ * into key_inline, which keeps the whole node in one 64 byte cache line and
+ * saves the separate key allocation; longer keys go to the heap.
+ *
+ * @param key           pointer to the saved keyvalue string, either
+ *                      key_inline or a heap copy
+ * @param data          saved data pointer
+ * @param next          pointer to next node_t
+ * @param hash          full hash of the key
+ * @param key_len       number of bytes in key, excluding the terminator
+ * @param key_inline    storage for keys shorter than HASH_TABLE_INLINE_KEY
+ * @param expires       timer wheel tick the entry expires at, 0 for an entry
+ *                      without a TTL; fills what was padding, so the node
+ *                      stays 64 bytes
  */
 typedef struct node_t
 {
     char *key;
     void *data;
     struct node_t *next;
+    uint64_t hash;
+    uint32_t key_len;
+    char key_inline[HASH_TABLE_INLINE_KEY];
+    uint32_t expires;
 } node_t;
 
+/**
+ * @brief storage engines that can back a hash_table_t
+ *
+ * @param HASH_ENGINE_CHAINED   array of node_t lists, one list per bucket
+ * @param HASH_ENGINE_SWISS     flat open-addressed array of 64 byte
+ *                              slots holding short keys inline, with one
+ *                              control byte per slot, probed 16 slots at a
+ *                              time
+ * @param HASH_ENGINE_ROBIN_HOOD    flat open-addressed slot array probed
+ *                                  one slot at a time, where keys far from
+ *                                  their home slot take the place of keys
+ *                                  closer to theirs, keeping every probe
+ *                                  short even at 90% load
+ * @param HASH_ENGINE_CUCKOO    node_t pointers in 64 byte buckets of four
+ *                              slots, every key in one of two buckets, so
+ *                              a lookup reads at most two cache lines of
+ *                              buckets; full buckets are made room in by
+ *                              moving keys to their other bucket
+ * @param HASH_ENGINE_MAPPED    read-only snapshot file mapped into memory,
+ *                              only created by hash_table_open_mapped
+ * @param HASH_ENGINE_FROZEN    read-only table indexed by a minimal perfect
+ *                              hash, only created by hash_table_freeze
+ */
+typedef enum hash_engine_t
+{
+    HASH_ENGINE_CHAINED,
+    HASH_ENGINE_SWISS,
+    HASH_ENGINE_ROBIN_HOOD,
+    HASH_ENGINE_CUCKOO,
+    HASH_ENGINE_MAPPED,
+    HASH_ENGINE_FROZEN
+} hash_engine_t;
+
+/**
+ * @brief ways a hash_table_t can be shared between threads
+ *
+ * @param HASH_SYNC_NONE        no synchronization, the caller serializes
+ *                              every call
+ * @param HASH_SYNC_STRIPED     add, lookup and remove lock one of
+ *                              lock_stripes mutexes picked by the key hash;
+ *                              resizing locks every stripe. Chained engine
+ *                              only, without use_slab
+ * @param HASH_SYNC_RCU         lookups take no lock and write nothing but
+ *                              their thread's lookup counters; add, remove
+ *                              and clear are serialized by one writer lock
+ *                              and publish their changes with atomic
+ *                              pointer stores. Unlinked entries
+ *                              are freed once every lookup that could still
+ *                              see them has finished. Meant for read-mostly
+ *                              tables. Chained and cuckoo engines only,
+ *                              without use_slab
+ */
+typedef enum hash_sync_t
+{
+    HASH_SYNC_NONE,
+    HASH_SYNC_STRIPED,
+    HASH_SYNC_RCU
+} hash_sync_t;
+
+/**
+ * @brief operations implemented by a storage engine, see hash_table_internal.h
+ */
+struct hash_engine_ops_t;
+
+/**
+ * @brief pooled allocators, see arena.h
+ */
+struct slab_t;
+struct arena_t;
+
+/**
+ * @brief per-thread lookup counters, see hash_table_internal.h
+ */
+struct hash_table_counters_t;
+
+/**
+ * @brief blocked bloom filter, see bloom.h
+ */
+struct bloom_t;
+
+/**
+ * @brief timer wheel of a table with entry TTLs, see hash_table_internal.h
+ */
+struct hash_ttl_t;
+
+/**
+ * @brief options accepted by hash_table_init_ex
+ *
+ * Zeroed fields select the default value, so a table can be configured with
+ * a designated initializer naming only the options it cares about.
+ *
+ * The chained engine grows to twice its bucket count once the average chain
+ * length passes max_load_factor, and shrinks (never below the initial size)
+ * once it drops under min_load_factor. Entries are moved to the new bucket
+ * array rehash_step buckets at a time on every add, lookup and remove, so no
+ * single call pays for the whole table.
+ *
+ * Bucket counts are powers of two so a bucket is picked by masking the key
+ * hash. Unless a seed is given, every table draws a random one so bucket
+ * placement cannot be predicted from outside the process.
+ *
+ * @param engine            storage engine, defaults to HASH_ENGINE_CHAINED
+ * @param hash_func         hash family, defaults to HASH_FUNC_WY
+ * @param seed              128 bit hash seed, all zero draws a random seed
+ * @param max_load_factor   entries per bucket that trigger growth, default 1.0
+ * @param min_load_factor   entries per bucket that trigger shrinking,
+ *                          default 0.1, at most half of max_load_factor
+ * @param rehash_step       buckets moved per operation while rehashing,
+ *                          default 1
+ * @param use_slab          non-zero to allocate node_t records from a
+ *                          per-table slab and key bytes from a bump arena;
+ *                          clear and destroy then release whole chunks
+ *                          instead of every entry, and freed nodes are
+ *                          reused, but key bytes of removed entries are only
+ *                          reclaimed by hash_table_clear
+ * @param sync              synchronization mode, defaults to HASH_SYNC_NONE
+ * @param lock_stripes      number of lock stripes of a HASH_SYNC_STRIPED
+ *                          table, a power of two, default 64. The bucket
+ *                          count never drops below it
+ * @param bloom_fp_rate     false positive rate of a bloom filter consulted
+ *                          before every lookup, 0 for no filter. Misses the
+ *                          filter answers cost one cache line instead of a
+ *                          bucket search. HASH_SYNC_NONE tables only
+ * @param ttl_tick_ms       resolution of entry TTLs in milliseconds, 0 for a
+ *                          table without TTLs. Entries added through the
+ *                          *_ttl functions are tracked in a hierarchical
+ *                          timer wheel of this tick. Chained engine with
+ *                          HASH_SYNC_NONE only; implies use_slab
+ */
+typedef struct hash_table_opts_t
+{
+    hash_engine_t engine;
+    hash_func_t hash_func;
+    uint64_t seed[2];
+    double max_load_factor;
+    double min_load_factor;
+    uint32_t rehash_step;
+    int use_slab;
+    hash_sync_t sync;
+    uint32_t lock_stripes;
+    double bloom_fp_rate;
+    uint32_t ttl_tick_ms;
+} hash_table_opts_t;
+
 /**
  * @brief structure of a hash_table_t object
  *
@@ -43,26 +222,210 @@ typedef struct node_t
  * If that slot is null, insert new node_t there
  * If not null (colision), traverse to end of list and append new node_t
  *
- * @param size          number of positions supported by table
- * @param table         the table of node_t lists
- * @param customfree    pointer to the user defined free function
+ * While the table is being resized, rehash_table holds the new bucket array.
+ * Buckets of table below rehash_index have already been moved into it and
+ * new entries are added to it; once every bucket has moved it replaces table.
+ *
+ * Tables created with a different engine, or with HASH_SYNC_RCU, leave table
+ * NULL and keep their storage in engine_data instead.
+ *
+ * @param size              number of positions supported by table, always a
+ *                          power of two
+ * @param table             the table of node_t lists
+ * @param customfree        pointer to the user defined free function
+ * @param engine            storage engine backing the table
+ * @param ops               operations of the storage engine
+ * @param engine_data       engine specific storage, NULL for the chained engine
+ * @param hash_func         hash family used for keys
+ * @param hash              function implementing hash_func
+ * @param seed              128 bit seed passed to hash
+ * @param count             number of entries stored in the table; striped
+ *                          tables only refresh it while every stripe is
+ *                          locked, when resizing or clearing
+ * @param rehash_table      bucket array being rehashed into, NULL when idle
+ * @param rehash_size       number of positions in rehash_table
+ * @param rehash_index      next position of table to move into rehash_table
+ * @param min_size          size the table never shrinks below
+ * @param max_load_factor   entries per bucket that trigger growth
+ * @param min_load_factor   entries per bucket that trigger shrinking
+ * @param rehash_step       buckets moved per operation while rehashing
+ * @param node_slab         slab node_t records come from, NULL for malloc
+ * @param key_arena         arena key bytes come from, NULL for malloc
+ * @param sync              synchronization mode
+ * @param sync_data         lock and reclamation state of a synchronized
+ *                          table
+ * @param counters          lookup counters read by hash_table_stats
+ * @param counter_mask      counter slots minus one, 0 for a table that is
+ *                          only read by one thread at a time
+ * @param bloom             filter of the keys added, NULL when disabled.
+ *                          Removed keys stay in it until it is rebuilt
+ * @param bloom_stale       keys removed since the filter was last built
+ * @param ttl               timer wheel of the entries added with a TTL, NULL
+ *                          when TTLs are disabled. Expired entries are
+ *                          counted in count until hash_table_expire
+ *                          reclaims them
  */
 typedef struct hash_table_t
 {
     uint32_t size;
     node_t **table;
     FREE_F customfree;
+    hash_engine_t engine;
+    const struct hash_engine_ops_t *ops;
+    void *engine_data;
+    hash_func_t hash_func;
+    HASH_F hash;
+    uint64_t seed[2];
+    uint32_t count;
+    node_t **rehash_table;
+    uint32_t rehash_size;
+    uint32_t rehash_index;
+    uint32_t min_size;
+    double max_load_factor;
+    double min_load_factor;
+    uint32_t rehash_step;
+    struct slab_t *node_slab;
+    struct arena_t *key_arena;
+    hash_sync_t sync;
+    void *sync_data;
+    struct hash_table_counters_t *counters;
+    uint32_t counter_mask;
+    struct bloom_t *bloom;
+    uint32_t bloom_stale;
+    struct hash_ttl_t *ttl;
 } hash_table_t;
 
+/**
+ * @brief number of bins in the histogram of hash_table_stats_t
+ */
+#define HASH_TABLE_STATS_BINS 16
+
+/**
+ * @brief a picture of a table's layout and lookup traffic, filled in by
+ *        hash_table_stats
+ *
+ * Chained and mapped tables count chain lengths: histogram[n] is the
+ * number of buckets holding n entries. Open-addressed engines count probe
+ * lengths instead: histogram[n] is the number of entries that sit n slots,
+ * or for the swiss engine n slot groups, past their home. Lengths of
+ * HASH_TABLE_STATS_BINS - 1 and more share the last bin.
+ *
+ * The lookup counters cover every hash_table_lookup, hash_table_lookup_n
+ * and key of hash_table_lookup_batch since the table was created.
+ *
+ * @param count         number of entries
+ * @param buckets       number of buckets or slots
+ * @param load_factor   count divided by buckets
+ * @param histogram     chain or probe length histogram
+ * @param longest       longest chain or probe length
+ * @param bytes_used    bytes allocated for the table, its entries and
+ *                      their keys, not counting allocator overhead
+ * @param lookups       keys looked up
+ * @param hits          lookups that found their key
+ * @param misses        lookups that did not
+ * @param probes        chain nodes, slots or slot groups examined by the
+ *                      lookups
+ * @param mean_probes   probes per lookup
+ * @param filtered      misses answered by the bloom filter alone
+ */
+typedef struct hash_table_stats_t
+{
+    uint32_t count;
+    uint32_t buckets;
+    double load_factor;
+    uint32_t histogram[HASH_TABLE_STATS_BINS];
+    uint32_t longest;
+    size_t bytes_used;
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t probes;
+    double mean_probes;
+    uint64_t filtered;
+} hash_table_stats_t;
+
 /**
  * @brief initializes hash table
  *
- * @param size number indexes in the table
+ * @param size number indexes in the table, rounded up to a power of two
  *
  * @return hash_table_t pointer to allocated table
  */
 hash_table_t *hash_table_init(uint32_t size, FREE_F customfree);
 
+/**
+ * @brief initializes hash table backed by the swiss engine
+ *
+ * Entries live directly in a flat slot array instead of separately
+ * allocated node_t records. Each slot has a control byte holding 7 bits of
+ * the key hash, so a lookup compares 16 control bytes at once and only
+ * touches the keys whose hash bits match. The slot array doubles once it is
+ * 7/8 full.
+ *
+ * @param size number of entries to reserve room for
+ *
+ * @return hash_table_t pointer to allocated table
+ */
+hash_table_t *hash_table_init_swiss(uint32_t size, FREE_F customfree);
+
+/**
+ * @brief initializes hash table that can be shared between threads
+ *
+ * Equivalent to hash_table_init_ex with sync set to HASH_SYNC_STRIPED.
+ * Keys are spread over independently locked stripes of buckets, so threads
+ * touching different stripes never wait on each other.
+ *
+ * @param size number indexes in the table
+ *
+ * @return hash_table_t pointer to allocated table
+ */
+hash_table_t *hash_table_init_concurrent(uint32_t size, FREE_F customfree);
+
+/**
+ * @brief initializes hash table with the given options
+ *
+ * @param size number indexes in the table, rounded up to a power of two
+ * @param customfree pointer to the user defined free function
+ * @param opts table options, NULL selects every default
+ *
+ * @return hash_table_t pointer to allocated table, NULL on failure or when
+ *         the options are out of range
+ */
+hash_table_t *hash_table_init_ex(uint32_t size, FREE_F customfree,
+                                 const hash_table_opts_t *opts);
+
+/**
+ * @brief builds a table holding n keys at once
+ *
+ * The result is the table n calls of hash_table_add would give, duplicates
+ * included, without paying n allocations and n chain walks. The bucket
+ * array is sized for n up front, every node_t and every key too long to be
+ * inlined is carved from one block, and each chain is linked front to back
+ * in a single pass. With threads above 1 the keys are hashed in parallel
+ * and partitioned by bucket range, so every thread fills buckets no other
+ * thread touches.
+ *
+ * Only chained tables without synchronization are built this way; they
+ * behave as if created with use_slab, so later removes recycle nodes and
+ * removed key bytes are reclaimed by hash_table_clear. Other engines and
+ * synchronization modes are presized and filled with hash_table_add.
+ *
+ * @param keys n NUL terminated keys
+ * @param values n data pointers, values[i] stored at keys[i]; none NULL
+ * @param n number of keys
+ * @param customfree pointer to the user defined free function
+ * @param opts table options, NULL selects every default
+ * @param threads number of threads to build with, 0 or 1 for the caller
+ *                only
+ *
+ * @return hash_table_t pointer to the built table, NULL on failure or when
+ *         a key or value is NULL
+ */
+hash_table_t *hash_table_build(char **keys, void **values, uint32_t n,
+                               FREE_F customfree,
+                               const hash_table_opts_t *opts,
+                               uint32_t threads);
+
 /**
  * @brief adds an item to the table
  *
@@ -74,6 +437,214 @@ hash_table_t *hash_table_init(uint32_t size, FREE_F customfree);
  */
 int hash_table_add(hash_table_t *table, void *data, char *key);
 
+/**
+ * @brief adds an item to the table under a key of len bytes
+ *
+ * The key may hold any bytes, including NUL, so binary keys such as packed
+ * ids or UUIDs can be stored as is. A NUL terminated key added with
+ * hash_table_add is the same key as its strlen bytes passed here.
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ *
+ * @return int exit code
+ */
+int hash_table_add_n(hash_table_t *table, void *data, const void *key,
+                     size_t len);
+
+/**
+ * @brief stores data at key, replacing the data already stored there
+ *
+ * Unlike hash_table_add, a key is never stored twice. The key is hashed and
+ * its chain or probe sequence walked once, whether it is found or added.
+ * The table does not own data, so the replaced data is handed back to the
+ * caller.
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param old_data receives the replaced data, NULL when key was new; may
+ *                 be NULL
+ *
+ * @return int exit code
+ */
+int hash_table_put(hash_table_t *table, void *data, char *key, void **old_data);
+
+/**
+ * @brief hash_table_put with a key of len bytes, see hash_table_add_n
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ * @param old_data receives the replaced data, NULL when key was new; may
+ *                 be NULL
+ *
+ * @return int exit code
+ */
+int hash_table_put_n(hash_table_t *table, void *data, const void *key,
+                     size_t len, void **old_data);
+
+/**
+ * @brief returns the data slot of key, adding key with data first when it
+ *        is not present
+ *
+ * Counters and aggregates can be updated in place with one hash and one
+ * probe:
+ *
+ *     void **slot = hash_table_get_or_insert(table, key, NULL);
+ *     if (NULL != slot && NULL == *slot)
+ *     {
+ *         *slot = new_counter();
+ *     }
+ *
+ * The slot stays valid until the table is next modified. A NULL slot value
+ * reads as missing to hash_table_lookup until the caller fills it in.
+ * Tables shared between threads are refused, since the caller writes the
+ * slot without holding any lock.
+ *
+ * @param table pointer to table address
+ * @param key key of the slot
+ * @param data data stored when key is added, may be NULL
+ *
+ * @return pointer to the data stored at key, NULL on failure
+ */
+void **hash_table_get_or_insert(hash_table_t *table, char *key, void *data);
+
+/**
+ * @brief hash_table_get_or_insert with a key of len bytes, see
+ *        hash_table_add_n
+ *
+ * @param table pointer to table address
+ * @param key key bytes of the slot
+ * @param len number of bytes in key
+ * @param data data stored when key is added, may be NULL
+ *
+ * @return pointer to the data stored at key, NULL on failure
+ */
+void **hash_table_get_or_insert_n(hash_table_t *table, const void *key,
+                                  size_t len, void *data);
+
+/**
+ * @brief hash_table_add for a table created with ttl_tick_ms: the entry
+ *        expires ttl_ms after the call
+ *
+ * An expired entry is no longer found by lookups, puts, removes or scans,
+ * and hash_table_expire later unlinks it and passes its data to the
+ * table's free function. The entry lives at least ttl_ms and at most two
+ * ticks longer. TTLs are capped at 2^31 - 1 ticks, and an expired entry
+ * that hash_table_expire has not reclaimed within that many ticks turns
+ * up again.
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param ttl_ms lifetime of the entry in milliseconds, 0 for no expiry
+ *
+ * @return int exit code, FAILURE for a table without TTLs
+ */
+int hash_table_add_ttl(hash_table_t *table, void *data, char *key,
+                       uint32_t ttl_ms);
+
+/**
+ * @brief hash_table_add_ttl with a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ * @param ttl_ms lifetime of the entry in milliseconds, 0 for no expiry
+ *
+ * @return int exit code, FAILURE for a table without TTLs
+ */
+int hash_table_add_ttl_n(hash_table_t *table, void *data, const void *key,
+                         size_t len, uint32_t ttl_ms);
+
+/**
+ * @brief hash_table_put for a table created with ttl_tick_ms, also
+ *        restarting the TTL of the entry, see hash_table_add_ttl
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param ttl_ms new lifetime of the entry in milliseconds, 0 for no expiry
+ * @param old_data receives the replaced data, NULL when key was new or had
+ *                 expired; may be NULL
+ *
+ * @return int exit code, FAILURE for a table without TTLs
+ */
+int hash_table_put_ttl(hash_table_t *table, void *data, char *key,
+                       uint32_t ttl_ms, void **old_data);
+
+/**
+ * @brief hash_table_put_ttl with a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ * @param ttl_ms new lifetime of the entry in milliseconds, 0 for no expiry
+ * @param old_data receives the replaced data, NULL when key was new or had
+ *                 expired; may be NULL
+ *
+ * @return int exit code, FAILURE for a table without TTLs
+ */
+int hash_table_put_ttl_n(hash_table_t *table, void *data, const void *key,
+                         size_t len, uint32_t ttl_ms, void **old_data);
+
+/**
+ * @brief hash_table_get_or_insert for a table created with ttl_tick_ms;
+ *        an added entry expires ttl_ms after the call, an entry already
+ *        present keeps its TTL
+ *
+ * @param table pointer to table address
+ * @param key key of the slot
+ * @param data data stored when key is added, may be NULL
+ * @param ttl_ms lifetime of an added entry in milliseconds, 0 for no
+ *               expiry
+ *
+ * @return pointer to the data stored at key, NULL on failure or for a
+ *         table without TTLs
+ */
+void **hash_table_get_or_insert_ttl(hash_table_t *table, char *key,
+                                    void *data, uint32_t ttl_ms);
+
+/**
+ * @brief hash_table_get_or_insert_ttl with a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param key key bytes of the slot
+ * @param len number of bytes in key
+ * @param data data stored when key is added, may be NULL
+ * @param ttl_ms lifetime of an added entry in milliseconds, 0 for no
+ *               expiry
+ *
+ * @return pointer to the data stored at key, NULL on failure or for a
+ *         table without TTLs
+ */
+void **hash_table_get_or_insert_ttl_n(hash_table_t *table, const void *key,
+                                      size_t len, void *data,
+                                      uint32_t ttl_ms);
+
+/**
+ * @brief reclaims expired entries, doing a bounded amount of work
+ *
+ * Advances the table's timer wheel towards the current tick, unlinking
+ * every expired entry it passes and handing its data to the table's free
+ * function. Each timer handled, and each step of the wheel, costs one
+ * unit of budget; a call that runs out leaves the rest to the next one.
+ * Entries whose TTL was restarted are rescheduled rather than reclaimed,
+ * so every entry costs O(1) amortized wheel work.
+ *
+ * @param table pointer to table address
+ * @param budget most units of work to do
+ *
+ * @return number of entries reclaimed
+ */
+uint32_t hash_table_expire(hash_table_t *table, uint32_t budget);
+
 /**
  * @brief looks up an item in the table by key
  *
@@ -84,6 +655,36 @@ int hash_table_add(hash_table_t *table, void *data, char *key);
  */
 void *hash_table_lookup(hash_table_t *table, char *key);
 
+/**
+ * @brief looks up an item in the table by a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param key key bytes for data being searched for
+ * @param len number of bytes in key
+ *
+ * @return void * data
+ */
+void *hash_table_lookup_n(hash_table_t *table, const void *key, size_t len);
+
+/**
+ * @brief looks up several items at once
+ *
+ * Keys are hashed up front and resolved in groups, prefetching every
+ * group's buckets and entries before comparing keys, so the cache misses
+ * of different keys overlap instead of being paid one after another. The
+ * result is the same as calling hash_table_lookup for every key.
+ *
+ * @param table pointer to table address
+ * @param keys keys for data being searched for; NULL keys are not found
+ * @param n number of keys
+ * @param out array of n pointers receiving the data stored at each key,
+ *            NULL when missing
+ *
+ * @return int exit code
+ */
+int hash_table_lookup_batch(hash_table_t *table, char **keys, size_t n,
+                            void **out);
+
 /**
  * @brief removes an item from the hash table
  *
@@ -94,6 +695,142 @@ void *hash_table_lookup(hash_table_t *table, char *key);
  */
 int hash_table_remove(hash_table_t *table, char *key);
 
+/**
+ * @brief removes an item stored under a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param key key bytes of data to be removed
+ * @param len number of bytes in key
+ *
+ * @return int
+ */
+int hash_table_remove_n(hash_table_t *table, const void *key, size_t len);
+
+/**
+ * @brief visits a bounded slice of the table's entries, resuming from a
+ *        cursor
+ *
+ * Start with cursor 0 and pass every returned cursor back in until 0 is
+ * returned. Each call visits around count entries and never more than
+ * a fixed multiple of count buckets, so a scan of a huge table can be
+ * spread over many short steps.
+ *
+ * Cursors advance in reverse binary order of the bucket index, so the
+ * buckets already visited stay visited when the table grows or shrinks
+ * between calls. Every entry present for the whole scan is therefore
+ * visited at least once. Entries added or removed during the scan may or
+ * may not be visited, and an entry may be visited more than once when the
+ * table shrinks. HASH_ENGINE_CUCKOO tables are the exception: an add may
+ * move other entries to their second bucket, so entries may be missed or
+ * repeated when keys are added during the scan.
+ *
+ * @param table pointer to table address
+ * @param cursor 0 to start a scan, otherwise a cursor returned by a
+ *               previous call
+ * @param count number of entries to aim for
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ *
+ * @return cursor to continue from, 0 once the scan is complete
+ */
+uint64_t hash_table_scan(hash_table_t *table, uint64_t cursor, uint32_t count,
+                         HASH_SCAN_F callback, void *context);
+
+/**
+ * @brief reports how far the keys of a HASH_ENGINE_ROBIN_HOOD table sit
+ *        from their home slot
+ *
+ * A key at distance d is found after comparing d + 1 slots, and a miss
+ * stops no later than the longest distance in its neighbourhood, so the
+ * maximum bounds the worst case lookup. The slots are walked once.
+ *
+ * @param table pointer to table address
+ * @param max_probe receives the largest distance, may be NULL
+ * @param mean_probe receives the mean distance, may be NULL
+ *
+ * @return int exit code, FAILURE for tables of other engines
+ */
+int hash_table_probe_stats(hash_table_t *table, uint32_t *max_probe,
+                           double *mean_probe);
+
+/**
+ * @brief reports a table's size, chain or probe length distribution,
+ *        memory use and lookup counters
+ *
+ * The counters are kept on every lookup in a cache line of the calling
+ * thread's own, written with plain stores, so they cost a few adds and
+ * can be left on in production. Past 63 live threads looking keys up in
+ * shared tables, the further threads share one line and add atomically. The layout is
+ * read by walking every bucket, with every stripe or the writer lock of
+ * a synchronized table held, so it takes time linear in the table size.
+ *
+ * @param table pointer to table address
+ * @param out receives the statistics
+ *
+ * @return int exit code
+ */
+int hash_table_stats(hash_table_t *table, hash_table_stats_t *out);
+
+/**
+ * @brief saves every entry of a table to a snapshot file that
+ *        hash_table_open_mapped can serve without loading it
+ *
+ * Entries are grouped by bucket into flat arrays of bucket offsets,
+ * entries, values and key bytes that hold no pointers, so the file can be
+ * mapped at any address. Data pointers cannot outlive the process, so the
+ * first value_size bytes each entry's data points at are saved in their
+ * place; value_size 0 saves the keys alone. The file is written next to
+ * path and renamed over it once complete. The table must not be modified
+ * while it is saved.
+ *
+ * @param table pointer to table address
+ * @param path file to write
+ * @param value_size bytes copied from every entry's data
+ *
+ * @return int exit code
+ */
+int hash_table_save(hash_table_t *table, const char *path, uint32_t value_size);
+
+/**
+ * @brief opens a snapshot written by hash_table_save without copying it
+ *
+ * The file is mapped read-only and lookups are served straight from the
+ * mapped pages, so opening costs no allocation per entry and only the
+ * pages lookups touch are ever read. The table hashes with the hash family
+ * and seed the snapshot was saved with. hash_table_lookup returns a pointer
+ * to the entry's saved value bytes inside the mapping, or to its key when
+ * the snapshot holds no values; the bytes must not be written and stay
+ * valid until the table is destroyed. Adding, removing and clearing fail.
+ *
+ * @param path snapshot file
+ *
+ * @return hash_table_t pointer to a read-only table, NULL when the file
+ *         cannot be mapped or is not a valid snapshot
+ */
+hash_table_t *hash_table_open_mapped(const char *path);
+
+/**
+ * @brief builds an immutable copy of a table indexed by a minimal perfect
+ *        hash
+ *
+ * Keys are hashed into small buckets and every bucket gets a 16 bit pilot
+ * that moves all of its keys onto free slots, so the n keys land on
+ * exactly n slots with no collision left to resolve. A lookup reads one
+ * pilot, computes the slot and verifies the key stored there against a
+ * single blob holding every key back to back. On top of the key bytes and
+ * data pointers the index costs about 3.5 bits per key.
+ *
+ * Later changes to table are not seen by the frozen copy. Where table holds
+ * a key more than once, the copy keeps the data hash_table_lookup returns.
+ * The frozen table refuses adding, removing and clearing. The table must
+ * not be modified while it is frozen.
+ *
+ * @param table pointer to table address
+ *
+ * @return hash_table_t pointer to the frozen table, NULL on failure
+ */
+hash_table_t *hash_table_freeze(hash_table_t *table);
+
 /**
  * @brief clears all data from hash table
  *
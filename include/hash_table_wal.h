@@ -0,0 +1,278 @@
+#ifndef _HASH_TABLE_WAL_H
+#define _HASH_TABLE_WAL_H
+
+#include <pthread.h>
+#include <hash_table.h>
+
+/**
+ * @brief when the records of a write-ahead log are forced to disk
+ *
+ * @param WAL_FSYNC_NONE        records are written every flush_interval_ms
+ *                              and left to the operating system; a crash
+ *                              of the machine may lose them
+ * @param WAL_FSYNC_INTERVAL    every flush, made every flush_interval_ms,
+ *                              ends with an fsync, so at most that much
+ *                              work is lost
+ * @param WAL_FSYNC_COMMIT      adds and removes return once their record
+ *                              has been fsynced. Records of calls made
+ *                              while an fsync is in progress are written
+ *                              and fsynced together by the next one
+ */
+typedef enum wal_fsync_t
+{
+    WAL_FSYNC_NONE,
+    WAL_FSYNC_INTERVAL,
+    WAL_FSYNC_COMMIT
+} wal_fsync_t;
+
+/**
+ * @brief A function pointer rebuilding the data of an entry from the value
+ *        bytes logged for it, when a log is replayed
+ *
+ * @param value logged value bytes
+ * @param size number of bytes in value
+ * @param context pointer passed in hash_table_wal_opts_t
+ *
+ * @return data to store at the entry's key, NULL to fail the replay
+ */
+typedef void *(*WAL_LOAD_F)(const void *value, uint32_t size, void *context);
+
+/**
+ * @brief options accepted by hash_table_wal_open
+ *
+ * Zeroed fields select the default value.
+ *
+ * @param fsync             fsync policy, defaults to WAL_FSYNC_NONE
+ * @param flush_interval_ms longest time a record waits in memory, default
+ *                          10
+ * @param buffer_size       bytes of records buffered before appends wait
+ *                          for the writer, default 1 MiB
+ * @param value_size        bytes copied from every added entry's data,
+ *                          as for hash_table_save; 0 logs keys alone
+ * @param compact_min_bytes log size from which the log is compacted once
+ *                          it has doubled since its last compaction, or
+ *                          since the last one failed, default 64 MiB
+ * @param load              rebuilds replayed data; NULL copies the value
+ *                          bytes into a malloc'd block
+ * @param load_context      pointer passed through to load
+ */
+typedef struct hash_table_wal_opts_t
+{
+    wal_fsync_t fsync;
+    uint32_t flush_interval_ms;
+    uint32_t buffer_size;
+    uint32_t value_size;
+    uint64_t compact_min_bytes;
+    WAL_LOAD_F load;
+    void *load_context;
+} hash_table_wal_opts_t;
+
+/**
+ * @brief structure of a hash_table_wal_t object
+ *
+ * A write-ahead log recording every add and remove made through it to a
+ * table. Records are appended to an in-memory buffer under a short lock;
+ * a writer thread swaps the buffer for a second one and writes it out, so
+ * appends never wait on the disk unless the buffer fills or the fsync
+ * policy asks them to.
+ *
+ * A compaction thread rewrites the log once it has grown: it replays the
+ * part of the file already written into a scratch table of record
+ * pointers, a consistent picture of the table at that point, writes the
+ * surviving records to a new file and copies over what was appended in the
+ * meantime. The writer then copies the last few records and renames the
+ * new file over the log. The table itself is never read or locked by the
+ * compaction, so lookups and adds keep going.
+ *
+ * @param table             table the log records
+ * @param path              log file
+ * @param opts              options with defaults applied
+ * @param fd                log file descriptor, used by the writer only
+ * @param lock              guards every field below
+ * @param wake              wakes the writer
+ * @param flushed           signalled whenever the writer made progress
+ * @param compact_wake      wakes the compaction thread
+ * @param compact_done      signalled when a compaction finished
+ * @param buffer            records waiting to be written
+ * @param used              bytes of records in buffer
+ * @param capacity          bytes of room in buffer
+ * @param spare             buffer being written by the writer
+ * @param spare_capacity    bytes of room in spare
+ * @param appended          bytes of records appended since the log was
+ *                          opened
+ * @param written           bytes of them written to the file
+ * @param synced            bytes of them fsynced
+ * @param sync_requested    non-zero when hash_table_wal_sync waits for an
+ *                          fsync
+ * @param file_bytes        bytes in the log file
+ * @param compacted_bytes   bytes in the log file after its last compaction,
+ *                          or when the last one failed; the log compacts
+ *                          itself again once it has doubled from there
+ * @param swap_fd           new log file waiting to replace the current one,
+ *                          -1 when none
+ * @param swap_from         bytes of the current file already copied into
+ *                          swap_fd
+ * @param swap_bytes        bytes in swap_fd
+ * @param swap_status       outcome of the last swap
+ * @param compact_requested compactions asked for so far
+ * @param compact_completed compactions finished so far
+ * @param compact_status    outcome of the last compaction
+ * @param compactions       compactions that rewrote the log
+ * @param error             non-zero once a write failed; adds and removes
+ *                          then fail and nothing more is written
+ * @param rollback          once error is set, end of the newest record
+ *                          whose change to the table is still to be
+ *                          undone
+ * @param stop              non-zero while the log is being closed
+ * @param writer            writer thread
+ * @param compactor         compaction thread
+ */
+typedef struct hash_table_wal_t
+{
+    hash_table_t *table;
+    char *path;
+    hash_table_wal_opts_t opts;
+    int fd;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t flushed;
+    pthread_cond_t compact_wake;
+    pthread_cond_t compact_done;
+    char *buffer;
+    size_t used;
+    size_t capacity;
+    char *spare;
+    size_t spare_capacity;
+    uint64_t appended;
+    uint64_t written;
+    uint64_t synced;
+    int sync_requested;
+    uint64_t file_bytes;
+    uint64_t compacted_bytes;
+    int swap_fd;
+    uint64_t swap_from;
+    uint64_t swap_bytes;
+    int swap_status;
+    uint64_t compact_requested;
+    uint64_t compact_completed;
+    int compact_status;
+    uint64_t compactions;
+    int error;
+    uint64_t rollback;
+    int stop;
+    pthread_t writer;
+    pthread_t compactor;
+} hash_table_wal_t;
+
+/**
+ * @brief opens a write-ahead log for a table, replaying it first
+ *
+ * Every record already in the file is applied to table, which should be
+ * empty. A torn record at the end of the file, left by a crash in the
+ * middle of a write, is cut off and everything before it kept. A missing
+ * file is created.
+ *
+ * @param path log file
+ * @param table table to replay into and record changes of
+ * @param opts log options, NULL selects every default
+ *
+ * @return hash_table_wal_t pointer to the open log, NULL on failure or
+ *         when the file is not a log written with the same value_size
+ */
+hash_table_wal_t *hash_table_wal_open(const char *path, hash_table_t *table,
+                                      const hash_table_wal_opts_t *opts);
+
+/**
+ * @brief adds an item to the table and logs it
+ *
+ * @param wal pointer to log address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ *
+ * @return int exit code. FAILURE leaves the table as it was: memory ran
+ *         out or the log has failed. A log failing while a
+ *         WAL_FSYNC_COMMIT caller waits for the fsync undoes the add,
+ *         though its record may still be in the file and be replayed;
+ *         data is not kept by the table either way
+ */
+int hash_table_wal_add(hash_table_wal_t *wal, void *data, char *key);
+
+/**
+ * @brief adds an item under a key of len bytes to the table and logs it
+ *
+ * @param wal pointer to log address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ *
+ * @return int exit code. FAILURE leaves the table as it was: memory ran
+ *         out or the log has failed. A log failing while a
+ *         WAL_FSYNC_COMMIT caller waits for the fsync undoes the add,
+ *         though its record may still be in the file and be replayed;
+ *         data is not kept by the table either way
+ */
+int hash_table_wal_add_n(hash_table_wal_t *wal, void *data, const void *key,
+                         size_t len);
+
+/**
+ * @brief removes an item from the table and logs it
+ *
+ * @param wal pointer to log address
+ * @param key key of data to be removed
+ *
+ * @return int exit code. FAILURE leaves the table as it was: the key was
+ *         not present or the log has failed. A log failing while a
+ *         WAL_FSYNC_COMMIT caller waits for the fsync puts the entry
+ *         back, though the record may still be in the file and be
+ *         replayed
+ */
+int hash_table_wal_remove(hash_table_wal_t *wal, char *key);
+
+/**
+ * @brief removes an item stored under a key of len bytes and logs it
+ *
+ * @param wal pointer to log address
+ * @param key key bytes of data to be removed
+ * @param len number of bytes in key
+ *
+ * @return int exit code. FAILURE leaves the table as it was: the key was
+ *         not present or the log has failed. A log failing while a
+ *         WAL_FSYNC_COMMIT caller waits for the fsync puts the entry
+ *         back, though the record may still be in the file and be
+ *         replayed
+ */
+int hash_table_wal_remove_n(hash_table_wal_t *wal, const void *key,
+                            size_t len);
+
+/**
+ * @brief waits until every record logged so far has been fsynced,
+ *        whatever the fsync policy
+ *
+ * @param wal pointer to log address
+ *
+ * @return int exit code
+ */
+int hash_table_wal_sync(hash_table_wal_t *wal);
+
+/**
+ * @brief asks the compaction thread to rewrite the log and waits for it
+ *
+ * Only the caller waits; adds, removes and lookups carry on meanwhile.
+ *
+ * @param wal pointer to log address
+ *
+ * @return int exit code
+ */
+int hash_table_wal_compact(hash_table_wal_t *wal);
+
+/**
+ * @brief writes and fsyncs every record, stops the log's threads and
+ *        closes the file; the table is left as it is
+ *
+ * @param wal_addr pointer to log address
+ *
+ * @return int exit code, FAILURE when a record could not be written
+ */
+int hash_table_wal_close(hash_table_wal_t **wal_addr);
+
+#endif
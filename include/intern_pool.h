@@ -0,0 +1,158 @@
+#ifndef _INTERN_POOL_H
+#define _INTERN_POOL_H
+
+#include <pthread.h>
+#include <hash_table.h>
+
+/**
+ * @brief number of chunks of the symbol directory of an intern_pool_t
+ */
+#define INTERN_POOL_CHUNKS 22
+
+/**
+ * @brief symbol returned for strings that are not interned
+ */
+#define INTERN_POOL_NO_SYMBOL UINT32_MAX
+
+/**
+ * @brief key arena of a pool, see arena.h
+ */
+struct arena_t;
+
+/**
+ * @brief structure of an interned string, carved from the pool's arena
+ *
+ * @param symbol    the string's symbol
+ * @param len       number of bytes in the string
+ * @param bytes     the string, NUL terminated; its address is the
+ *                  canonical pointer handed out for it
+ */
+typedef struct intern_entry_t
+{
+    uint32_t symbol;
+    uint32_t len;
+    char bytes[];
+} intern_entry_t;
+
+/**
+ * @brief structure of an intern_pool_t object
+ *
+ * Every distinct string gets one canonical copy in a chunked arena, which
+ * keeps its address for the life of the pool, so two interned strings are
+ * equal exactly when their pointers are. The lookup table keeps its own
+ * copy of each key besides, inline in its node or in a separate allocation
+ * for long strings, so a string costs its bytes twice. Strings are also
+ * numbered from 0 in the order they were first interned; symbols index a
+ * directory of chunks that double in size and never move.
+ *
+ * A shared pool keeps its strings in a HASH_SYNC_RCU table, so interning a
+ * string that is already present takes no lock. New strings are added
+ * under a mutex, which also guards the arena and the directory.
+ *
+ * @param table     interned strings, each mapped to its intern_entry_t
+ * @param bytes     arena holding the entries
+ * @param chunks    symbol directory; chunk c holds the canonical pointers
+ *                  of 1024 << c symbols
+ * @param count     number of interned strings
+ * @param shared    non-zero when several threads may intern at once
+ * @param lock      mutex serializing new strings of a shared pool
+ */
+typedef struct intern_pool_t
+{
+    hash_table_t *table;
+    struct arena_t *bytes;
+    const char **chunks[INTERN_POOL_CHUNKS];
+    uint32_t count;
+    int shared;
+    pthread_mutex_t lock;
+} intern_pool_t;
+
+/**
+ * @brief initializes a pool
+ *
+ * @param size number of distinct strings to reserve room for
+ * @param shared non-zero to allow intern_pool_intern and every lookup from
+ *               several threads at once
+ *
+ * @return intern_pool_t pointer to allocated pool, NULL on failure
+ */
+intern_pool_t *intern_pool_init(uint32_t size, int shared);
+
+/**
+ * @brief returns the canonical copy of a string, interning it first when
+ *        it is new
+ *
+ * @param pool pointer to pool address
+ * @param str string bytes, may hold NUL bytes
+ * @param len number of bytes in str
+ *
+ * @return canonical NUL terminated copy of str, valid until the pool is
+ *         destroyed; NULL on failure
+ */
+const char *intern_pool_intern(intern_pool_t *pool, const char *str,
+                               size_t len);
+
+/**
+ * @brief returns the symbol of a string, interning it first when it is new
+ *
+ * @param pool pointer to pool address
+ * @param str string bytes, may hold NUL bytes
+ * @param len number of bytes in str
+ *
+ * @return the string's symbol, INTERN_POOL_NO_SYMBOL on failure
+ */
+uint32_t intern_pool_symbol(intern_pool_t *pool, const char *str, size_t len);
+
+/**
+ * @brief returns the canonical copy of a string without interning it
+ *
+ * @param pool pointer to pool address
+ * @param str string bytes
+ * @param len number of bytes in str
+ *
+ * @return canonical copy of str, NULL when it was never interned
+ */
+const char *intern_pool_lookup(intern_pool_t *pool, const char *str,
+                               size_t len);
+
+/**
+ * @brief returns the canonical string of a symbol
+ *
+ * @param pool pointer to pool address
+ * @param symbol symbol returned by intern_pool_symbol
+ * @param len receives the number of bytes in the string, may be NULL
+ *
+ * @return canonical string, NULL for unknown symbols
+ */
+const char *intern_pool_string(intern_pool_t *pool, uint32_t symbol,
+                               uint32_t *len);
+
+/**
+ * @brief returns the symbol of a canonical pointer in constant time
+ *
+ * @param interned pointer returned by intern_pool_intern or
+ *                 intern_pool_string, never any other string
+ *
+ * @return the string's symbol
+ */
+uint32_t intern_pool_symbol_of(const char *interned);
+
+/**
+ * @brief number of strings interned
+ *
+ * @param pool pointer to pool address
+ *
+ * @return number of distinct strings, 0 for a NULL pool
+ */
+uint32_t intern_pool_count(intern_pool_t *pool);
+
+/**
+ * @brief destroys the pool and every canonical string
+ *
+ * @param pool_addr pointer to pool address
+ *
+ * @return int exit code
+ */
+int intern_pool_destroy(intern_pool_t **pool_addr);
+
+#endif
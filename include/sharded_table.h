@@ -0,0 +1,240 @@
+#ifndef _SHARDED_TABLE_H
+#define _SHARDED_TABLE_H
+
+#include <pthread.h>
+#include <hash_table.h>
+
+/**
+ * @brief how the shards of a sharded_table_t are shared between threads
+ *
+ * @param SHARD_MODE_LOCKED     every shard has a mutex of its own, taken by
+ *                              every call, so any thread may use any key
+ * @param SHARD_MODE_OWNED      no locks; the caller routes every key to the
+ *                              one thread owning its shard, see
+ *                              sharded_table_shard_of
+ * @param SHARD_MODE_PRIVATE    ingest mode: each thread adds into a shard of
+ *                              its own with sharded_table_add_local, whatever
+ *                              the key, and sharded_table_merge later moves
+ *                              every key to its home shard and switches the
+ *                              table to SHARD_MODE_LOCKED
+ */
+typedef enum shard_mode_t
+{
+    SHARD_MODE_LOCKED,
+    SHARD_MODE_OWNED,
+    SHARD_MODE_PRIVATE
+} shard_mode_t;
+
+/**
+ * @brief one shard, padded to its own cache lines so threads working on
+ *        different shards never share a line
+ *
+ * The shard's hash_table_t is allocated on cache lines of its own by
+ * hash_table_init_ex, so its counters are kept apart as well.
+ *
+ * @param lock  mutex guarding table, SHARD_MODE_LOCKED only
+ * @param table the shard's entries
+ */
+typedef struct sharded_table_shard_t
+{
+    _Alignas(64) pthread_mutex_t lock;
+    hash_table_t *table;
+} sharded_table_shard_t;
+
+/**
+ * @brief structure of a sharded_table_t object
+ *
+ * Keys are spread over independent hash_table_t shards by a seeded hash
+ * of their own, so threads adding different keys mostly lock, and write,
+ * different cache lines instead of contending on one table's buckets and
+ * counters.
+ *
+ * @param shards        the shards
+ * @param shard_count   number of shards
+ * @param mode          how the shards are shared between threads
+ * @param opts          options every shard table is created with
+ * @param customfree    pointer to the user defined free function
+ * @param seed          random seed of the hash picking a key's shard
+ */
+typedef struct sharded_table_t
+{
+    sharded_table_shard_t *shards;
+    uint32_t shard_count;
+    shard_mode_t mode;
+    hash_table_opts_t opts;
+    FREE_F customfree;
+    uint64_t seed[2];
+} sharded_table_t;
+
+/**
+ * @brief initializes a sharded table
+ *
+ * @param shard_count number of shards, typically the number of cores
+ * @param size number of entries to reserve room for over all shards
+ * @param customfree pointer to the user defined free function
+ * @param mode how the shards are shared between threads
+ * @param opts options of every shard table, NULL selects every default;
+ *             sync must be HASH_SYNC_NONE, the shards bring their own
+ *
+ * @return sharded_table_t pointer to allocated table, NULL on failure
+ */
+sharded_table_t *sharded_table_init(uint32_t shard_count, uint32_t size,
+                                    FREE_F customfree, shard_mode_t mode,
+                                    const hash_table_opts_t *opts);
+
+/**
+ * @brief returns the home shard of a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return shard index, below shard_count
+ */
+uint32_t sharded_table_shard_of(const sharded_table_t *table, const void *key,
+                                size_t len);
+
+/**
+ * @brief adds an item to the key's home shard
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ *
+ * @return int exit code, FAILURE on a SHARD_MODE_PRIVATE table
+ */
+int sharded_table_add(sharded_table_t *table, void *data, char *key);
+
+/**
+ * @brief adds an item under a key of len bytes to the key's home shard
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ *
+ * @return int exit code, FAILURE on a SHARD_MODE_PRIVATE table
+ */
+int sharded_table_add_n(sharded_table_t *table, void *data, const void *key,
+                        size_t len);
+
+/**
+ * @brief adds an item to the calling thread's private shard of a
+ *        SHARD_MODE_PRIVATE table
+ *
+ * @param table pointer to table address
+ * @param shard the caller's shard; no other thread may use it until
+ *              sharded_table_merge
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ *
+ * @return int exit code
+ */
+int sharded_table_add_local(sharded_table_t *table, uint32_t shard,
+                            void *data, char *key);
+
+/**
+ * @brief adds an item under a key of len bytes to the calling thread's
+ *        private shard, see sharded_table_add_local
+ *
+ * @param table pointer to table address
+ * @param shard the caller's shard
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ *
+ * @return int exit code
+ */
+int sharded_table_add_local_n(sharded_table_t *table, uint32_t shard,
+                              void *data, const void *key, size_t len);
+
+/**
+ * @brief moves every key of a SHARD_MODE_PRIVATE table to its home shard
+ *        and switches the table to SHARD_MODE_LOCKED
+ *
+ * Each shard's entries are partitioned by home shard, then every home
+ * shard is built in one pass into a table sized for all of its entries,
+ * both steps spread over up to threads threads. No other call may run on
+ * the table meanwhile. Keys added more than once keep every copy, as
+ * repeated hash_table_add calls would.
+ *
+ * @param table pointer to table address
+ * @param threads number of threads to merge with, 0 or 1 for the caller
+ *                only
+ *
+ * @return int exit code; on failure the table is left unmerged
+ */
+int sharded_table_merge(sharded_table_t *table, uint32_t threads);
+
+/**
+ * @brief looks up an item in the key's home shard
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ *
+ * @return void * data, NULL when missing or on a SHARD_MODE_PRIVATE table
+ */
+void *sharded_table_lookup(sharded_table_t *table, char *key);
+
+/**
+ * @brief looks up an item by a key of len bytes in the key's home shard
+ *
+ * @param table pointer to table address
+ * @param key key bytes for data being searched for
+ * @param len number of bytes in key
+ *
+ * @return void * data, NULL when missing or on a SHARD_MODE_PRIVATE table
+ */
+void *sharded_table_lookup_n(sharded_table_t *table, const void *key,
+                             size_t len);
+
+/**
+ * @brief removes an item from the key's home shard
+ *
+ * @param table pointer to table address
+ * @param key key of data to be removed
+ *
+ * @return int exit code, FAILURE on a SHARD_MODE_PRIVATE table
+ */
+int sharded_table_remove(sharded_table_t *table, char *key);
+
+/**
+ * @brief removes an item stored under a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param key key bytes of data to be removed
+ * @param len number of bytes in key
+ *
+ * @return int exit code, FAILURE on a SHARD_MODE_PRIVATE table
+ */
+int sharded_table_remove_n(sharded_table_t *table, const void *key,
+                           size_t len);
+
+/**
+ * @brief counts the entries of every shard
+ *
+ * @param table pointer to table address
+ *
+ * @return number of entries, 0 for a NULL table
+ */
+uint64_t sharded_table_count(sharded_table_t *table);
+
+/**
+ * @brief clears every shard
+ *
+ * @param table pointer to table address
+ *
+ * @return int exit code
+ */
+int sharded_table_clear(sharded_table_t *table);
+
+/**
+ * @brief destroys the table and every shard
+ *
+ * @param table_addr pointer to table address
+ *
+ * @return int exit code
+ */
+int sharded_table_destroy(sharded_table_t **table_addr);
+
+#endif
@@ -0,0 +1,284 @@
+#include <arena.h>
+
+#define ARENA_ALIGN 16
+
+/**
+ * @brief allocates a chunk with room for size bytes
+ *
+ * @param size number of usable bytes
+ * @return pointer to the chunk on success, NULL on failure
+ */
+static arena_chunk_t *arena_chunk_new(size_t size)
+{
+    arena_chunk_t *chunk = NULL;
+
+    if (size <= SIZE_MAX - sizeof(arena_chunk_t))
+    {
+        chunk = (arena_chunk_t *)malloc(sizeof(arena_chunk_t) + size);
+    }
+    if (NULL != chunk)
+    {
+        chunk->next = NULL;
+        chunk->size = size;
+        chunk->used = 0;
+    }
+
+    return chunk;
+}
+
+/**
+ * @brief creates a new arena
+ *
+ * @param chunk_size usable bytes per chunk
+ * @return pointer to allocated arena on success, NULL on failure
+ */
+arena_t *arena_init(size_t chunk_size)
+{
+    arena_t *arena = NULL;
+
+    if (0 != chunk_size)
+    {
+        arena = (arena_t *)calloc(1, sizeof(arena_t));
+    }
+    if (NULL != arena)
+    {
+        arena->chunk_size = chunk_size;
+    }
+
+    return arena;
+}
+
+/**
+ * @brief allocates size bytes aligned to 16 bytes
+ *
+ * @param arena arena to allocate from
+ * @param size number of bytes
+ * @return pointer to the memory on success, NULL on failure
+ */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    void *memory = NULL;
+
+    if (NULL != arena && 0 != size && size <= SIZE_MAX - ARENA_ALIGN)
+    {
+        size_t rounded = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        arena_chunk_t *chunk = arena->head;
+
+        if (rounded > arena->chunk_size)
+        {
+            // oversized requests get their own chunk behind the current one
+            chunk = arena_chunk_new(rounded);
+            if (NULL != chunk)
+            {
+                if (NULL == arena->head)
+                {
+                    arena->head = chunk;
+                }
+                else
+                {
+                    chunk->next = arena->head->next;
+                    arena->head->next = chunk;
+                }
+                arena->allocated += rounded;
+            }
+        }
+        else if (NULL == chunk || chunk->size - chunk->used < rounded)
+        {
+            chunk = arena_chunk_new(arena->chunk_size);
+            if (NULL != chunk)
+            {
+                chunk->next = arena->head;
+                arena->head = chunk;
+                arena->allocated += arena->chunk_size;
+            }
+        }
+
+        if (NULL != chunk)
+        {
+            memory = chunk->bytes + chunk->used;
+            chunk->used += rounded;
+        }
+    }
+
+    return memory;
+}
+
+/**
+ * @brief releases every allocation, keeping one chunk for reuse
+ *
+ * @param arena arena to clear
+ * @return 0 on success, non-zero value on failure
+ */
+int arena_clear(arena_t *arena)
+{
+    int status = FAILURE;
+
+    if (NULL != arena)
+    {
+        arena_chunk_t *keep = NULL;
+        arena_chunk_t *current = arena->head;
+        while (NULL != current)
+        {
+            arena_chunk_t *next = current->next;
+            if (NULL == keep && current->size == arena->chunk_size)
+            {
+                keep = current;
+                keep->used = 0;
+                keep->next = NULL;
+            }
+            else
+            {
+                free(current);
+            }
+            current = next;
+        }
+        arena->head = keep;
+        arena->allocated = keep ? keep->size : 0;
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief destroys an arena and all of its chunks
+ *
+ * @param arena_addr pointer to arena pointer
+ * @return 0 on success, non-zero value on failure
+ */
+int arena_destroy(arena_t **arena_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != arena_addr && NULL != *arena_addr)
+    {
+        arena_chunk_t *current = (*arena_addr)->head;
+        while (NULL != current)
+        {
+            arena_chunk_t *next = current->next;
+            free(current);
+            current = next;
+        }
+        free(*arena_addr);
+        *arena_addr = NULL;
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief creates a new slab
+ *
+ * @param object_size size of each object
+ * @param objects_per_chunk number of objects carved from each chunk
+ * @return pointer to allocated slab on success, NULL on failure
+ */
+slab_t *slab_init(size_t object_size, uint32_t objects_per_chunk)
+{
+    slab_t *slab = NULL;
+
+    if (object_size < sizeof(void *))
+    {
+        object_size = sizeof(void *);
+    }
+    object_size = (object_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if (0 != objects_per_chunk && object_size <= SIZE_MAX / objects_per_chunk)
+    {
+        slab = (slab_t *)calloc(1, sizeof(slab_t));
+    }
+    if (NULL != slab)
+    {
+        slab->object_size = object_size;
+        slab->arena = arena_init(object_size * objects_per_chunk);
+        if (NULL == slab->arena)
+        {
+            free(slab);
+            slab = NULL;
+        }
+    }
+
+    return slab;
+}
+
+/**
+ * @brief allocates one object, reusing freed objects first
+ *
+ * @param slab slab to allocate from
+ * @return pointer to the object on success, NULL on failure
+ */
+void *slab_alloc(slab_t *slab)
+{
+    void *object = NULL;
+
+    if (NULL != slab)
+    {
+        if (NULL != slab->free_list)
+        {
+            object = slab->free_list;
+            memcpy(&slab->free_list, object, sizeof(void *));
+        }
+        else
+        {
+            object = arena_alloc(slab->arena, slab->object_size);
+        }
+    }
+
+    return object;
+}
+
+/**
+ * @brief returns an object to the slab's free list
+ *
+ * @param slab slab the object was allocated from
+ * @param object object to free
+ */
+void slab_free(slab_t *slab, void *object)
+{
+    if (NULL != slab && NULL != object)
+    {
+        memcpy(object, &slab->free_list, sizeof(void *));
+        slab->free_list = object;
+    }
+}
+
+/**
+ * @brief releases every object at once
+ *
+ * @param slab slab to clear
+ * @return 0 on success, non-zero value on failure
+ */
+int slab_clear(slab_t *slab)
+{
+    int status = FAILURE;
+
+    if (NULL != slab)
+    {
+        slab->free_list = NULL;
+        status = arena_clear(slab->arena);
+    }
+
+    return status;
+}
+
+/**
+ * @brief destroys a slab and all of its chunks
+ *
+ * @param slab_addr pointer to slab pointer
+ * @return 0 on success, non-zero value on failure
+ */
+int slab_destroy(slab_t **slab_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != slab_addr && NULL != *slab_addr)
+    {
+        arena_destroy(&(*slab_addr)->arena);
+        free(*slab_addr);
+        *slab_addr = NULL;
+        status = SUCCESS;
+    }
+
+    return status;
+}
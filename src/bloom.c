@@ -0,0 +1,268 @@
+#include <bloom.h>
+#include <math.h>
+
+#define BLOOM_BLOCK_BITS (BLOOM_BLOCK_WORDS * 64)
+#define BLOOM_LN2 0.69314718055994530942
+
+/**
+ * @brief picks the block of a key from the high half of its hash
+ *
+ * Multiplying by the block count and keeping the high 32 bits maps the
+ * hash onto any number of blocks without a division.
+ *
+ * @param bloom pointer to filter address
+ * @param hash hash of the key
+ *
+ * @return the key's block
+ */
+static inline bloom_block_t *bloom_block(const bloom_t *bloom, uint64_t hash)
+{
+    return bloom->blocks + (((hash >> 32) * bloom->block_count) >> 32);
+}
+
+/**
+ * @brief odd multipliers spreading the low half of a key's hash into one
+ *        bit position per hash function
+ */
+static const uint32_t bloom_salts[BLOOM_MAX_HASHES] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+    0x9e3779b1U, 0x85ebca6bU, 0xc2b2ae35U, 0x27d4eb2fU,
+    0x165667b1U, 0xfd7046c5U, 0xb55a4f09U, 0x61c88647U};
+
+/**
+ * @brief position inside its block of one of a key's bits
+ *
+ * Multiplying by an odd constant mixes every bit of the hash into the top
+ * bits of the product; the top 9 pick one of the BLOOM_BLOCK_BITS bits.
+ *
+ * @param hash hash of the key
+ * @param x which of the key's bits
+ *
+ * @return bit position
+ */
+static inline uint32_t bloom_bit(uint64_t hash, uint32_t x)
+{
+    return ((uint32_t)hash * bloom_salts[x]) >> 23;
+}
+
+/**
+ * @brief expected false positive rate of a blocked filter
+ *
+ * The number of keys landing in one block follows a Poisson distribution
+ * around the average, and a block holding i keys passes a missing key
+ * with probability (1 - e^(-k * i / BLOOM_BLOCK_BITS))^k.
+ *
+ * @param per_block average number of keys per block
+ * @param hashes bits set per key
+ *
+ * @return expected false positive rate
+ */
+static double bloom_expected_rate(double per_block, uint32_t hashes)
+{
+    double weight = exp(-per_block);
+    double rate = 0;
+    uint32_t last = (uint32_t)(per_block + 8 * sqrt(per_block)) + 16;
+
+    for (uint32_t keys = 0; keys <= last; keys++)
+    {
+        double empty = exp(-(double)hashes * keys / BLOOM_BLOCK_BITS);
+        rate += weight * pow(1 - empty, hashes);
+        weight = weight * per_block / (keys + 1);
+    }
+
+    return rate;
+}
+
+/**
+ * @brief initializes a bloom filter
+ *
+ * A classic filter needs -ln(fp_rate) / ln(2)^2 bits per key and
+ * log2(1 / fp_rate) bits set per key. Keys are not spread evenly over
+ * the blocks, so crowded blocks answer worse than the average; blocks are
+ * added until the expected rate over the spread of block loads meets
+ * fp_rate, which costs a twentieth more bits at 1% and a tenth more at
+ * 0.1%.
+ *
+ * @param capacity number of keys to size the filter for
+ * @param fp_rate target false positive rate, above 0 and below 1
+ *
+ * @return bloom_t pointer to allocated filter, NULL on failure or when
+ *         fp_rate is out of range
+ */
+bloom_t *bloom_init(uint32_t capacity, double fp_rate)
+{
+    bloom_t *bloom = NULL;
+
+    if (fp_rate > 0 && fp_rate < 1)
+    {
+        bloom = (bloom_t *)calloc(1, sizeof(bloom_t));
+    }
+
+    if (NULL != bloom)
+    {
+        double keys = 0 != capacity ? capacity : 1;
+        double bits = keys * -log(fp_rate) / (BLOOM_LN2 * BLOOM_LN2);
+        double blocks = ceil(bits / BLOOM_BLOCK_BITS);
+        long hashes = lround(-log2(fp_rate));
+
+        bloom->hashes = hashes < 1                ? 1 :
+                        hashes > BLOOM_MAX_HASHES ? BLOOM_MAX_HASHES :
+                                                    (uint32_t)hashes;
+        while (blocks <= UINT32_MAX &&
+               bloom_expected_rate(keys / blocks, bloom->hashes) > fp_rate)
+        {
+            blocks = ceil(blocks * 1.05);
+        }
+        bloom->capacity = capacity;
+        bloom->fp_rate = fp_rate;
+        hash_func_random_seed(bloom->seed);
+        if (blocks <= UINT32_MAX)
+        {
+            bloom->block_count = (uint32_t)blocks;
+            bloom->blocks = (bloom_block_t *)aligned_alloc(
+                sizeof(bloom_block_t),
+                (size_t)bloom->block_count * sizeof(bloom_block_t));
+        }
+        if (NULL == bloom->blocks)
+        {
+            free(bloom);
+            bloom = NULL;
+        }
+        else
+        {
+            memset(bloom->blocks, 0,
+                   (size_t)bloom->block_count * sizeof(bloom_block_t));
+        }
+    }
+
+    return bloom;
+}
+
+/**
+ * @brief adds a key to the filter by its 64 bit hash
+ *
+ * @param bloom pointer to filter address
+ * @param hash well mixed 64 bit hash of the key
+ */
+void bloom_add_hash(bloom_t *bloom, uint64_t hash)
+{
+    bloom_block_t *block = bloom_block(bloom, hash);
+
+    for (uint32_t x = 0; x < bloom->hashes; x++)
+    {
+        uint32_t bit = bloom_bit(hash, x);
+        block->words[bit / 64] |= 1ULL << (bit % 64);
+    }
+    bloom->count++;
+}
+
+/**
+ * @brief tests a key against the filter by its 64 bit hash
+ *
+ * @param bloom pointer to filter address
+ * @param hash well mixed 64 bit hash of the key
+ *
+ * @return 0 when the key was never added, non-zero when it may have been
+ */
+int bloom_contains_hash(const bloom_t *bloom, uint64_t hash)
+{
+    const bloom_block_t *block = bloom_block(bloom, hash);
+    uint64_t missing = 0;
+
+    // no early exit: the bits all live in the one cache line
+    for (uint32_t x = 0; x < bloom->hashes; x++)
+    {
+        uint32_t bit = bloom_bit(hash, x);
+        missing |= ~block->words[bit / 64] & (1ULL << (bit % 64));
+    }
+
+    return 0 == missing;
+}
+
+/**
+ * @brief adds a key of len bytes to the filter
+ *
+ * @param bloom pointer to filter address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return int exit code
+ */
+int bloom_add(bloom_t *bloom, const void *key, size_t len)
+{
+    int status = FAILURE;
+
+    if (NULL != bloom && NULL != key)
+    {
+        bloom_add_hash(bloom, hash_func_wy(key, len, bloom->seed));
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief tests a key of len bytes against the filter
+ *
+ * @param bloom pointer to filter address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return 0 when the key was never added, non-zero when it may have been
+ */
+int bloom_contains(const bloom_t *bloom, const void *key, size_t len)
+{
+    int found = 0;
+
+    if (NULL != bloom && NULL != key)
+    {
+        found = bloom_contains_hash(bloom, hash_func_wy(key, len, bloom->seed));
+    }
+
+    return found;
+}
+
+/**
+ * @brief removes every key from the filter
+ *
+ * @param bloom pointer to filter address
+ *
+ * @return int exit code
+ */
+int bloom_clear(bloom_t *bloom)
+{
+    int status = FAILURE;
+
+    if (NULL != bloom)
+    {
+        memset(bloom->blocks, 0,
+               (size_t)bloom->block_count * sizeof(bloom_block_t));
+        bloom->count = 0;
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief destroys the filter
+ *
+ * @param bloom_addr pointer to filter address
+ *
+ * @return int exit code
+ */
+int bloom_destroy(bloom_t **bloom_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != bloom_addr && NULL != *bloom_addr)
+    {
+        free((*bloom_addr)->blocks);
+        free(*bloom_addr);
+        *bloom_addr = NULL;
+        status = SUCCESS;
+    }
+
+    return status;
+}
@@ -0,0 +1,733 @@
+#include <cache.h>
+
+#define CACHE_DEFAULT_SIZE 64
+
+/**
+ * @brief links entry in at the head of list
+ *
+ * @param list list to add to
+ * @param entry unlinked cache_entry_t
+ */
+static void cache_list_push(cache_list_t *list, cache_entry_t *entry)
+{
+    entry->prev = NULL;
+    entry->next = list->head;
+    if (NULL != list->head)
+    {
+        list->head->prev = entry;
+    }
+    else
+    {
+        list->tail = entry;
+    }
+    list->head = entry;
+    list->count++;
+    list->bytes += entry->bytes;
+}
+
+/**
+ * @brief unlinks entry from list
+ *
+ * @param list list holding entry
+ * @param entry cache_entry_t to unlink
+ */
+static void cache_list_unlink(cache_list_t *list, cache_entry_t *entry)
+{
+    if (NULL != entry->prev)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        list->head = entry->next;
+    }
+    if (NULL != entry->next)
+    {
+        entry->next->prev = entry->prev;
+    }
+    else
+    {
+        list->tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+    list->count--;
+    list->bytes -= entry->bytes;
+}
+
+/**
+ * @brief returns the list an entry is linked into
+ */
+static cache_list_t *cache_list_of(cache_t *cache, cache_entry_t *entry)
+{
+    cache_list_t *list = &cache->segments[entry->segment];
+
+    if (CACHE_POLICY_LFU == cache->policy)
+    {
+        list = &entry->freq->entries;
+    }
+
+    return list;
+}
+
+/**
+ * @brief allocates an empty frequency list and links it in after prev,
+ *        or first when prev is NULL
+ *
+ * @param cache pointer to cache address
+ * @param prev list of the next lower frequency, may be NULL
+ * @param frequency frequency of the new list
+ *
+ * @return cache_freq_t pointer, NULL on allocation failure
+ */
+static cache_freq_t *cache_freq_insert(cache_t *cache, cache_freq_t *prev,
+                                       uint64_t frequency)
+{
+    cache_freq_t *freq = (cache_freq_t *)calloc(1, sizeof(cache_freq_t));
+
+    if (NULL != freq)
+    {
+        freq->frequency = frequency;
+        freq->prev = prev;
+        freq->next = NULL != prev ? prev->next : cache->lowest;
+        if (NULL != freq->next)
+        {
+            freq->next->prev = freq;
+        }
+        if (NULL != prev)
+        {
+            prev->next = freq;
+        }
+        else
+        {
+            cache->lowest = freq;
+        }
+    }
+
+    return freq;
+}
+
+/**
+ * @brief unlinks and frees a frequency list once its last entry left it
+ *
+ * @param cache pointer to cache address
+ * @param freq frequency list to check
+ */
+static void cache_freq_release(cache_t *cache, cache_freq_t *freq)
+{
+    if (0 == freq->entries.count)
+    {
+        if (NULL != freq->prev)
+        {
+            freq->prev->next = freq->next;
+        }
+        else
+        {
+            cache->lowest = freq->next;
+        }
+        if (NULL != freq->next)
+        {
+            freq->next->prev = freq->prev;
+        }
+        free(freq);
+    }
+}
+
+/**
+ * @brief links a new entry in where its policy starts entries: the head of
+ *        the recency list, of probation, or of the frequency 1 list
+ *
+ * @param cache pointer to cache address
+ * @param entry unlinked cache_entry_t
+ *
+ * @return int exit code
+ */
+static int cache_link(cache_t *cache, cache_entry_t *entry)
+{
+    int status = SUCCESS;
+
+    if (CACHE_POLICY_LFU == cache->policy)
+    {
+        cache_freq_t *freq = cache->lowest;
+        if (NULL == freq || 1 != freq->frequency)
+        {
+            freq = cache_freq_insert(cache, NULL, 1);
+        }
+        if (NULL == freq)
+        {
+            status = FAILURE;
+        }
+        else
+        {
+            entry->freq = freq;
+            cache_list_push(&freq->entries, entry);
+        }
+    }
+    else
+    {
+        cache_list_push(&cache->segments[0], entry);
+    }
+
+    if (SUCCESS == status)
+    {
+        cache->count++;
+        cache->bytes += entry->bytes;
+    }
+
+    return status;
+}
+
+/**
+ * @brief unlinks an entry from whichever list holds it
+ *
+ * @param cache pointer to cache address
+ * @param entry cache_entry_t to unlink
+ */
+static void cache_unlink(cache_t *cache, cache_entry_t *entry)
+{
+    cache_list_unlink(cache_list_of(cache, entry), entry);
+    if (CACHE_POLICY_LFU == cache->policy)
+    {
+        cache_freq_release(cache, entry->freq);
+        entry->freq = NULL;
+    }
+    cache->count--;
+    cache->bytes -= entry->bytes;
+}
+
+/**
+ * @brief moves protected entries back to probation, least recently used
+ *        first, until the protected segment holds at most 4/5 of the
+ *        cache's limits
+ *
+ * @param cache pointer to cache address
+ */
+static void cache_slru_balance(cache_t *cache)
+{
+    cache_list_t *protected = &cache->segments[1];
+
+    while (protected->count > 1 &&
+           ((0 != cache->max_entries &&
+             protected->count > cache->max_entries - cache->max_entries / 5) ||
+            (0 != cache->max_bytes &&
+             protected->bytes > cache->max_bytes - cache->max_bytes / 5)))
+    {
+        cache_entry_t *demoted = protected->tail;
+        cache_list_unlink(protected, demoted);
+        demoted->segment = 0;
+        cache_list_push(&cache->segments[0], demoted);
+    }
+}
+
+/**
+ * @brief marks an entry as just used according to the cache's policy
+ *
+ * LFU entries move to the list of the next frequency. A frequency list
+ * holding only the entry is renumbered in place instead, and when the
+ * next list cannot be allocated the entry only moves to the head of its
+ * own list.
+ *
+ * @param cache pointer to cache address
+ * @param entry cache_entry_t that was used
+ */
+static void cache_touch(cache_t *cache, cache_entry_t *entry)
+{
+    if (CACHE_POLICY_LFU == cache->policy)
+    {
+        cache_freq_t *freq = entry->freq;
+        cache_freq_t *next = freq->next;
+
+        if (1 == freq->entries.count &&
+            (NULL == next || next->frequency > freq->frequency + 1))
+        {
+            freq->frequency++;
+        }
+        else
+        {
+            if (NULL == next || next->frequency != freq->frequency + 1)
+            {
+                next = cache_freq_insert(cache, freq, freq->frequency + 1);
+            }
+            cache_list_unlink(&freq->entries, entry);
+            if (NULL == next)
+            {
+                cache_list_push(&freq->entries, entry);
+            }
+            else
+            {
+                entry->freq = next;
+                cache_list_push(&next->entries, entry);
+                cache_freq_release(cache, freq);
+            }
+        }
+    }
+    else
+    {
+        cache_list_unlink(&cache->segments[entry->segment], entry);
+        // a second use earns an SLRU entry its place in the protected
+        // segment
+        if (CACHE_POLICY_SLRU == cache->policy)
+        {
+            entry->segment = 1;
+        }
+        cache_list_push(&cache->segments[entry->segment], entry);
+        if (CACHE_POLICY_SLRU == cache->policy)
+        {
+            cache_slru_balance(cache);
+        }
+    }
+}
+
+/**
+ * @brief picks the entry to evict next, skipping keep
+ *
+ * @param cache pointer to cache address
+ * @param keep entry that must stay, may be NULL
+ *
+ * @return cache_entry_t to evict, NULL when there is none
+ */
+static cache_entry_t *cache_victim(cache_t *cache, const cache_entry_t *keep)
+{
+    cache_entry_t *victim = NULL;
+
+    if (CACHE_POLICY_LFU == cache->policy)
+    {
+        for (cache_freq_t *freq = cache->lowest; NULL == victim && NULL != freq;
+             freq = freq->next)
+        {
+            victim = freq->entries.tail;
+            if (NULL != keep && victim == keep)
+            {
+                victim = keep->prev;
+            }
+        }
+    }
+    else
+    {
+        for (int segment = 0; NULL == victim && segment < 2; segment++)
+        {
+            victim = cache->segments[segment].tail;
+            if (NULL != keep && victim == keep)
+            {
+                victim = keep->prev;
+            }
+        }
+    }
+
+    return victim;
+}
+
+/**
+ * @brief frees an entry that was unlinked and dropped from the index,
+ *        along with its data
+ *
+ * @param cache pointer to cache address
+ * @param entry cache_entry_t to free
+ * @param evicted non-zero when the entry is freed to make room
+ */
+static void cache_release(cache_t *cache, cache_entry_t *entry, int evicted)
+{
+    if (evicted && NULL != cache->on_evict)
+    {
+        cache->on_evict(entry->key, entry->key_len, entry->data,
+                        cache->context);
+    }
+    else
+    {
+        cache->index->customfree(entry->data);
+    }
+    free(entry);
+}
+
+/**
+ * @brief evicts one entry other than keep
+ *
+ * @param cache pointer to cache address
+ * @param keep entry that must stay, may be NULL
+ *
+ * @return int exit code, FAILURE when there is nothing to evict
+ */
+static int cache_evict_one(cache_t *cache, const cache_entry_t *keep)
+{
+    int status = FAILURE;
+    cache_entry_t *victim = cache_victim(cache, keep);
+
+    if (NULL != victim)
+    {
+        cache_unlink(cache, victim);
+        hash_table_remove_n(cache->index, victim->key, victim->key_len);
+        cache->evictions++;
+        cache_release(cache, victim, 1);
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief initializes an LRU cache holding up to max_entries entries
+ *
+ * @param max_entries number of entries to keep
+ * @param customfree pointer to the user defined free function
+ *
+ * @return cache_t pointer to allocated cache, NULL on failure
+ */
+cache_t *cache_init(uint32_t max_entries, FREE_F customfree)
+{
+    return cache_init_ex(max_entries, customfree, NULL);
+}
+
+/**
+ * @brief initializes a cache with the given options
+ *
+ * @param max_entries number of entries to keep, 0 for no limit
+ * @param customfree pointer to the user defined free function
+ * @param opts cache options, NULL selects every default
+ *
+ * @return cache_t pointer to allocated cache, NULL on failure or when
+ *         neither an entry nor a byte limit is set
+ */
+cache_t *cache_init_ex(uint32_t max_entries, FREE_F customfree,
+                       const cache_opts_t *opts)
+{
+    cache_opts_t settings = {0};
+    cache_t *cache = NULL;
+
+    if (NULL != opts)
+    {
+        settings = *opts;
+    }
+
+    if ((0 != max_entries || 0 != settings.max_bytes) &&
+        settings.policy <= CACHE_POLICY_LFU)
+    {
+        cache = (cache_t *)calloc(1, sizeof(cache_t));
+    }
+    if (NULL != cache)
+    {
+        cache->index = hash_table_init(
+            0 != max_entries ? max_entries : CACHE_DEFAULT_SIZE, customfree);
+        if (NULL == cache->index)
+        {
+            free(cache);
+            cache = NULL;
+        }
+    }
+    if (NULL != cache)
+    {
+        cache->policy = settings.policy;
+        cache->max_entries = max_entries;
+        cache->max_bytes = settings.max_bytes;
+        cache->on_evict = settings.on_evict;
+        cache->context = settings.context;
+    }
+
+    return cache;
+}
+
+/**
+ * @brief looks up key and marks its entry as used
+ *
+ * @param cache pointer to cache address
+ * @param key key for data being searched for
+ *
+ * @return data stored at key, NULL when missing
+ */
+void *cache_get(cache_t *cache, char *key)
+{
+    return cache_get_n(cache, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief looks up a key of len bytes and marks its entry as used
+ *
+ * @param cache pointer to cache address
+ * @param key key bytes for data being searched for
+ * @param len number of bytes in key
+ *
+ * @return data stored at key, NULL when missing
+ */
+void *cache_get_n(cache_t *cache, const void *key, size_t len)
+{
+    void *data = NULL;
+
+    if (NULL != cache && NULL != key)
+    {
+        cache_entry_t *entry =
+            (cache_entry_t *)hash_table_lookup_n(cache->index, key, len);
+        if (NULL != entry)
+        {
+            cache_touch(cache, entry);
+            data = entry->data;
+            cache->hits++;
+        }
+        else
+        {
+            cache->misses++;
+        }
+    }
+
+    return data;
+}
+
+/**
+ * @brief stores data at key, freeing the data it replaces, and evicts
+ *        entries until the cache is back within its limits
+ *
+ * @param cache pointer to cache address
+ * @param data data to be stored at that key value, not NULL
+ * @param key key for data to be stored at
+ * @param bytes size charged against max_bytes for data
+ *
+ * @return int exit code, FAILURE when bytes alone exceeds max_bytes
+ */
+int cache_put(cache_t *cache, void *data, char *key, size_t bytes)
+{
+    return cache_put_n(cache, data, key, NULL != key ? strlen(key) : 0, bytes);
+}
+
+/**
+ * @brief stores data at a key of len bytes
+ *
+ * The key is looked up and, when missing, added to the index in the same
+ * probe. The new or updated entry is never the one evicted to make room.
+ *
+ * @param cache pointer to cache address
+ * @param data data to be stored at that key value, not NULL
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ * @param bytes size charged against max_bytes for data
+ *
+ * @return int exit code
+ */
+int cache_put_n(cache_t *cache, void *data, const void *key, size_t len,
+                size_t bytes)
+{
+    int status = FAILURE;
+    void **slot = NULL;
+    cache_entry_t *entry = NULL;
+
+    if (NULL != cache && NULL != data && NULL != key &&
+        (0 == cache->max_bytes || bytes <= cache->max_bytes))
+    {
+        slot = hash_table_get_or_insert_n(cache->index, key, len, NULL);
+    }
+
+    if (NULL != slot && NULL != *slot)
+    {
+        cache_list_t *list = NULL;
+
+        entry = (cache_entry_t *)*slot;
+        list = cache_list_of(cache, entry);
+        if (entry->data != data)
+        {
+            cache->index->customfree(entry->data);
+        }
+        entry->data = data;
+        list->bytes += bytes - entry->bytes;
+        cache->bytes += bytes - entry->bytes;
+        entry->bytes = bytes;
+        cache_touch(cache, entry);
+        status = SUCCESS;
+    }
+    else if (NULL != slot)
+    {
+        entry = (cache_entry_t *)malloc(sizeof(cache_entry_t) + len + 1);
+        if (NULL != entry)
+        {
+            memcpy(entry->key, key, len);
+            entry->key[len] = '\0';
+            entry->key_len = (uint32_t)len;
+            entry->data = data;
+            entry->bytes = bytes;
+            entry->freq = NULL;
+            entry->segment = 0;
+            status = cache_link(cache, entry);
+        }
+        if (SUCCESS == status)
+        {
+            *slot = entry;
+        }
+        else
+        {
+            free(entry);
+            entry = NULL;
+            hash_table_remove_n(cache->index, key, len);
+        }
+    }
+
+    while (SUCCESS == status &&
+           ((0 != cache->max_entries && cache->count > cache->max_entries) ||
+            (0 != cache->max_bytes && cache->bytes > cache->max_bytes)) &&
+           SUCCESS == cache_evict_one(cache, entry))
+    {
+    }
+
+    return status;
+}
+
+/**
+ * @brief removes key and frees its data
+ *
+ * @param cache pointer to cache address
+ * @param key key of data to be removed
+ *
+ * @return int exit code, FAILURE when key is not present
+ */
+int cache_remove(cache_t *cache, char *key)
+{
+    return cache_remove_n(cache, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief removes a key of len bytes and frees its data
+ *
+ * @param cache pointer to cache address
+ * @param key key bytes of data to be removed
+ * @param len number of bytes in key
+ *
+ * @return int exit code, FAILURE when key is not present
+ */
+int cache_remove_n(cache_t *cache, const void *key, size_t len)
+{
+    int status = FAILURE;
+    cache_entry_t *entry = NULL;
+
+    if (NULL != cache && NULL != key)
+    {
+        entry = (cache_entry_t *)hash_table_lookup_n(cache->index, key, len);
+    }
+    if (NULL != entry)
+    {
+        cache_unlink(cache, entry);
+        hash_table_remove_n(cache->index, key, len);
+        cache_release(cache, entry, 0);
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief evicts the entry the cache's policy would evict next
+ *
+ * @param cache pointer to cache address
+ *
+ * @return int exit code, FAILURE when the cache is empty
+ */
+int cache_evict(cache_t *cache)
+{
+    int status = FAILURE;
+
+    if (NULL != cache)
+    {
+        status = cache_evict_one(cache, NULL);
+    }
+
+    return status;
+}
+
+/**
+ * @brief reports the size and counters of a cache
+ *
+ * @param cache pointer to cache address
+ * @param out receives the counters
+ *
+ * @return int exit code
+ */
+int cache_stats(cache_t *cache, cache_stats_t *out)
+{
+    int status = FAILURE;
+
+    if (NULL != cache && NULL != out)
+    {
+        out->count = cache->count;
+        out->bytes = cache->bytes;
+        out->hits = cache->hits;
+        out->misses = cache->misses;
+        out->evictions = cache->evictions;
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief frees every entry of a list along with its data
+ *
+ * @param cache pointer to cache address
+ * @param list list to empty
+ */
+static void cache_free_list(cache_t *cache, cache_list_t *list)
+{
+    while (NULL != list->head)
+    {
+        cache_entry_t *entry = list->head;
+        list->head = entry->next;
+        cache_release(cache, entry, 0);
+    }
+    memset(list, 0, sizeof(cache_list_t));
+}
+
+/**
+ * @brief frees every entry and its data, leaving the lists empty
+ *
+ * @param cache pointer to cache address
+ */
+static void cache_free_entries(cache_t *cache)
+{
+    while (NULL != cache->lowest)
+    {
+        cache_freq_t *freq = cache->lowest;
+        cache->lowest = freq->next;
+        cache_free_list(cache, &freq->entries);
+        free(freq);
+    }
+    cache_free_list(cache, &cache->segments[0]);
+    cache_free_list(cache, &cache->segments[1]);
+    cache->count = 0;
+    cache->bytes = 0;
+}
+
+/**
+ * @brief removes every entry, freeing its data, and keeps the counters
+ *
+ * @param cache pointer to cache address
+ *
+ * @return int exit code
+ */
+int cache_clear(cache_t *cache)
+{
+    int status = FAILURE;
+
+    if (NULL != cache)
+    {
+        cache_free_entries(cache);
+        status = hash_table_clear(cache->index);
+    }
+
+    return status;
+}
+
+/**
+ * @brief destroys the cache, freeing the data of every entry
+ *
+ * @param cache_addr pointer to cache address
+ *
+ * @return int exit code
+ */
+int cache_destroy(cache_t **cache_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != cache_addr && NULL != *cache_addr)
+    {
+        cache_free_entries(*cache_addr);
+        hash_table_destroy(&(*cache_addr)->index);
+        free(*cache_addr);
+        *cache_addr = NULL;
+        status = SUCCESS;
+    }
+
+    return status;
+}
@@ -0,0 +1,266 @@
+#include <hash_func.h>
+#include <string.h>
+#include <time.h>
+#include <sys/random.h>
+
+// wyhash secret constants (public domain, Wang Yi)
+static const uint64_t wy_secret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+/**
+ * @brief 64x64->128 bit multiply, low half returned in a, high half in b
+ */
+static inline void wy_mum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 u128;
+    u128 product = (u128)*a * *b;
+    *a = (uint64_t)product;
+    *b = (uint64_t)(product >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+/**
+ * @brief folds the 128 bit product of a and b into 64 bits
+ */
+static inline uint64_t wy_mix(uint64_t a, uint64_t b)
+{
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+    uint64_t value = 0;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t read32(const uint8_t *p)
+{
+    uint32_t value = 0;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief wyhash style hash, reading the key 8 bytes at a time and mixing
+ *        with 64x64->128 bit multiplies
+ *
+ * Keys up to 16 bytes are folded into two overlapping words without a loop;
+ * longer keys are consumed 16 or 48 bytes per iteration.
+ *
+ * @param key bytes to hash
+ * @param len number of bytes in key
+ * @param seed 128 bit seed
+ *
+ * @return 64 bit hash
+ */
+uint64_t hash_func_wy(const void *key, size_t len, const uint64_t seed[2])
+{
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t state = seed[0] ^ wy_mix(seed[1] ^ wy_secret[0], wy_secret[1]);
+    uint64_t a = 0;
+    uint64_t b = 0;
+
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            size_t shift = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + shift);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - shift);
+        }
+        else if (len > 0)
+        {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) |
+                p[len - 1];
+        }
+    }
+    else
+    {
+        size_t left = len;
+        if (left > 48)
+        {
+            uint64_t state1 = state;
+            uint64_t state2 = state;
+            do
+            {
+                state = wy_mix(read64(p) ^ wy_secret[1], read64(p + 8) ^ state);
+                state1 = wy_mix(read64(p + 16) ^ wy_secret[2],
+                                read64(p + 24) ^ state1);
+                state2 = wy_mix(read64(p + 32) ^ wy_secret[3],
+                                read64(p + 40) ^ state2);
+                p += 48;
+                left -= 48;
+            } while (left > 48);
+            state ^= state1 ^ state2;
+        }
+        while (left > 16)
+        {
+            state = wy_mix(read64(p) ^ wy_secret[1], read64(p + 8) ^ state);
+            p += 16;
+            left -= 16;
+        }
+        a = read64(p + left - 16);
+        b = read64(p + left - 8);
+    }
+
+    a ^= wy_secret[1];
+    b ^= state;
+    wy_mum(&a, &b);
+    return wy_mix(a ^ wy_secret[0] ^ len, b ^ wy_secret[1]);
+}
+
+#define SIP_ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIP_ROUND(v0, v1, v2, v3)                                              \
+    do                                                                         \
+    {                                                                          \
+        v0 += v1;                                                              \
+        v1 = SIP_ROTL(v1, 13);                                                 \
+        v1 ^= v0;                                                              \
+        v0 = SIP_ROTL(v0, 32);                                                 \
+        v2 += v3;                                                              \
+        v3 = SIP_ROTL(v3, 16);                                                 \
+        v3 ^= v2;                                                              \
+        v0 += v3;                                                              \
+        v3 = SIP_ROTL(v3, 21);                                                 \
+        v3 ^= v0;                                                              \
+        v2 += v1;                                                              \
+        v1 = SIP_ROTL(v1, 17);                                                 \
+        v1 ^= v2;                                                              \
+        v2 = SIP_ROTL(v2, 32);                                                 \
+    } while (0)
+
+/**
+ * @brief SipHash-2-4 keyed by seed
+ *
+ * @param key bytes to hash
+ * @param len number of bytes in key
+ * @param seed 128 bit secret key
+ *
+ * @return 64 bit hash
+ */
+uint64_t hash_func_sip(const void *key, size_t len, const uint64_t seed[2])
+{
+    const uint8_t *p = (const uint8_t *)key;
+    const uint8_t *end = p + (len & ~(size_t)7);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ seed[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ seed[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ seed[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ seed[1];
+    uint64_t last = (uint64_t)len << 56;
+
+    for (; p != end; p += 8)
+    {
+        uint64_t m = read64(p);
+        v3 ^= m;
+        SIP_ROUND(v0, v1, v2, v3);
+        SIP_ROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    for (size_t x = 0; x < (len & 7); x++)
+    {
+        last |= (uint64_t)p[x] << (8 * x);
+    }
+
+    v3 ^= last;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/**
+ * @brief multiply by 31 polynomial hash, the seed is ignored
+ *
+ * @param key bytes to hash
+ * @param len number of bytes in key
+ * @param seed unused
+ *
+ * @return 32 bit hash widened to 64 bits
+ */
+uint64_t hash_func_poly31(const void *key, size_t len, const uint64_t seed[2])
+{
+    const char *p = (const char *)key;
+    uint32_t hash = 0;
+    uint32_t prime = 31; // A small prime number
+
+    (void)seed;
+    for (size_t x = 0; x < len; x++)
+    {
+        hash = (hash * prime) + p[x];
+    }
+
+    return hash;
+}
+
+/**
+ * @brief returns the function implementing a hash family
+ *
+ * @param func hash family
+ *
+ * @return HASH_F pointer, NULL for an unknown family
+ */
+HASH_F hash_func_get(hash_func_t func)
+{
+    HASH_F hash = NULL;
+
+    switch (func)
+    {
+    case HASH_FUNC_WY:
+        hash = hash_func_wy;
+        break;
+    case HASH_FUNC_SIP:
+        hash = hash_func_sip;
+        break;
+    case HASH_FUNC_POLY31:
+        hash = hash_func_poly31;
+        break;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief fills seed with random bytes from the operating system
+ *
+ * Falls back to mixing the clock and stack address when the kernel
+ * entropy source is unavailable.
+ *
+ * @param seed 128 bit seed to fill
+ */
+void hash_func_random_seed(uint64_t seed[2])
+{
+    if (getrandom(seed, 2 * sizeof(uint64_t), 0) !=
+        (ssize_t)(2 * sizeof(uint64_t)))
+    {
+        struct timespec now = {0};
+        const uint64_t zero[2] = {0, 0};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        seed[0] = (uint64_t)now.tv_nsec ^ ((uint64_t)now.tv_sec << 32);
+        seed[1] = (uint64_t)(uintptr_t)&now;
+        seed[0] = hash_func_wy(seed, 2 * sizeof(uint64_t), zero);
+        seed[1] = hash_func_wy(seed, 2 * sizeof(uint64_t), zero);
+    }
+}
@@ -0,0 +1,442 @@
+#include <hash_map_u64.h>
+#include <hash_func.h>
+
+#define U64_MIN_CAPACITY 16
+
+/**
+ * @brief scrambles a key into a slot hash
+ *
+ * The murmur3 64 bit finalizer: every input bit flips about half of the
+ * output bits, so sequential ids spread over the whole array. It is a
+ * bijection, so keys never collide on the full hash, only on the slot.
+ *
+ * @param key key to mix
+ * @param seed random seed
+ *
+ * @return mixed key
+ */
+static inline uint64_t u64_mix(uint64_t key, uint64_t seed)
+{
+    key ^= seed;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+
+    return key;
+}
+
+/**
+ * @brief number of slots allowed to be full in an array of capacity slots
+ */
+static inline uint32_t u64_max_load(uint32_t capacity)
+{
+    return capacity - capacity / 4;
+}
+
+/**
+ * @brief finds the slot holding key, or the empty slot ending its probe
+ *
+ * @param entries slot array to search
+ * @param mask capacity minus one
+ * @param seed seed of the map
+ * @param key non-zero key being searched for
+ *
+ * @return slot index
+ */
+static inline uint32_t u64_find(const hash_map_u64_entry_t *entries,
+                                uint32_t mask, uint64_t seed, uint64_t key)
+{
+    uint32_t slot = (uint32_t)u64_mix(key, seed) & mask;
+
+    while (0 != entries[slot].key && key != entries[slot].key)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/**
+ * @brief moves every key into a slot array of twice the capacity
+ *
+ * @param map pointer to map address
+ *
+ * @return int exit code
+ */
+static int u64_grow(hash_map_u64_t *map)
+{
+    int status = SUCCESS;
+    uint32_t capacity = map->capacity * 2;
+    hash_map_u64_entry_t *entries = NULL;
+
+    if (0 != capacity)
+    {
+        entries = (hash_map_u64_entry_t *)calloc(capacity,
+                                                 sizeof(hash_map_u64_entry_t));
+    }
+
+    if (NULL == entries)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        for (uint32_t x = 0; x < map->capacity; x++)
+        {
+            if (0 != map->entries[x].key)
+            {
+                uint32_t slot = u64_find(entries, capacity - 1, map->seed,
+                                         map->entries[x].key);
+                entries[slot] = map->entries[x];
+            }
+        }
+        free(map->entries);
+        map->entries = entries;
+        map->capacity = capacity;
+    }
+
+    return status;
+}
+
+/**
+ * @brief initializes an integer keyed map
+ *
+ * @param size number of keys to reserve room for
+ *
+ * @return hash_map_u64_t pointer to allocated map, NULL on failure
+ */
+hash_map_u64_t *hash_map_u64_init(uint32_t size)
+{
+    hash_map_u64_t *map = NULL;
+    uint32_t capacity = U64_MIN_CAPACITY;
+    uint64_t seed[2] = {0};
+
+    while (0 != capacity && u64_max_load(capacity) < size)
+    {
+        capacity *= 2;
+    }
+
+    if (0 != capacity)
+    {
+        map = (hash_map_u64_t *)calloc(1, sizeof(hash_map_u64_t));
+    }
+    if (NULL != map)
+    {
+        map->entries = (hash_map_u64_entry_t *)calloc(
+            capacity, sizeof(hash_map_u64_entry_t));
+        if (NULL == map->entries)
+        {
+            free(map);
+            map = NULL;
+        }
+    }
+    if (NULL != map)
+    {
+        // a random seed keeps crafted ids from piling onto one run of slots
+        hash_func_random_seed(seed);
+        map->seed = seed[0];
+        map->capacity = capacity;
+    }
+
+    return map;
+}
+
+/**
+ * @brief returns the value slot of key, adding key with value in the same
+ *        probe when it is not present
+ *
+ * @param map pointer to map address
+ * @param key key being searched for
+ * @param value value to store when key is not present
+ *
+ * @return pointer to the value stored at key, NULL on failure
+ */
+static uint64_t *u64_upsert(hash_map_u64_t *map, uint64_t key, uint64_t value)
+{
+    uint64_t *slot_value = NULL;
+
+    if (0 == key)
+    {
+        if (!map->has_zero)
+        {
+            map->has_zero = 1;
+            map->zero = value;
+            map->count++;
+        }
+        slot_value = &map->zero;
+    }
+    else
+    {
+        uint32_t slot = u64_find(map->entries, map->capacity - 1, map->seed,
+                                 key);
+
+        if (0 == map->entries[slot].key &&
+            map->count - map->has_zero >= u64_max_load(map->capacity))
+        {
+            if (SUCCESS == u64_grow(map))
+            {
+                slot = u64_find(map->entries, map->capacity - 1, map->seed,
+                                key);
+            }
+            else
+            {
+                slot = map->capacity;
+            }
+        }
+
+        if (slot != map->capacity)
+        {
+            if (0 == map->entries[slot].key)
+            {
+                map->entries[slot].key = key;
+                map->entries[slot].value = value;
+                map->count++;
+            }
+            slot_value = &map->entries[slot].value;
+        }
+    }
+
+    return slot_value;
+}
+
+/**
+ * @brief stores value at key, replacing the value already stored there
+ *
+ * @param map pointer to map address
+ * @param key key to store value at
+ * @param value value to store
+ *
+ * @return int exit code
+ */
+int hash_map_u64_put(hash_map_u64_t *map, uint64_t key, uint64_t value)
+{
+    int status = FAILURE;
+
+    if (NULL != map)
+    {
+        uint64_t *slot_value = u64_upsert(map, key, value);
+        if (NULL != slot_value)
+        {
+            *slot_value = value;
+            status = SUCCESS;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief looks up the value stored at key
+ *
+ * @param map pointer to map address
+ * @param key key being searched for
+ * @param value receives the value stored at key, may be NULL
+ *
+ * @return SUCCESS when key is present, FAILURE otherwise
+ */
+int hash_map_u64_get(hash_map_u64_t *map, uint64_t key, uint64_t *value)
+{
+    int status = FAILURE;
+    uint64_t found = 0;
+
+    if (NULL != map && 0 == key)
+    {
+        status = map->has_zero ? SUCCESS : FAILURE;
+        found = map->zero;
+    }
+    else if (NULL != map)
+    {
+        const hash_map_u64_entry_t *entry = &map->entries[u64_find(
+            map->entries, map->capacity - 1, map->seed, key)];
+        status = 0 != entry->key ? SUCCESS : FAILURE;
+        found = entry->value;
+    }
+
+    if (SUCCESS == status && NULL != value)
+    {
+        *value = found;
+    }
+
+    return status;
+}
+
+/**
+ * @brief returns the value slot of key, adding key with value in the same
+ *        probe when it is not present
+ *
+ * @param map pointer to map address
+ * @param key key being searched for
+ * @param value value to store when key is not present
+ *
+ * @return pointer to the value stored at key, NULL on failure
+ */
+uint64_t *hash_map_u64_get_or_insert(hash_map_u64_t *map, uint64_t key,
+                                     uint64_t value)
+{
+    uint64_t *slot_value = NULL;
+
+    if (NULL != map)
+    {
+        slot_value = u64_upsert(map, key, value);
+    }
+
+    return slot_value;
+}
+
+/**
+ * @brief removes key, shifting back every following key of the run whose
+ *        probe passed through the freed slot
+ *
+ * @param map pointer to map address
+ * @param key key to remove
+ * @param value receives the value that was stored at key, may be NULL
+ *
+ * @return SUCCESS when key was removed, FAILURE when it was not present
+ */
+int hash_map_u64_remove(hash_map_u64_t *map, uint64_t key, uint64_t *value)
+{
+    int status = FAILURE;
+    uint64_t found = 0;
+
+    if (NULL != map && 0 == key && map->has_zero)
+    {
+        found = map->zero;
+        map->has_zero = 0;
+        map->zero = 0;
+        map->count--;
+        status = SUCCESS;
+    }
+    else if (NULL != map && 0 != key)
+    {
+        uint32_t mask = map->capacity - 1;
+        uint32_t hole = u64_find(map->entries, mask, map->seed, key);
+
+        if (0 != map->entries[hole].key)
+        {
+            found = map->entries[hole].value;
+            for (uint32_t next = (hole + 1) & mask;
+                 0 != map->entries[next].key; next = (next + 1) & mask)
+            {
+                uint32_t home =
+                    (uint32_t)u64_mix(map->entries[next].key, map->seed) &
+                    mask;
+                // a key may fill the hole unless its home lies after the
+                // hole, cyclically, on the way from the hole to the key
+                if (((next - home) & mask) >= ((next - hole) & mask))
+                {
+                    map->entries[hole] = map->entries[next];
+                    hole = next;
+                }
+            }
+            map->entries[hole].key = 0;
+            map->entries[hole].value = 0;
+            map->count--;
+            status = SUCCESS;
+        }
+    }
+
+    if (SUCCESS == status && NULL != value)
+    {
+        *value = found;
+    }
+
+    return status;
+}
+
+/**
+ * @brief steps through every key of the map in slot order, key 0 first
+ *
+ * @param map pointer to map address
+ * @param cursor 0 to start, then passed back unchanged
+ * @param key receives the next key
+ * @param value receives the value stored at it, may be NULL
+ *
+ * @return SUCCESS while a key was returned, FAILURE once every key was
+ */
+int hash_map_u64_next(hash_map_u64_t *map, uint64_t *cursor, uint64_t *key,
+                      uint64_t *value)
+{
+    int status = FAILURE;
+    uint64_t found = 0;
+
+    if (NULL != map && NULL != cursor && NULL != key)
+    {
+        // cursor 0 stands for key 0, cursor n + 1 for slot n
+        if (0 == *cursor)
+        {
+            (*cursor)++;
+            if (map->has_zero)
+            {
+                *key = 0;
+                found = map->zero;
+                status = SUCCESS;
+            }
+        }
+        while (SUCCESS != status && *cursor <= map->capacity)
+        {
+            const hash_map_u64_entry_t *entry = &map->entries[*cursor - 1];
+            (*cursor)++;
+            if (0 != entry->key)
+            {
+                *key = entry->key;
+                found = entry->value;
+                status = SUCCESS;
+            }
+        }
+    }
+
+    if (SUCCESS == status && NULL != value)
+    {
+        *value = found;
+    }
+
+    return status;
+}
+
+/**
+ * @brief removes every key but keeps the slot array
+ *
+ * @param map pointer to map address
+ *
+ * @return int exit code
+ */
+int hash_map_u64_clear(hash_map_u64_t *map)
+{
+    int status = FAILURE;
+
+    if (NULL != map)
+    {
+        memset(map->entries, 0,
+               map->capacity * sizeof(hash_map_u64_entry_t));
+        map->count = 0;
+        map->has_zero = 0;
+        map->zero = 0;
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief destroys the map
+ *
+ * @param map_addr pointer to map address
+ *
+ * @return int exit code
+ */
+int hash_map_u64_destroy(hash_map_u64_t **map_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != map_addr && NULL != *map_addr)
+    {
+        free((*map_addr)->entries);
+        free(*map_addr);
+        *map_addr = NULL;
+        status = SUCCESS;
+    }
+
+    return status;
+}
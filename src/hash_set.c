@@ -0,0 +1,823 @@
+#include <hash_set.h>
+#include <arena.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define SET_GROUP_WIDTH 16
+#define SET_CTRL_EMPTY ((int8_t)-128)
+#define SET_CTRL_DELETED ((int8_t)-2)
+#define SET_KEY_CHUNK (64 * 1024)
+#define SET_MAX_CAPACITY (1U << 29)
+#define SET_PREFETCH_DISTANCE 8
+
+static uint64_t set_seed[2] = {0};
+static pthread_once_t set_seed_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief draws the seed shared by every set of the process
+ */
+static void set_seed_init(void)
+{
+    hash_func_random_seed(set_seed);
+}
+
+/**
+ * @brief hashes a key with the process wide seed
+ *
+ * The low 7 bits become the control byte and the bits above them pick the
+ * home group, so 32 bits cover sets of up to SET_MAX_CAPACITY slots.
+ */
+static inline uint32_t set_hash(const void *key, size_t len)
+{
+    pthread_once(&set_seed_once, set_seed_init);
+
+    return (uint32_t)hash_func_wy(key, len, set_seed);
+}
+
+/**
+ * @brief bitmask of the slots in a group whose control byte equals value
+ *
+ * @param ctrl first control byte of the group
+ * @param value control byte to search for
+ *
+ * @return bit i set when slot i of the group matches
+ */
+static inline uint32_t set_group_match(const int8_t *ctrl, int8_t value)
+{
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+    uint32_t mask = 0;
+    for (uint32_t x = 0; x < SET_GROUP_WIDTH; x++)
+    {
+        mask |= (uint32_t)(ctrl[x] == value) << x;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief bitmask of the slots in a group that are empty or deleted
+ *
+ * @param ctrl first control byte of the group
+ *
+ * @return bit i set when slot i of the group is free
+ */
+static inline uint32_t set_group_match_free(const int8_t *ctrl)
+{
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_loadu_si128((const __m128i *)ctrl));
+#else
+    uint32_t mask = 0;
+    for (uint32_t x = 0; x < SET_GROUP_WIDTH; x++)
+    {
+        mask |= (uint32_t)(ctrl[x] < 0) << x;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief number of keys allowed in a set of the given capacity
+ */
+static inline uint32_t set_max_load(uint32_t capacity)
+{
+    return capacity - capacity / 8;
+}
+
+/**
+ * @brief smallest capacity holding size keys, 0 when none is allowed
+ */
+static uint32_t set_capacity_for(uint32_t size)
+{
+    uint32_t capacity = SET_GROUP_WIDTH;
+
+    while (capacity <= SET_MAX_CAPACITY && set_max_load(capacity) < size)
+    {
+        capacity *= 2;
+    }
+
+    return capacity <= SET_MAX_CAPACITY ? capacity : 0;
+}
+
+/**
+ * @brief first control byte of the home group of a hash
+ */
+static inline const int8_t *set_home_group(const hash_set_t *set,
+                                           uint32_t hash)
+{
+    uint32_t group_mask = set->capacity / SET_GROUP_WIDTH - 1;
+
+    return set->ctrl + ((hash >> 7) & group_mask) * SET_GROUP_WIDTH;
+}
+
+/**
+ * @brief allocates an empty slot array of the given capacity
+ *
+ * @param set set to fill in
+ * @param capacity number of slots, a power of two multiple of 16
+ *
+ * @return int exit code
+ */
+static int set_alloc(hash_set_t *set, uint32_t capacity)
+{
+    int status = SUCCESS;
+    int8_t *ctrl = NULL;
+    hash_set_slot_t *slots = NULL;
+
+    if (0 != capacity)
+    {
+        ctrl = (int8_t *)malloc(capacity);
+        slots = (hash_set_slot_t *)malloc(capacity * sizeof(hash_set_slot_t));
+    }
+
+    if (NULL == ctrl || NULL == slots)
+    {
+        free(ctrl);
+        free(slots);
+        status = FAILURE;
+    }
+    else
+    {
+        memset(ctrl, SET_CTRL_EMPTY, capacity);
+        set->ctrl = ctrl;
+        set->slots = slots;
+        set->capacity = capacity;
+        set->count = 0;
+        set->growth_left = set_max_load(capacity);
+    }
+
+    return status;
+}
+
+/**
+ * @brief finds the first empty or deleted slot on the probe sequence of
+ *        hash; the load limit guarantees one exists
+ *
+ * @param set set to search
+ * @param hash hash of the key being inserted
+ *
+ * @return slot index
+ */
+static uint32_t set_find_free(const hash_set_t *set, uint32_t hash)
+{
+    uint32_t group_mask = set->capacity / SET_GROUP_WIDTH - 1;
+    uint32_t group = (hash >> 7) & group_mask;
+    uint32_t match = 0;
+
+    for (uint32_t step = 1;; step++)
+    {
+        match = set_group_match_free(set->ctrl + group * SET_GROUP_WIDTH);
+        if (0 != match)
+        {
+            break;
+        }
+        group = (group + step) & group_mask;
+    }
+
+    return group * SET_GROUP_WIDTH + (uint32_t)__builtin_ctz(match);
+}
+
+/**
+ * @brief finds the slot holding key
+ *
+ * Groups are visited in triangular order. Candidates whose control byte
+ * matches are checked against the stored 32 bit hash before the key bytes
+ * are touched.
+ *
+ * @param set set to search
+ * @param key key being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return slot index, or capacity when key is not present
+ */
+static uint32_t set_find(const hash_set_t *set, const char *key, uint32_t len,
+                         uint32_t hash)
+{
+    uint32_t group_mask = set->capacity / SET_GROUP_WIDTH - 1;
+    uint32_t group = (hash >> 7) & group_mask;
+    int8_t h2 = (int8_t)(hash & 0x7f);
+    uint32_t index = set->capacity;
+
+    for (uint32_t step = 1; index == set->capacity; step++)
+    {
+        const int8_t *ctrl = set->ctrl + group * SET_GROUP_WIDTH;
+        uint32_t match = set_group_match(ctrl, h2);
+        while (0 != match)
+        {
+            uint32_t slot = group * SET_GROUP_WIDTH +
+                            (uint32_t)__builtin_ctz(match);
+            const hash_set_slot_t *candidate = &set->slots[slot];
+            if (candidate->hash == hash && candidate->len == len &&
+                memcmp(key, candidate->key, len) == 0)
+            {
+                index = slot;
+                break;
+            }
+            match &= match - 1;
+        }
+
+        // an empty slot ends every probe sequence that reached this group
+        if (index == set->capacity &&
+            0 != set_group_match(ctrl, SET_CTRL_EMPTY))
+        {
+            break;
+        }
+        group = (group + step) & group_mask;
+    }
+
+    return index;
+}
+
+/**
+ * @brief stores a slot known not to be in the set in the first free slot
+ *        of its probe sequence, without comparing keys
+ *
+ * @param set set to store into, with growth left
+ * @param slot slot to store, its key owned by the set
+ */
+static void set_place(hash_set_t *set, const hash_set_slot_t *slot)
+{
+    uint32_t index = set_find_free(set, slot->hash);
+
+    if (SET_CTRL_EMPTY == set->ctrl[index])
+    {
+        set->growth_left--;
+    }
+    set->ctrl[index] = (int8_t)(slot->hash & 0x7f);
+    set->slots[index] = *slot;
+    set->count++;
+}
+
+/**
+ * @brief moves every key into a new slot array, dropping deleted markers
+ *        and doubling the capacity when more than half of the load limit
+ *        is in use
+ *
+ * @param set pointer to set address
+ * @param size number of keys the new array must hold
+ *
+ * @return int exit code
+ */
+static int set_rebuild(hash_set_t *set, uint32_t size)
+{
+    int status = SUCCESS;
+    hash_set_t rebuilt = {0};
+    uint32_t capacity = set->capacity;
+
+    if (set->count >= set_max_load(capacity) / 2 &&
+        capacity < SET_MAX_CAPACITY)
+    {
+        capacity *= 2;
+    }
+    if (set_max_load(capacity) < size)
+    {
+        capacity = set_capacity_for(size);
+    }
+
+    if (SUCCESS != set_alloc(&rebuilt, capacity))
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        for (uint32_t x = 0; x < set->capacity; x++)
+        {
+            if (set->ctrl[x] >= 0)
+            {
+                set_place(&rebuilt, &set->slots[x]);
+            }
+        }
+        free(set->ctrl);
+        free(set->slots);
+        set->ctrl = rebuilt.ctrl;
+        set->slots = rebuilt.slots;
+        set->capacity = rebuilt.capacity;
+        set->growth_left = rebuilt.growth_left;
+    }
+
+    return status;
+}
+
+/**
+ * @brief makes room for extra more keys without a rebuild
+ *
+ * @param set pointer to set address
+ * @param extra number of keys about to be added
+ *
+ * @return int exit code
+ */
+static int set_reserve(hash_set_t *set, uint32_t extra)
+{
+    int status = SUCCESS;
+
+    if (set->growth_left < extra)
+    {
+        status = extra <= UINT32_MAX - set->count ?
+                     set_rebuild(set, set->count + extra) :
+                     FAILURE;
+    }
+
+    return status;
+}
+
+/**
+ * @brief copies key bytes into the set's arena and stores them
+ *
+ * @param set pointer to set address, with growth left
+ * @param key key bytes
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int exit code
+ */
+static int set_insert(hash_set_t *set, const char *key, uint32_t len,
+                      uint32_t hash)
+{
+    int status = SUCCESS;
+    char *copy = (char *)arena_alloc(set->keys, (size_t)len + 1);
+
+    if (NULL == copy)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        memcpy(copy, key, len);
+        copy[len] = '\0';
+        set->live_bytes += (size_t)len + 1;
+        set_place(set, &(hash_set_slot_t){copy, len, hash});
+    }
+
+    return status;
+}
+
+/**
+ * @brief copies every key into a fresh arena once removed keys take up
+ *        more of the arena than live ones, so the copy is paid for by the
+ *        removes before it
+ *
+ * @param set pointer to set address
+ */
+static void set_compact(hash_set_t *set)
+{
+    arena_t *keys = NULL;
+
+    if (set->dead_bytes > set->live_bytes + SET_KEY_CHUNK)
+    {
+        keys = arena_init(SET_KEY_CHUNK);
+    }
+
+    for (uint32_t x = 0; NULL != keys && x < set->capacity; x++)
+    {
+        if (set->ctrl[x] >= 0)
+        {
+            char *copy = (char *)arena_alloc(keys, set->slots[x].len + 1);
+            if (NULL == copy)
+            {
+                // the old arena still holds every key
+                arena_destroy(&keys);
+            }
+            else
+            {
+                memcpy(copy, set->slots[x].key, set->slots[x].len + 1);
+                set->slots[x].key = copy;
+            }
+        }
+    }
+
+    if (NULL != keys)
+    {
+        arena_destroy(&set->keys);
+        set->keys = keys;
+        set->dead_bytes = 0;
+    }
+}
+
+/**
+ * @brief initializes a set
+ *
+ * @param size number of keys to reserve room for
+ *
+ * @return hash_set_t pointer to allocated set, NULL on failure
+ */
+hash_set_t *hash_set_init(uint32_t size)
+{
+    hash_set_t *set = (hash_set_t *)calloc(1, sizeof(hash_set_t));
+
+    if (NULL != set)
+    {
+        set->keys = arena_init(SET_KEY_CHUNK);
+        if (NULL == set->keys ||
+            SUCCESS != set_alloc(set, set_capacity_for(size)))
+        {
+            arena_destroy(&set->keys);
+            free(set);
+            set = NULL;
+        }
+    }
+
+    return set;
+}
+
+/**
+ * @brief adds key to the set
+ *
+ * @param set pointer to set address
+ * @param key key to add
+ *
+ * @return SUCCESS when key was added, FAILURE when it was already present
+ *         or on failure
+ */
+int hash_set_add(hash_set_t *set, char *key)
+{
+    return hash_set_add_n(set, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief adds a key of len bytes to the set
+ *
+ * @param set pointer to set address
+ * @param key key bytes to add
+ * @param len number of bytes in key
+ *
+ * @return SUCCESS when key was added, FAILURE when it was already present
+ *         or on failure
+ */
+int hash_set_add_n(hash_set_t *set, const void *key, size_t len)
+{
+    int status = FAILURE;
+
+    if (NULL != set && NULL != key && len < UINT32_MAX)
+    {
+        uint32_t hash = set_hash(key, len);
+        if (set_find(set, key, (uint32_t)len, hash) == set->capacity &&
+            SUCCESS == set_reserve(set, 1))
+        {
+            status = set_insert(set, key, (uint32_t)len, hash);
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief tests whether key is in the set
+ *
+ * @param set pointer to set address
+ * @param key key being searched for
+ *
+ * @return non-zero when key is present
+ */
+int hash_set_contains(const hash_set_t *set, char *key)
+{
+    return hash_set_contains_n(set, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief tests whether a key of len bytes is in the set
+ *
+ * @param set pointer to set address
+ * @param key key bytes being searched for
+ * @param len number of bytes in key
+ *
+ * @return non-zero when key is present
+ */
+int hash_set_contains_n(const hash_set_t *set, const void *key, size_t len)
+{
+    int found = 0;
+
+    if (NULL != set && NULL != key && len < UINT32_MAX)
+    {
+        found = set_find(set, key, (uint32_t)len, set_hash(key, len)) !=
+                set->capacity;
+    }
+
+    return found;
+}
+
+/**
+ * @brief removes key from the set
+ *
+ * @param set pointer to set address
+ * @param key key to remove
+ *
+ * @return SUCCESS when key was removed, FAILURE when it was not present
+ */
+int hash_set_remove(hash_set_t *set, char *key)
+{
+    return hash_set_remove_n(set, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief removes a key of len bytes from the set
+ *
+ * @param set pointer to set address
+ * @param key key bytes to remove
+ * @param len number of bytes in key
+ *
+ * @return SUCCESS when key was removed, FAILURE when it was not present
+ */
+int hash_set_remove_n(hash_set_t *set, const void *key, size_t len)
+{
+    int status = FAILURE;
+    uint32_t slot = 0;
+
+    if (NULL != set && NULL != key && len < UINT32_MAX &&
+        (slot = set_find(set, key, (uint32_t)len, set_hash(key, len))) !=
+            set->capacity)
+    {
+        const int8_t *group = set->ctrl + (slot & ~(SET_GROUP_WIDTH - 1));
+        if (0 != set_group_match(group, SET_CTRL_EMPTY))
+        {
+            set->ctrl[slot] = SET_CTRL_EMPTY;
+            set->growth_left++;
+        }
+        else
+        {
+            set->ctrl[slot] = SET_CTRL_DELETED;
+        }
+        set->count--;
+        set->live_bytes -= (size_t)set->slots[slot].len + 1;
+        set->dead_bytes += (size_t)set->slots[slot].len + 1;
+        set_compact(set);
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief steps through every key of the set in slot order
+ *
+ * @param set pointer to set address
+ * @param cursor 0 to start, then passed back unchanged
+ * @param key receives the next key, owned by the set
+ * @param len receives the number of bytes in key, may be NULL
+ *
+ * @return SUCCESS while a key was returned, FAILURE once every key was
+ */
+int hash_set_next(const hash_set_t *set, uint64_t *cursor, const char **key,
+                  uint32_t *len)
+{
+    int status = FAILURE;
+
+    if (NULL != set && NULL != cursor && NULL != key)
+    {
+        while (*cursor < set->capacity && set->ctrl[*cursor] < 0)
+        {
+            (*cursor)++;
+        }
+        if (*cursor < set->capacity)
+        {
+            *key = set->slots[*cursor].key;
+            if (NULL != len)
+            {
+                *len = set->slots[*cursor].len;
+            }
+            (*cursor)++;
+            status = SUCCESS;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief walks the full slots of walk and probes each key in probe with
+ *        the hash walk stored for it, adding it to out when its presence
+ *        in probe equals keep
+ *
+ * The home group of the key SET_PREFETCH_DISTANCE slots ahead is
+ * prefetched, so the probes of consecutive keys overlap their cache misses
+ * instead of waiting on each one in turn.
+ *
+ * @param walk set whose keys are visited
+ * @param probe set the keys are looked up in
+ * @param keep non-zero to keep keys found in probe, 0 to keep the others
+ * @param out set receiving the kept keys, with room for them; NULL to
+ *            only count them
+ * @param status set to FAILURE when a key could not be added to out
+ *
+ * @return number of keys kept
+ */
+static uint32_t set_probe_all(const hash_set_t *walk, const hash_set_t *probe,
+                              int keep, hash_set_t *out, int *status)
+{
+    uint32_t kept = 0;
+
+    for (uint32_t x = 0; SUCCESS == *status && x < walk->capacity; x++)
+    {
+        if (x + SET_PREFETCH_DISTANCE < walk->capacity &&
+            walk->ctrl[x + SET_PREFETCH_DISTANCE] >= 0)
+        {
+            __builtin_prefetch(set_home_group(
+                probe, walk->slots[x + SET_PREFETCH_DISTANCE].hash));
+        }
+        if (walk->ctrl[x] >= 0)
+        {
+            const hash_set_slot_t *slot = &walk->slots[x];
+            int found = set_find(probe, slot->key, slot->len, slot->hash) !=
+                        probe->capacity;
+            if (found == keep)
+            {
+                kept++;
+                if (NULL != out)
+                {
+                    *status = set_insert(out, slot->key, slot->len,
+                                         slot->hash);
+                }
+            }
+        }
+    }
+
+    return kept;
+}
+
+/**
+ * @brief builds the union of two sets
+ *
+ * @param a first set
+ * @param b second set
+ *
+ * @return hash_set_t pointer to a new set, NULL on failure
+ */
+hash_set_t *hash_set_union(const hash_set_t *a, const hash_set_t *b)
+{
+    hash_set_t *out = NULL;
+    int status = FAILURE;
+
+    if (NULL != a && NULL != b && a->count <= UINT32_MAX - b->count)
+    {
+        const hash_set_t *large = a->count >= b->count ? a : b;
+        const hash_set_t *small = large == a ? b : a;
+        out = hash_set_init(a->count + b->count);
+        status = NULL != out ? SUCCESS : FAILURE;
+
+        // keys of one set are distinct, so they are placed without a probe
+        for (uint32_t x = 0; SUCCESS == status && x < large->capacity; x++)
+        {
+            if (large->ctrl[x] >= 0)
+            {
+                status = set_insert(out, large->slots[x].key,
+                                    large->slots[x].len,
+                                    large->slots[x].hash);
+            }
+        }
+        if (SUCCESS == status)
+        {
+            set_probe_all(small, large, 0, out, &status);
+        }
+    }
+
+    if (SUCCESS != status)
+    {
+        hash_set_destroy(&out);
+    }
+
+    return out;
+}
+
+/**
+ * @brief builds the intersection of two sets
+ *
+ * @param a first set
+ * @param b second set
+ *
+ * @return hash_set_t pointer to a new set, NULL on failure
+ */
+hash_set_t *hash_set_intersection(const hash_set_t *a, const hash_set_t *b)
+{
+    hash_set_t *out = NULL;
+    int status = FAILURE;
+
+    if (NULL != a && NULL != b)
+    {
+        const hash_set_t *large = a->count >= b->count ? a : b;
+        const hash_set_t *small = large == a ? b : a;
+        out = hash_set_init(small->count);
+        status = NULL != out ? SUCCESS : FAILURE;
+        if (SUCCESS == status && 0 != large->count)
+        {
+            set_probe_all(small, large, 1, out, &status);
+        }
+    }
+
+    if (SUCCESS != status)
+    {
+        hash_set_destroy(&out);
+    }
+
+    return out;
+}
+
+/**
+ * @brief builds the keys of a that are not in b
+ *
+ * @param a set keys are taken from
+ * @param b set of keys to leave out
+ *
+ * @return hash_set_t pointer to a new set, NULL on failure
+ */
+hash_set_t *hash_set_difference(const hash_set_t *a, const hash_set_t *b)
+{
+    hash_set_t *out = NULL;
+    int status = FAILURE;
+
+    if (NULL != a && NULL != b)
+    {
+        out = hash_set_init(a->count);
+        status = NULL != out ? SUCCESS : FAILURE;
+        if (SUCCESS == status)
+        {
+            set_probe_all(a, b, 0, out, &status);
+        }
+    }
+
+    if (SUCCESS != status)
+    {
+        hash_set_destroy(&out);
+    }
+
+    return out;
+}
+
+/**
+ * @brief counts the keys two sets share without building their
+ *        intersection
+ *
+ * @param a first set
+ * @param b second set
+ *
+ * @return number of shared keys, 0 when either set is NULL
+ */
+uint32_t hash_set_intersection_count(const hash_set_t *a, const hash_set_t *b)
+{
+    uint32_t count = 0;
+    int status = SUCCESS;
+
+    if (NULL != a && NULL != b && 0 != a->count && 0 != b->count)
+    {
+        const hash_set_t *large = a->count >= b->count ? a : b;
+        const hash_set_t *small = large == a ? b : a;
+        count = set_probe_all(small, large, 1, NULL, &status);
+    }
+
+    return count;
+}
+
+/**
+ * @brief removes every key but keeps the slot array
+ *
+ * @param set pointer to set address
+ *
+ * @return int exit code
+ */
+int hash_set_clear(hash_set_t *set)
+{
+    int status = FAILURE;
+
+    if (NULL != set)
+    {
+        memset(set->ctrl, SET_CTRL_EMPTY, set->capacity);
+        set->count = 0;
+        set->growth_left = set_max_load(set->capacity);
+        arena_clear(set->keys);
+        set->live_bytes = 0;
+        set->dead_bytes = 0;
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief destroys the set
+ *
+ * @param set_addr pointer to set address
+ *
+ * @return int exit code
+ */
+int hash_set_destroy(hash_set_t **set_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != set_addr && NULL != *set_addr)
+    {
+        free((*set_addr)->ctrl);
+        free((*set_addr)->slots);
+        arena_destroy(&(*set_addr)->keys);
+        free(*set_addr);
+        *set_addr = NULL;
+        status = SUCCESS;
+    }
+
+    return status;
+}
@@ -1,109 +1,1945 @@
 #include <hash_table.h>
+#include <arena.h>
+#include <bloom.h>
+#include <pthread.h>
+#include <stddef.h>
+#include "hash_table_internal.h"
+
+#define DEFAULT_MAX_LOAD_FACTOR 1.0
+#define DEFAULT_MIN_LOAD_FACTOR 0.1
+#define DEFAULT_REHASH_STEP 1
+#define REHASH_EMPTY_VISITS 10
+#define SLAB_NODES_PER_CHUNK 1024
+#define KEY_ARENA_CHUNK (64 * 1024)
+#define CACHE_LINE 64
+#define DEFAULT_LOCK_STRIPES 64
+#define SCAN_STEPS_PER_ENTRY 10
+#define COLLECT_SCAN_COUNT 1024
+#define BLOOM_MIN_CAPACITY 64
+#define BLOOM_REBUILD_MIN 64
+
+_Thread_local uint32_t hash_table_thread_slot = 0;
+// bit n set while a thread owns counter slot n; slot 0 and the bits past
+// the last slot are never handed out
+static uint64_t thread_slots_owned =
+    1 | ~((2ULL << (HASH_TABLE_COUNTER_SLOTS - 1)) - 1);
+static pthread_once_t thread_slot_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_slot_key;
 
 /**
  * @brief initializes hash table
  *
  * @param size number indexes in the table
  *
- * @return hash_table_t pointer to allocated table
+ * @return hash_table_t pointer to allocated table
+ */
+hash_table_t *hash_table_init(uint32_t size, FREE_F customfree)
+{
+    return hash_table_init_ex(size, customfree, NULL);
+}
+
+/**
+ * @brief initializes hash table backed by the swiss engine
+ *
+ * @param size number of entries to reserve room for
+ *
+ * @return hash_table_t pointer to allocated table
+ */
+hash_table_t *hash_table_init_swiss(uint32_t size, FREE_F customfree)
+{
+    hash_table_opts_t opts = {.engine = HASH_ENGINE_SWISS};
+
+    return hash_table_init_ex(size, customfree, &opts);
+}
+
+/**
+ * @brief initializes hash table that can be shared between threads
+ *
+ * @param size number indexes in the table
+ *
+ * @return hash_table_t pointer to allocated table
+ */
+hash_table_t *hash_table_init_concurrent(uint32_t size, FREE_F customfree)
+{
+    hash_table_opts_t opts = {.sync = HASH_SYNC_STRIPED};
+
+    return hash_table_init_ex(size, customfree, &opts);
+}
+
+/**
+ * @brief checks that the requested synchronization mode can be combined
+ *        with the rest of the options
+ *
+ * Stripes must never straddle a bucket, so striping needs chained buckets.
+ * RCU readers walk node_t chains, or search cuckoo buckets and check their
+ * versions, which no other engine offers. The slab and arena
+ * allocators are not thread safe and clear their memory without waiting
+ * for readers.
+ *
+ * @param opts table options with defaults applied
+ *
+ * @return non-zero when supported
+ */
+static int sync_supported(const hash_table_opts_t *opts)
+{
+    int supported = 0;
+
+    switch (opts->sync)
+    {
+    case HASH_SYNC_NONE:
+        supported = 1;
+        break;
+    case HASH_SYNC_STRIPED:
+        supported = HASH_ENGINE_CHAINED == opts->engine && !opts->use_slab &&
+                    0 == (opts->lock_stripes & (opts->lock_stripes - 1));
+        break;
+    case HASH_SYNC_RCU:
+        supported = (HASH_ENGINE_CHAINED == opts->engine ||
+                     HASH_ENGINE_CUCKOO == opts->engine) &&
+                    !opts->use_slab;
+        break;
+    }
+
+    return supported;
+}
+
+/**
+ * @brief initializes hash table with the given options
+ *
+ * @param size number indexes in the table
+ * @param customfree pointer to the user defined free function
+ * @param opts table options, NULL selects every default
+ *
+ * @return hash_table_t pointer to allocated table, NULL on failure or when
+ *         the options are out of range
+ */
+hash_table_t *hash_table_init_ex(uint32_t size, FREE_F customfree,
+                                 const hash_table_opts_t *opts)
+{
+    hash_table_opts_t settings = {0};
+    const hash_engine_ops_t *ops = NULL;
+    hash_table_t *hash_table = NULL;
+
+    if (NULL != opts)
+    {
+        settings = *opts;
+    }
+    if (0 == settings.max_load_factor)
+    {
+        settings.max_load_factor = DEFAULT_MAX_LOAD_FACTOR;
+    }
+    if (0 == settings.min_load_factor)
+    {
+        settings.min_load_factor = DEFAULT_MIN_LOAD_FACTOR;
+    }
+    if (0 == settings.rehash_step)
+    {
+        settings.rehash_step = DEFAULT_REHASH_STEP;
+    }
+    if (0 == settings.lock_stripes)
+    {
+        settings.lock_stripes = DEFAULT_LOCK_STRIPES;
+    }
+    if (0 != settings.ttl_tick_ms)
+    {
+        // expiry timers may outlive the nodes they were set for, which
+        // stay readable in a slab
+        settings.use_slab = 1;
+    }
+
+    switch (settings.engine)
+    {
+    case HASH_ENGINE_CHAINED:
+        ops = HASH_SYNC_RCU == settings.sync ? &rcu_engine_ops :
+                                               &chained_engine_ops;
+        break;
+    case HASH_ENGINE_SWISS:
+        ops = &swiss_engine_ops;
+        break;
+    case HASH_ENGINE_ROBIN_HOOD:
+        ops = &robin_engine_ops;
+        break;
+    case HASH_ENGINE_CUCKOO:
+        ops = &cuckoo_engine_ops;
+        break;
+    case HASH_ENGINE_MAPPED:
+    case HASH_ENGINE_FROZEN:
+        // read-only, built by hash_table_open_mapped and hash_table_freeze
+        break;
+    }
+
+    // shrinking halves the bucket count and so doubles the load; it must
+    // not land the table straight back above the growth threshold
+    if (0 != size && NULL != ops && NULL != hash_func_get(settings.hash_func) &&
+        settings.max_load_factor > 0 &&
+        settings.min_load_factor > 0 &&
+        2 * settings.min_load_factor <= settings.max_load_factor &&
+        sync_supported(&settings) &&
+        (0 == settings.bloom_fp_rate ||
+         (HASH_SYNC_NONE == settings.sync && settings.bloom_fp_rate > 0 &&
+          settings.bloom_fp_rate < 1)) &&
+        (0 == settings.ttl_tick_ms ||
+         (HASH_ENGINE_CHAINED == settings.engine &&
+          HASH_SYNC_NONE == settings.sync)))
+    {
+        // the table gets cache lines of its own, so the count every add and
+        // remove writes never shares a line with another table, such as a
+        // neighbouring shard of a sharded_table_t
+        size_t bytes = (sizeof(hash_table_t) + CACHE_LINE - 1) &
+                       ~(size_t)(CACHE_LINE - 1);
+        hash_table = (hash_table_t *)aligned_alloc(CACHE_LINE, bytes);
+        if (NULL != hash_table)
+        {
+            memset(hash_table, 0, bytes);
+        }
+    }
+
+    // every bucket must map to exactly one lock stripe
+    if (HASH_SYNC_STRIPED == settings.sync && size < settings.lock_stripes)
+    {
+        size = settings.lock_stripes;
+    }
+
+    if (NULL != hash_table)
+    {
+        hash_table->customfree = customfree ? customfree : free;
+        hash_table->engine = settings.engine;
+        hash_table->ops = ops;
+        hash_table->hash_func = settings.hash_func;
+        hash_table->hash = hash_func_get(settings.hash_func);
+        if (0 == settings.seed[0] && 0 == settings.seed[1])
+        {
+            hash_func_random_seed(settings.seed);
+        }
+        hash_table->seed[0] = settings.seed[0];
+        hash_table->seed[1] = settings.seed[1];
+        hash_table->min_size = size;
+        hash_table->max_load_factor = settings.max_load_factor;
+        hash_table->min_load_factor = settings.min_load_factor;
+        hash_table->rehash_step = settings.rehash_step;
+        hash_table->sync = settings.sync;
+        if (SUCCESS != ops->init(hash_table, size))
+        {
+            free(hash_table);
+            hash_table = NULL;
+        }
+    }
+
+    if (NULL != hash_table && HASH_SYNC_STRIPED == settings.sync &&
+        SUCCESS != hash_table_sync_init(hash_table, settings.lock_stripes))
+    {
+        hash_table_destroy(&hash_table);
+    }
+    if (NULL != hash_table && HASH_SYNC_RCU == settings.sync &&
+        SUCCESS != hash_table_rcu_init(hash_table))
+    {
+        hash_table_destroy(&hash_table);
+    }
+
+    if (NULL != hash_table &&
+        SUCCESS != hash_table_counters_init(hash_table,
+                                            HASH_SYNC_NONE != settings.sync))
+    {
+        hash_table_destroy(&hash_table);
+    }
+
+    if (NULL != hash_table && settings.use_slab)
+    {
+        hash_table->node_slab = slab_init(sizeof(node_t), SLAB_NODES_PER_CHUNK);
+        hash_table->key_arena = arena_init(KEY_ARENA_CHUNK);
+        if (NULL == hash_table->node_slab || NULL == hash_table->key_arena)
+        {
+            hash_table_destroy(&hash_table);
+        }
+    }
+
+    if (NULL != hash_table && 0 != settings.bloom_fp_rate)
+    {
+        hash_table->bloom = bloom_init(
+            size > BLOOM_MIN_CAPACITY ? size : BLOOM_MIN_CAPACITY,
+            settings.bloom_fp_rate);
+        if (NULL == hash_table->bloom)
+        {
+            hash_table_destroy(&hash_table);
+        }
+    }
+
+    if (NULL != hash_table && 0 != settings.ttl_tick_ms)
+    {
+        hash_table->ttl = hash_table_ttl_init(settings.ttl_tick_ms);
+        if (NULL == hash_table->ttl)
+        {
+            hash_table_destroy(&hash_table);
+        }
+    }
+
+    return hash_table;
+}
+
+/**
+ * @brief copies key bytes into table owned memory, from the key arena when
+ *        the table has one
+ *
+ * @param table pointer to table address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return NUL terminated copy of key, NULL on allocation failure
+ */
+char *hash_table_key_copy(hash_table_t *table, const char *key, uint32_t len)
+{
+    char *copy = NULL;
+
+    if (NULL != table->key_arena)
+    {
+        copy = (char *)arena_alloc(table->key_arena, (size_t)len + 1);
+    }
+    else
+    {
+        copy = (char *)malloc((size_t)len + 1);
+    }
+
+    if (NULL != copy)
+    {
+        memcpy(copy, key, len);
+        copy[len] = '\0';
+    }
+
+    return copy;
+}
+
+/**
+ * @brief frees a key copied by hash_table_key_copy; arena keys stay until
+ *        the table is cleared
+ *
+ * @param table pointer to table address
+ * @param key key copy to free
+ */
+void hash_table_key_free(hash_table_t *table, char *key)
+{
+    if (NULL == table->key_arena)
+    {
+        free(key);
+    }
+}
+
+/**
+ * @brief gives an exiting thread's counter slot back
+ *
+ * The release orders the thread's last counter stores before the slot's
+ * next owner adds to them.
+ *
+ * @param slot slot owned by the thread, as stored by pthread_setspecific
+ */
+static void thread_slot_release(void *slot)
+{
+    __atomic_fetch_and(&thread_slots_owned, ~(1ULL << (uintptr_t)slot),
+                       __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief creates the key whose destructor gives counter slots back
+ */
+static void thread_slot_key_create(void)
+{
+    pthread_key_create(&thread_slot_key, thread_slot_release);
+}
+
+/**
+ * @brief hands the calling thread a counter slot no other live thread
+ *        owns, given back when the thread exits
+ *
+ * @return the thread's slot, HASH_TABLE_COUNTER_SLOTS when every slot is
+ *         owned
+ */
+uint32_t hash_table_thread_slot_assign(void)
+{
+    uint32_t slot = HASH_TABLE_COUNTER_SLOTS;
+    uint64_t owned = __atomic_load_n(&thread_slots_owned, __ATOMIC_RELAXED);
+
+    pthread_once(&thread_slot_once, thread_slot_key_create);
+    while (HASH_TABLE_COUNTER_SLOTS == slot && UINT64_MAX != owned)
+    {
+        uint32_t free_slot = (uint32_t)__builtin_ctzll(~owned);
+        if (__atomic_compare_exchange_n(&thread_slots_owned, &owned,
+                                        owned | (1ULL << free_slot), 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            slot = free_slot;
+        }
+    }
+    if (HASH_TABLE_COUNTER_SLOTS != slot &&
+        0 != pthread_setspecific(thread_slot_key, (void *)(uintptr_t)slot))
+    {
+        // without a destructor the slot would never be given back
+        thread_slot_release((void *)(uintptr_t)slot);
+        slot = HASH_TABLE_COUNTER_SLOTS;
+    }
+    hash_table_thread_slot = slot;
+
+    return slot;
+}
+
+/**
+ * @brief allocates the lookup counters of a table
+ *
+ * @param table pointer to table address
+ * @param shared non-zero when several threads may look keys up at once
+ *
+ * @return int exit code
+ */
+int hash_table_counters_init(hash_table_t *table, int shared)
+{
+    int status = SUCCESS;
+    uint32_t slots = shared ? HASH_TABLE_COUNTER_SLOTS : 1;
+
+    table->counters = (hash_table_counters_t *)aligned_alloc(
+        sizeof(hash_table_counters_t), slots * sizeof(hash_table_counters_t));
+    if (NULL == table->counters)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        memset(table->counters, 0, slots * sizeof(hash_table_counters_t));
+        table->counter_mask = slots - 1;
+    }
+
+    return status;
+}
+
+/**
+ * @brief index of a hash's bucket in a power of two sized bucket array
+ * @param hash The key hash
+ * @param table_size The size of the bucket array
+ *
+ * @return index
+ */
+static inline uint32_t bucket_index(uint64_t hash, uint32_t table_size)
+{
+    return (uint32_t)hash & (table_size - 1);
+}
+
+/**
+ * @brief frees a node_t and its key when the key lives outside the node,
+ *        returning slab nodes to the slab's free list
+ *
+ * @param table pointer to table address
+ * @param node node_t to free
+ */
+void hash_table_node_free(hash_table_t *table, node_t *node)
+{
+    if (node->key != node->key_inline)
+    {
+        hash_table_key_free(table, node->key);
+    }
+
+    if (NULL != table->node_slab)
+    {
+        // a pending expiry timer finds the node without a TTL and drops
+        node->expires = 0;
+        slab_free(table->node_slab, node);
+    }
+    else
+    {
+        free(node);
+    }
+}
+
+/**
+ * @brief allocates a node_t, copying keys shorter than
+ *        HASH_TABLE_INLINE_KEY into the node itself
+ *
+ * Nodes come from the table's slab when it has one.
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return node_t pointer, NULL on allocation failure
+ */
+node_t *hash_table_node_create(hash_table_t *table, void *data,
+                               const char *key, uint32_t len, uint64_t hash)
+{
+    node_t *new_node = NULL;
+
+    if (NULL != table->node_slab)
+    {
+        new_node = (node_t *)slab_alloc(table->node_slab);
+    }
+    else
+    {
+        new_node = (node_t *)malloc(sizeof(node_t));
+    }
+
+    if (NULL != new_node)
+    {
+        if (len < HASH_TABLE_INLINE_KEY)
+        {
+            new_node->key = new_node->key_inline;
+            memcpy(new_node->key, key, len);
+            new_node->key[len] = '\0';
+        }
+        else
+        {
+            new_node->key = hash_table_key_copy(table, key, len);
+        }
+
+        if (NULL == new_node->key)
+        {
+            new_node->key = new_node->key_inline;
+            hash_table_node_free(table, new_node);
+            new_node = NULL;
+        }
+        else
+        {
+            new_node->key_len = len;
+            new_node->hash = hash;
+            new_node->data = data;
+            new_node->next = NULL;
+            new_node->expires = 0;
+        }
+    }
+
+    return new_node;
+}
+
+/**
+ * @brief allocates the bucket array of the chained engine
+ *
+ * @param table pointer to table address
+ * @param size number indexes in the table, rounded up to a power of two
+ *
+ * @return int exit code
+ */
+static int chained_init(hash_table_t *table, uint32_t size)
+{
+    int status = SUCCESS;
+    uint32_t buckets = 1;
+
+    while (buckets != 0 && buckets < size)
+    {
+        buckets *= 2;
+    }
+
+    if (0 != buckets)
+    {
+        table->table = (node_t **)calloc(buckets, sizeof(node_t *));
+    }
+    if (NULL == table->table)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        table->size = buckets;
+        table->min_size = buckets;
+    }
+
+    return status;
+}
+
+/**
+ * @brief starts moving the entries into a bucket array of new_size
+ *
+ * Failing to allocate the new array is not an error, the table just keeps
+ * working with longer chains and retries on a later operation.
+ *
+ * @param table pointer to table address
+ * @param new_size number indexes in the new bucket array
+ */
+static void chained_rehash_start(hash_table_t *table, uint32_t new_size)
+{
+    table->rehash_table = (node_t **)calloc(new_size, sizeof(node_t *));
+    if (NULL != table->rehash_table)
+    {
+        table->rehash_size = new_size;
+        table->rehash_index = 0;
+    }
+}
+
+/**
+ * @brief moves up to rehash_step non-empty buckets into rehash_table
+ *
+ * Each moved chain is pushed onto the front of its new buckets in its
+ * original order, ahead of anything added since the rehash started, so
+ * duplicate keys keep resolving to the oldest entry. At most
+ * REHASH_EMPTY_VISITS empty buckets are skipped per moved bucket to keep
+ * the step bounded on sparse tables.
+ *
+ * @param table pointer to table address
+ */
+static void chained_rehash_step(hash_table_t *table)
+{
+    uint32_t buckets = table->rehash_step;
+    uint32_t empty_visits = buckets * REHASH_EMPTY_VISITS;
+
+    while (0 != buckets && table->rehash_index < table->size)
+    {
+        node_t *current = table->table[table->rehash_index];
+        if (NULL == current)
+        {
+            table->rehash_index++;
+            if (0 == --empty_visits)
+            {
+                break;
+            }
+            continue;
+        }
+
+        node_t *reversed = NULL;
+        while (NULL != current)
+        {
+            node_t *next = current->next;
+            current->next = reversed;
+            reversed = current;
+            current = next;
+        }
+        while (NULL != reversed)
+        {
+            node_t *next = reversed->next;
+            uint32_t index = bucket_index(reversed->hash, table->rehash_size);
+            reversed->next = table->rehash_table[index];
+            table->rehash_table[index] = reversed;
+            reversed = next;
+        }
+        table->table[table->rehash_index++] = NULL;
+        buckets--;
+    }
+
+    if (table->rehash_index >= table->size)
+    {
+        free(table->table);
+        table->table = table->rehash_table;
+        table->size = table->rehash_size;
+        table->rehash_table = NULL;
+        table->rehash_size = 0;
+        table->rehash_index = 0;
+    }
+}
+
+/**
+ * @brief advances a running rehash, or starts one when the load factor has
+ *        left the configured range
+ *
+ * Striped tables are left alone, see hash_table_sync_unlock.
+ *
+ * @param table pointer to table address
+ */
+static void chained_rehash_check(hash_table_t *table)
+{
+    if (NULL != table->sync_data)
+    {
+        // striped tables resize under every stripe lock instead
+    }
+    else if (NULL != table->rehash_table)
+    {
+        chained_rehash_step(table);
+    }
+    else if (table->count > table->size * table->max_load_factor &&
+             table->size <= UINT32_MAX / 2)
+    {
+        chained_rehash_start(table, table->size * 2);
+    }
+    else if (table->count < table->size * table->min_load_factor &&
+             table->size / 2 >= table->min_size)
+    {
+        // shrink straight to the smallest size that still leaves the table
+        // half way below the growth threshold
+        uint32_t new_size = table->size / 2;
+        while (new_size / 2 >= table->min_size &&
+               table->count < (new_size / 2) * table->max_load_factor / 2)
+        {
+            new_size /= 2;
+        }
+        chained_rehash_start(table, new_size);
+    }
+}
+
+/**
+ * @brief moves every entry into a bucket array of new_size in one pass
+ *
+ * @param table pointer to table address
+ * @param new_size number indexes in the new bucket array, a power of two
+ */
+void hash_table_chained_resize(hash_table_t *table, uint32_t new_size)
+{
+    chained_rehash_start(table, new_size);
+    while (NULL != table->rehash_table)
+    {
+        chained_rehash_step(table);
+    }
+}
+
+/**
+ * @brief finds the first node_t stored at key in either bucket array
+ *
+ * The key's bucket in table is walked first; it is simply empty once it
+ * has been moved. The key's bucket in rehash_table is walked next.
+ * Expired entries are passed over.
+ *
+ * @param table pointer to table address
+ * @param key key being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param link_out set to the pointer that links the found node_t
+ * @param probes incremented for every node_t compared with key
+ *
+ * @return node_t pointer, NULL when key is not present
+ */
+static node_t *chained_find(hash_table_t *table, const char *key, uint32_t len,
+                            uint64_t hash, node_t ***link_out,
+                            uint32_t *probes)
+{
+    node_t *found = NULL;
+    node_t **link = &table->table[bucket_index(hash, table->size)];
+
+    for (int pass = 0; NULL == found && pass < 2; pass++)
+    {
+        if (1 == pass)
+        {
+            if (NULL == table->rehash_table)
+            {
+                break;
+            }
+            link = &table->rehash_table[bucket_index(hash, table->rehash_size)];
+        }
+
+        while (NULL != *link &&
+               (!hash_table_node_matches(*link, key, len, hash) ||
+                hash_table_node_expired(table, *link)))
+        {
+            link = &(*link)->next;
+            (*probes)++;
+        }
+        found = *link;
+        *probes += NULL != found;
+    }
+
+    *link_out = link;
+    return found;
+}
+
+/**
+ * @brief appends a new node_t to the chain of the key's bucket
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return the new node_t, NULL on allocation failure
+ */
+static node_t *chained_append(hash_table_t *table, void *data,
+                              const char *key, uint32_t len, uint64_t hash)
+{
+    chained_rehash_check(table);
+
+    node_t *new_node = hash_table_node_create(table, data, key, len, hash);
+    if (NULL != new_node)
+    {
+        node_t **bucket = NULL;
+        if (NULL != table->rehash_table)
+        {
+            bucket = &table->rehash_table[bucket_index(hash, table->rehash_size)];
+        }
+        else
+        {
+            bucket = &table->table[bucket_index(hash, table->size)];
+        }
+
+        while (NULL != *bucket)
+        {
+            bucket = &(*bucket)->next;
+        }
+        *bucket = new_node;
+    }
+
+    return new_node;
+}
+
+/**
+ * @brief appends a new node_t to the chain of the key's bucket
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int exit code
+ */
+static int chained_add(hash_table_t *table, void *data, const char *key,
+                       uint32_t len, uint64_t hash)
+{
+    return NULL != chained_append(table, data, key, len, hash) ? SUCCESS :
+                                                                 FAILURE;
+}
+
+/**
+ * @brief finds the node_t stored at key, appending a new one holding data
+ *        at the end of the same chain walk when there is none
+ *
+ * @param table pointer to table address
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param data data to store when key is not present
+ * @param inserted set to non-zero when a new node_t was added
+ *
+ * @return pointer to the node's data, NULL on allocation failure
+ */
+static void **chained_upsert(hash_table_t *table, const char *key,
+                             uint32_t len, uint64_t hash, void *data,
+                             int *inserted)
+{
+    void **value = NULL;
+    node_t **link = NULL;
+    uint32_t probes = 0;
+
+    chained_rehash_check(table);
+
+    // a miss leaves link at the end of the chain new keys are added to
+    node_t *current = chained_find(table, key, len, hash, &link, &probes);
+    *inserted = 0;
+    if (NULL != current)
+    {
+        value = &current->data;
+    }
+    else
+    {
+        current = hash_table_node_create(table, data, key, len, hash);
+        if (NULL != current)
+        {
+            *link = current;
+            value = &current->data;
+            *inserted = 1;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief walks the chain of the key's bucket looking for key
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return void * data
+ */
+static void *chained_lookup(hash_table_t *table, const char *key, uint32_t len,
+                            uint64_t hash)
+{
+    void *node_data = NULL;
+    node_t **link = NULL;
+    uint32_t probes = 0;
+
+    if (NULL != table->rehash_table)
+    {
+        chained_rehash_step(table);
+    }
+
+    node_t *current = chained_find(table, key, len, hash, &link, &probes);
+    if (NULL != current)
+    {
+        node_data = current->data;
+    }
+    hash_table_count_lookups(table, 1, NULL != current, probes);
+
+    return node_data;
+}
+
+/**
+ * @brief looks up a group of keys in stages: every bucket is prefetched,
+ *        then every chain head, then every out of line key, before the
+ *        chains are walked, so the cache misses of the keys overlap
+ *
+ * @param table pointer to table address
+ * @param keys keys being searched for
+ * @param lens number of bytes in each key
+ * @param hashes hash of each key
+ * @param n number of keys, at most HASH_TABLE_BATCH
+ * @param out data stored at each key, NULL when missing
+ */
+static void chained_lookup_batch(hash_table_t *table, const char *const *keys,
+                                 const uint32_t *lens, const uint64_t *hashes,
+                                 uint32_t n, void **out)
+{
+    node_t *heads[HASH_TABLE_BATCH];
+
+    if (NULL != table->rehash_table || NULL != table->ttl)
+    {
+        for (uint32_t x = 0; x < n; x++)
+        {
+            out[x] = chained_lookup(table, keys[x], lens[x], hashes[x]);
+        }
+    }
+    else
+    {
+        for (uint32_t x = 0; x < n; x++)
+        {
+            __builtin_prefetch(
+                &table->table[bucket_index(hashes[x], table->size)]);
+        }
+        for (uint32_t x = 0; x < n; x++)
+        {
+            heads[x] = table->table[bucket_index(hashes[x], table->size)];
+            __builtin_prefetch(heads[x]);
+        }
+        for (uint32_t x = 0; x < n; x++)
+        {
+            if (NULL != heads[x] && heads[x]->hash == hashes[x] &&
+                heads[x]->key != heads[x]->key_inline)
+            {
+                __builtin_prefetch(heads[x]->key);
+            }
+        }
+        uint32_t hits = 0;
+        uint32_t probes = 0;
+        for (uint32_t x = 0; x < n; x++)
+        {
+            node_t *current = heads[x];
+            while (NULL != current &&
+                   !hash_table_node_matches(current, keys[x], lens[x],
+                                            hashes[x]))
+            {
+                current = current->next;
+                probes++;
+            }
+            out[x] = NULL != current ? current->data : NULL;
+            hits += NULL != current;
+        }
+        hash_table_count_lookups(table, n, hits, probes + hits);
+    }
+}
+
+/**
+ * @brief unlinks and frees the first node_t stored at key
+ *
+ * @param table pointer to table address
+ * @param key key of data to be removed
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int
+ */
+static int chained_remove(hash_table_t *table, const char *key, uint32_t len,
+                          uint64_t hash)
+{
+    int status = SUCCESS;
+    node_t **link = NULL;
+    uint32_t probes = 0;
+
+    chained_rehash_check(table);
+
+    node_t *current = chained_find(table, key, len, hash, &link, &probes);
+    if (NULL == current)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        //free the node
+        *link = current->next;
+        hash_table_node_free(table, current);
+    }
+
+    return status;
+}
+
+/**
+ * @brief unlinks a node_t from whichever bucket array holds it, without
+ *        freeing it
+ *
+ * @param table pointer to table address
+ * @param node node_t to unlink, which must be in the table
+ */
+static void chained_unlink(hash_table_t *table, node_t *node)
+{
+    node_t **link = &table->table[bucket_index(node->hash, table->size)];
+
+    while (NULL != *link && node != *link)
+    {
+        link = &(*link)->next;
+    }
+    if (NULL == *link && NULL != table->rehash_table)
+    {
+        link = &table->rehash_table[bucket_index(node->hash,
+                                                 table->rehash_size)];
+        while (node != *link)
+        {
+            link = &(*link)->next;
+        }
+    }
+    *link = node->next;
+}
+
+/**
+ * @brief passes every unexpired node_t of a chain to a scan callback
+ *
+ * @param table pointer to table address
+ * @param current first node_t of the chain
+ * @param callback function called for every node_t
+ * @param context pointer passed through to callback
+ *
+ * @return number of nodes visited
+ */
+static uint32_t chained_scan_chain(hash_table_t *table, node_t *current,
+                                   HASH_SCAN_F callback, void *context)
+{
+    uint32_t visited = 0;
+
+    while (NULL != current)
+    {
+        if (!hash_table_node_expired(table, current))
+        {
+            callback(current->key, current->key_len, current->data, context);
+            visited++;
+        }
+        current = current->next;
+    }
+
+    return visited;
+}
+
+/**
+ * @brief visits the bucket the cursor points at
+ *
+ * While rehashing, the cursor's bucket in the smaller array is visited
+ * along with every bucket of the larger array it splits into, so entries
+ * are found whichever array they currently sit in.
+ *
+ * @param table pointer to table address
+ * @param cursor current cursor
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ * @param emitted incremented for every visited entry
+ *
+ * @return next cursor, 0 once every bucket was visited
+ */
+static uint64_t chained_scan(hash_table_t *table, uint64_t cursor,
+                             HASH_SCAN_F callback, void *context,
+                             uint32_t *emitted)
+{
+    if (NULL == table->rehash_table)
+    {
+        uint64_t mask = table->size - 1;
+        *emitted += chained_scan_chain(table, table->table[cursor & mask],
+                                       callback, context);
+        cursor = hash_table_cursor_next(cursor, mask);
+    }
+    else
+    {
+        node_t **small = table->table;
+        node_t **large = table->rehash_table;
+        uint64_t small_mask = table->size - 1;
+        uint64_t large_mask = table->rehash_size - 1;
+        if (table->size > table->rehash_size)
+        {
+            small = table->rehash_table;
+            large = table->table;
+            small_mask = table->rehash_size - 1;
+            large_mask = table->size - 1;
+        }
+
+        *emitted += chained_scan_chain(table, small[cursor & small_mask],
+                                       callback, context);
+        do
+        {
+            *emitted += chained_scan_chain(table, large[cursor & large_mask],
+                                           callback, context);
+            cursor = hash_table_cursor_next(cursor, large_mask);
+        } while (0 != (cursor & (small_mask ^ large_mask)));
+    }
+
+    return cursor;
+}
+
+/**
+ * @brief frees every node_t of a bucket array
+ *
+ * Slab allocated nodes are not visited at all; hash_table_clear releases
+ * the whole slab afterwards, so only the bucket array is reset.
+ *
+ * @param table pointer to table address
+ * @param buckets bucket array to empty
+ * @param size number indexes in buckets
+ */
+static void chained_free_buckets(hash_table_t *table, node_t **buckets,
+                                 uint32_t size)
+{
+    for (uint32_t x = 0; NULL == table->node_slab && x < size; x++)
+    {
+        node_t *current = buckets[x];
+        while (current != NULL)
+        {
+            node_t *node_to_free = current;
+            current = current->next;
+            hash_table_node_free(table, node_to_free);
+        }
+    }
+    memset(buckets, 0, size * sizeof(node_t *));
+}
+
+/**
+ * @brief frees every node_t in every bucket, finishing any running rehash
+ *        by keeping the larger of the two bucket arrays
+ *
+ * @param table pointer to table address
+ */
+static void chained_clear(hash_table_t *table)
+{
+    chained_free_buckets(table, table->table, table->size);
+    if (NULL != table->rehash_table)
+    {
+        chained_free_buckets(table, table->rehash_table, table->rehash_size);
+        if (table->rehash_size > table->size)
+        {
+            free(table->table);
+            table->table = table->rehash_table;
+            table->size = table->rehash_size;
+        }
+        else
+        {
+            free(table->rehash_table);
+        }
+        table->rehash_table = NULL;
+        table->rehash_size = 0;
+        table->rehash_index = 0;
+    }
+}
+
+/**
+ * @brief records the chain lengths and memory of a bucket array
+ *
+ * @param buckets bucket array to walk
+ * @param size number indexes in buckets
+ * @param out stats being filled in
+ */
+static void chained_stats_buckets(node_t **buckets, uint32_t size,
+                                  hash_table_stats_t *out)
+{
+    for (uint32_t x = 0; x < size; x++)
+    {
+        uint32_t length = 0;
+        for (node_t *current = buckets[x]; NULL != current;
+             current = current->next)
+        {
+            out->bytes_used += hash_table_node_bytes(current);
+            length++;
+        }
+        hash_table_stats_record(out, length, 1);
+    }
+    out->bytes_used += size * sizeof(node_t *);
+}
+
+/**
+ * @brief reports the chain lengths of both bucket arrays of a table that
+ *        is being rehashed
+ *
+ * @param table pointer to table address
+ * @param out stats being filled in
+ */
+static void chained_stats(hash_table_t *table, hash_table_stats_t *out)
+{
+    chained_stats_buckets(table->table, table->size, out);
+    out->buckets = table->size;
+    if (NULL != table->rehash_table)
+    {
+        chained_stats_buckets(table->rehash_table, table->rehash_size, out);
+        out->buckets += table->rehash_size;
+    }
+}
+
+/**
+ * @brief frees the bucket array of the chained engine
+ *
+ * @param table pointer to table address
+ */
+static void chained_destroy(hash_table_t *table)
+{
+    chained_clear(table);
+    free(table->table);
+    table->table = NULL;
+}
+
+const hash_engine_ops_t chained_engine_ops = {
+    .init = chained_init,
+    .add = chained_add,
+    .lookup = chained_lookup,
+    .remove = chained_remove,
+    .clear = chained_clear,
+    .destroy = chained_destroy,
+    .lookup_batch = chained_lookup_batch,
+    .upsert = chained_upsert,
+    .scan = chained_scan,
+    .stats = chained_stats,
+};
+
+/**
+ * @brief read-only tables are only created from existing tables or
+ *        snapshots, never by hash_table_init_ex
+ *
+ * @return FAILURE
+ */
+int hash_table_readonly_init(hash_table_t *table, uint32_t size)
+{
+    (void)table;
+    (void)size;
+
+    return FAILURE;
+}
+
+/**
+ * @brief read-only tables refuse new entries
+ *
+ * @return FAILURE
+ */
+int hash_table_readonly_add(hash_table_t *table, void *data, const char *key,
+                            uint32_t len, uint64_t hash)
+{
+    (void)table;
+    (void)data;
+    (void)key;
+    (void)len;
+    (void)hash;
+
+    return FAILURE;
+}
+
+/**
+ * @brief read-only tables refuse removals
+ *
+ * @return FAILURE
+ */
+int hash_table_readonly_remove(hash_table_t *table, const char *key,
+                               uint32_t len, uint64_t hash)
+{
+    (void)table;
+    (void)key;
+    (void)len;
+    (void)hash;
+
+    return FAILURE;
+}
+
+/**
+ * @brief read-only tables are never cleared, hash_table_clear refuses them
+ *        before getting here
+ *
+ * @param table pointer to table address
+ */
+void hash_table_readonly_clear(hash_table_t *table)
+{
+    (void)table;
+}
+
+/**
+ * @brief read-only tables hand out no writable data slots
+ *
+ * @return NULL
+ */
+void **hash_table_readonly_upsert(hash_table_t *table, const char *key,
+                                  uint32_t len, uint64_t hash, void *data,
+                                  int *inserted)
+{
+    (void)table;
+    (void)key;
+    (void)len;
+    (void)hash;
+    (void)data;
+    *inserted = 0;
+
+    return NULL;
+}
+
+/**
+ * @brief entries gathered by collect_entry
+ *
+ * @param table     table being collected
+ * @param entries   collected entries
+ * @param count     number of collected entries
+ * @param capacity  number of entries that fit in entries
+ * @param status    FAILURE once an allocation failed
+ */
+typedef struct collect_context_t
+{
+    hash_table_t *table;
+    hash_table_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+    int status;
+} collect_context_t;
+
+/**
+ * @brief scan callback appending every entry to a collect_context_t
+ */
+static void collect_entry(const char *key, uint32_t len, void *data,
+                          void *context)
+{
+    collect_context_t *collect = (collect_context_t *)context;
+
+    if (collect->count == collect->capacity && SUCCESS == collect->status)
+    {
+        uint32_t capacity = 0 != collect->capacity ? collect->capacity * 2 :
+                                                     COLLECT_SCAN_COUNT;
+        hash_table_entry_t *entries = (hash_table_entry_t *)realloc(
+            collect->entries, capacity * sizeof(hash_table_entry_t));
+        if (NULL == entries || capacity < collect->capacity)
+        {
+            collect->status = FAILURE;
+        }
+        else
+        {
+            collect->entries = entries;
+            collect->capacity = capacity;
+        }
+    }
+
+    if (SUCCESS == collect->status)
+    {
+        collect->entries[collect->count++] = (hash_table_entry_t){
+            key, data, hash_table_hash(collect->table, key, len), len};
+    }
+}
+
+/**
+ * @brief lists every entry of a table in scan order
+ *
+ * @param table pointer to table address
+ * @param entries receives a malloc'd array of the entries
+ * @param count receives the number of entries
+ *
+ * @return int exit code
+ */
+int hash_table_collect(hash_table_t *table, hash_table_entry_t **entries,
+                       uint32_t *count)
+{
+    collect_context_t collect = {.table = table, .status = SUCCESS};
+    uint64_t cursor = 0;
+
+    do
+    {
+        cursor = hash_table_scan(table, cursor, COLLECT_SCAN_COUNT,
+                                 collect_entry, &collect);
+    } while (0 != cursor && SUCCESS == collect.status);
+
+    if (SUCCESS != collect.status)
+    {
+        free(collect.entries);
+        collect.entries = NULL;
+        collect.count = 0;
+    }
+    *entries = collect.entries;
+    *count = collect.count;
+
+    return collect.status;
+}
+
+/**
+ * @brief scan callback adding every entry to the bloom filter of a table
+ */
+static void bloom_entry(const char *key, uint32_t len, void *data,
+                        void *context)
+{
+    hash_table_t *table = (hash_table_t *)context;
+
+    (void)data;
+    bloom_add_hash(table->bloom, hash_table_hash(table, key, len));
+}
+
+/**
+ * @brief replaces the bloom filter of a table with one holding only the
+ *        keys present now, sized for twice as many
+ *
+ * Called once the filter is over capacity, or once removed keys make up a
+ * third of it, so the full scan is paid for by the adds or removes before
+ * it. The old filter stays in place when the new one cannot be allocated;
+ * it still never misses a present key.
+ *
+ * @param table pointer to table address
+ */
+static void table_bloom_rebuild(hash_table_t *table)
+{
+    uint32_t capacity = table->count < UINT32_MAX / 2 ? 2 * table->count :
+                                                        UINT32_MAX;
+    bloom_t *bloom = bloom_init(capacity > BLOOM_MIN_CAPACITY ?
+                                    capacity :
+                                    BLOOM_MIN_CAPACITY,
+                                table->bloom->fp_rate);
+
+    if (NULL != bloom)
+    {
+        uint64_t cursor = 0;
+        uint32_t emitted = 0;
+
+        bloom_destroy(&table->bloom);
+        table->bloom = bloom;
+        table->bloom_stale = 0;
+        do
+        {
+            cursor = table->ops->scan(table, cursor, bloom_entry, table,
+                                      &emitted);
+        } while (0 != cursor);
+    }
+}
+
+/**
+ * @brief adds the hash of a newly inserted key to the table's bloom filter
+ *
+ * @param table pointer to table address
+ * @param hash hash of the key
+ */
+static inline void table_bloom_add(hash_table_t *table, uint64_t hash)
+{
+    if (NULL != table->bloom)
+    {
+        bloom_add_hash(table->bloom, hash);
+        if (table->count > table->bloom->capacity)
+        {
+            table_bloom_rebuild(table);
+        }
+    }
+}
+
+/**
+ * @brief notes a key removed from a table with a bloom filter, rebuilding
+ *        the filter once too many removed keys still pass it
+ *
+ * @param table pointer to table address
+ */
+static inline void table_bloom_remove(hash_table_t *table)
+{
+    if (NULL != table->bloom &&
+        ++table->bloom_stale > table->count / 2 + BLOOM_REBUILD_MIN)
+    {
+        table_bloom_rebuild(table);
+    }
+}
+
+/**
+ * @brief counts lookups the bloom filter answered without the engine
+ *
+ * Filters are only attached to HASH_SYNC_NONE tables, so the counters are
+ * never shared.
+ *
+ * @param table pointer to table address
+ * @param lookups number of lookups answered
+ */
+static inline void table_bloom_filtered(hash_table_t *table, uint32_t lookups)
+{
+    table->counters->filtered += lookups;
+    hash_table_count_lookups(table, lookups, 0, 0);
+}
+
+/**
+ * @brief locks the part of the table a key lives in, when the table is
+ *        shared between threads
+ *
+ * @param table pointer to table address
+ * @param hash hash of the key about to be accessed
+ * @param write non-zero when the table is about to be modified
+ *
+ * @return token to pass to table_leave
+ */
+static inline uint32_t table_enter(hash_table_t *table, uint64_t hash,
+                                   int write)
+{
+    uint32_t token = 0;
+
+    switch (table->sync)
+    {
+    case HASH_SYNC_NONE:
+        break;
+    case HASH_SYNC_STRIPED:
+        token = hash_table_sync_lock(table, hash);
+        break;
+    case HASH_SYNC_RCU:
+        token = write ? hash_table_rcu_write_lock(table) :
+                        hash_table_rcu_read_lock(table);
+        break;
+    }
+
+    return token;
+}
+
+/**
+ * @brief records a change in the number of entries and releases what
+ *        table_enter locked
+ *
+ * @param table pointer to table address
+ * @param token token returned by table_enter
+ * @param write non-zero when table_enter was told the table is modified
+ * @param delta change in the number of entries, -1, 0 or 1
+ */
+static inline void table_leave(hash_table_t *table, uint32_t token, int write,
+                               int delta)
+{
+    switch (table->sync)
+    {
+    case HASH_SYNC_NONE:
+        table->count += delta;
+        break;
+    case HASH_SYNC_STRIPED:
+        hash_table_sync_unlock(table, token, delta);
+        break;
+    case HASH_SYNC_RCU:
+        if (write)
+        {
+            table->count += delta;
+            hash_table_rcu_write_unlock(table);
+        }
+        else
+        {
+            hash_table_rcu_read_unlock(table, token);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief adds an item to the table
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ *
+ * @return int exit code
+ */
+int hash_table_add(hash_table_t *table, void *data, char *key)
+{
+    return hash_table_add_n(table, data, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief adds an item to the table under a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ *
+ * @return int exit code
+ */
+int hash_table_add_n(hash_table_t *table, void *data, const void *key,
+                     size_t len)
+{
+    int status = SUCCESS;
+
+    if (NULL == table || NULL == data || NULL == key || len > UINT32_MAX)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        uint64_t hash = hash_table_hash(table, key, len);
+        uint32_t token = table_enter(table, hash, 1);
+        status = table->ops->add(table, data, (const char *)key,
+                                 (uint32_t)len, hash);
+        table_leave(table, token, 1, SUCCESS == status);
+        if (SUCCESS == status)
+        {
+            table_bloom_add(table, hash);
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief stores data at key, replacing the data already stored there
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param old_data receives the replaced data, NULL when key was new; may
+ *                 be NULL
+ *
+ * @return int exit code
+ */
+int hash_table_put(hash_table_t *table, void *data, char *key, void **old_data)
+{
+    return hash_table_put_n(table, data, key, NULL != key ? strlen(key) : 0,
+                            old_data);
+}
+
+/**
+ * @brief stores data at a key of len bytes, replacing the data already
+ *        stored there
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ * @param old_data receives the replaced data, NULL when key was new; may
+ *                 be NULL
+ *
+ * @return int exit code
+ */
+int hash_table_put_n(hash_table_t *table, void *data, const void *key,
+                     size_t len, void **old_data)
+{
+    int status = SUCCESS;
+    void *previous = NULL;
+
+    if (NULL == table || NULL == data || NULL == key || len > UINT32_MAX)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        uint64_t hash = hash_table_hash(table, key, len);
+        uint32_t token = table_enter(table, hash, 1);
+        int inserted = 0;
+        void **value = table->ops->upsert(table, (const char *)key,
+                                          (uint32_t)len, hash, data, &inserted);
+        if (NULL == value)
+        {
+            status = FAILURE;
+        }
+        else if (!inserted)
+        {
+            previous = *value;
+            // lock-free readers may be loading the old pointer
+            __atomic_store_n(value, data, __ATOMIC_RELEASE);
+        }
+        table_leave(table, token, 1, inserted);
+        if (inserted)
+        {
+            table_bloom_add(table, hash);
+        }
+    }
+
+    if (NULL != old_data)
+    {
+        *old_data = previous;
+    }
+
+    return status;
+}
+
+/**
+ * @brief returns the data slot of key, adding key with data first when it
+ *        is not present
+ *
+ * @param table pointer to table address
+ * @param key key of the slot
+ * @param data data stored when key is added, may be NULL
+ *
+ * @return pointer to the data stored at key, NULL on failure
+ */
+void **hash_table_get_or_insert(hash_table_t *table, char *key, void *data)
+{
+    return hash_table_get_or_insert_n(table, key,
+                                      NULL != key ? strlen(key) : 0, data);
+}
+
+/**
+ * @brief returns the data slot of a key of len bytes, adding the key with
+ *        data first when it is not present
+ *
+ * @param table pointer to table address
+ * @param key key bytes of the slot
+ * @param len number of bytes in key
+ * @param data data stored when key is added, may be NULL
+ *
+ * @return pointer to the data stored at key, NULL on failure
  */
-hash_table_t *hash_table_init(uint32_t size, FREE_F customfree)
+void **hash_table_get_or_insert_n(hash_table_t *table, const void *key,
+                                  size_t len, void *data)
 {
-    hash_table_t *hash_table = (hash_table_t *)malloc(sizeof(hash_table_t));
-    if (NULL != hash_table)
+    void **value = NULL;
+
+    // the caller writes the slot after the call, outside any lock
+    if (NULL != table && HASH_SYNC_NONE == table->sync && NULL != key &&
+        len <= UINT32_MAX)
     {
-        hash_table->size = size;
-        if (NULL != customfree)
+        uint64_t hash = hash_table_hash(table, key, len);
+        int inserted = 0;
+        value = table->ops->upsert(table, (const char *)key, (uint32_t)len,
+                                   hash, data, &inserted);
+        table->count += inserted;
+        if (inserted)
         {
-            customfree = free;
-        }
-        hash_table->table = (node_t **)calloc(size, sizeof(node_t *));
-        if (NULL == hash_table->table)
-        {
-            free(hash_table);
-            hash_table = NULL;
+            table_bloom_add(table, hash);
         }
     }
 
-    return hash_table;
+    return value;
 }
 
 /**
- * @brief hash function for hash table indexing
- * @param key The key to hash
- * @param table_size The size of the hash_table array
- * 
- * @return index
+ * @brief gives a node_t newly added by a *_ttl function its TTL, taking
+ *        it out of the table again when no timer can be armed
+ *
+ * @param table pointer to table address
+ * @param node node_t just linked in
+ * @param ttl_ms lifetime in milliseconds, 0 for no expiry
+ *
+ * @return int exit code
  */
-static uint32_t hash_function(const char *key, uint32_t table_size) {
-    uint32_t hash = 0;
-    uint32_t prime = 31; // A small prime number
-    while (NULL != *key) 
+static int ttl_arm_new(hash_table_t *table, node_t *node, uint32_t ttl_ms)
+{
+    int status = SUCCESS;
+
+    if (0 != ttl_ms &&
+        SUCCESS != hash_table_ttl_schedule(
+                       table->ttl, node,
+                       hash_table_ttl_deadline(table->ttl, ttl_ms)))
     {
-        hash = (hash * prime) + *key++;
+        chained_unlink(table, node);
+        hash_table_node_free(table, node);
+        status = FAILURE;
     }
-    return hash % table_size;
+
+    return status;
 }
 
 /**
- * @brief adds an item to the table
+ * @brief adds an item that expires ttl_ms from now
  *
  * @param table pointer to table address
  * @param data data to be stored at that key value
  * @param key key for data to be stored at
+ * @param ttl_ms lifetime of the entry in milliseconds, 0 for no expiry
  *
  * @return int exit code
  */
-int hash_table_add(hash_table_t *table, void *data, char *key)
+int hash_table_add_ttl(hash_table_t *table, void *data, char *key,
+                       uint32_t ttl_ms)
+{
+    return hash_table_add_ttl_n(table, data, key,
+                                NULL != key ? strlen(key) : 0, ttl_ms);
+}
+
+/**
+ * @brief adds an item under a key of len bytes that expires ttl_ms from
+ *        now
+ *
+ * TTL tables are chained and unsynchronized, so the chained engine is
+ * called directly.
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ * @param ttl_ms lifetime of the entry in milliseconds, 0 for no expiry
+ *
+ * @return int exit code
+ */
+int hash_table_add_ttl_n(hash_table_t *table, void *data, const void *key,
+                         size_t len, uint32_t ttl_ms)
 {
     int status = SUCCESS;
 
-    if (NULL == table || NULL == data || NULL == key)
+    if (NULL == table || NULL == table->ttl || NULL == data || NULL == key ||
+        len > UINT32_MAX)
     {
         status = FAILURE;
     }
     else
     {
-        node_t *new_node = (node_t *)malloc(sizeof(node_t));
-        if (NULL != new_node)
+        uint64_t hash = hash_table_hash(table, key, len);
+        node_t *node = chained_append(table, data, (const char *)key,
+                                      (uint32_t)len, hash);
+        status = NULL != node ? ttl_arm_new(table, node, ttl_ms) : FAILURE;
+        if (SUCCESS == status)
         {
-            uint32_t hashkey = hash_function(key, table->size);
-            new_node->key = strdup(key);
-            new_node->data = data;
-            new_node->next = NULL;
-            if (NULL == new_node->key)
-            {
-                free(new_node);
-                status = FAILURE;
-            }
+            table->count++;
+            table_bloom_add(table, hash);
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief stores data at key, replacing the data already stored there and
+ *        restarting its TTL
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param ttl_ms new lifetime of the entry in milliseconds, 0 for no expiry
+ * @param old_data receives the replaced data, NULL when key was new; may
+ *                 be NULL
+ *
+ * @return int exit code
+ */
+int hash_table_put_ttl(hash_table_t *table, void *data, char *key,
+                       uint32_t ttl_ms, void **old_data)
+{
+    return hash_table_put_ttl_n(table, data, key,
+                                NULL != key ? strlen(key) : 0, ttl_ms,
+                                old_data);
+}
+
+/**
+ * @brief stores data at a key of len bytes, replacing the data already
+ *        stored there and restarting its TTL
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ * @param ttl_ms new lifetime of the entry in milliseconds, 0 for no expiry
+ * @param old_data receives the replaced data, NULL when key was new; may
+ *                 be NULL
+ *
+ * @return int exit code
+ */
+int hash_table_put_ttl_n(hash_table_t *table, void *data, const void *key,
+                         size_t len, uint32_t ttl_ms, void **old_data)
+{
+    int status = SUCCESS;
+    void *previous = NULL;
 
+    if (NULL == table || NULL == table->ttl || NULL == data || NULL == key ||
+        len > UINT32_MAX)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        uint64_t hash = hash_table_hash(table, key, len);
+        int inserted = 0;
+        void **value = chained_upsert(table, (const char *)key, (uint32_t)len,
+                                      hash, data, &inserted);
+        node_t *node = NULL != value ?
+                           (node_t *)((char *)value - offsetof(node_t, data)) :
+                           NULL;
+        if (NULL == node)
+        {
+            status = FAILURE;
+        }
+        else if (inserted)
+        {
+            status = ttl_arm_new(table, node, ttl_ms);
+            inserted = SUCCESS == status;
+        }
+        else
+        {
+            status = hash_table_ttl_schedule(
+                table->ttl, node,
+                0 != ttl_ms ? hash_table_ttl_deadline(table->ttl, ttl_ms) : 0);
             if (SUCCESS == status)
             {
-                if (NULL == table->table[hashkey])
-                {
-                    table->table[hashkey] = new_node;
-                }
-                else
-                {
-                    node_t *current = table->table[hashkey];
-                    while(NULL != current->next)
-                    {
-                        current = current->next;
-                    }
-                    current->next = new_node;
-                }
+                previous = *value;
+                *value = data;
             }
         }
-        else
+        table->count += inserted;
+        if (inserted)
         {
-            status = FAILURE;
+            table_bloom_add(table, hash);
         }
-        
+    }
+
+    if (NULL != old_data)
+    {
+        *old_data = previous;
     }
 
     return status;
 }
 
+/**
+ * @brief returns the data slot of key, adding key with data and a TTL
+ *        first when it is not present
+ *
+ * @param table pointer to table address
+ * @param key key of the slot
+ * @param data data stored when key is added, may be NULL
+ * @param ttl_ms lifetime of an added entry in milliseconds, 0 for no
+ *               expiry
+ *
+ * @return pointer to the data stored at key, NULL on failure
+ */
+void **hash_table_get_or_insert_ttl(hash_table_t *table, char *key,
+                                    void *data, uint32_t ttl_ms)
+{
+    return hash_table_get_or_insert_ttl_n(
+        table, key, NULL != key ? strlen(key) : 0, data, ttl_ms);
+}
+
+/**
+ * @brief returns the data slot of a key of len bytes, adding the key with
+ *        data and a TTL first when it is not present
+ *
+ * @param table pointer to table address
+ * @param key key bytes of the slot
+ * @param len number of bytes in key
+ * @param data data stored when key is added, may be NULL
+ * @param ttl_ms lifetime of an added entry in milliseconds, 0 for no
+ *               expiry
+ *
+ * @return pointer to the data stored at key, NULL on failure
+ */
+void **hash_table_get_or_insert_ttl_n(hash_table_t *table, const void *key,
+                                      size_t len, void *data,
+                                      uint32_t ttl_ms)
+{
+    void **value = NULL;
+
+    if (NULL != table && NULL != table->ttl && NULL != key &&
+        len <= UINT32_MAX)
+    {
+        uint64_t hash = hash_table_hash(table, key, len);
+        int inserted = 0;
+        value = chained_upsert(table, (const char *)key, (uint32_t)len, hash,
+                               data, &inserted);
+        if (NULL != value && inserted &&
+            SUCCESS != ttl_arm_new(
+                           table,
+                           (node_t *)((char *)value - offsetof(node_t, data)),
+                           ttl_ms))
+        {
+            value = NULL;
+            inserted = 0;
+        }
+        table->count += inserted;
+        if (inserted)
+        {
+            table_bloom_add(table, hash);
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief reclaims expired entries, doing a bounded amount of work
+ *
+ * @param table pointer to table address
+ * @param budget most units of work to do, see hash_table_ttl_pop
+ *
+ * @return number of entries reclaimed
+ */
+uint32_t hash_table_expire(hash_table_t *table, uint32_t budget)
+{
+    uint32_t reclaimed = 0;
+    node_t *node = NULL;
+
+    while (NULL != table && NULL != table->ttl &&
+           NULL != (node = hash_table_ttl_pop(table->ttl, &budget)))
+    {
+        chained_unlink(table, node);
+        table->customfree(node->data);
+        hash_table_node_free(table, node);
+        table->count--;
+        reclaimed++;
+        table_bloom_remove(table);
+    }
+
+    return reclaimed;
+}
+
 /**
  * @brief looks up an item in the table by key
  *
@@ -113,28 +1949,128 @@ int hash_table_add(hash_table_t *table, void *data, char *key)
  * @return void * data
  */
 void *hash_table_lookup(hash_table_t *table, char *key)
+{
+    return hash_table_lookup_n(table, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief looks up an item in the table by a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param key key bytes for data being searched for
+ * @param len number of bytes in key
+ *
+ * @return void * data
+ */
+void *hash_table_lookup_n(hash_table_t *table, const void *key, size_t len)
 {
     void *node_data = NULL;
 
-    if (NULL != table)
+    if (NULL != table && NULL != key && len <= UINT32_MAX)
+    {
+        uint64_t hash = hash_table_hash(table, key, len);
+        if (NULL != table->bloom && !bloom_contains_hash(table->bloom, hash))
+        {
+            table_bloom_filtered(table, 1);
+        }
+        else
+        {
+            uint32_t token = table_enter(table, hash, 0);
+            node_data = table->ops->lookup(table, (const char *)key,
+                                           (uint32_t)len, hash);
+            table_leave(table, token, 0, 0);
+        }
+    }
+
+    return node_data;
+}
+
+/**
+ * @brief looks up several items at once
+ *
+ * @param table pointer to table address
+ * @param keys keys for data being searched for
+ * @param n number of keys
+ * @param out receives the data stored at each key, NULL when missing
+ *
+ * @return int exit code
+ */
+int hash_table_lookup_batch(hash_table_t *table, char **keys, size_t n,
+                            void **out)
+{
+    int status = SUCCESS;
+
+    if (NULL == table || NULL == keys || NULL == out)
+    {
+        status = FAILURE;
+    }
+
+    for (size_t start = 0; SUCCESS == status && start < n;
+         start += HASH_TABLE_BATCH)
     {
-        uint32_t index = hash_function(key, table->size);
-        if (NULL != table->table[index]) 
+        const char *batch_keys[HASH_TABLE_BATCH];
+        uint32_t lens[HASH_TABLE_BATCH];
+        uint64_t hashes[HASH_TABLE_BATCH];
+        size_t positions[HASH_TABLE_BATCH];
+        void *found[HASH_TABLE_BATCH];
+        uint32_t valid = 0;
+        uint32_t filtered = 0;
+
+        // hash the whole group up front, skipping keys lookup would reject
+        // and keys the bloom filter rules out
+        for (size_t x = start; x < n && x < start + HASH_TABLE_BATCH; x++)
         {
-            node_t *current = table->table[index];
-            while (current != NULL)
+            size_t len = 0;
+            out[x] = NULL;
+            if (NULL != keys[x] && (len = strlen(keys[x])) <= UINT32_MAX)
             {
-                if (strcmp(key, current->key) == 0)
+                batch_keys[valid] = keys[x];
+                lens[valid] = (uint32_t)len;
+                hashes[valid] = hash_table_hash(table, keys[x], len);
+                positions[valid] = x;
+                if (NULL != table->bloom &&
+                    !bloom_contains_hash(table->bloom, hashes[valid]))
+                {
+                    filtered++;
+                }
+                else
                 {
-                    node_data = current->data;
-                    break;
+                    valid++;
                 }
-                current = current->next; 
             }
         }
+        if (0 != filtered)
+        {
+            table_bloom_filtered(table, filtered);
+        }
+
+        if (HASH_SYNC_STRIPED == table->sync ||
+            NULL == table->ops->lookup_batch)
+        {
+            // every key may need a different stripe
+            for (uint32_t x = 0; x < valid; x++)
+            {
+                uint32_t token = table_enter(table, hashes[x], 0);
+                found[x] = table->ops->lookup(table, batch_keys[x], lens[x],
+                                              hashes[x]);
+                table_leave(table, token, 0, 0);
+            }
+        }
+        else if (0 != valid)
+        {
+            uint32_t token = table_enter(table, 0, 0);
+            table->ops->lookup_batch(table, batch_keys, lens, hashes, valid,
+                                     found);
+            table_leave(table, token, 0, 0);
+        }
+
+        for (uint32_t x = 0; x < valid; x++)
+        {
+            out[positions[x]] = found[x];
+        }
     }
 
-    return node_data;
+    return status;
 }
 
 /**
@@ -146,49 +2082,81 @@ void *hash_table_lookup(hash_table_t *table, char *key)
  * @return int
  */
 int hash_table_remove(hash_table_t *table, char *key)
+{
+    return hash_table_remove_n(table, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief removes an item stored under a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param key key bytes of data to be removed
+ * @param len number of bytes in key
+ *
+ * @return int
+ */
+int hash_table_remove_n(hash_table_t *table, const void *key, size_t len)
 {
     int status = SUCCESS;
 
-    if (NULL == table)
+    if (NULL == table || NULL == key || len > UINT32_MAX)
     {
         status = FAILURE;
     }
     else
     {
-        uint32_t index = hash_function(key, table->size);
-        if (NULL == table->table[index])
-        {
-            status = FAILURE;
-        }
-        else
+        uint64_t hash = hash_table_hash(table, key, len);
+        uint32_t token = table_enter(table, hash, 1);
+        status = table->ops->remove(table, (const char *)key, (uint32_t)len,
+                                    hash);
+        table_leave(table, token, 1, -(SUCCESS == status));
+        if (SUCCESS == status)
         {
-            node_t *previous = NULL;
-            node_t *current = table->table[index];
-            while(NULL != current && strcmp(key, current->key) != 0)
-            {
-                previous = current;
-                current = current->next; 
-            }
-            
-            //free the node
-            if (NULL == previous)
-            {
-                table->table[index] = current->next;
-                free(current->key);
-                free(current);
-            }
-            else
-            {
-                previous->next = current->next;
-                free(current->key);
-                free(current);
-            }
+            table_bloom_remove(table);
         }
     }
 
     return status;
 }
 
+/**
+ * @brief visits a bounded slice of the table's entries, resuming from a
+ *        cursor
+ *
+ * @param table pointer to table address
+ * @param cursor 0 to start a scan, otherwise a cursor returned by a
+ *               previous call
+ * @param count number of entries to aim for
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ *
+ * @return cursor to continue from, 0 once the scan is complete
+ */
+uint64_t hash_table_scan(hash_table_t *table, uint64_t cursor, uint32_t count,
+                         HASH_SCAN_F callback, void *context)
+{
+    uint64_t next = 0;
+
+    if (NULL != table && NULL != callback)
+    {
+        uint32_t emitted = 0;
+        uint64_t steps = (uint64_t)(0 != count ? count : 1) *
+                         SCAN_STEPS_PER_ENTRY;
+
+        next = cursor;
+        do
+        {
+            // the low bits of the cursor are the bucket index, and so also
+            // pick the stripe guarding every bucket the step visits
+            uint32_t token = table_enter(table, next, 0);
+            next = table->ops->scan(table, next, callback, context, &emitted);
+            table_leave(table, token, 0, 0);
+        } while (0 != next && emitted < count && 0 != --steps);
+    }
+
+    return next;
+}
+
 /**
  * @brief clears all data from hash table
  *
@@ -200,19 +2168,111 @@ int hash_table_clear(hash_table_t *table_addr)
 {
     int status = FAILURE;
 
-    if (NULL != table_addr)
+    if (NULL != table_addr && HASH_ENGINE_MAPPED != table_addr->engine &&
+        HASH_ENGINE_FROZEN != table_addr->engine)
     {
-        for (uint32_t x = 0; x < table_addr->size; x++)
+        if (HASH_SYNC_STRIPED == table_addr->sync)
         {
-            node_t *current = table_addr->table[x];
-            while (current != NULL)
-            {
-                node_t *node_to_free = current;
-                current = current->next;
-                free(node_to_free->key);
-                free(node_to_free);
-            }
-            table_addr->table[x] = NULL;
+            hash_table_sync_lock_all(table_addr);
+        }
+        else if (HASH_SYNC_RCU == table_addr->sync)
+        {
+            hash_table_rcu_write_lock(table_addr);
+        }
+
+        table_addr->ops->clear(table_addr);
+        slab_clear(table_addr->node_slab);
+        arena_clear(table_addr->key_arena);
+        bloom_clear(table_addr->bloom);
+        hash_table_ttl_clear(table_addr->ttl);
+        table_addr->bloom_stale = 0;
+        table_addr->count = 0;
+
+        if (HASH_SYNC_STRIPED == table_addr->sync)
+        {
+            hash_table_sync_clear_counts(table_addr);
+            hash_table_sync_unlock_all(table_addr);
+        }
+        else if (HASH_SYNC_RCU == table_addr->sync)
+        {
+            hash_table_rcu_write_unlock(table_addr);
+        }
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief reports a table's size, chain or probe length distribution,
+ *        memory use and lookup counters
+ *
+ * @param table pointer to table address
+ * @param out receives the statistics
+ *
+ * @return int exit code
+ */
+int hash_table_stats(hash_table_t *table, hash_table_stats_t *out)
+{
+    int status = FAILURE;
+
+    if (NULL != table && NULL != out)
+    {
+        memset(out, 0, sizeof(hash_table_stats_t));
+
+        if (HASH_SYNC_STRIPED == table->sync)
+        {
+            hash_table_sync_lock_all(table);
+        }
+        else if (HASH_SYNC_RCU == table->sync)
+        {
+            hash_table_rcu_write_lock(table);
+        }
+
+        table->ops->stats(table, out);
+        out->count = table->count;
+
+        if (HASH_SYNC_STRIPED == table->sync)
+        {
+            hash_table_sync_unlock_all(table);
+        }
+        else if (HASH_SYNC_RCU == table->sync)
+        {
+            hash_table_rcu_write_unlock(table);
+        }
+
+        for (uint32_t x = 0; x <= table->counter_mask; x++)
+        {
+            out->lookups += __atomic_load_n(&table->counters[x].lookups,
+                                            __ATOMIC_RELAXED);
+            out->hits += __atomic_load_n(&table->counters[x].hits,
+                                         __ATOMIC_RELAXED);
+            out->probes += __atomic_load_n(&table->counters[x].probes,
+                                           __ATOMIC_RELAXED);
+            out->filtered += __atomic_load_n(&table->counters[x].filtered,
+                                             __ATOMIC_RELAXED);
+        }
+        // hits may have been counted after the lookups read above
+        out->hits = out->hits < out->lookups ? out->hits : out->lookups;
+        out->misses = out->lookups - out->hits;
+        out->mean_probes =
+            0 != out->lookups ? (double)out->probes / out->lookups : 0;
+        out->load_factor =
+            0 != out->buckets ? (double)out->count / out->buckets : 0;
+        out->bytes_used += sizeof(hash_table_t) +
+                           (table->counter_mask + 1U) *
+                               sizeof(hash_table_counters_t);
+        if (NULL != table->bloom)
+        {
+            out->bytes_used += sizeof(bloom_t) +
+                               (size_t)table->bloom->block_count *
+                                   sizeof(bloom_block_t);
+        }
+        if (NULL != table->ttl)
+        {
+            out->bytes_used += sizeof(hash_ttl_t) +
+                               (size_t)table->ttl->timers *
+                                   sizeof(hash_timer_t);
         }
         status = SUCCESS;
     }
@@ -232,8 +2292,20 @@ int hash_table_destroy(hash_table_t **table_addr)
 
     if (NULL != table_addr && NULL != *table_addr)
     {
-        hash_table_clear(*table_addr);
-        free((*table_addr)->table);
+        (*table_addr)->ops->destroy(*table_addr);
+        slab_destroy(&(*table_addr)->node_slab);
+        arena_destroy(&(*table_addr)->key_arena);
+        bloom_destroy(&(*table_addr)->bloom);
+        hash_table_ttl_destroy(&(*table_addr)->ttl);
+        if (HASH_SYNC_RCU == (*table_addr)->sync)
+        {
+            hash_table_rcu_destroy(*table_addr);
+        }
+        else
+        {
+            hash_table_sync_destroy(*table_addr);
+        }
+        free((*table_addr)->counters);
         free(*table_addr);
         *table_addr = NULL;
 
@@ -251,4 +2323,4 @@ int hash_table_destroy(hash_table_t **table_addr)
 void custom_free(void *mem_addr)
 {
     free(mem_addr);
-}
\ No newline at end of file
+}
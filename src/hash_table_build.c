@@ -0,0 +1,438 @@
+#include <hash_table.h>
+#include <arena.h>
+#include <bloom.h>
+#include <pthread.h>
+#include "hash_table_internal.h"
+
+#define BUILD_MAX_THREADS 64
+#define BUILD_MIN_KEYS_PER_THREAD 16384
+#define BUILD_NODE_ALIGN 64
+
+/**
+ * @brief what the first pass learns about a key
+ *
+ * @param hash  hash of the key
+ * @param len   number of bytes in the key
+ * @param part  partition of the key's bucket
+ */
+typedef struct build_key_t
+{
+    uint64_t hash;
+    uint32_t len;
+    uint32_t part;
+} build_key_t;
+
+/**
+ * @brief state shared by the threads of a build
+ *
+ * Partition p holds buckets p * size / threads up to the start of
+ * partition p + 1. Thread t hashes and fills the keys of input range t and
+ * links the buckets of partition t.
+ *
+ * @param table         table being built
+ * @param keys          keys to add
+ * @param values        data stored at every key
+ * @param n             number of keys
+ * @param threads       number of threads, input ranges and partitions
+ * @param size_bits     log2 of the bucket count
+ * @param info          hash, length and partition of every key
+ * @param offsets       threads x threads matrix; row t counts the keys of
+ *                      range t in every partition, then holds where the
+ *                      next of them goes in order
+ * @param starts        first position of every partition in order, and n
+ * @param order         key indices grouped by partition, in input order
+ *                      within a partition
+ * @param nodes         node of every key, in input order
+ * @param key_bytes     copies of the keys too long to be inlined
+ */
+typedef struct build_t
+{
+    hash_table_t *table;
+    char **keys;
+    void **values;
+    uint32_t n;
+    uint32_t threads;
+    uint32_t size_bits;
+    build_key_t *info;
+    uint32_t *offsets;
+    uint32_t *starts;
+    uint32_t *order;
+    node_t *nodes;
+    char *key_bytes;
+} build_t;
+
+/**
+ * @brief work of one build thread
+ *
+ * @param build     shared state
+ * @param id        input range and partition of the thread
+ * @param first     first key of the range
+ * @param last      one past the last key of the range
+ * @param key_total key bytes the range's long keys need
+ * @param key_next  where the range's next long key is copied to
+ * @param thread    thread running the pass
+ * @param started   non-zero when thread was created
+ * @param status    outcome of the pass
+ */
+typedef struct build_context_t
+{
+    build_t *build;
+    uint32_t id;
+    uint32_t first;
+    uint32_t last;
+    size_t key_total;
+    size_t key_next;
+    pthread_t thread;
+    int started;
+    int status;
+} build_context_t;
+
+/**
+ * @brief first pass: measures and hashes the keys of a range and counts
+ *        them per partition
+ */
+static void *build_hash_worker(void *arg)
+{
+    build_context_t *context = (build_context_t *)arg;
+    build_t *build = context->build;
+    uint32_t *counts = build->offsets + context->id * build->threads;
+    uint32_t mask = build->table->size - 1;
+
+    context->status = SUCCESS;
+    for (uint32_t x = context->first;
+         SUCCESS == context->status && x < context->last; x++)
+    {
+        if (NULL == build->keys[x] || NULL == build->values[x])
+        {
+            context->status = FAILURE;
+        }
+        else
+        {
+            size_t len = strlen(build->keys[x]);
+            uint64_t hash = hash_table_hash(build->table, build->keys[x], len);
+            uint32_t bucket = (uint32_t)hash & mask;
+            uint32_t part = (uint32_t)(((uint64_t)bucket * build->threads) >>
+                                       build->size_bits);
+            build->info[x] = (build_key_t){hash, (uint32_t)len, part};
+            counts[part]++;
+            if (len >= HASH_TABLE_INLINE_KEY)
+            {
+                context->key_total += len + 1;
+            }
+            context->status = len < UINT32_MAX ? SUCCESS : FAILURE;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief second pass: fills the nodes of a range and files every key
+ *        under its partition
+ */
+static void *build_fill_worker(void *arg)
+{
+    build_context_t *context = (build_context_t *)arg;
+    build_t *build = context->build;
+    uint32_t *offsets = build->offsets + context->id * build->threads;
+
+    for (uint32_t x = context->first; x < context->last; x++)
+    {
+        node_t *node = &build->nodes[x];
+        uint32_t len = build->info[x].len;
+
+        node->key = node->key_inline;
+        if (len >= HASH_TABLE_INLINE_KEY)
+        {
+            node->key = build->key_bytes + context->key_next;
+            context->key_next += (size_t)len + 1;
+        }
+        memcpy(node->key, build->keys[x], (size_t)len + 1);
+        node->data = build->values[x];
+        node->next = NULL;
+        node->hash = build->info[x].hash;
+        node->key_len = len;
+        node->expires = 0;
+        build->order[offsets[build->info[x].part]++] = x;
+    }
+    context->status = SUCCESS;
+
+    return NULL;
+}
+
+/**
+ * @brief third pass: links the nodes of a partition into their buckets
+ *
+ * The keys are pushed in reverse, so every chain ends up in input order,
+ * as hash_table_add would have appended them.
+ */
+static void *build_link_worker(void *arg)
+{
+    build_context_t *context = (build_context_t *)arg;
+    build_t *build = context->build;
+    node_t **buckets = build->table->table;
+    uint32_t mask = build->table->size - 1;
+
+    for (uint32_t x = build->starts[context->id + 1];
+         x > build->starts[context->id]; x--)
+    {
+        node_t *node = &build->nodes[build->order[x - 1]];
+        uint32_t bucket = (uint32_t)node->hash & mask;
+        node->next = buckets[bucket];
+        buckets[bucket] = node;
+    }
+    context->status = SUCCESS;
+
+    return NULL;
+}
+
+/**
+ * @brief runs one pass on every context, the first on the calling thread;
+ *        contexts whose thread could not be created run on the caller
+ *        afterwards
+ *
+ * @param contexts one context per thread
+ * @param threads number of contexts
+ * @param body pass to run
+ *
+ * @return int exit code, FAILURE when any context failed
+ */
+static int build_run(build_context_t *contexts, uint32_t threads,
+                     void *(*body)(void *))
+{
+    int status = SUCCESS;
+
+    for (uint32_t x = 1; x < threads; x++)
+    {
+        contexts[x].started = 0 == pthread_create(&contexts[x].thread, NULL,
+                                                  body, &contexts[x]);
+    }
+    body(&contexts[0]);
+    for (uint32_t x = 1; x < threads; x++)
+    {
+        if (contexts[x].started)
+        {
+            pthread_join(contexts[x].thread, NULL);
+        }
+        else
+        {
+            body(&contexts[x]);
+        }
+    }
+
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        if (SUCCESS != contexts[x].status)
+        {
+            status = FAILURE;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief turns the per range partition counts into the position of every
+ *        range's first key of every partition, partition by partition, and
+ *        lays the long key bytes of the ranges out back to back
+ *
+ * @param build shared state
+ * @param contexts one context per thread
+ */
+static void build_layout(build_t *build, build_context_t *contexts)
+{
+    uint32_t position = 0;
+    size_t key_next = 0;
+
+    for (uint32_t part = 0; part < build->threads; part++)
+    {
+        build->starts[part] = position;
+        for (uint32_t range = 0; range < build->threads; range++)
+        {
+            uint32_t *slot = &build->offsets[range * build->threads + part];
+            uint32_t count = *slot;
+            *slot = position;
+            position += count;
+        }
+    }
+    build->starts[build->threads] = position;
+
+    for (uint32_t range = 0; range < build->threads; range++)
+    {
+        contexts[range].key_next = key_next;
+        key_next += contexts[range].key_total;
+    }
+}
+
+/**
+ * @brief carves the nodes and long key bytes of n keys out of one block of
+ *        the table's node slab
+ *
+ * Nodes are aligned to a cache line each. The block is freed with the slab
+ * on hash_table_clear or hash_table_destroy, and removed nodes go to the
+ * slab's free list like any other slab node.
+ *
+ * @param build shared state
+ * @param key_total bytes of long keys
+ *
+ * @return int exit code
+ */
+static int build_alloc(build_t *build, size_t key_total)
+{
+    int status = FAILURE;
+    size_t node_bytes = (size_t)build->n * sizeof(node_t);
+    unsigned char *block = NULL;
+
+    if (key_total <= SIZE_MAX - node_bytes - BUILD_NODE_ALIGN)
+    {
+        block = (unsigned char *)arena_alloc(build->table->node_slab->arena,
+                                             node_bytes + key_total +
+                                                 BUILD_NODE_ALIGN);
+    }
+    if (NULL != block)
+    {
+        uintptr_t aligned = ((uintptr_t)block + BUILD_NODE_ALIGN - 1) &
+                            ~(uintptr_t)(BUILD_NODE_ALIGN - 1);
+        build->nodes = (node_t *)aligned;
+        build->key_bytes = (char *)aligned + node_bytes;
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief builds a chained table in three passes over the keys
+ *
+ * @param build shared state, with table, keys, values, n and threads set
+ *
+ * @return int exit code
+ */
+static int build_chained(build_t *build)
+{
+    int status = FAILURE;
+    build_context_t *contexts = NULL;
+    uint32_t threads = build->threads;
+    size_t key_total = 0;
+
+    while ((1U << build->size_bits) < build->table->size)
+    {
+        build->size_bits++;
+    }
+    build->info = (build_key_t *)malloc((size_t)build->n *
+                                        sizeof(build_key_t));
+    build->order = (uint32_t *)malloc((size_t)build->n * sizeof(uint32_t));
+    build->offsets = (uint32_t *)calloc((size_t)threads * threads,
+                                        sizeof(uint32_t));
+    build->starts = (uint32_t *)malloc((threads + 1) * sizeof(uint32_t));
+    contexts = (build_context_t *)calloc(threads, sizeof(build_context_t));
+
+    if (NULL != build->info && NULL != build->order &&
+        NULL != build->offsets && NULL != build->starts && NULL != contexts)
+    {
+        for (uint32_t x = 0; x < threads; x++)
+        {
+            contexts[x].build = build;
+            contexts[x].id = x;
+            contexts[x].first = (uint32_t)((uint64_t)build->n * x / threads);
+            contexts[x].last =
+                (uint32_t)((uint64_t)build->n * (x + 1) / threads);
+        }
+        status = build_run(contexts, threads, build_hash_worker);
+    }
+
+    if (SUCCESS == status)
+    {
+        build_layout(build, contexts);
+        for (uint32_t x = 0; x < threads; x++)
+        {
+            key_total += contexts[x].key_total;
+        }
+        status = build_alloc(build, key_total);
+    }
+
+    if (SUCCESS == status)
+    {
+        build_run(contexts, threads, build_fill_worker);
+        build_run(contexts, threads, build_link_worker);
+        build->table->count = build->n;
+        for (uint32_t x = 0; NULL != build->table->bloom && x < build->n; x++)
+        {
+            bloom_add_hash(build->table->bloom, build->nodes[x].hash);
+        }
+    }
+
+    free(contexts);
+    free(build->starts);
+    free(build->offsets);
+    free(build->order);
+    free(build->info);
+
+    return status;
+}
+
+/**
+ * @brief builds a table holding n keys at once
+ *
+ * @param keys n NUL terminated keys
+ * @param values n data pointers, values[i] stored at keys[i]; none NULL
+ * @param n number of keys
+ * @param customfree pointer to the user defined free function
+ * @param opts table options, NULL selects every default
+ * @param threads number of threads to build with, 0 or 1 for the caller
+ *                only
+ *
+ * @return hash_table_t pointer to the built table, NULL on failure or when
+ *         a key or value is NULL
+ */
+hash_table_t *hash_table_build(char **keys, void **values, uint32_t n,
+                               FREE_F customfree,
+                               const hash_table_opts_t *opts,
+                               uint32_t threads)
+{
+    hash_table_opts_t settings = {0};
+    hash_table_t *table = NULL;
+    int status = FAILURE;
+
+    if (NULL != opts)
+    {
+        settings = *opts;
+    }
+    if (HASH_ENGINE_CHAINED == settings.engine &&
+        HASH_SYNC_NONE == settings.sync)
+    {
+        settings.use_slab = 1;
+    }
+
+    if (NULL != keys && NULL != values)
+    {
+        table = hash_table_init_ex(0 != n ? n : 1, customfree, &settings);
+    }
+
+    if (NULL != table && NULL != table->node_slab && 0 != n)
+    {
+        build_t build = {.table = table, .keys = keys, .values = values,
+                         .n = n};
+        threads = threads < BUILD_MAX_THREADS ? threads : BUILD_MAX_THREADS;
+        threads = threads < n / BUILD_MIN_KEYS_PER_THREAD ?
+                      threads :
+                      n / BUILD_MIN_KEYS_PER_THREAD;
+        build.threads = 0 != threads ? threads : 1;
+        status = build_chained(&build);
+    }
+    else if (NULL != table)
+    {
+        status = SUCCESS;
+        for (uint32_t x = 0; SUCCESS == status && x < n; x++)
+        {
+            status = hash_table_add(table, values[x], keys[x]);
+        }
+    }
+
+    if (SUCCESS != status)
+    {
+        hash_table_destroy(&table);
+    }
+
+    return table;
+}
@@ -0,0 +1,865 @@
+#include <hash_table.h>
+#include "hash_table_internal.h"
+
+#define CUCKOO_SLOTS 4
+#define CUCKOO_MIN_BUCKETS 4
+#define CUCKOO_MAX_PATH 5
+#define CUCKOO_MAX_SEARCH 512
+
+/**
+ * @brief structure of a cuckoo engine bucket, one 64 byte cache line
+ *
+ * A slot is empty when its tag is 0. Writers make version odd while they
+ * change the bucket and even again once they are done, so a lookup that
+ * runs without the writer lock can tell a key was moved under it.
+ *
+ * @param version   number of changes started on the bucket
+ * @param tags      top 16 bits of the hash of every slot's key, never 0
+ * @param nodes     node_t of every slot
+ */
+typedef struct cuckoo_bucket_t
+{
+    uint32_t version;
+    uint16_t tags[CUCKOO_SLOTS];
+    node_t *nodes[CUCKOO_SLOTS];
+} __attribute__((aligned(64))) cuckoo_bucket_t;
+
+/**
+ * @brief storage of the cuckoo engine
+ *
+ * Every key may live in one of two buckets, picked from its hash, so a
+ * lookup reads at most two cache lines of buckets however full the table
+ * is, plus the node_t of every slot whose tag matches. When both buckets
+ * of a new key are full, a breadth first search finds the shortest chain
+ * of keys that can each move to their other bucket and ends at a free
+ * slot, and the chain is shifted along to make room. Growing doubles the
+ * bucket count; a key's two buckets in the larger array are the ones its
+ * old buckets split into, so every slot keeps its index and no key is
+ * hashed again.
+ *
+ * @param mask      number of buckets minus one, a power of two minus one
+ * @param count     number of full slots
+ * @param buckets   the buckets
+ */
+typedef struct cuckoo_table_t
+{
+    uint32_t mask;
+    uint32_t count;
+    cuckoo_bucket_t buckets[];
+} cuckoo_table_t;
+
+/**
+ * @brief one bucket reached by the displacement search
+ *
+ * @param bucket    index of the bucket
+ * @param parent    step the key moving into bucket comes from, -1 for the
+ *                  new key's own buckets
+ * @param slot      slot of that key in the parent's bucket
+ * @param depth     number of keys that have to move to free a slot here
+ */
+typedef struct cuckoo_step_t
+{
+    uint32_t bucket;
+    int32_t parent;
+    uint32_t slot;
+    uint32_t depth;
+} cuckoo_step_t;
+
+/**
+ * @brief number of full slots allowed in a table of the given slot count
+ */
+static inline uint32_t cuckoo_max_load(uint32_t slots)
+{
+    return slots - slots / 16;
+}
+
+/**
+ * @brief tag stored for a hash, its top 16 bits; 0 marks empty slots so it
+ *        is moved to 1
+ */
+static inline uint16_t cuckoo_tag(uint64_t hash)
+{
+    uint16_t tag = (uint16_t)(hash >> 48);
+
+    return 0 != tag ? tag : 1;
+}
+
+/**
+ * @brief first bucket of a hash
+ */
+static inline uint32_t cuckoo_primary(uint64_t hash, uint32_t mask)
+{
+    return (uint32_t)hash & mask;
+}
+
+/**
+ * @brief second bucket of a hash; the odd offset keeps it apart from the
+ *        first one in any array of two or more buckets
+ */
+static inline uint32_t cuckoo_alternate(uint64_t hash, uint32_t mask)
+{
+    return ((uint32_t)hash ^ ((uint32_t)(hash >> 32) | 1)) & mask;
+}
+
+/**
+ * @brief the bucket a key stored in bucket can move to
+ */
+static inline uint32_t cuckoo_other(uint64_t hash, uint32_t bucket,
+                                    uint32_t mask)
+{
+    uint32_t primary = cuckoo_primary(hash, mask);
+
+    return bucket == primary ? cuckoo_alternate(hash, mask) : primary;
+}
+
+/**
+ * @brief marks a bucket as being changed
+ */
+static inline void cuckoo_write_begin(cuckoo_bucket_t *bucket)
+{
+    __atomic_store_n(&bucket->version, bucket->version + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief marks the change of a bucket as done
+ */
+static inline void cuckoo_write_end(cuckoo_bucket_t *bucket)
+{
+    __atomic_store_n(&bucket->version, bucket->version + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief fills or empties one slot of a bucket between cuckoo_write_begin
+ *        and cuckoo_write_end
+ *
+ * @param bucket bucket to change
+ * @param slot slot index
+ * @param node node_t to store, NULL to empty the slot
+ */
+static inline void cuckoo_set(cuckoo_bucket_t *bucket, uint32_t slot,
+                              node_t *node)
+{
+    __atomic_store_n(&bucket->tags[slot],
+                     NULL != node ? cuckoo_tag(node->hash) : 0,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&bucket->nodes[slot], node, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief allocates empty storage of the given bucket count
+ *
+ * @param buckets number of buckets, a power of two
+ *
+ * @return cuckoo_table_t pointer, NULL on allocation failure
+ */
+static cuckoo_table_t *cuckoo_alloc(uint32_t buckets)
+{
+    size_t bytes = sizeof(cuckoo_table_t) +
+                   (size_t)buckets * sizeof(cuckoo_bucket_t);
+    cuckoo_table_t *cuckoo =
+        (cuckoo_table_t *)aligned_alloc(sizeof(cuckoo_bucket_t), bytes);
+
+    if (NULL != cuckoo)
+    {
+        memset(cuckoo, 0, bytes);
+        cuckoo->mask = buckets - 1;
+    }
+
+    return cuckoo;
+}
+
+/**
+ * @brief searches the two buckets of key
+ *
+ * Safe to run while a writer changes the table: a node is only ever read
+ * once it is fully built, so a match is always a real entry. A miss may
+ * be wrong, when a writer moved key between the buckets mid search, and
+ * is checked against the bucket versions by the caller.
+ *
+ * @param cuckoo storage to search
+ * @param key key being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param where when not NULL, receives bucket * CUCKOO_SLOTS + slot of the
+ *              match
+ * @param probes incremented for every bucket searched
+ *
+ * @return node_t holding key, NULL when missing
+ */
+static node_t *cuckoo_find(cuckoo_table_t *cuckoo, const char *key,
+                           uint32_t len, uint64_t hash, uint32_t *where,
+                           uint32_t *probes)
+{
+    uint32_t buckets[2] = {cuckoo_primary(hash, cuckoo->mask),
+                           cuckoo_alternate(hash, cuckoo->mask)};
+    uint16_t tag = cuckoo_tag(hash);
+    node_t *found = NULL;
+
+    for (uint32_t choice = 0; NULL == found && choice < 2; choice++)
+    {
+        cuckoo_bucket_t *bucket = &cuckoo->buckets[buckets[choice]];
+        (*probes)++;
+        for (uint32_t slot = 0; slot < CUCKOO_SLOTS; slot++)
+        {
+            if (tag == __atomic_load_n(&bucket->tags[slot], __ATOMIC_RELAXED))
+            {
+                node_t *node =
+                    __atomic_load_n(&bucket->nodes[slot], __ATOMIC_ACQUIRE);
+                if (NULL != node &&
+                    hash_table_node_matches(node, key, len, hash))
+                {
+                    found = node;
+                    if (NULL != where)
+                    {
+                        *where = buckets[choice] * CUCKOO_SLOTS + slot;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief searches the two buckets of key without the writer lock,
+ *        searching again when a writer changed either bucket meanwhile and
+ *        the key was not found
+ *
+ * @param table pointer to table address
+ * @param key key being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param probes incremented for every bucket searched
+ *
+ * @return node_t holding key, NULL when missing
+ */
+static node_t *cuckoo_read(hash_table_t *table, const char *key, uint32_t len,
+                           uint64_t hash, uint32_t *probes)
+{
+    cuckoo_table_t *cuckoo = (cuckoo_table_t *)__atomic_load_n(
+        &table->engine_data, __ATOMIC_ACQUIRE);
+    node_t *found = NULL;
+
+    if (HASH_SYNC_RCU != table->sync)
+    {
+        found = cuckoo_find(cuckoo, key, len, hash, NULL, probes);
+    }
+    else
+    {
+        cuckoo_bucket_t *first =
+            &cuckoo->buckets[cuckoo_primary(hash, cuckoo->mask)];
+        cuckoo_bucket_t *second =
+            &cuckoo->buckets[cuckoo_alternate(hash, cuckoo->mask)];
+        int settled = 0;
+
+        while (!settled)
+        {
+            uint32_t first_version =
+                __atomic_load_n(&first->version, __ATOMIC_ACQUIRE);
+            uint32_t second_version =
+                __atomic_load_n(&second->version, __ATOMIC_ACQUIRE);
+
+            found = cuckoo_find(cuckoo, key, len, hash, NULL, probes);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            settled =
+                NULL != found ||
+                (0 == ((first_version | second_version) & 1) &&
+                 first_version ==
+                     __atomic_load_n(&first->version, __ATOMIC_RELAXED) &&
+                 second_version ==
+                     __atomic_load_n(&second->version, __ATOMIC_RELAXED));
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief moves the key in slot from of bucket source to slot to of bucket
+ *        target, the key's other bucket
+ *
+ * The key is stored in target before it leaves source, so a lookup always
+ * finds it in at least one of them.
+ *
+ * @param cuckoo storage to change
+ * @param source bucket index the key leaves
+ * @param from slot of the key in source
+ * @param target bucket index the key moves to
+ * @param to empty slot of target
+ */
+static void cuckoo_move(cuckoo_table_t *cuckoo, uint32_t source, uint32_t from,
+                        uint32_t target, uint32_t to)
+{
+    cuckoo_bucket_t *source_bucket = &cuckoo->buckets[source];
+    cuckoo_bucket_t *target_bucket = &cuckoo->buckets[target];
+
+    cuckoo_write_begin(source_bucket);
+    cuckoo_write_begin(target_bucket);
+    cuckoo_set(target_bucket, to, source_bucket->nodes[from]);
+    cuckoo_set(source_bucket, from, NULL);
+    cuckoo_write_end(target_bucket);
+    cuckoo_write_end(source_bucket);
+}
+
+/**
+ * @brief checks whether bucket already lies on the path leading to step
+ */
+static int cuckoo_on_path(const cuckoo_step_t *steps, int32_t step,
+                          uint32_t bucket)
+{
+    int found = 0;
+
+    for (; !found && -1 != step; step = steps[step].parent)
+    {
+        found = steps[step].bucket == bucket;
+    }
+
+    return found;
+}
+
+/**
+ * @brief frees a slot in one of the two buckets of hash, moving other keys
+ *        to their other bucket when both are full
+ *
+ * The search visits buckets breadth first, so the shortest chain of moves
+ * is used, and gives up after CUCKOO_MAX_SEARCH buckets or chains longer
+ * than CUCKOO_MAX_PATH keys. A bucket never appears twice on one chain.
+ *
+ * @param cuckoo storage to change
+ * @param hash hash of the key being placed
+ * @param where receives bucket * CUCKOO_SLOTS + slot of the free slot
+ *
+ * @return int exit code
+ */
+static int cuckoo_make_room(cuckoo_table_t *cuckoo, uint64_t hash,
+                            uint32_t *where)
+{
+    int status = FAILURE;
+    cuckoo_step_t steps[CUCKOO_MAX_SEARCH];
+    uint32_t head = 0;
+    uint32_t tail = 2;
+    uint32_t free_slot = 0;
+
+    steps[0] = (cuckoo_step_t){cuckoo_primary(hash, cuckoo->mask), -1, 0, 0};
+    steps[1] = (cuckoo_step_t){cuckoo_alternate(hash, cuckoo->mask), -1, 0, 0};
+
+    for (; FAILURE == status && head < tail; head++)
+    {
+        cuckoo_bucket_t *bucket = &cuckoo->buckets[steps[head].bucket];
+
+        for (uint32_t slot = 0; slot < CUCKOO_SLOTS; slot++)
+        {
+            if (NULL == bucket->nodes[slot])
+            {
+                free_slot = slot;
+                status = SUCCESS;
+                break;
+            }
+        }
+
+        for (uint32_t slot = 0; FAILURE == status &&
+                                steps[head].depth < CUCKOO_MAX_PATH &&
+                                slot < CUCKOO_SLOTS && tail < CUCKOO_MAX_SEARCH;
+             slot++)
+        {
+            uint32_t other = cuckoo_other(bucket->nodes[slot]->hash,
+                                          steps[head].bucket, cuckoo->mask);
+            if (!cuckoo_on_path(steps, (int32_t)head, other))
+            {
+                steps[tail++] = (cuckoo_step_t){other, (int32_t)head, slot,
+                                                steps[head].depth + 1};
+            }
+        }
+    }
+
+    if (SUCCESS == status)
+    {
+        // the loop moved past the step holding the free slot
+        int32_t step = (int32_t)head - 1;
+
+        // shift the chain from its free end, so every key is always stored
+        while (-1 != steps[step].parent)
+        {
+            int32_t parent = steps[step].parent;
+            cuckoo_move(cuckoo, steps[parent].bucket, steps[step].slot,
+                        steps[step].bucket, free_slot);
+            free_slot = steps[step].slot;
+            step = parent;
+        }
+        *where = steps[step].bucket * CUCKOO_SLOTS + free_slot;
+    }
+
+    return status;
+}
+
+/**
+ * @brief frees storage replaced by a larger one, once no reader can be
+ *        searching it any more
+ */
+static void cuckoo_release_storage(hash_table_t *table, void *memory)
+{
+    (void)table;
+    free(memory);
+}
+
+/**
+ * @brief frees a node_t once no reader can be looking at it any more
+ */
+static void cuckoo_release_node(hash_table_t *table, void *memory)
+{
+    hash_table_node_free(table, (node_t *)memory);
+}
+
+/**
+ * @brief moves every key into storage of twice the bucket count
+ *
+ * Each old bucket splits into the two buckets of the same index modulo
+ * the old size, and a key in its first bucket stays in its first one, so
+ * every key keeps its slot index and always fits.
+ *
+ * @param table pointer to table address
+ *
+ * @return int exit code
+ */
+static int cuckoo_grow(hash_table_t *table)
+{
+    int status = SUCCESS;
+    cuckoo_table_t *cuckoo = (cuckoo_table_t *)table->engine_data;
+    uint32_t buckets = (cuckoo->mask + 1) * 2;
+    cuckoo_table_t *grown = NULL;
+
+    if (0 != buckets * CUCKOO_SLOTS)
+    {
+        grown = cuckoo_alloc(buckets);
+    }
+
+    if (NULL == grown)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        for (uint32_t x = 0; x <= cuckoo->mask; x++)
+        {
+            for (uint32_t slot = 0; slot < CUCKOO_SLOTS; slot++)
+            {
+                node_t *node = cuckoo->buckets[x].nodes[slot];
+                if (NULL != node)
+                {
+                    uint32_t target =
+                        x == cuckoo_primary(node->hash, cuckoo->mask) ?
+                            cuckoo_primary(node->hash, grown->mask) :
+                            cuckoo_alternate(node->hash, grown->mask);
+                    grown->buckets[target].tags[slot] =
+                        cuckoo->buckets[x].tags[slot];
+                    grown->buckets[target].nodes[slot] = node;
+                }
+            }
+        }
+        grown->count = cuckoo->count;
+
+        __atomic_store_n(&table->engine_data, grown, __ATOMIC_RELEASE);
+        table->size = buckets * CUCKOO_SLOTS;
+        if (HASH_SYNC_RCU == table->sync)
+        {
+            hash_table_rcu_retire(table, cuckoo, cuckoo_release_storage);
+        }
+        else
+        {
+            free(cuckoo);
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief allocates cuckoo storage with room for size entries
+ *
+ * @param table pointer to table address
+ * @param size number of entries to reserve room for
+ *
+ * @return int exit code
+ */
+static int cuckoo_init(hash_table_t *table, uint32_t size)
+{
+    int status = SUCCESS;
+    uint32_t buckets = CUCKOO_MIN_BUCKETS;
+    cuckoo_table_t *cuckoo = NULL;
+
+    while (0 != buckets * CUCKOO_SLOTS &&
+           cuckoo_max_load(buckets * CUCKOO_SLOTS) < size)
+    {
+        buckets *= 2;
+    }
+
+    if (0 != buckets * CUCKOO_SLOTS)
+    {
+        cuckoo = cuckoo_alloc(buckets);
+    }
+
+    if (NULL == cuckoo)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        table->engine_data = cuckoo;
+        table->size = buckets * CUCKOO_SLOTS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief stores node in one of its two buckets, growing when the table is
+ *        full or no chain of moves frees a slot
+ *
+ * @param table pointer to table address
+ * @param node node_t to store
+ *
+ * @return int exit code
+ */
+static int cuckoo_insert(hash_table_t *table, node_t *node)
+{
+    int status = FAILURE;
+    int done = 0;
+
+    while (!done)
+    {
+        cuckoo_table_t *cuckoo = (cuckoo_table_t *)table->engine_data;
+        uint32_t slots = (cuckoo->mask + 1) * CUCKOO_SLOTS;
+        uint32_t where = 0;
+
+        if (cuckoo->count < cuckoo_max_load(slots) &&
+            SUCCESS == cuckoo_make_room(cuckoo, node->hash, &where))
+        {
+            cuckoo_bucket_t *bucket = &cuckoo->buckets[where / CUCKOO_SLOTS];
+            cuckoo_write_begin(bucket);
+            cuckoo_set(bucket, where % CUCKOO_SLOTS, node);
+            cuckoo_write_end(bucket);
+            cuckoo->count++;
+            status = SUCCESS;
+            done = 1;
+        }
+        // a mostly empty table with no room for the key already holds
+        // eight copies of it in its two buckets; growing cannot help
+        else if (cuckoo->count < slots / 4 || SUCCESS != cuckoo_grow(table))
+        {
+            done = 1;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief stores data at key in one of the key's two buckets
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int exit code
+ */
+static int cuckoo_add(hash_table_t *table, void *data, const char *key,
+                      uint32_t len, uint64_t hash)
+{
+    int status = FAILURE;
+    node_t *node = hash_table_node_create(table, data, key, len, hash);
+
+    if (NULL != node)
+    {
+        status = cuckoo_insert(table, node);
+        if (SUCCESS != status)
+        {
+            hash_table_node_free(table, node);
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief returns the data slot of key, adding key with data when it is not
+ *        present
+ *
+ * @param table pointer to table address
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param data data to store when key is not present
+ * @param inserted set to non-zero when key was added
+ *
+ * @return pointer to the node's data, NULL on allocation failure
+ */
+static void **cuckoo_upsert(hash_table_t *table, const char *key,
+                            uint32_t len, uint64_t hash, void *data,
+                            int *inserted)
+{
+    uint32_t probes = 0;
+    node_t *node = cuckoo_find((cuckoo_table_t *)table->engine_data, key, len,
+                               hash, NULL, &probes);
+
+    *inserted = 0;
+    if (NULL == node)
+    {
+        node = hash_table_node_create(table, data, key, len, hash);
+        if (NULL != node && SUCCESS != cuckoo_insert(table, node))
+        {
+            hash_table_node_free(table, node);
+            node = NULL;
+        }
+        *inserted = NULL != node;
+    }
+
+    return NULL != node ? &node->data : NULL;
+}
+
+/**
+ * @brief looks up key in its two buckets
+ *
+ * The buckets hold only a 16 bit tag of each key, so a slot whose tag
+ * matches still has its node_t opened to compare the key and read the
+ * data. A hit therefore touches a third cache line, and more when the key
+ * is longer than the inline space; a miss opens a node only on the rare
+ * tag collision.
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return void * data
+ */
+static void *cuckoo_lookup(hash_table_t *table, const char *key, uint32_t len,
+                           uint64_t hash)
+{
+    void *data = NULL;
+    uint32_t probes = 0;
+    node_t *node = cuckoo_read(table, key, len, hash, &probes);
+
+    if (NULL != node)
+    {
+        data = __atomic_load_n(&node->data, __ATOMIC_ACQUIRE);
+    }
+    hash_table_count_lookups(table, 1, NULL != node, probes);
+
+    return data;
+}
+
+/**
+ * @brief looks up a group of keys after prefetching both buckets of every
+ *        key, so their cache misses overlap
+ *
+ * @param table pointer to table address
+ * @param keys keys being searched for
+ * @param lens number of bytes in each key
+ * @param hashes hash of each key
+ * @param n number of keys, at most HASH_TABLE_BATCH
+ * @param out data stored at each key, NULL when missing
+ */
+static void cuckoo_lookup_batch(hash_table_t *table, const char *const *keys,
+                                const uint32_t *lens, const uint64_t *hashes,
+                                uint32_t n, void **out)
+{
+    cuckoo_table_t *cuckoo = (cuckoo_table_t *)__atomic_load_n(
+        &table->engine_data, __ATOMIC_ACQUIRE);
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        __builtin_prefetch(
+            &cuckoo->buckets[cuckoo_primary(hashes[x], cuckoo->mask)]);
+        __builtin_prefetch(
+            &cuckoo->buckets[cuckoo_alternate(hashes[x], cuckoo->mask)]);
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        out[x] = cuckoo_lookup(table, keys[x], lens[x], hashes[x]);
+    }
+}
+
+/**
+ * @brief empties the slot holding key
+ *
+ * @param table pointer to table address
+ * @param key key of data to be removed
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int
+ */
+static int cuckoo_remove(hash_table_t *table, const char *key, uint32_t len,
+                         uint64_t hash)
+{
+    int status = FAILURE;
+    cuckoo_table_t *cuckoo = (cuckoo_table_t *)table->engine_data;
+    uint32_t where = 0;
+    uint32_t probes = 0;
+    node_t *node = cuckoo_find(cuckoo, key, len, hash, &where, &probes);
+
+    if (NULL != node)
+    {
+        cuckoo_bucket_t *bucket = &cuckoo->buckets[where / CUCKOO_SLOTS];
+        cuckoo_write_begin(bucket);
+        cuckoo_set(bucket, where % CUCKOO_SLOTS, NULL);
+        cuckoo_write_end(bucket);
+        cuckoo->count--;
+        if (HASH_SYNC_RCU == table->sync)
+        {
+            hash_table_rcu_retire(table, node, cuckoo_release_node);
+        }
+        else
+        {
+            hash_table_node_free(table, node);
+        }
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+/**
+ * @brief visits every key stored in the bucket the cursor points at
+ *
+ * Growing keeps keys in the buckets their old bucket split into, so the
+ * reverse binary cursor survives it. A key moved to its other bucket by
+ * an add made during the scan may be missed or visited twice.
+ *
+ * @param table pointer to table address
+ * @param cursor current cursor
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ * @param emitted incremented for every visited entry
+ *
+ * @return next cursor, 0 once every bucket was visited
+ */
+static uint64_t cuckoo_scan(hash_table_t *table, uint64_t cursor,
+                            HASH_SCAN_F callback, void *context,
+                            uint32_t *emitted)
+{
+    cuckoo_table_t *cuckoo = (cuckoo_table_t *)__atomic_load_n(
+        &table->engine_data, __ATOMIC_ACQUIRE);
+    cuckoo_bucket_t *bucket = &cuckoo->buckets[(uint32_t)cursor & cuckoo->mask];
+
+    for (uint32_t slot = 0; slot < CUCKOO_SLOTS; slot++)
+    {
+        node_t *node = __atomic_load_n(&bucket->nodes[slot], __ATOMIC_ACQUIRE);
+        if (NULL != node)
+        {
+            callback(node->key, node->key_len,
+                     __atomic_load_n(&node->data, __ATOMIC_ACQUIRE), context);
+            (*emitted)++;
+        }
+    }
+
+    return hash_table_cursor_next(cursor, cuckoo->mask);
+}
+
+/**
+ * @brief empties every slot; under HASH_SYNC_RCU the nodes are retired
+ *        one by one as lookups may still be reading them
+ *
+ * @param table pointer to table address
+ */
+static void cuckoo_clear(hash_table_t *table)
+{
+    cuckoo_table_t *cuckoo = (cuckoo_table_t *)table->engine_data;
+
+    for (uint32_t x = 0; x <= cuckoo->mask; x++)
+    {
+        cuckoo_bucket_t *bucket = &cuckoo->buckets[x];
+
+        cuckoo_write_begin(bucket);
+        for (uint32_t slot = 0; slot < CUCKOO_SLOTS; slot++)
+        {
+            node_t *node = bucket->nodes[slot];
+            if (NULL == node)
+            {
+                continue;
+            }
+            cuckoo_set(bucket, slot, NULL);
+            if (HASH_SYNC_RCU == table->sync)
+            {
+                hash_table_rcu_retire(table, node, cuckoo_release_node);
+            }
+            // slab nodes are released by hash_table_clear all at once
+            else if (NULL == table->node_slab)
+            {
+                hash_table_node_free(table, node);
+            }
+        }
+        cuckoo_write_end(bucket);
+    }
+    cuckoo->count = 0;
+}
+
+/**
+ * @brief frees the cuckoo storage and every node in it
+ *
+ * @param table pointer to table address
+ */
+static void cuckoo_destroy(hash_table_t *table)
+{
+    cuckoo_table_t *cuckoo = (cuckoo_table_t *)table->engine_data;
+
+    for (uint32_t x = 0; NULL == table->node_slab && x <= cuckoo->mask; x++)
+    {
+        for (uint32_t slot = 0; slot < CUCKOO_SLOTS; slot++)
+        {
+            if (NULL != cuckoo->buckets[x].nodes[slot])
+            {
+                hash_table_node_free(table, cuckoo->buckets[x].nodes[slot]);
+            }
+        }
+    }
+    free(cuckoo);
+    table->engine_data = NULL;
+}
+
+/**
+ * @brief reports how many keys sit in their first bucket, length 0, and
+ *        how many in their second, length 1
+ *
+ * @param table pointer to table address
+ * @param out stats being filled in
+ */
+static void cuckoo_stats(hash_table_t *table, hash_table_stats_t *out)
+{
+    cuckoo_table_t *cuckoo = (cuckoo_table_t *)table->engine_data;
+
+    for (uint32_t x = 0; x <= cuckoo->mask; x++)
+    {
+        for (uint32_t slot = 0; slot < CUCKOO_SLOTS; slot++)
+        {
+            node_t *node = cuckoo->buckets[x].nodes[slot];
+            if (NULL != node)
+            {
+                hash_table_stats_record(
+                    out, x != cuckoo_primary(node->hash, cuckoo->mask), 1);
+                out->bytes_used += hash_table_node_bytes(node);
+            }
+        }
+    }
+    out->buckets = cuckoo->mask + 1;
+    out->bytes_used += sizeof(cuckoo_table_t) +
+                       (cuckoo->mask + 1) * sizeof(cuckoo_bucket_t);
+}
+
+const hash_engine_ops_t cuckoo_engine_ops = {
+    .init = cuckoo_init,
+    .add = cuckoo_add,
+    .lookup = cuckoo_lookup,
+    .remove = cuckoo_remove,
+    .clear = cuckoo_clear,
+    .destroy = cuckoo_destroy,
+    .lookup_batch = cuckoo_lookup_batch,
+    .upsert = cuckoo_upsert,
+    .scan = cuckoo_scan,
+    .stats = cuckoo_stats,
+};
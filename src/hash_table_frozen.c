@@ -0,0 +1,683 @@
+#include <hash_table.h>
+#include "hash_table_internal.h"
+
+#define FROZEN_KEYS_PER_BUCKET 5
+#define FROZEN_MAX_PILOT UINT16_MAX
+#define FROZEN_ATTEMPTS 16
+#define FROZEN_MAX_BUCKET 64
+#define FROZEN_DENSE_KEYS (0x100000000ULL * 6 / 10)
+
+/**
+ * @brief one slot of a frozen table
+ *
+ * @param data          data stored at the key
+ * @param key_offset    start of the key bytes in the key blob
+ * @param key_len       number of bytes in key, excluding the terminator
+ */
+typedef struct frozen_entry_t
+{
+    void *data;
+    uint32_t key_offset;
+    uint32_t key_len;
+} frozen_entry_t;
+
+/**
+ * @brief storage of a table built by hash_table_freeze
+ *
+ * Every key has one slot, an entry holding its data and where its bytes
+ * start in keys, so a lookup reads a single entry before comparing the
+ * key. A key hashes to a bucket, and the bucket's pilot picks
+ * the key's position among the slots positions. Positions past count are
+ * folded back onto the slots left free below count through remap, so the
+ * keys occupy exactly count slots.
+ *
+ * @param count     number of keys
+ * @param slots     number of positions pilots map keys to, slightly more
+ *                  than count so the last buckets still find free ones
+ * @param buckets   number of buckets
+ * @param pilots    pilot of every bucket
+ * @param remap     slot of every position past count
+ * @param entries   the entry of every slot
+ * @param keys      every key back to back, each followed by a NUL
+ */
+typedef struct frozen_table_t
+{
+    uint32_t count;
+    uint32_t slots;
+    uint32_t buckets;
+    uint16_t *pilots;
+    uint32_t *remap;
+    frozen_entry_t *entries;
+    char *keys;
+} frozen_table_t;
+
+/**
+ * @brief a key being placed, sorted by hash to find duplicates
+ *
+ * @param hash  hash of the key under the frozen table's seed
+ * @param index position of the key in the collected entries
+ */
+typedef struct frozen_key_t
+{
+    uint64_t hash;
+    uint32_t index;
+} frozen_key_t;
+
+/**
+ * @brief bucket of a key
+ *
+ * Buckets are skewed: the high half of the hash sends 60% of the keys to
+ * the first 30% of the buckets, and the low half picks the bucket within
+ * either range. The dense buckets are placed first, while most slots are
+ * still free, leaving mostly one and two key buckets for the crowded end
+ * of the search, which cuts the pilot search several times over.
+ */
+static inline uint32_t frozen_bucket(uint64_t hash, uint32_t buckets)
+{
+    uint32_t dense = (uint32_t)((uint64_t)buckets * 3 / 10) + 1;
+    uint64_t low = hash & 0xffffffffULL;
+    uint32_t bucket = 0;
+
+    if ((hash >> 32) < FROZEN_DENSE_KEYS)
+    {
+        bucket = (uint32_t)((low * dense) >> 32);
+    }
+    else
+    {
+        bucket = dense + (uint32_t)((low * (buckets - dense)) >> 32);
+    }
+
+    return bucket;
+}
+
+/**
+ * @brief position of a key under its bucket's pilot
+ *
+ * The pilot is mixed into the whole hash, so every pilot sends the keys of
+ * a bucket to independent positions.
+ */
+static inline uint32_t frozen_position(uint64_t hash, uint32_t pilot,
+                                       uint32_t slots)
+{
+    uint64_t mixed = hash ^ ((pilot + 1ULL) * 0x9e3779b97f4a7c15ULL);
+
+    mixed ^= mixed >> 33;
+    mixed *= 0xff51afd7ed558ccdULL;
+    mixed ^= mixed >> 33;
+
+    return (uint32_t)(((mixed & 0xffffffffULL) * slots) >> 32);
+}
+
+/**
+ * @brief slot a key is stored at
+ */
+static inline uint32_t frozen_slot(const frozen_table_t *frozen,
+                                   uint64_t hash)
+{
+    uint32_t pilot = frozen->pilots[frozen_bucket(hash, frozen->buckets)];
+    uint32_t position = frozen_position(hash, pilot, frozen->slots);
+
+    return position < frozen->count ? position :
+                                      frozen->remap[position - frozen->count];
+}
+
+/**
+ * @brief orders keys by hash, and keys of equal hash by their position in
+ *        the source table
+ */
+static int frozen_key_compare(const void *left, const void *right)
+{
+    const frozen_key_t *a = (const frozen_key_t *)left;
+    const frozen_key_t *b = (const frozen_key_t *)right;
+    int order = 0;
+
+    if (a->hash != b->hash)
+    {
+        order = a->hash < b->hash ? -1 : 1;
+    }
+    else if (a->index != b->index)
+    {
+        order = a->index < b->index ? -1 : 1;
+    }
+
+    return order;
+}
+
+/**
+ * @brief frees the storage of a frozen table
+ */
+static void frozen_free(frozen_table_t *frozen)
+{
+    if (NULL != frozen)
+    {
+        free(frozen->pilots);
+        free(frozen->remap);
+        free(frozen->entries);
+        free(frozen->keys);
+        free(frozen);
+    }
+}
+
+/**
+ * @brief hashes every entry with the frozen table's seed, sorts them by
+ *        hash and drops all but the first copy of every key
+ *
+ * @param table frozen table whose hash function and seed to use
+ * @param entries collected entries
+ * @param count number of entries
+ * @param keys receives the distinct keys sorted by hash
+ *
+ * @return number of distinct keys, UINT32_MAX when two different keys
+ *         share a hash and another seed has to be tried
+ */
+static uint32_t frozen_hash_keys(hash_table_t *table,
+                                 const hash_table_entry_t *entries,
+                                 uint32_t count, frozen_key_t *keys)
+{
+    uint32_t distinct = 0;
+
+    for (uint32_t x = 0; x < count; x++)
+    {
+        keys[x].hash = hash_table_hash(table, entries[x].key, entries[x].len);
+        keys[x].index = x;
+    }
+    qsort(keys, count, sizeof(frozen_key_t), frozen_key_compare);
+
+    for (uint32_t x = 0; x < count && UINT32_MAX != distinct; x++)
+    {
+        if (0 == distinct || keys[distinct - 1].hash != keys[x].hash)
+        {
+            keys[distinct++] = keys[x];
+        }
+        else
+        {
+            const hash_table_entry_t *kept = &entries[keys[distinct - 1].index];
+            const hash_table_entry_t *other = &entries[keys[x].index];
+            if (kept->len != other->len ||
+                0 != memcmp(kept->key, other->key, kept->len))
+            {
+                distinct = UINT32_MAX;
+            }
+        }
+    }
+
+    return distinct;
+}
+
+/**
+ * @brief searches a pilot for every bucket, largest buckets first, so that
+ *        no two keys share a position
+ *
+ * @param frozen storage with count, slots and buckets set and pilots
+ *               allocated
+ * @param keys distinct keys
+ * @param positions receives the position of every key
+ *
+ * @return int exit code, FAILURE when some bucket has no pilot left
+ */
+static int frozen_place(frozen_table_t *frozen, const frozen_key_t *keys,
+                        uint32_t *positions)
+{
+    int status = SUCCESS;
+    uint32_t *starts = (uint32_t *)calloc(frozen->buckets + 2ULL,
+                                          sizeof(uint32_t));
+    uint32_t *members = (uint32_t *)malloc(
+        (frozen->count + 1ULL) * sizeof(uint32_t));
+    uint32_t *order = (uint32_t *)malloc(
+        (frozen->buckets + 1ULL) * sizeof(uint32_t));
+    uint64_t *taken = (uint64_t *)calloc(frozen->slots / 64 + 1,
+                                         sizeof(uint64_t));
+    uint32_t sizes[FROZEN_MAX_BUCKET + 2] = {0};
+
+    if (NULL == starts || NULL == members || NULL == order || NULL == taken)
+    {
+        status = FAILURE;
+    }
+
+    if (SUCCESS == status)
+    {
+        // group keys by bucket
+        for (uint32_t x = 0; x < frozen->count; x++)
+        {
+            starts[frozen_bucket(keys[x].hash, frozen->buckets) + 2]++;
+        }
+        for (uint32_t x = 2; x < frozen->buckets + 2; x++)
+        {
+            starts[x] += starts[x - 1];
+        }
+        for (uint32_t x = 0; x < frozen->count; x++)
+        {
+            uint32_t bucket = frozen_bucket(keys[x].hash, frozen->buckets);
+            members[starts[bucket + 1]++] = x;
+        }
+
+        // order buckets by size, largest first, while they are still easy
+        // to place
+        for (uint32_t x = 0; SUCCESS == status && x < frozen->buckets; x++)
+        {
+            uint32_t size = starts[x + 1] - starts[x];
+            if (size > FROZEN_MAX_BUCKET)
+            {
+                status = FAILURE;
+            }
+            else
+            {
+                sizes[FROZEN_MAX_BUCKET - size + 1]++;
+            }
+        }
+        for (uint32_t x = 1; x <= FROZEN_MAX_BUCKET + 1; x++)
+        {
+            sizes[x] += sizes[x - 1];
+        }
+        for (uint32_t x = 0; SUCCESS == status && x < frozen->buckets; x++)
+        {
+            order[sizes[FROZEN_MAX_BUCKET - (starts[x + 1] - starts[x])]++] = x;
+        }
+    }
+
+    for (uint32_t x = 0; SUCCESS == status && x < frozen->buckets; x++)
+    {
+        uint32_t bucket = order[x];
+        uint32_t first = starts[bucket];
+        uint32_t size = starts[bucket + 1] - first;
+        uint32_t pilot = 0;
+
+        for (; size > 0 && pilot <= FROZEN_MAX_PILOT; pilot++)
+        {
+            uint32_t placed = 0;
+            for (; placed < size; placed++)
+            {
+                uint32_t key = members[first + placed];
+                uint32_t position = frozen_position(keys[key].hash, pilot,
+                                                    frozen->slots);
+                if (taken[position / 64] & (1ULL << (position % 64)))
+                {
+                    break;
+                }
+                // keep the position taken so later keys of the bucket
+                // cannot land on it too
+                taken[position / 64] |= 1ULL << (position % 64);
+                positions[key] = position;
+            }
+            if (placed == size)
+            {
+                break;
+            }
+            for (uint32_t y = 0; y < placed; y++)
+            {
+                uint32_t position = positions[members[first + y]];
+                taken[position / 64] &= ~(1ULL << (position % 64));
+            }
+        }
+
+        if (pilot > FROZEN_MAX_PILOT)
+        {
+            status = FAILURE;
+        }
+        else
+        {
+            frozen->pilots[bucket] = (uint16_t)pilot;
+        }
+    }
+
+    // send every position past count to a slot left free below it
+    for (uint32_t position = frozen->count, free_slot = 0;
+         SUCCESS == status && position < frozen->slots; position++)
+    {
+        if (taken[position / 64] & (1ULL << (position % 64)))
+        {
+            while (taken[free_slot / 64] & (1ULL << (free_slot % 64)))
+            {
+                free_slot++;
+            }
+            frozen->remap[position - frozen->count] = free_slot++;
+        }
+    }
+
+    free(taken);
+    free(order);
+    free(members);
+    free(starts);
+
+    return status;
+}
+
+/**
+ * @brief copies the keys and data into slot order
+ *
+ * @param frozen storage with pilots and remap filled in
+ * @param entries collected entries
+ * @param keys distinct keys
+ * @param positions position of every key
+ *
+ * @return int exit code
+ */
+static int frozen_fill(frozen_table_t *frozen,
+                       const hash_table_entry_t *entries,
+                       const frozen_key_t *keys, const uint32_t *positions)
+{
+    int status = SUCCESS;
+    uint32_t *owner = (uint32_t *)malloc(
+        (frozen->count + 1ULL) * sizeof(uint32_t));
+    uint64_t key_bytes = 0;
+
+    for (uint32_t x = 0; x < frozen->count; x++)
+    {
+        key_bytes += entries[keys[x].index].len + 1ULL;
+    }
+
+    frozen->entries = (frozen_entry_t *)malloc(
+        (frozen->count + 1ULL) * sizeof(frozen_entry_t));
+    if (key_bytes <= UINT32_MAX)
+    {
+        frozen->keys = (char *)malloc(key_bytes + 1);
+    }
+    if (NULL == owner || NULL == frozen->entries || NULL == frozen->keys)
+    {
+        status = FAILURE;
+    }
+
+    if (SUCCESS == status)
+    {
+        uint32_t offset = 0;
+
+        for (uint32_t x = 0; x < frozen->count; x++)
+        {
+            uint32_t position = positions[x];
+            if (position >= frozen->count)
+            {
+                position = frozen->remap[position - frozen->count];
+            }
+            owner[position] = x;
+        }
+
+        for (uint32_t slot = 0; slot < frozen->count; slot++)
+        {
+            const hash_table_entry_t *entry = &entries[keys[owner[slot]].index];
+            frozen->entries[slot] = (frozen_entry_t){entry->data, offset,
+                                                     entry->len};
+            memcpy(frozen->keys + offset, entry->key, entry->len);
+            frozen->keys[offset + entry->len] = '\0';
+            offset += entry->len + 1;
+        }
+    }
+
+    free(owner);
+
+    return status;
+}
+
+/**
+ * @brief builds an immutable copy of a table indexed by a minimal perfect
+ *        hash
+ *
+ * @param table pointer to table address
+ *
+ * @return hash_table_t pointer to the frozen table, NULL on failure
+ */
+hash_table_t *hash_table_freeze(hash_table_t *table)
+{
+    hash_table_t *frozen_table = NULL;
+    frozen_table_t *frozen = NULL;
+    hash_table_entry_t *entries = NULL;
+    frozen_key_t *keys = NULL;
+    uint32_t *positions = NULL;
+    uint32_t count = 0;
+    int status = FAILURE;
+    int built = 0;
+
+    if (NULL != table && SUCCESS == hash_table_collect(table, &entries, &count))
+    {
+        frozen_table = (hash_table_t *)calloc(1, sizeof(hash_table_t));
+        keys = (frozen_key_t *)malloc((count + 1ULL) * sizeof(frozen_key_t));
+        positions = (uint32_t *)malloc((count + 1ULL) * sizeof(uint32_t));
+    }
+
+    if (NULL != frozen_table && NULL != keys && NULL != positions)
+    {
+        frozen_table->customfree = free;
+        frozen_table->engine = HASH_ENGINE_FROZEN;
+        frozen_table->ops = &frozen_engine_ops;
+        frozen_table->hash_func = HASH_FUNC_WY;
+        frozen_table->hash = hash_func_get(HASH_FUNC_WY);
+        frozen_table->sync = HASH_SYNC_NONE;
+        status = SUCCESS;
+    }
+
+    // a seed can fail when two keys share a hash or a bucket runs out of
+    // pilots; both are rare, so a handful of fresh seeds always suffices in
+    // practice. Every retry also spreads the keys over more buckets
+    for (uint32_t attempt = 0;
+         SUCCESS == status && !built && attempt < FROZEN_ATTEMPTS; attempt++)
+    {
+        uint32_t distinct = 0;
+
+        frozen_free(frozen);
+        frozen = (frozen_table_t *)calloc(1, sizeof(frozen_table_t));
+        if (NULL != frozen)
+        {
+            hash_func_random_seed(frozen_table->seed);
+            distinct = frozen_hash_keys(frozen_table, entries, count, keys);
+        }
+
+        if (NULL == frozen)
+        {
+            status = FAILURE;
+        }
+        else if (UINT32_MAX != distinct)
+        {
+            frozen->count = distinct;
+            frozen->slots = distinct + distinct / 99 + 1;
+            frozen->buckets = (uint32_t)((uint64_t)distinct * (4 + attempt) /
+                                         4 / FROZEN_KEYS_PER_BUCKET) + 2;
+            frozen->pilots = (uint16_t *)calloc(frozen->buckets,
+                                                sizeof(uint16_t));
+            frozen->remap = (uint32_t *)calloc(frozen->slots - frozen->count,
+                                               sizeof(uint32_t));
+            if (NULL == frozen->pilots || NULL == frozen->remap)
+            {
+                status = FAILURE;
+            }
+            else if (SUCCESS == frozen_place(frozen, keys, positions))
+            {
+                status = frozen_fill(frozen, entries, keys, positions);
+                built = 1;
+            }
+        }
+    }
+
+    // a frozen table never changes, so any number of threads may read it
+    if (SUCCESS == status && built &&
+        SUCCESS == hash_table_counters_init(frozen_table, 1))
+    {
+        frozen_table->engine_data = frozen;
+        frozen_table->count = frozen->count;
+        frozen_table->size = frozen->count;
+        frozen_table->min_size = frozen->count;
+    }
+    else
+    {
+        frozen_free(frozen);
+        free(frozen_table);
+        frozen_table = NULL;
+    }
+
+    free(positions);
+    free(keys);
+    free(entries);
+
+    return frozen_table;
+}
+
+/**
+ * @brief checks whether the key stored at slot is key
+ */
+static inline int frozen_matches(const frozen_table_t *frozen, uint32_t slot,
+                                 const char *key, uint32_t len)
+{
+    const frozen_entry_t *entry = &frozen->entries[slot];
+
+    return entry->key_len == len &&
+           memcmp(frozen->keys + entry->key_offset, key, len) == 0;
+}
+
+/**
+ * @brief finds the data stored at key with one pilot read and one key
+ *        comparison
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return data stored at key, NULL when missing
+ */
+static void *frozen_lookup(hash_table_t *table, const char *key, uint32_t len,
+                           uint64_t hash)
+{
+    frozen_table_t *frozen = (frozen_table_t *)table->engine_data;
+    void *data = NULL;
+
+    if (0 != frozen->count)
+    {
+        uint32_t slot = frozen_slot(frozen, hash);
+        if (frozen_matches(frozen, slot, key, len))
+        {
+            data = frozen->entries[slot].data;
+        }
+        hash_table_count_lookups(table, 1, NULL != data, 1);
+    }
+
+    return data;
+}
+
+/**
+ * @brief looks up several keys, prefetching every pilot, then every slot,
+ *        then every key before comparing
+ *
+ * @param table pointer to table address
+ * @param keys keys for data being searched for
+ * @param lens number of bytes in each key
+ * @param hashes hash of each key
+ * @param n number of keys, at most HASH_TABLE_BATCH
+ * @param out data stored at each key, NULL when missing
+ */
+static void frozen_lookup_batch(hash_table_t *table, const char *const *keys,
+                                const uint32_t *lens, const uint64_t *hashes,
+                                uint32_t n, void **out)
+{
+    frozen_table_t *frozen = (frozen_table_t *)table->engine_data;
+    uint32_t slots[HASH_TABLE_BATCH];
+
+    if (0 == frozen->count)
+    {
+        memset(out, 0, n * sizeof(void *));
+    }
+    else
+    {
+        for (uint32_t x = 0; x < n; x++)
+        {
+            __builtin_prefetch(
+                &frozen->pilots[frozen_bucket(hashes[x], frozen->buckets)]);
+        }
+        for (uint32_t x = 0; x < n; x++)
+        {
+            slots[x] = frozen_slot(frozen, hashes[x]);
+            __builtin_prefetch(&frozen->entries[slots[x]]);
+        }
+        for (uint32_t x = 0; x < n; x++)
+        {
+            __builtin_prefetch(frozen->keys +
+                               frozen->entries[slots[x]].key_offset);
+        }
+        uint32_t hits = 0;
+        for (uint32_t x = 0; x < n; x++)
+        {
+            int found = frozen_matches(frozen, slots[x], keys[x], lens[x]);
+            out[x] = found ? frozen->entries[slots[x]].data : NULL;
+            hits += found;
+        }
+        hash_table_count_lookups(table, n, hits, n);
+    }
+}
+
+/**
+ * @brief visits the slot the cursor points at; the table never changes, so
+ *        the cursor is simply the slot index
+ *
+ * @param table pointer to table address
+ * @param cursor current cursor
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ * @param emitted incremented for every visited entry
+ *
+ * @return next cursor, 0 once every slot was visited
+ */
+static uint64_t frozen_scan(hash_table_t *table, uint64_t cursor,
+                            HASH_SCAN_F callback, void *context,
+                            uint32_t *emitted)
+{
+    frozen_table_t *frozen = (frozen_table_t *)table->engine_data;
+    uint64_t next = 0;
+
+    if (cursor < frozen->count)
+    {
+        const frozen_entry_t *entry = &frozen->entries[cursor];
+        callback(frozen->keys + entry->key_offset, entry->key_len, entry->data,
+                 context);
+        (*emitted)++;
+        if (cursor + 1 < frozen->count)
+        {
+            next = cursor + 1;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * @brief frees the frozen storage
+ *
+ * @param table pointer to table address
+ */
+static void frozen_destroy(hash_table_t *table)
+{
+    frozen_free((frozen_table_t *)table->engine_data);
+    table->engine_data = NULL;
+}
+
+/**
+ * @brief every key sits in the one slot its pilot picks, so every probe
+ *        length is 0
+ *
+ * @param table pointer to table address
+ * @param out stats being filled in
+ */
+static void frozen_stats(hash_table_t *table, hash_table_stats_t *out)
+{
+    frozen_table_t *frozen = (frozen_table_t *)table->engine_data;
+
+    for (uint32_t x = 0; x < frozen->count; x++)
+    {
+        out->bytes_used += frozen->entries[x].key_len + 1U;
+    }
+    hash_table_stats_record(out, 0, frozen->count);
+    out->buckets = frozen->count;
+    out->bytes_used += sizeof(frozen_table_t) +
+                       frozen->buckets * sizeof(uint16_t) +
+                       (frozen->slots - frozen->count) * sizeof(uint32_t) +
+                       frozen->count * sizeof(frozen_entry_t);
+}
+
+const hash_engine_ops_t frozen_engine_ops = {
+    .init = hash_table_readonly_init,
+    .add = hash_table_readonly_add,
+    .lookup = frozen_lookup,
+    .remove = hash_table_readonly_remove,
+    .clear = hash_table_readonly_clear,
+    .destroy = frozen_destroy,
+    .lookup_batch = frozen_lookup_batch,
+    .upsert = hash_table_readonly_upsert,
+    .scan = frozen_scan,
+    .stats = frozen_stats,
+};
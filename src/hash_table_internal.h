@@ -0,0 +1,504 @@
+#ifndef _HASH_TABLE_INTERNAL_H
+#define _HASH_TABLE_INTERNAL_H
+
+#include <hash_table.h>
+
+/**
+ * @brief number of keys an engine's lookup_batch resolves together
+ */
+#define HASH_TABLE_BATCH 16
+
+/**
+ * @brief operations implemented by a hash_table_t storage engine
+ *
+ * The public hash_table_* functions validate their arguments, measure and
+ * hash the key once, and then dispatch through the table's ops, so every
+ * engine can assume a non-NULL table and key along with its length and
+ * hash.
+ *
+ * @param init      allocates engine storage for size entries
+ * @param add       stores data at key
+ * @param lookup    returns the data stored at key, NULL when missing
+ * @param remove    removes the first entry stored at key
+ * @param clear     removes every entry but keeps the storage allocated
+ * @param destroy   releases all engine storage
+ * @param lookup_batch  optional, looks up n <= HASH_TABLE_BATCH keys at once,
+ *                      prefetching ahead so the cache misses of the keys
+ *                      overlap; NULL falls back to lookup
+ * @param upsert    returns the data slot of key, adding key with data in
+ *                  the same probe when it is not present
+ * @param scan      visits the entries of the buckets one cursor step
+ *                  covers, see hash_table_scan, adding the number visited
+ *                  to emitted, and returns the next cursor
+ * @param stats     fills in the buckets, histogram, longest and
+ *                  bytes_used fields of hash_table_stats_t for the
+ *                  engine's storage
+ */
+typedef struct hash_engine_ops_t
+{
+    int (*init)(hash_table_t *table, uint32_t size);
+    int (*add)(hash_table_t *table, void *data, const char *key, uint32_t len,
+               uint64_t hash);
+    void *(*lookup)(hash_table_t *table, const char *key, uint32_t len,
+                    uint64_t hash);
+    int (*remove)(hash_table_t *table, const char *key, uint32_t len,
+                  uint64_t hash);
+    void (*clear)(hash_table_t *table);
+    void (*destroy)(hash_table_t *table);
+    void (*lookup_batch)(hash_table_t *table, const char *const *keys,
+                         const uint32_t *lens, const uint64_t *hashes,
+                         uint32_t n, void **out);
+    void **(*upsert)(hash_table_t *table, const char *key, uint32_t len,
+                     uint64_t hash, void *data, int *inserted);
+    uint64_t (*scan)(hash_table_t *table, uint64_t cursor,
+                     HASH_SCAN_F callback, void *context, uint32_t *emitted);
+    void (*stats)(hash_table_t *table, hash_table_stats_t *out);
+} hash_engine_ops_t;
+
+/**
+ * @brief number of counter slots of a table that may be read by several
+ *        threads at once, a power of two; the owned slots are tracked in
+ *        one 64 bit mask, so at most 64
+ */
+#define HASH_TABLE_COUNTER_SLOTS 64
+
+/**
+ * @brief lookup counters, padded to a cache line of their own
+ *
+ * A table read by several threads at once keeps HASH_TABLE_COUNTER_SLOTS
+ * slots. Slots 1 and up are each owned by one live thread at a time, see
+ * hash_table_thread_slot_assign; slot 0 is shared by the threads started
+ * while every other slot is owned.
+ *
+ * @param lookups   keys looked up
+ * @param hits      lookups that found their key
+ * @param probes    chain nodes, slots or slot groups the lookups examined
+ * @param filtered  lookups the bloom filter answered
+ */
+typedef struct hash_table_counters_t
+{
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t probes;
+    uint64_t filtered;
+} __attribute__((aligned(64))) hash_table_counters_t;
+
+/**
+ * @brief counter slot of the calling thread, 0 until the thread first
+ *        counts a lookup on a shared table, HASH_TABLE_COUNTER_SLOTS when
+ *        it shares slot 0
+ */
+extern _Thread_local uint32_t hash_table_thread_slot;
+
+/**
+ * @brief hands the calling thread a counter slot no other live thread
+ *        owns, given back when the thread exits
+ *
+ * @return the thread's slot, HASH_TABLE_COUNTER_SLOTS when every slot is
+ *         owned
+ */
+uint32_t hash_table_thread_slot_assign(void);
+
+/**
+ * @brief allocates the lookup counters of a table
+ *
+ * @param table pointer to table address
+ * @param shared non-zero when several threads may look keys up at once,
+ *               which gives the table one counter slot per thread
+ *
+ * @return int exit code
+ */
+int hash_table_counters_init(hash_table_t *table, int shared);
+
+/**
+ * @brief adds to a counter only the calling thread writes
+ *
+ * A relaxed load and store compile to plain moves; they only keep
+ * hash_table_stats, reading from another thread, free of torn values.
+ *
+ * @param counter counter to add to
+ * @param n amount to add
+ */
+static inline void hash_table_counter_add(uint64_t *counter, uint64_t n)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n,
+                     __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief records lookups in the calling thread's counter slot; engines
+ *        call it from their lookup and lookup_batch operations
+ *
+ * On a shared table a thread owning its slot adds without a locked
+ * instruction and writes no cache line another thread writes. Only
+ * threads sharing slot 0, once every other slot is owned, add with
+ * atomic read-modify-writes.
+ *
+ * @param table pointer to table address
+ * @param lookups number of keys looked up
+ * @param hits number of them that were found
+ * @param probes chain nodes, slots or slot groups examined
+ */
+static inline void hash_table_count_lookups(hash_table_t *table,
+                                            uint32_t lookups, uint32_t hits,
+                                            uint32_t probes)
+{
+    hash_table_counters_t *counters = table->counters;
+
+    if (0 == table->counter_mask)
+    {
+        counters->lookups += lookups;
+        counters->hits += hits;
+        counters->probes += probes;
+    }
+    else
+    {
+        uint32_t slot = hash_table_thread_slot;
+        if (0 == slot)
+        {
+            slot = hash_table_thread_slot_assign();
+        }
+        counters += slot & table->counter_mask;
+        if (HASH_TABLE_COUNTER_SLOTS == slot)
+        {
+            __atomic_fetch_add(&counters->lookups, lookups,
+                               __ATOMIC_RELAXED);
+            __atomic_fetch_add(&counters->hits, hits, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&counters->probes, probes, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            hash_table_counter_add(&counters->lookups, lookups);
+            hash_table_counter_add(&counters->hits, hits);
+            hash_table_counter_add(&counters->probes, probes);
+        }
+    }
+}
+
+/**
+ * @brief adds one chain or probe length to a stats histogram, the last
+ *        bin collecting every length past it
+ *
+ * @param out stats being filled in
+ * @param length chain length or probe distance
+ * @param times number of chains or entries of that length
+ */
+static inline void hash_table_stats_record(hash_table_stats_t *out,
+                                           uint32_t length, uint32_t times)
+{
+    uint32_t bin = length < HASH_TABLE_STATS_BINS - 1 ?
+                       length :
+                       HASH_TABLE_STATS_BINS - 1;
+
+    out->histogram[bin] += times;
+    if (0 != times && length > out->longest)
+    {
+        out->longest = length;
+    }
+}
+
+/**
+ * @brief bytes held by a node_t of a chained table, with its key
+ *
+ * @param node node_t to measure
+ *
+ * @return bytes allocated for node
+ */
+static inline size_t hash_table_node_bytes(const node_t *node)
+{
+    return sizeof(node_t) +
+           (node->key != node->key_inline ? node->key_len + 1U : 0);
+}
+
+/**
+ * @brief hashes a key with the table's hash function and seed
+ *
+ * @param table pointer to table address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return 64 bit hash
+ */
+static inline uint64_t hash_table_hash(const hash_table_t *table,
+                                       const char *key, size_t len)
+{
+    return table->hash(key, len, table->seed);
+}
+
+/**
+ * @brief reverses the order of the bits of a 64 bit value
+ *
+ * @param value value to reverse
+ *
+ * @return value with bit 0 swapped with bit 63, bit 1 with bit 62 and so on
+ */
+static inline uint64_t hash_table_reverse_bits(uint64_t value)
+{
+    value = ((value >> 1) & 0x5555555555555555ULL) |
+            ((value & 0x5555555555555555ULL) << 1);
+    value = ((value >> 2) & 0x3333333333333333ULL) |
+            ((value & 0x3333333333333333ULL) << 2);
+    value = ((value >> 4) & 0x0f0f0f0f0f0f0f0fULL) |
+            ((value & 0x0f0f0f0f0f0f0f0fULL) << 4);
+
+    return __builtin_bswap64(value);
+}
+
+/**
+ * @brief advances a scan cursor to the next bucket in reverse binary order
+ *
+ * Incrementing the bit reversed index means the low bits of the cursor,
+ * which pick the bucket in any power of two sized array, are walked from
+ * the most significant end. A bucket visited in a small array then covers
+ * every bucket it splits into in a larger one, and the other way around.
+ *
+ * @param cursor current cursor
+ * @param mask bucket count minus one
+ *
+ * @return next cursor, 0 after the last bucket
+ */
+static inline uint64_t hash_table_cursor_next(uint64_t cursor, uint64_t mask)
+{
+    cursor = hash_table_reverse_bits(cursor | ~mask) + 1;
+
+    return hash_table_reverse_bits(cursor);
+}
+
+/**
+ * @brief copies key bytes into table owned memory, from the key arena when
+ *        the table has one
+ *
+ * @param table pointer to table address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return NUL terminated copy of key, NULL on allocation failure
+ */
+char *hash_table_key_copy(hash_table_t *table, const char *key, uint32_t len);
+
+/**
+ * @brief frees a key copied by hash_table_key_copy; arena keys stay until
+ *        the table is cleared
+ *
+ * @param table pointer to table address
+ * @param key key copy to free
+ */
+void hash_table_key_free(hash_table_t *table, char *key);
+
+/**
+ * @brief checks whether a node_t holds key, rejecting on the cached hash
+ *        and length before touching the key bytes
+ *
+ * @param node node_t to check
+ * @param key key being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return non-zero when node holds key
+ */
+static inline int hash_table_node_matches(const node_t *node, const char *key,
+                                          uint32_t len, uint64_t hash)
+{
+    return node->hash == hash && node->key_len == len &&
+           memcmp(node->key, key, len) == 0;
+}
+
+/**
+ * @brief allocates a node_t, copying keys shorter than
+ *        HASH_TABLE_INLINE_KEY into the node itself
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return node_t pointer, NULL on allocation failure
+ */
+node_t *hash_table_node_create(hash_table_t *table, void *data,
+                               const char *key, uint32_t len, uint64_t hash);
+
+/**
+ * @brief frees a node_t created by hash_table_node_create
+ *
+ * @param table pointer to table address
+ * @param node node_t to free
+ */
+void hash_table_node_free(hash_table_t *table, node_t *node);
+
+/**
+ * @brief moves every entry of a chained table into a bucket array of
+ *        new_size in one pass
+ *
+ * @param table pointer to table address
+ * @param new_size number indexes in the new bucket array, a power of two
+ */
+void hash_table_chained_resize(hash_table_t *table, uint32_t new_size);
+
+/**
+ * @brief an entry copied out of a table by hash_table_collect
+ *
+ * @param key   key bytes, owned by the table
+ * @param data  data stored at key
+ * @param hash  hash of key under the table's hash function
+ * @param len   number of bytes in key
+ */
+typedef struct hash_table_entry_t
+{
+    const char *key;
+    void *data;
+    uint64_t hash;
+    uint32_t len;
+} hash_table_entry_t;
+
+/**
+ * @brief lists every entry of a table in scan order, for building other
+ *        representations of it; the table must not change while the
+ *        entries are in use
+ *
+ * @param table pointer to table address
+ * @param entries receives a malloc'd array of the entries
+ * @param count receives the number of entries
+ *
+ * @return int exit code
+ */
+int hash_table_collect(hash_table_t *table, hash_table_entry_t **entries,
+                       uint32_t *count);
+
+/**
+ * @brief engine operations of read-only tables, which are never created
+ *        by hash_table_init_ex and refuse every change
+ */
+int hash_table_readonly_init(hash_table_t *table, uint32_t size);
+int hash_table_readonly_add(hash_table_t *table, void *data, const char *key,
+                            uint32_t len, uint64_t hash);
+int hash_table_readonly_remove(hash_table_t *table, const char *key,
+                               uint32_t len, uint64_t hash);
+void hash_table_readonly_clear(hash_table_t *table);
+void **hash_table_readonly_upsert(hash_table_t *table, const char *key,
+                                  uint32_t len, uint64_t hash, void *data,
+                                  int *inserted);
+
+/**
+ * @brief levels of the timer wheel of a table with entry TTLs, and the
+ *        slots of each level
+ */
+#define HASH_TTL_LEVELS 4
+#define HASH_TTL_SLOT_BITS 8
+#define HASH_TTL_SLOTS (1U << HASH_TTL_SLOT_BITS)
+
+/**
+ * @brief a pending expiry in a timer wheel
+ *
+ * A timer is never cancelled. When it fires it checks the entry's own
+ * expires: 0 means the entry was removed or lost its TTL and the timer is
+ * dropped, a later tick means the TTL was restarted and the timer is
+ * placed again. Removed nodes stay readable since TTL tables allocate
+ * from their slab.
+ *
+ * @param node      entry the timer was set for
+ * @param next      next timer in the same slot
+ * @param expires   tick the timer fires at
+ */
+typedef struct hash_timer_t
+{
+    node_t *node;
+    struct hash_timer_t *next;
+    uint32_t expires;
+} hash_timer_t;
+
+/**
+ * @brief hierarchical timer wheel of a table with entry TTLs
+ *
+ * Level l has HASH_TTL_SLOTS slots of 2^(8 l) ticks each. A timer goes to
+ * the lowest level whose span covers the distance from now to its tick,
+ * and drops one or more levels each time now reaches the start of its
+ * slot, so every timer is moved at most HASH_TTL_LEVELS - 1 times before
+ * it fires. Ticks wrap around; deadlines are compared by their signed
+ * distance.
+ *
+ * @param tick_ms   milliseconds per tick
+ * @param epoch_ms  monotonic clock reading of tick 0
+ * @param now       tick the wheel has reached; the level 0 slot of now
+ *                  is the next to fire
+ * @param slots     timer lists of every level
+ * @param occupied  bitmap of the non-empty slots of every level
+ * @param cascade   timers taken from the level l slot now has reached,
+ *                  still to be placed again; indexed by level
+ * @param timers    number of timers held
+ * @param slab      slab the timers come from
+ */
+typedef struct hash_ttl_t
+{
+    uint32_t tick_ms;
+    uint64_t epoch_ms;
+    uint32_t now;
+    hash_timer_t *slots[HASH_TTL_LEVELS][HASH_TTL_SLOTS];
+    uint64_t occupied[HASH_TTL_LEVELS][HASH_TTL_SLOTS / 64];
+    hash_timer_t *cascade[HASH_TTL_LEVELS];
+    uint32_t timers;
+    struct slab_t *slab;
+} hash_ttl_t;
+
+/**
+ * @brief entry TTLs of tables created with ttl_tick_ms, see
+ *        hash_table_ttl.c
+ */
+hash_ttl_t *hash_table_ttl_init(uint32_t tick_ms);
+void hash_table_ttl_destroy(hash_ttl_t **ttl_addr);
+void hash_table_ttl_clear(hash_ttl_t *ttl);
+uint32_t hash_table_ttl_tick(const hash_ttl_t *ttl);
+uint32_t hash_table_ttl_deadline(const hash_ttl_t *ttl, uint32_t ttl_ms);
+int hash_table_ttl_schedule(hash_ttl_t *ttl, node_t *node, uint32_t expires);
+node_t *hash_table_ttl_pop(hash_ttl_t *ttl, uint32_t *budget);
+
+/**
+ * @brief checks whether an entry of a chained table has expired, reading
+ *        the clock only for entries with a TTL
+ *
+ * @param table pointer to table address
+ * @param node node_t to check
+ *
+ * @return non-zero when node expired
+ */
+static inline int hash_table_node_expired(const hash_table_t *table,
+                                          const node_t *node)
+{
+    return 0 != node->expires &&
+           (int32_t)(hash_table_ttl_tick(table->ttl) - node->expires) >= 0;
+}
+
+/**
+ * @brief lock striping used by HASH_SYNC_STRIPED tables, see
+ *        hash_table_sync.c
+ */
+int hash_table_sync_init(hash_table_t *table, uint32_t stripes);
+void hash_table_sync_destroy(hash_table_t *table);
+uint32_t hash_table_sync_lock(hash_table_t *table, uint64_t hash);
+void hash_table_sync_unlock(hash_table_t *table, uint32_t stripe, int delta);
+void hash_table_sync_lock_all(hash_table_t *table);
+void hash_table_sync_unlock_all(hash_table_t *table);
+void hash_table_sync_clear_counts(hash_table_t *table);
+
+/**
+ * @brief epoch based reclamation used by HASH_SYNC_RCU tables, see
+ *        hash_table_rcu.c
+ */
+int hash_table_rcu_init(hash_table_t *table);
+void hash_table_rcu_destroy(hash_table_t *table);
+uint32_t hash_table_rcu_read_lock(hash_table_t *table);
+void hash_table_rcu_read_unlock(hash_table_t *table, uint32_t token);
+uint32_t hash_table_rcu_write_lock(hash_table_t *table);
+void hash_table_rcu_write_unlock(hash_table_t *table);
+void hash_table_rcu_retire(hash_table_t *table, void *memory,
+                           void (*release)(hash_table_t *table, void *memory));
+
+extern const hash_engine_ops_t chained_engine_ops;
+extern const hash_engine_ops_t swiss_engine_ops;
+extern const hash_engine_ops_t robin_engine_ops;
+extern const hash_engine_ops_t cuckoo_engine_ops;
+extern const hash_engine_ops_t rcu_engine_ops;
+extern const hash_engine_ops_t mapped_engine_ops;
+extern const hash_engine_ops_t frozen_engine_ops;
+
+#endif
@@ -0,0 +1,677 @@
+#include <hash_table.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hash_table_internal.h"
+
+#define MAPPED_MAGIC 0x0150414e53544854ULL
+#define MAPPED_VERSION 1
+#define MAPPED_ALIGN 8
+
+/**
+ * @brief header at offset 0 of a snapshot file
+ *
+ * Every offset is counted from the start of the file, so the file can be
+ * mapped at any address. Integers are stored in host byte order; a file
+ * written on a host of the other byte order fails the magic check.
+ *
+ * @param magic         MAPPED_MAGIC
+ * @param version       MAPPED_VERSION
+ * @param hash_func     hash family the entries were placed with
+ * @param seed          hash seed the entries were placed with
+ * @param buckets       number of buckets, a power of two
+ * @param count         number of entries
+ * @param value_size    bytes of data saved per entry
+ * @param value_stride  distance between two saved values, value_size
+ *                      rounded up to MAPPED_ALIGN
+ * @param bucket_offset start of the uint32_t array of buckets + 1 entry
+ *                      indexes; bucket b holds entries
+ *                      [starts[b], starts[b + 1])
+ * @param entry_offset  start of the mapped_entry_t array, sorted by bucket
+ * @param value_offset  start of the saved values, in entry order
+ * @param key_offset    start of the NUL terminated key bytes
+ * @param file_size     total size of the file
+ */
+typedef struct mapped_header_t
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t hash_func;
+    uint64_t seed[2];
+    uint32_t buckets;
+    uint32_t count;
+    uint32_t value_size;
+    uint32_t value_stride;
+    uint64_t bucket_offset;
+    uint64_t entry_offset;
+    uint64_t value_offset;
+    uint64_t key_offset;
+    uint64_t file_size;
+} mapped_header_t;
+
+/**
+ * @brief one entry of a snapshot file
+ *
+ * @param hash          full hash of the key
+ * @param key_offset    offset of the key bytes from the start of the keys
+ * @param key_len       number of bytes in key, excluding the terminator
+ * @param reserved      zero
+ */
+typedef struct mapped_entry_t
+{
+    uint64_t hash;
+    uint64_t key_offset;
+    uint32_t key_len;
+    uint32_t reserved;
+} mapped_entry_t;
+
+/**
+ * @brief storage of a table opened with hash_table_open_mapped
+ *
+ * @param base      start of the mapping
+ * @param length    number of bytes mapped
+ * @param header    snapshot header
+ * @param starts    first entry of every bucket
+ * @param entries   the entries
+ * @param values    the saved values
+ * @param keys      the key bytes
+ * @param key_bytes number of bytes of key storage
+ */
+typedef struct mapped_table_t
+{
+    void *base;
+    size_t length;
+    const mapped_header_t *header;
+    const uint32_t *starts;
+    const mapped_entry_t *entries;
+    const char *values;
+    const char *keys;
+    uint64_t key_bytes;
+} mapped_table_t;
+
+/**
+ * @brief rounds offset up to MAPPED_ALIGN
+ */
+static inline uint64_t mapped_align(uint64_t offset)
+{
+    return (offset + MAPPED_ALIGN - 1) & ~(uint64_t)(MAPPED_ALIGN - 1);
+}
+
+/**
+ * @brief writes size bytes of zeroes
+ *
+ * @return int exit code
+ */
+static int write_zeroes(FILE *file, uint64_t size)
+{
+    static const char zeroes[MAPPED_ALIGN] = {0};
+    int status = SUCCESS;
+
+    while (SUCCESS == status && size > 0)
+    {
+        size_t chunk = size < MAPPED_ALIGN ? (size_t)size : MAPPED_ALIGN;
+        status = 1 == fwrite(zeroes, chunk, 1, file) ? SUCCESS : FAILURE;
+        size -= chunk;
+    }
+
+    return status;
+}
+
+/**
+ * @brief writes the collected entries in snapshot format, grouped by
+ *        bucket
+ *
+ * @param file file to write to
+ * @param header header with the hash settings and value size filled in
+ * @param entries collected entries
+ * @param order entry indexes sorted by bucket
+ * @param starts first position in order of every bucket, plus the total
+ *
+ * @return int exit code
+ */
+static int save_write(FILE *file, mapped_header_t *header,
+                      const hash_table_entry_t *entries, const uint32_t *order,
+                      const uint32_t *starts)
+{
+    int status = SUCCESS;
+    uint64_t key_bytes = 0;
+
+    for (uint32_t x = 0; x < header->count; x++)
+    {
+        key_bytes += entries[x].len + 1;
+    }
+    header->bucket_offset = mapped_align(sizeof(mapped_header_t));
+    header->entry_offset = mapped_align(
+        header->bucket_offset + (header->buckets + 1ULL) * sizeof(uint32_t));
+    header->value_offset =
+        header->entry_offset + header->count * sizeof(mapped_entry_t);
+    header->key_offset =
+        header->value_offset + (uint64_t)header->count * header->value_stride;
+    header->file_size = header->key_offset + key_bytes;
+
+    if (1 != fwrite(header, sizeof(mapped_header_t), 1, file) ||
+        SUCCESS != write_zeroes(file, header->bucket_offset -
+                                          sizeof(mapped_header_t)) ||
+        1 != fwrite(starts, (header->buckets + 1ULL) * sizeof(uint32_t), 1,
+                    file) ||
+        SUCCESS != write_zeroes(file, header->entry_offset -
+                                          header->bucket_offset -
+                                          (header->buckets + 1ULL) *
+                                              sizeof(uint32_t)))
+    {
+        status = FAILURE;
+    }
+
+    key_bytes = 0;
+    for (uint32_t x = 0; SUCCESS == status && x < header->count; x++)
+    {
+        const hash_table_entry_t *entry = &entries[order[x]];
+        mapped_entry_t saved = {entry->hash, key_bytes, entry->len, 0};
+        status = 1 == fwrite(&saved, sizeof(saved), 1, file) ? SUCCESS :
+                                                                FAILURE;
+        key_bytes += entry->len + 1;
+    }
+    for (uint32_t x = 0; SUCCESS == status && x < header->count; x++)
+    {
+        const hash_table_entry_t *entry = &entries[order[x]];
+        if (NULL != entry->data && 0 != header->value_size)
+        {
+            status = 1 == fwrite(entry->data, header->value_size, 1, file) ?
+                         SUCCESS :
+                         FAILURE;
+        }
+        else
+        {
+            status = write_zeroes(file, header->value_size);
+        }
+        if (SUCCESS == status)
+        {
+            status = write_zeroes(file,
+                                  header->value_stride - header->value_size);
+        }
+    }
+    for (uint32_t x = 0; SUCCESS == status && x < header->count; x++)
+    {
+        const hash_table_entry_t *entry = &entries[order[x]];
+        if ((0 != entry->len && 1 != fwrite(entry->key, entry->len, 1, file)) ||
+            EOF == fputc('\0', file))
+        {
+            status = FAILURE;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief saves every entry of a table to a snapshot file
+ *
+ * @param table pointer to table address
+ * @param path file to write
+ * @param value_size bytes copied from every entry's data
+ *
+ * @return int exit code
+ */
+int hash_table_save(hash_table_t *table, const char *path, uint32_t value_size)
+{
+    int status = SUCCESS;
+    hash_table_entry_t *entries = NULL;
+    uint32_t count = 0;
+    mapped_header_t header = {.magic = MAPPED_MAGIC,
+                              .version = MAPPED_VERSION,
+                              .value_size = value_size};
+    uint32_t *starts = NULL;
+    uint32_t *order = NULL;
+    char *temporary = NULL;
+    FILE *file = NULL;
+
+    if (NULL == table || NULL == path || value_size > UINT32_MAX - MAPPED_ALIGN)
+    {
+        status = FAILURE;
+    }
+
+    if (SUCCESS == status)
+    {
+        status = hash_table_collect(table, &entries, &count);
+    }
+
+    if (SUCCESS == status)
+    {
+        header.hash_func = table->hash_func;
+        header.seed[0] = table->seed[0];
+        header.seed[1] = table->seed[1];
+        header.count = count;
+        header.value_stride = (uint32_t)mapped_align(value_size);
+        header.buckets = 1;
+        while (header.buckets < count && header.buckets <= UINT32_MAX / 2)
+        {
+            header.buckets *= 2;
+        }
+
+        starts = (uint32_t *)calloc(header.buckets + 1ULL, sizeof(uint32_t));
+        order = (uint32_t *)malloc((count + 1ULL) * sizeof(uint32_t));
+        temporary = (char *)malloc(strlen(path) + sizeof(".tmp"));
+        if (NULL == starts || NULL == order || NULL == temporary)
+        {
+            status = FAILURE;
+        }
+    }
+
+    if (SUCCESS == status)
+    {
+        uint32_t mask = header.buckets - 1;
+
+        // counting sort by bucket, so every bucket's entries are adjacent
+        for (uint32_t x = 0; x < count; x++)
+        {
+            starts[((uint32_t)entries[x].hash & mask) + 1]++;
+        }
+        for (uint32_t x = 0; x < header.buckets; x++)
+        {
+            starts[x + 1] += starts[x];
+        }
+        for (uint32_t x = 0; x < count; x++)
+        {
+            order[starts[(uint32_t)entries[x].hash & mask]++] = x;
+        }
+        for (uint32_t x = header.buckets; x > 0; x--)
+        {
+            starts[x] = starts[x - 1];
+        }
+        starts[0] = 0;
+
+        // written next to the target and renamed over it, so a crash never
+        // leaves a partial snapshot at path
+        sprintf(temporary, "%s.tmp", path);
+        file = fopen(temporary, "wb");
+        if (NULL == file)
+        {
+            status = FAILURE;
+        }
+    }
+
+    if (NULL != file)
+    {
+        status = save_write(file, &header, entries, order, starts);
+        if (SUCCESS == status &&
+            (0 != fflush(file) || 0 != fsync(fileno(file))))
+        {
+            status = FAILURE;
+        }
+        if (0 != fclose(file) ||
+            (SUCCESS == status && 0 != rename(temporary, path)))
+        {
+            status = FAILURE;
+        }
+        if (SUCCESS != status)
+        {
+            remove(temporary);
+        }
+    }
+
+    free(temporary);
+    free(order);
+    free(starts);
+    free(entries);
+
+    return status;
+}
+
+/**
+ * @brief checks that count items of size bytes starting at offset end at
+ *        limit, without letting the sum wrap
+ *
+ * @param offset start of the section
+ * @param count number of items in the section
+ * @param size bytes per item
+ * @param limit offset the section must end at or before
+ * @param end receives the offset one past the section
+ *
+ * @return non-zero when the section fits
+ */
+static int mapped_section(uint64_t offset, uint64_t count, uint64_t size,
+                          uint64_t limit, uint64_t *end)
+{
+    uint64_t bytes = 0;
+
+    return !__builtin_mul_overflow(count, size, &bytes) &&
+           !__builtin_add_overflow(offset, bytes, end) && *end <= limit;
+}
+
+/**
+ * @brief checks that a mapped file is a snapshot and that every section
+ *        it describes lies inside the mapping
+ *
+ * Every offset in the header is untrusted, so each section is bounded
+ * with overflow checked arithmetic; an offset near UINT64_MAX cannot wrap
+ * around to pass a later comparison.
+ *
+ * @param header header at the start of the mapping
+ * @param length number of bytes mapped
+ *
+ * @return non-zero when the file can be served
+ */
+static int mapped_valid(const mapped_header_t *header, size_t length)
+{
+    uint64_t end = 0;
+    int valid = length >= sizeof(mapped_header_t) &&
+                MAPPED_MAGIC == header->magic &&
+                MAPPED_VERSION == header->version;
+
+    if (valid)
+    {
+        valid = NULL != hash_func_get((hash_func_t)header->hash_func) &&
+                0 != header->buckets &&
+                0 == (header->buckets & (header->buckets - 1)) &&
+                header->file_size == length &&
+                header->value_stride >= header->value_size &&
+                0 == header->value_stride % MAPPED_ALIGN &&
+                0 == header->bucket_offset % MAPPED_ALIGN &&
+                0 == header->entry_offset % MAPPED_ALIGN &&
+                header->bucket_offset >= sizeof(mapped_header_t) &&
+                mapped_section(header->bucket_offset, header->buckets + 1ULL,
+                               sizeof(uint32_t), header->entry_offset,
+                               &end) &&
+                mapped_section(header->entry_offset, header->count,
+                               sizeof(mapped_entry_t), length, &end) &&
+                end == header->value_offset &&
+                mapped_section(header->value_offset, header->count,
+                               header->value_stride, length, &end) &&
+                end == header->key_offset;
+    }
+
+    return valid;
+}
+
+/**
+ * @brief opens a snapshot written by hash_table_save without copying it
+ *
+ * @param path snapshot file
+ *
+ * @return hash_table_t pointer to a read-only table, NULL on failure
+ */
+hash_table_t *hash_table_open_mapped(const char *path)
+{
+    hash_table_t *table = NULL;
+    mapped_table_t *mapped = NULL;
+    struct stat info = {0};
+    void *base = MAP_FAILED;
+    int fd = -1;
+
+    if (NULL != path)
+    {
+        fd = open(path, O_RDONLY);
+    }
+    if (fd >= 0 && 0 == fstat(fd, &info) &&
+        (size_t)info.st_size >= sizeof(mapped_header_t))
+    {
+        base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    if (MAP_FAILED != base &&
+        mapped_valid((const mapped_header_t *)base, (size_t)info.st_size))
+    {
+        table = (hash_table_t *)calloc(1, sizeof(hash_table_t));
+        mapped = (mapped_table_t *)calloc(1, sizeof(mapped_table_t));
+    }
+
+    if (NULL == table || NULL == mapped)
+    {
+        free(table);
+        free(mapped);
+        table = NULL;
+        if (MAP_FAILED != base)
+        {
+            munmap(base, (size_t)info.st_size);
+        }
+    }
+    else
+    {
+        const mapped_header_t *header = (const mapped_header_t *)base;
+        const char *bytes = (const char *)base;
+
+        // lookups land on unrelated pages, read-ahead would only waste I/O
+        madvise(base, (size_t)info.st_size, MADV_RANDOM);
+
+        mapped->base = base;
+        mapped->length = (size_t)info.st_size;
+        mapped->header = header;
+        mapped->starts = (const uint32_t *)(bytes + header->bucket_offset);
+        mapped->entries =
+            (const mapped_entry_t *)(bytes + header->entry_offset);
+        mapped->values = bytes + header->value_offset;
+        mapped->keys = bytes + header->key_offset;
+        mapped->key_bytes = header->file_size - header->key_offset;
+
+        table->size = header->buckets;
+        table->customfree = free;
+        table->engine = HASH_ENGINE_MAPPED;
+        table->ops = &mapped_engine_ops;
+        table->engine_data = mapped;
+        table->hash_func = (hash_func_t)header->hash_func;
+        table->hash = hash_func_get(table->hash_func);
+        table->seed[0] = header->seed[0];
+        table->seed[1] = header->seed[1];
+        table->count = header->count;
+        table->min_size = header->buckets;
+        table->sync = HASH_SYNC_NONE;
+
+        // the mapping never changes, so any number of threads may read it
+        if (SUCCESS != hash_table_counters_init(table, 1))
+        {
+            hash_table_destroy(&table);
+        }
+    }
+
+    return table;
+}
+
+/**
+ * @brief returns the data handed out for an entry: its saved value, or its
+ *        key when no value bytes were saved
+ */
+static inline void *mapped_data(const mapped_table_t *mapped, uint32_t index)
+{
+    void *data = NULL;
+
+    if (0 != mapped->header->value_size)
+    {
+        data = (void *)(mapped->values +
+                        (uint64_t)index * mapped->header->value_stride);
+    }
+    else
+    {
+        data = (void *)(mapped->keys + mapped->entries[index].key_offset);
+    }
+
+    return data;
+}
+
+/**
+ * @brief checks whether an entry holds key, rejecting on the saved hash and
+ *        length before touching the key bytes
+ *
+ * Key offsets are checked against the key section, so a damaged file can
+ * make a key go missing but never reads outside the mapping.
+ */
+static inline int mapped_matches(const mapped_table_t *mapped,
+                                 const mapped_entry_t *entry, const char *key,
+                                 uint32_t len, uint64_t hash)
+{
+    return entry->hash == hash && entry->key_len == len &&
+           entry->key_offset < mapped->key_bytes &&
+           len < mapped->key_bytes - entry->key_offset &&
+           memcmp(mapped->keys + entry->key_offset, key, len) == 0;
+}
+
+/**
+ * @brief range of entries of the bucket a hash falls in
+ *
+ * @param mapped mapped storage
+ * @param hash hash of the key
+ * @param end receives one past the last entry of the bucket
+ *
+ * @return first entry of the bucket
+ */
+static inline uint32_t mapped_bucket(const mapped_table_t *mapped,
+                                     uint64_t hash, uint32_t *end)
+{
+    uint32_t bucket = (uint32_t)hash & (mapped->header->buckets - 1);
+    uint32_t count = mapped->header->count;
+
+    *end = mapped->starts[bucket + 1] < count ? mapped->starts[bucket + 1] :
+                                                count;
+
+    return mapped->starts[bucket];
+}
+
+/**
+ * @brief finds the data saved at key
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return pointer into the mapping, NULL when missing
+ */
+static void *mapped_lookup(hash_table_t *table, const char *key, uint32_t len,
+                           uint64_t hash)
+{
+    mapped_table_t *mapped = (mapped_table_t *)table->engine_data;
+    void *data = NULL;
+    uint32_t end = 0;
+    uint32_t probes = 0;
+
+    for (uint32_t x = mapped_bucket(mapped, hash, &end); x < end; x++)
+    {
+        probes++;
+        if (mapped_matches(mapped, &mapped->entries[x], key, len, hash))
+        {
+            data = mapped_data(mapped, x);
+            break;
+        }
+    }
+    hash_table_count_lookups(table, 1, NULL != data, probes);
+
+    return data;
+}
+
+/**
+ * @brief looks up several keys, prefetching every bucket and then every
+ *        bucket's entries before comparing keys
+ *
+ * @param table pointer to table address
+ * @param keys keys for data being searched for
+ * @param lens number of bytes in each key
+ * @param hashes hash of each key
+ * @param n number of keys, at most HASH_TABLE_BATCH
+ * @param out data stored at each key, NULL when missing
+ */
+static void mapped_lookup_batch(hash_table_t *table, const char *const *keys,
+                                const uint32_t *lens, const uint64_t *hashes,
+                                uint32_t n, void **out)
+{
+    mapped_table_t *mapped = (mapped_table_t *)table->engine_data;
+    uint32_t mask = mapped->header->buckets - 1;
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        __builtin_prefetch(&mapped->starts[(uint32_t)hashes[x] & mask]);
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        __builtin_prefetch(
+            &mapped->entries[mapped->starts[(uint32_t)hashes[x] & mask]]);
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        out[x] = mapped_lookup(table, keys[x], lens[x], hashes[x]);
+    }
+}
+
+/**
+ * @brief visits the bucket the cursor points at
+ *
+ * @param table pointer to table address
+ * @param cursor current cursor
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ * @param emitted incremented for every visited entry
+ *
+ * @return next cursor, 0 once every bucket was visited
+ */
+static uint64_t mapped_scan(hash_table_t *table, uint64_t cursor,
+                            HASH_SCAN_F callback, void *context,
+                            uint32_t *emitted)
+{
+    mapped_table_t *mapped = (mapped_table_t *)table->engine_data;
+    uint64_t mask = mapped->header->buckets - 1;
+    uint32_t end = 0;
+
+    for (uint32_t x = mapped_bucket(mapped, cursor & mask, &end); x < end; x++)
+    {
+        const mapped_entry_t *entry = &mapped->entries[x];
+        if (entry->key_offset < mapped->key_bytes &&
+            entry->key_len < mapped->key_bytes - entry->key_offset)
+        {
+            callback(mapped->keys + entry->key_offset, entry->key_len,
+                     mapped_data(mapped, x), context);
+            (*emitted)++;
+        }
+    }
+
+    return hash_table_cursor_next(cursor, mask);
+}
+
+/**
+ * @brief records the length of every bucket's run of entries
+ *
+ * @param table pointer to table address
+ * @param out stats being filled in
+ */
+static void mapped_stats(hash_table_t *table, hash_table_stats_t *out)
+{
+    mapped_table_t *mapped = (mapped_table_t *)table->engine_data;
+    uint32_t end = 0;
+
+    for (uint32_t x = 0; x < mapped->header->buckets; x++)
+    {
+        uint32_t start = mapped_bucket(mapped, x, &end);
+        hash_table_stats_record(out, end > start ? end - start : 0, 1);
+    }
+    out->buckets = mapped->header->buckets;
+    out->bytes_used += sizeof(mapped_table_t) + mapped->length;
+}
+
+/**
+ * @brief unmaps the snapshot
+ *
+ * @param table pointer to table address
+ */
+static void mapped_destroy(hash_table_t *table)
+{
+    mapped_table_t *mapped = (mapped_table_t *)table->engine_data;
+
+    munmap(mapped->base, mapped->length);
+    free(mapped);
+    table->engine_data = NULL;
+}
+
+const hash_engine_ops_t mapped_engine_ops = {
+    .init = hash_table_readonly_init,
+    .add = hash_table_readonly_add,
+    .lookup = mapped_lookup,
+    .remove = hash_table_readonly_remove,
+    .clear = hash_table_readonly_clear,
+    .destroy = mapped_destroy,
+    .lookup_batch = mapped_lookup_batch,
+    .upsert = hash_table_readonly_upsert,
+    .scan = mapped_scan,
+    .stats = mapped_stats,
+};
@@ -0,0 +1,950 @@
+#include <hash_table.h>
+#include <pthread.h>
+#include <sched.h>
+#include "hash_table_internal.h"
+
+#define CACHE_LINE 64
+
+/**
+ * @brief what a retired allocation is, and so how to free it
+ *
+ * @param RCU_RETIRED_NODE      one unlinked node_t
+ * @param RCU_RETIRED_CHAIN     a detached list of node_t
+ * @param RCU_RETIRED_BUCKETS   a replaced bucket array and every chain in it
+ * @param RCU_RETIRED_OTHER     anything else, freed by a release callback
+ */
+typedef enum rcu_retired_kind_t
+{
+    RCU_RETIRED_NODE,
+    RCU_RETIRED_CHAIN,
+    RCU_RETIRED_BUCKETS,
+    RCU_RETIRED_OTHER
+} rcu_retired_kind_t;
+
+/**
+ * @brief epoch slot of one reading thread, padded to its own cache line so
+ *        readers never write a line another thread uses
+ *
+ * Records are shared by every HASH_SYNC_RCU table and recycled when their
+ * thread exits; they are never freed.
+ *
+ * @param epoch     global epoch observed when the current read started, 0
+ *                  while the thread is not reading
+ * @param nesting   number of read sections the thread is inside
+ * @param in_use    non-zero while a live thread owns the record
+ * @param next      next record in the global list
+ */
+typedef struct rcu_reader_t
+{
+    _Alignas(CACHE_LINE) uint64_t epoch;
+    uint32_t nesting;
+    int in_use;
+    struct rcu_reader_t *next;
+} rcu_reader_t;
+
+/**
+ * @brief an allocation waiting for every reader that may still see it
+ *
+ * @param next      next retired allocation
+ * @param memory    the allocation
+ * @param kind      how to free memory
+ * @param release   frees memory of kind RCU_RETIRED_OTHER
+ * @param epoch     global epoch published after memory was unlinked; it is
+ *                  freed once no reader is in an older epoch
+ */
+typedef struct rcu_retired_t
+{
+    struct rcu_retired_t *next;
+    void *memory;
+    rcu_retired_kind_t kind;
+    void (*release)(hash_table_t *table, void *memory);
+    uint64_t epoch;
+} rcu_retired_t;
+
+/**
+ * @brief writer side state of a HASH_SYNC_RCU table
+ *
+ * @param writer    serializes add, remove and clear
+ * @param pending   allocations retired by the write in progress
+ * @param retired   allocations waiting for their grace period
+ */
+typedef struct rcu_state_t
+{
+    pthread_mutex_t writer;
+    rcu_retired_t *pending;
+    rcu_retired_t *retired;
+} rcu_state_t;
+
+/**
+ * @brief bucket array published to readers with a single pointer swap
+ *
+ * @param size      number of buckets, a power of two
+ * @param heads     first node_t of every chain
+ */
+typedef struct rcu_buckets_t
+{
+    uint32_t size;
+    node_t *heads[];
+} rcu_buckets_t;
+
+static rcu_reader_t *rcu_readers = NULL;
+static uint64_t rcu_epoch = 1;
+static pthread_key_t rcu_reader_key;
+static pthread_once_t rcu_reader_once = PTHREAD_ONCE_INIT;
+static int rcu_reader_key_valid = 0;
+static _Thread_local rcu_reader_t *rcu_local_reader = NULL;
+
+/**
+ * @brief hands a thread's reader record back when the thread exits
+ *
+ * @param reader the thread's rcu_reader_t
+ */
+static void rcu_reader_release(void *reader)
+{
+    __atomic_store_n(&((rcu_reader_t *)reader)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void rcu_reader_key_create(void)
+{
+    rcu_reader_key_valid =
+        0 == pthread_key_create(&rcu_reader_key, rcu_reader_release);
+}
+
+/**
+ * @brief returns the calling thread's reader record, claiming a recycled
+ *        one or allocating a new one on the thread's first read
+ *
+ * @return rcu_reader_t pointer, NULL on allocation failure
+ */
+static rcu_reader_t *rcu_reader_get(void)
+{
+    rcu_reader_t *reader = rcu_local_reader;
+
+    if (NULL == reader)
+    {
+        pthread_once(&rcu_reader_once, rcu_reader_key_create);
+
+        reader = __atomic_load_n(&rcu_readers, __ATOMIC_ACQUIRE);
+        while (NULL != reader)
+        {
+            int unused = 0;
+            if (__atomic_compare_exchange_n(&reader->in_use, &unused, 1, 0,
+                                            __ATOMIC_ACQ_REL,
+                                            __ATOMIC_RELAXED))
+            {
+                break;
+            }
+            reader = reader->next;
+        }
+
+        if (NULL == reader)
+        {
+            reader = (rcu_reader_t *)aligned_alloc(CACHE_LINE,
+                                                   sizeof(rcu_reader_t));
+            if (NULL != reader)
+            {
+                reader->epoch = 0;
+                reader->nesting = 0;
+                reader->in_use = 1;
+                reader->next = __atomic_load_n(&rcu_readers, __ATOMIC_RELAXED);
+                while (!__atomic_compare_exchange_n(&rcu_readers, &reader->next,
+                                                    reader, 1, __ATOMIC_RELEASE,
+                                                    __ATOMIC_RELAXED))
+                {
+                }
+            }
+        }
+
+        if (NULL != reader)
+        {
+            if (rcu_reader_key_valid)
+            {
+                pthread_setspecific(rcu_reader_key, reader);
+            }
+            rcu_local_reader = reader;
+        }
+    }
+
+    return reader;
+}
+
+/**
+ * @brief oldest epoch any reader is currently reading in
+ *
+ * @return the epoch, UINT64_MAX when nobody is reading
+ */
+static uint64_t rcu_oldest_epoch(void)
+{
+    uint64_t oldest = UINT64_MAX;
+
+    for (rcu_reader_t *reader = __atomic_load_n(&rcu_readers, __ATOMIC_ACQUIRE);
+         NULL != reader; reader = reader->next)
+    {
+        uint64_t epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+        if (0 != epoch && epoch < oldest)
+        {
+            oldest = epoch;
+        }
+    }
+
+    return oldest;
+}
+
+/**
+ * @brief frees a list of node_t
+ *
+ * @param table pointer to table address
+ * @param current first node_t of the list
+ */
+static void rcu_free_chain(hash_table_t *table, node_t *current)
+{
+    while (NULL != current)
+    {
+        node_t *next = current->next;
+        hash_table_node_free(table, current);
+        current = next;
+    }
+}
+
+/**
+ * @brief frees a bucket array and every chain in it
+ *
+ * @param table pointer to table address
+ * @param buckets bucket array to free
+ */
+static void rcu_free_buckets(hash_table_t *table, rcu_buckets_t *buckets)
+{
+    for (uint32_t x = 0; x < buckets->size; x++)
+    {
+        rcu_free_chain(table, buckets->heads[x]);
+    }
+    free(buckets);
+}
+
+/**
+ * @brief frees a retired allocation according to its kind
+ *
+ * @param table pointer to table address
+ * @param memory the allocation
+ * @param kind how to free memory
+ * @param release frees memory of kind RCU_RETIRED_OTHER
+ */
+static void rcu_free(hash_table_t *table, void *memory, rcu_retired_kind_t kind,
+                     void (*release)(hash_table_t *table, void *memory))
+{
+    switch (kind)
+    {
+    case RCU_RETIRED_NODE:
+        hash_table_node_free(table, (node_t *)memory);
+        break;
+    case RCU_RETIRED_CHAIN:
+        rcu_free_chain(table, (node_t *)memory);
+        break;
+    case RCU_RETIRED_BUCKETS:
+        rcu_free_buckets(table, (rcu_buckets_t *)memory);
+        break;
+    case RCU_RETIRED_OTHER:
+        release(table, memory);
+        break;
+    }
+}
+
+/**
+ * @brief frees every retired allocation no reader can still be looking at
+ *
+ * @param table pointer to table address
+ * @param state writer state of the table
+ */
+static void rcu_reclaim(hash_table_t *table, rcu_state_t *state)
+{
+    uint64_t oldest = rcu_oldest_epoch();
+    rcu_retired_t **link = &state->retired;
+
+    while (NULL != *link)
+    {
+        rcu_retired_t *retired = *link;
+        if (retired->epoch <= oldest)
+        {
+            *link = retired->next;
+            rcu_free(table, retired->memory, retired->kind,
+                     retired->release);
+            free(retired);
+        }
+        else
+        {
+            link = &retired->next;
+        }
+    }
+}
+
+/**
+ * @brief queues an allocation the write in progress has unlinked, to be
+ *        freed after its grace period
+ *
+ * When the bookkeeping cannot be allocated the writer instead waits for
+ * every current reader to finish and frees memory straight away; readers
+ * are never made to wait.
+ *
+ * @param table pointer to table address
+ * @param memory the allocation
+ * @param kind how to free memory
+ * @param release frees memory of kind RCU_RETIRED_OTHER, NULL otherwise
+ */
+static void rcu_retire(hash_table_t *table, void *memory,
+                       rcu_retired_kind_t kind,
+                       void (*release)(hash_table_t *table, void *memory))
+{
+    rcu_state_t *state = (rcu_state_t *)table->sync_data;
+    rcu_retired_t *retired = (rcu_retired_t *)malloc(sizeof(rcu_retired_t));
+
+    if (NULL != retired)
+    {
+        retired->memory = memory;
+        retired->kind = kind;
+        retired->release = release;
+        retired->epoch = 0;
+        retired->next = state->pending;
+        state->pending = retired;
+    }
+    else
+    {
+        uint64_t epoch = __atomic_add_fetch(&rcu_epoch, 1, __ATOMIC_SEQ_CST);
+        while (rcu_oldest_epoch() < epoch)
+        {
+            sched_yield();
+        }
+        rcu_free(table, memory, kind, release);
+    }
+}
+
+/**
+ * @brief queues an allocation another engine has unlinked under the
+ *        writer lock, to be passed to release after its grace period
+ *
+ * @param table pointer to table address
+ * @param memory the allocation
+ * @param release frees memory
+ */
+void hash_table_rcu_retire(hash_table_t *table, void *memory,
+                           void (*release)(hash_table_t *table, void *memory))
+{
+    rcu_retire(table, memory, RCU_RETIRED_OTHER, release);
+}
+
+/**
+ * @brief allocates the writer state of a HASH_SYNC_RCU table
+ *
+ * @param table pointer to table address
+ *
+ * @return int exit code
+ */
+int hash_table_rcu_init(hash_table_t *table)
+{
+    int status = SUCCESS;
+    rcu_state_t *state = (rcu_state_t *)calloc(1, sizeof(rcu_state_t));
+
+    if (NULL == state)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        pthread_mutex_init(&state->writer, NULL);
+        table->sync_data = state;
+    }
+
+    return status;
+}
+
+/**
+ * @brief frees the writer state and everything still waiting for a grace
+ *        period; no thread may be reading the table any more
+ *
+ * @param table pointer to table address
+ */
+void hash_table_rcu_destroy(hash_table_t *table)
+{
+    rcu_state_t *state = (rcu_state_t *)table->sync_data;
+
+    if (NULL != state)
+    {
+        for (int list = 0; list < 2; list++)
+        {
+            rcu_retired_t *current = list ? state->retired : state->pending;
+            while (NULL != current)
+            {
+                rcu_retired_t *next = current->next;
+                rcu_free(table, current->memory, current->kind,
+                         current->release);
+                free(current);
+                current = next;
+            }
+        }
+        pthread_mutex_destroy(&state->writer);
+        free(state);
+        table->sync_data = NULL;
+    }
+}
+
+/**
+ * @brief starts a read: publishes the current epoch in the thread's own
+ *        reader record, taking no lock
+ *
+ * Reads may nest, as when a scan callback looks up another RCU table. A
+ * thread whose record cannot be allocated falls back to the writer lock.
+ *
+ * @param table pointer to table address
+ *
+ * @return token to pass to hash_table_rcu_read_unlock
+ */
+uint32_t hash_table_rcu_read_lock(hash_table_t *table)
+{
+    uint32_t token = 0;
+    rcu_reader_t *reader = rcu_reader_get();
+
+    if (NULL == reader)
+    {
+        pthread_mutex_lock(&((rcu_state_t *)table->sync_data)->writer);
+        token = 1;
+    }
+    else if (0 == reader->nesting++)
+    {
+        // nested reads keep the epoch of the outermost one
+        __atomic_store_n(&reader->epoch,
+                         __atomic_load_n(&rcu_epoch, __ATOMIC_SEQ_CST),
+                         __ATOMIC_RELAXED);
+        // the epoch must be visible before any bucket pointer is loaded
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    return token;
+}
+
+/**
+ * @brief ends a read started by hash_table_rcu_read_lock
+ *
+ * @param table pointer to table address
+ * @param token token returned by hash_table_rcu_read_lock
+ */
+void hash_table_rcu_read_unlock(hash_table_t *table, uint32_t token)
+{
+    if (0 != token)
+    {
+        pthread_mutex_unlock(&((rcu_state_t *)table->sync_data)->writer);
+    }
+    else if (0 == --rcu_local_reader->nesting)
+    {
+        __atomic_store_n(&rcu_local_reader->epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief serializes a write against other writers; readers carry on
+ *
+ * @param table pointer to table address
+ *
+ * @return token, always 0
+ */
+uint32_t hash_table_rcu_write_lock(hash_table_t *table)
+{
+    pthread_mutex_lock(&((rcu_state_t *)table->sync_data)->writer);
+
+    return 0;
+}
+
+/**
+ * @brief ends a write: stamps what it retired with a new epoch, frees
+ *        whatever earlier writes retired that no reader can still see, and
+ *        releases the writer lock
+ *
+ * @param table pointer to table address
+ */
+void hash_table_rcu_write_unlock(hash_table_t *table)
+{
+    rcu_state_t *state = (rcu_state_t *)table->sync_data;
+
+    if (NULL != state->pending)
+    {
+        // unlinks happened before the epoch moves, so readers that start in
+        // the new epoch cannot reach anything retired by this write
+        uint64_t epoch = __atomic_add_fetch(&rcu_epoch, 1, __ATOMIC_SEQ_CST);
+        rcu_retired_t *last = state->pending;
+        last->epoch = epoch;
+        while (NULL != last->next)
+        {
+            last = last->next;
+            last->epoch = epoch;
+        }
+        last->next = state->retired;
+        state->retired = state->pending;
+        state->pending = NULL;
+    }
+
+    rcu_reclaim(table, state);
+    pthread_mutex_unlock(&state->writer);
+}
+
+/**
+ * @brief allocates an empty bucket array
+ *
+ * @param size number of buckets, a power of two
+ *
+ * @return rcu_buckets_t pointer, NULL on allocation failure
+ */
+static rcu_buckets_t *rcu_buckets_alloc(uint32_t size)
+{
+    rcu_buckets_t *buckets = (rcu_buckets_t *)calloc(
+        1, sizeof(rcu_buckets_t) + (size_t)size * sizeof(node_t *));
+
+    if (NULL != buckets)
+    {
+        buckets->size = size;
+    }
+
+    return buckets;
+}
+
+/**
+ * @brief publishes a copy of every entry in a bucket array of new_size and
+ *        retires the old array
+ *
+ * Readers may be walking the old chains, so nodes are copied rather than
+ * relinked. Failing to allocate the copy is not an error, the table just
+ * keeps its current size.
+ *
+ * @param table pointer to table address
+ * @param new_size number of buckets, a power of two
+ */
+static void rcu_resize(hash_table_t *table, uint32_t new_size)
+{
+    rcu_buckets_t *old = (rcu_buckets_t *)table->engine_data;
+    rcu_buckets_t *fresh = rcu_buckets_alloc(new_size);
+    int status = NULL == fresh ? FAILURE : SUCCESS;
+
+    for (uint32_t x = 0; SUCCESS == status && x < old->size; x++)
+    {
+        for (node_t *current = old->heads[x];
+             SUCCESS == status && NULL != current; current = current->next)
+        {
+            node_t *copy = hash_table_node_create(table, current->data,
+                                                  current->key,
+                                                  current->key_len,
+                                                  current->hash);
+            if (NULL == copy)
+            {
+                status = FAILURE;
+            }
+            else
+            {
+                // appending keeps duplicates resolving to the oldest entry
+                node_t **link =
+                    &fresh->heads[(uint32_t)copy->hash & (new_size - 1)];
+                while (NULL != *link)
+                {
+                    link = &(*link)->next;
+                }
+                *link = copy;
+            }
+        }
+    }
+
+    if (SUCCESS == status)
+    {
+        __atomic_store_n(&table->engine_data, fresh, __ATOMIC_RELEASE);
+        table->size = new_size;
+        rcu_retire(table, old, RCU_RETIRED_BUCKETS, NULL);
+    }
+    else if (NULL != fresh)
+    {
+        rcu_free_buckets(table, fresh);
+    }
+}
+
+/**
+ * @brief allocates the first published bucket array
+ *
+ * @param table pointer to table address
+ * @param size number indexes in the table, rounded up to a power of two
+ *
+ * @return int exit code
+ */
+static int rcu_init(hash_table_t *table, uint32_t size)
+{
+    int status = SUCCESS;
+    uint32_t buckets = 1;
+
+    while (buckets != 0 && buckets < size)
+    {
+        buckets *= 2;
+    }
+
+    if (0 != buckets)
+    {
+        table->engine_data = rcu_buckets_alloc(buckets);
+    }
+    if (NULL == table->engine_data)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        table->size = buckets;
+        table->min_size = buckets;
+    }
+
+    return status;
+}
+
+/**
+ * @brief appends a new node_t to the chain of the key's bucket, publishing
+ *        it with a single release store once fully initialized
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param link end of the key's chain when the caller already walked it,
+ *             NULL otherwise
+ *
+ * @return the new node_t, NULL on allocation failure
+ */
+static node_t *rcu_append(hash_table_t *table, void *data, const char *key,
+                          uint32_t len, uint64_t hash, node_t **link)
+{
+    node_t *new_node = NULL;
+
+    if (table->count >= table->size * table->max_load_factor &&
+        table->size <= UINT32_MAX / 2)
+    {
+        uint32_t size = table->size;
+        rcu_resize(table, size * 2);
+        link = size != table->size ? NULL : link;
+    }
+
+    if (NULL == link)
+    {
+        rcu_buckets_t *buckets = (rcu_buckets_t *)table->engine_data;
+        link = &buckets->heads[(uint32_t)hash & (buckets->size - 1)];
+        while (NULL != *link)
+        {
+            link = &(*link)->next;
+        }
+    }
+
+    new_node = hash_table_node_create(table, data, key, len, hash);
+    if (NULL != new_node)
+    {
+        __atomic_store_n(link, new_node, __ATOMIC_RELEASE);
+    }
+
+    return new_node;
+}
+
+/**
+ * @brief appends a new node_t to the chain of the key's bucket
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int exit code
+ */
+static int rcu_add(hash_table_t *table, void *data, const char *key,
+                   uint32_t len, uint64_t hash)
+{
+    int status = SUCCESS;
+
+    if (NULL == rcu_append(table, data, key, len, hash, NULL))
+    {
+        status = FAILURE;
+    }
+
+    return status;
+}
+
+/**
+ * @brief returns the data slot of key, publishing a new node_t holding data
+ *        at the end of the walked chain when key is not present
+ *
+ * @param table pointer to table address
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param data data to store when key is not present
+ * @param inserted set to non-zero when a new node_t was added
+ *
+ * @return pointer to the node's data, NULL on allocation failure
+ */
+static void **rcu_upsert(hash_table_t *table, const char *key, uint32_t len,
+                         uint64_t hash, void *data, int *inserted)
+{
+    void **value = NULL;
+    rcu_buckets_t *buckets = (rcu_buckets_t *)table->engine_data;
+    node_t **link = &buckets->heads[(uint32_t)hash & (buckets->size - 1)];
+
+    while (NULL != *link && !hash_table_node_matches(*link, key, len, hash))
+    {
+        link = &(*link)->next;
+    }
+
+    *inserted = 0;
+    if (NULL != *link)
+    {
+        value = &(*link)->data;
+    }
+    else
+    {
+        node_t *new_node = rcu_append(table, data, key, len, hash, link);
+        if (NULL != new_node)
+        {
+            value = &new_node->data;
+            *inserted = 1;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief walks the chain of the key's bucket without taking any lock
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return void * data
+ */
+static void *rcu_lookup(hash_table_t *table, const char *key, uint32_t len,
+                        uint64_t hash)
+{
+    void *node_data = NULL;
+    rcu_buckets_t *buckets =
+        (rcu_buckets_t *)__atomic_load_n(&table->engine_data, __ATOMIC_ACQUIRE);
+    node_t *current = __atomic_load_n(
+        &buckets->heads[(uint32_t)hash & (buckets->size - 1)],
+        __ATOMIC_ACQUIRE);
+    uint32_t probes = 0;
+
+    while (NULL != current && !hash_table_node_matches(current, key, len, hash))
+    {
+        current = __atomic_load_n(&current->next, __ATOMIC_ACQUIRE);
+        probes++;
+    }
+    if (NULL != current)
+    {
+        // hash_table_put may be swapping the data
+        node_data = __atomic_load_n(&current->data, __ATOMIC_ACQUIRE);
+        probes++;
+    }
+    hash_table_count_lookups(table, 1, NULL != current, probes);
+
+    return node_data;
+}
+
+/**
+ * @brief looks up a group of keys in stages without taking any lock,
+ *        prefetching every bucket and then every chain head before the
+ *        chains are walked
+ *
+ * @param table pointer to table address
+ * @param keys keys being searched for
+ * @param lens number of bytes in each key
+ * @param hashes hash of each key
+ * @param n number of keys, at most HASH_TABLE_BATCH
+ * @param out data stored at each key, NULL when missing
+ */
+static void rcu_lookup_batch(hash_table_t *table, const char *const *keys,
+                             const uint32_t *lens, const uint64_t *hashes,
+                             uint32_t n, void **out)
+{
+    rcu_buckets_t *buckets =
+        (rcu_buckets_t *)__atomic_load_n(&table->engine_data, __ATOMIC_ACQUIRE);
+    uint32_t mask = buckets->size - 1;
+    node_t *heads[HASH_TABLE_BATCH];
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        __builtin_prefetch(&buckets->heads[(uint32_t)hashes[x] & mask]);
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        heads[x] = __atomic_load_n(&buckets->heads[(uint32_t)hashes[x] & mask],
+                                   __ATOMIC_ACQUIRE);
+        __builtin_prefetch(heads[x]);
+    }
+    uint32_t hits = 0;
+    uint32_t probes = 0;
+    for (uint32_t x = 0; x < n; x++)
+    {
+        node_t *current = heads[x];
+        while (NULL != current &&
+               !hash_table_node_matches(current, keys[x], lens[x], hashes[x]))
+        {
+            current = __atomic_load_n(&current->next, __ATOMIC_ACQUIRE);
+            probes++;
+        }
+        out[x] = NULL != current ?
+                     __atomic_load_n(&current->data, __ATOMIC_ACQUIRE) :
+                     NULL;
+        hits += NULL != current;
+    }
+    hash_table_count_lookups(table, n, hits, probes + hits);
+}
+
+/**
+ * @brief visits the bucket the cursor points at without taking any lock
+ *
+ * @param table pointer to table address
+ * @param cursor current cursor
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ * @param emitted incremented for every visited entry
+ *
+ * @return next cursor, 0 once every bucket was visited
+ */
+static uint64_t rcu_scan(hash_table_t *table, uint64_t cursor,
+                         HASH_SCAN_F callback, void *context,
+                         uint32_t *emitted)
+{
+    rcu_buckets_t *buckets =
+        (rcu_buckets_t *)__atomic_load_n(&table->engine_data, __ATOMIC_ACQUIRE);
+    uint64_t mask = buckets->size - 1;
+    node_t *current =
+        __atomic_load_n(&buckets->heads[cursor & mask], __ATOMIC_ACQUIRE);
+
+    while (NULL != current)
+    {
+        callback(current->key, current->key_len,
+                 __atomic_load_n(&current->data, __ATOMIC_ACQUIRE), context);
+        (*emitted)++;
+        current = __atomic_load_n(&current->next, __ATOMIC_ACQUIRE);
+    }
+
+    return hash_table_cursor_next(cursor, mask);
+}
+
+/**
+ * @brief unlinks the first node_t stored at key with a single release
+ *        store and retires it
+ *
+ * @param table pointer to table address
+ * @param key key of data to be removed
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int
+ */
+static int rcu_remove(hash_table_t *table, const char *key, uint32_t len,
+                      uint64_t hash)
+{
+    int status = SUCCESS;
+    rcu_buckets_t *buckets = (rcu_buckets_t *)table->engine_data;
+    node_t **link = &buckets->heads[(uint32_t)hash & (buckets->size - 1)];
+
+    while (NULL != *link && !hash_table_node_matches(*link, key, len, hash))
+    {
+        link = &(*link)->next;
+    }
+
+    if (NULL == *link)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        node_t *current = *link;
+        uint32_t count = table->count - 1;
+
+        __atomic_store_n(link, current->next, __ATOMIC_RELEASE);
+        rcu_retire(table, current, RCU_RETIRED_NODE, NULL);
+
+        if (count < table->size * table->min_load_factor &&
+            table->size / 2 >= table->min_size)
+        {
+            uint32_t new_size = table->size / 2;
+            while (new_size / 2 >= table->min_size &&
+                   count < (new_size / 2) * table->max_load_factor / 2)
+            {
+                new_size /= 2;
+            }
+            rcu_resize(table, new_size);
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief detaches every chain and retires it
+ *
+ * @param table pointer to table address
+ */
+static void rcu_clear(hash_table_t *table)
+{
+    rcu_buckets_t *buckets = (rcu_buckets_t *)table->engine_data;
+
+    for (uint32_t x = 0; x < buckets->size; x++)
+    {
+        node_t *chain = buckets->heads[x];
+        if (NULL != chain)
+        {
+            __atomic_store_n(&buckets->heads[x], NULL, __ATOMIC_RELEASE);
+            rcu_retire(table, chain, RCU_RETIRED_CHAIN, NULL);
+        }
+    }
+}
+
+/**
+ * @brief records the chain lengths of the published bucket array; the
+ *        caller holds the writer lock, so no chain changes meanwhile
+ *
+ * @param table pointer to table address
+ * @param out stats being filled in
+ */
+static void rcu_stats(hash_table_t *table, hash_table_stats_t *out)
+{
+    rcu_buckets_t *buckets = (rcu_buckets_t *)table->engine_data;
+
+    for (uint32_t x = 0; x < buckets->size; x++)
+    {
+        uint32_t length = 0;
+        for (node_t *current = buckets->heads[x]; NULL != current;
+             current = current->next)
+        {
+            out->bytes_used += hash_table_node_bytes(current);
+            length++;
+        }
+        hash_table_stats_record(out, length, 1);
+    }
+    out->buckets = buckets->size;
+    out->bytes_used += sizeof(rcu_buckets_t) +
+                       buckets->size * sizeof(node_t *);
+}
+
+/**
+ * @brief frees the published bucket array and every chain in it
+ *
+ * @param table pointer to table address
+ */
+static void rcu_destroy(hash_table_t *table)
+{
+    rcu_free_buckets(table, (rcu_buckets_t *)table->engine_data);
+    table->engine_data = NULL;
+}
+
+const hash_engine_ops_t rcu_engine_ops = {
+    .init = rcu_init,
+    .add = rcu_add,
+    .lookup = rcu_lookup,
+    .remove = rcu_remove,
+    .clear = rcu_clear,
+    .destroy = rcu_destroy,
+    .lookup_batch = rcu_lookup_batch,
+    .upsert = rcu_upsert,
+    .scan = rcu_scan,
+    .stats = rcu_stats,
+};
@@ -0,0 +1,680 @@
+#include <hash_table.h>
+#include "hash_table_internal.h"
+
+#define ROBIN_MIN_CAPACITY 16
+#define ROBIN_MAX_PROBE UINT8_MAX
+
+/**
+ * @brief structure of a robin hood engine slot
+ *
+ * @param key       pointer to the saved keyvalue string
+ * @param data      saved data pointer
+ * @param hash      full hash of the key, so resizing never rehashes keys
+ * @param key_len   number of bytes in key, excluding the terminator
+ */
+typedef struct robin_slot_t
+{
+    char *key;
+    void *data;
+    uint64_t hash;
+    uint32_t key_len;
+} robin_slot_t;
+
+/**
+ * @brief storage of the robin hood engine
+ *
+ * probe holds one byte per slot: 0 for an empty slot, otherwise one more
+ * than the distance of the slot's key from its home slot, hash & mask.
+ * Inserts take the slot of any key closer to its home than the key being
+ * placed and carry that key on instead, so every run of occupied slots
+ * stays sorted by home slot and no key sits much further from home than
+ * the others. A lookup can stop at the first slot whose key is closer to
+ * home than the probe has come, and a remove shifts the following keys
+ * back a slot instead of leaving a tombstone.
+ *
+ * @param probe     probe length byte of every slot
+ * @param slots     the key/data slots
+ * @param capacity  number of slots, a power of two
+ * @param count     number of full slots
+ */
+typedef struct robin_table_t
+{
+    uint8_t *probe;
+    robin_slot_t *slots;
+    uint32_t capacity;
+    uint32_t count;
+} robin_table_t;
+
+/**
+ * @brief number of full slots allowed in a table of the given capacity
+ */
+static inline uint32_t robin_max_load(uint32_t capacity)
+{
+    return capacity - capacity / 10;
+}
+
+/**
+ * @brief allocates empty storage of the given capacity
+ *
+ * @param robin storage to fill in
+ * @param capacity number of slots, a power of two
+ *
+ * @return int exit code
+ */
+static int robin_alloc(robin_table_t *robin, uint32_t capacity)
+{
+    int status = SUCCESS;
+
+    robin->probe = (uint8_t *)calloc(capacity, sizeof(uint8_t));
+    robin->slots = (robin_slot_t *)malloc(capacity * sizeof(robin_slot_t));
+    if (NULL == robin->probe || NULL == robin->slots)
+    {
+        free(robin->probe);
+        free(robin->slots);
+        status = FAILURE;
+    }
+    else
+    {
+        robin->capacity = capacity;
+        robin->count = 0;
+    }
+
+    return status;
+}
+
+/**
+ * @brief checks that placing a key at start, probe length probe, keeps
+ *        every key it displaces within ROBIN_MAX_PROBE of its home
+ *
+ * @param robin storage to check
+ * @param start first slot the key may take
+ * @param probe probe length of the key at start
+ *
+ * @return non-zero when the key can be placed
+ */
+static int robin_fits(const robin_table_t *robin, uint32_t start,
+                      uint32_t probe)
+{
+    uint32_t mask = robin->capacity - 1;
+    uint32_t slot = start;
+
+    while (0 != robin->probe[slot] && probe <= ROBIN_MAX_PROBE)
+    {
+        // the key placed here stays, the displaced one is carried on
+        if (robin->probe[slot] < probe)
+        {
+            probe = robin->probe[slot];
+        }
+        slot = (slot + 1) & mask;
+        probe++;
+    }
+
+    return probe <= ROBIN_MAX_PROBE;
+}
+
+/**
+ * @brief places a key at start, carrying on every key it displaces; the
+ *        caller has checked robin_fits
+ *
+ * @param robin storage to place into
+ * @param entry slot contents of the key
+ * @param start first slot the key may take
+ * @param probe probe length of the key at start
+ *
+ * @return slot the key was placed in
+ */
+static uint32_t robin_place(robin_table_t *robin, robin_slot_t entry,
+                            uint32_t start, uint32_t probe)
+{
+    uint32_t mask = robin->capacity - 1;
+    uint32_t placed = robin->capacity;
+    uint32_t slot = start;
+
+    while (0 != robin->probe[slot])
+    {
+        if (robin->probe[slot] < probe)
+        {
+            robin_slot_t carried = robin->slots[slot];
+            uint32_t carried_probe = robin->probe[slot];
+
+            robin->slots[slot] = entry;
+            robin->probe[slot] = (uint8_t)probe;
+            if (placed == robin->capacity)
+            {
+                placed = slot;
+            }
+            entry = carried;
+            probe = carried_probe;
+        }
+        slot = (slot + 1) & mask;
+        probe++;
+    }
+
+    robin->slots[slot] = entry;
+    robin->probe[slot] = (uint8_t)probe;
+    robin->count++;
+
+    return placed == robin->capacity ? slot : placed;
+}
+
+/**
+ * @brief finds the slot holding key
+ *
+ * The probe also notes where it stopped and with which probe length,
+ * which is where key belongs, so a miss can be followed by an insert
+ * without probing again.
+ *
+ * @param robin storage to search
+ * @param key key being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param stop when not NULL, receives the slot the probe stopped at
+ * @param stop_probe when not NULL, receives the probe length at stop
+ *
+ * @return slot index, or capacity when key is not present
+ */
+static uint32_t robin_find(const robin_table_t *robin, const char *key,
+                           uint32_t len, uint64_t hash, uint32_t *stop,
+                           uint32_t *stop_probe)
+{
+    uint32_t mask = robin->capacity - 1;
+    uint32_t slot = (uint32_t)hash & mask;
+    uint32_t probe = 1;
+    uint32_t index = robin->capacity;
+
+    // past the first key closer to home than the probe, key cannot follow
+    while (robin->probe[slot] >= probe)
+    {
+        const robin_slot_t *current = &robin->slots[slot];
+        if (robin->probe[slot] == probe && current->hash == hash &&
+            current->key_len == len && memcmp(current->key, key, len) == 0)
+        {
+            index = slot;
+            break;
+        }
+        slot = (slot + 1) & mask;
+        probe++;
+    }
+
+    if (NULL != stop)
+    {
+        *stop = slot;
+        *stop_probe = probe;
+    }
+
+    return index;
+}
+
+/**
+ * @brief moves every key into storage of twice the capacity
+ *
+ * @param table pointer to table address
+ *
+ * @return int exit code
+ */
+static int robin_grow(hash_table_t *table)
+{
+    int status = SUCCESS;
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+    robin_table_t grown = {0};
+    uint32_t capacity = robin->capacity * 2;
+
+    if (0 == capacity || SUCCESS != robin_alloc(&grown, capacity))
+    {
+        status = FAILURE;
+    }
+
+    for (uint32_t x = 0; SUCCESS == status && x < robin->capacity; x++)
+    {
+        if (0 != robin->probe[x])
+        {
+            uint32_t home = (uint32_t)robin->slots[x].hash & (capacity - 1);
+            if (robin_fits(&grown, home, 1))
+            {
+                robin_place(&grown, robin->slots[x], home, 1);
+            }
+            else
+            {
+                free(grown.probe);
+                free(grown.slots);
+                status = FAILURE;
+            }
+        }
+    }
+
+    if (SUCCESS == status)
+    {
+        free(robin->probe);
+        free(robin->slots);
+        *robin = grown;
+        table->size = capacity;
+    }
+
+    return status;
+}
+
+/**
+ * @brief allocates robin hood storage with room for size entries
+ *
+ * @param table pointer to table address
+ * @param size number of entries to reserve room for
+ *
+ * @return int exit code
+ */
+static int robin_init(hash_table_t *table, uint32_t size)
+{
+    int status = SUCCESS;
+    uint32_t capacity = ROBIN_MIN_CAPACITY;
+    robin_table_t *robin = (robin_table_t *)calloc(1, sizeof(robin_table_t));
+
+    while (capacity != 0 && robin_max_load(capacity) < size)
+    {
+        capacity *= 2;
+    }
+
+    if (NULL == robin || 0 == capacity ||
+        SUCCESS != robin_alloc(robin, capacity))
+    {
+        free(robin);
+        status = FAILURE;
+    }
+    else
+    {
+        table->engine_data = robin;
+        table->size = capacity;
+    }
+
+    return status;
+}
+
+/**
+ * @brief stores a copy of key at start, growing first when the table is
+ *        full or a displaced key would end up too far from home
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param start slot the probe for key stopped at
+ * @param probe probe length at start
+ *
+ * @return index of the filled slot, capacity on failure
+ */
+static uint32_t robin_insert(hash_table_t *table, void *data, const char *key,
+                             uint32_t len, uint64_t hash, uint32_t start,
+                             uint32_t probe)
+{
+    int status = SUCCESS;
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+    robin_slot_t entry = {NULL, data, hash, len};
+    uint32_t slot = robin->capacity;
+
+    entry.key = hash_table_key_copy(table, key, len);
+    if (NULL == entry.key)
+    {
+        status = FAILURE;
+    }
+
+    while (SUCCESS == status &&
+           (robin->count >= robin_max_load(robin->capacity) ||
+            !robin_fits(robin, start, probe)))
+    {
+        // a nearly empty table whose keys still end up too far from home
+        // is holding hundreds of copies of one hash; growing cannot help
+        if (robin->count < robin_max_load(robin->capacity) / 4)
+        {
+            status = FAILURE;
+            break;
+        }
+        status = robin_grow(table);
+        start = (uint32_t)hash & (robin->capacity - 1);
+        probe = 1;
+        // the key's own probe sequence has to be walked again to find the
+        // end of the keys that share its home
+        while (robin->probe[start] >= probe)
+        {
+            start = (start + 1) & (robin->capacity - 1);
+            probe++;
+        }
+    }
+
+    if (SUCCESS != status)
+    {
+        hash_table_key_free(table, entry.key);
+    }
+    else
+    {
+        slot = robin_place(robin, entry, start, probe);
+    }
+
+    return slot;
+}
+
+/**
+ * @brief stores data after every key already stored at the same home slot
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int exit code
+ */
+static int robin_add(hash_table_t *table, void *data, const char *key,
+                     uint32_t len, uint64_t hash)
+{
+    int status = SUCCESS;
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+    uint32_t mask = robin->capacity - 1;
+    uint32_t start = (uint32_t)hash & mask;
+    uint32_t probe = 1;
+
+    // equal keys share a home, so a duplicate lands behind the key that
+    // lookups keep finding
+    while (robin->probe[start] >= probe)
+    {
+        start = (start + 1) & mask;
+        probe++;
+    }
+
+    if (robin_insert(table, data, key, len, hash, start, probe) ==
+        robin->capacity)
+    {
+        status = FAILURE;
+    }
+
+    return status;
+}
+
+/**
+ * @brief returns the data slot of key, inserting key where the same probe
+ *        stopped when it is not present
+ *
+ * @param table pointer to table address
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param data data to store when key is not present
+ * @param inserted set to non-zero when key was added
+ *
+ * @return pointer to the slot's data, NULL on allocation failure
+ */
+static void **robin_upsert(hash_table_t *table, const char *key, uint32_t len,
+                           uint64_t hash, void *data, int *inserted)
+{
+    void **value = NULL;
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+    uint32_t stop = 0;
+    uint32_t stop_probe = 0;
+    uint32_t slot = robin_find(robin, key, len, hash, &stop, &stop_probe);
+
+    *inserted = 0;
+    if (slot == robin->capacity)
+    {
+        slot = robin_insert(table, data, key, len, hash, stop, stop_probe);
+        *inserted = slot != robin->capacity;
+    }
+    if (slot != robin->capacity)
+    {
+        value = &robin->slots[slot].data;
+    }
+
+    return value;
+}
+
+/**
+ * @brief looks up key, stopping once the probe passes where key would be
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return void * data
+ */
+static void *robin_lookup(hash_table_t *table, const char *key, uint32_t len,
+                          uint64_t hash)
+{
+    void *data = NULL;
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+    uint32_t stop = 0;
+    uint32_t probes = 0;
+    uint32_t slot = robin_find(robin, key, len, hash, &stop, &probes);
+
+    if (slot != robin->capacity)
+    {
+        data = robin->slots[slot].data;
+    }
+    hash_table_count_lookups(table, 1, slot != robin->capacity, probes);
+
+    return data;
+}
+
+/**
+ * @brief looks up a group of keys in stages: every home slot's probe byte
+ *        is prefetched, then every home slot, before the probes are run
+ *
+ * @param table pointer to table address
+ * @param keys keys being searched for
+ * @param lens number of bytes in each key
+ * @param hashes hash of each key
+ * @param n number of keys, at most HASH_TABLE_BATCH
+ * @param out data stored at each key, NULL when missing
+ */
+static void robin_lookup_batch(hash_table_t *table, const char *const *keys,
+                               const uint32_t *lens, const uint64_t *hashes,
+                               uint32_t n, void **out)
+{
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+    uint32_t mask = robin->capacity - 1;
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        __builtin_prefetch(&robin->probe[(uint32_t)hashes[x] & mask]);
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        __builtin_prefetch(&robin->slots[(uint32_t)hashes[x] & mask]);
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        out[x] = robin_lookup(table, keys[x], lens[x], hashes[x]);
+    }
+}
+
+/**
+ * @brief frees the slot holding key and shifts the keys after it back by
+ *        one slot, up to the next empty slot or key already at home
+ *
+ * @param table pointer to table address
+ * @param key key of data to be removed
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int
+ */
+static int robin_remove(hash_table_t *table, const char *key, uint32_t len,
+                        uint64_t hash)
+{
+    int status = SUCCESS;
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+    uint32_t mask = robin->capacity - 1;
+    uint32_t slot = robin_find(robin, key, len, hash, NULL, NULL);
+
+    if (slot == robin->capacity)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        uint32_t next = (slot + 1) & mask;
+
+        hash_table_key_free(table, robin->slots[slot].key);
+        while (robin->probe[next] > 1)
+        {
+            robin->slots[slot] = robin->slots[next];
+            robin->probe[slot] = robin->probe[next] - 1;
+            slot = next;
+            next = (next + 1) & mask;
+        }
+        robin->probe[slot] = 0;
+        robin->count--;
+    }
+
+    return status;
+}
+
+/**
+ * @brief visits every key whose home is the slot the cursor points at
+ *
+ * Keys sharing a home are stored next to each other, starting at the first
+ * slot at or after the home whose probe length puts its key's home there.
+ *
+ * @param table pointer to table address
+ * @param cursor current cursor
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ * @param emitted incremented for every visited entry
+ *
+ * @return next cursor, 0 once every home slot was visited
+ */
+static uint64_t robin_scan(hash_table_t *table, uint64_t cursor,
+                           HASH_SCAN_F callback, void *context,
+                           uint32_t *emitted)
+{
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+    uint32_t mask = robin->capacity - 1;
+    uint32_t slot = (uint32_t)cursor & mask;
+
+    for (uint32_t probe = 1; robin->probe[slot] >= probe; probe++)
+    {
+        if (robin->probe[slot] == probe)
+        {
+            robin_slot_t *current = &robin->slots[slot];
+            callback(current->key, current->key_len, current->data, context);
+            (*emitted)++;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return hash_table_cursor_next(cursor, mask);
+}
+
+/**
+ * @brief frees every key and marks every slot empty
+ *
+ * @param table pointer to table address
+ */
+static void robin_clear(hash_table_t *table)
+{
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+
+    // arena keys are released by hash_table_clear without visiting slots
+    for (uint32_t x = 0; NULL == table->key_arena && x < robin->capacity; x++)
+    {
+        if (0 != robin->probe[x])
+        {
+            hash_table_key_free(table, robin->slots[x].key);
+        }
+    }
+    memset(robin->probe, 0, robin->capacity);
+    robin->count = 0;
+}
+
+/**
+ * @brief frees the robin hood storage
+ *
+ * @param table pointer to table address
+ */
+static void robin_destroy(hash_table_t *table)
+{
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+
+    robin_clear(table);
+    free(robin->probe);
+    free(robin->slots);
+    free(robin);
+    table->engine_data = NULL;
+}
+
+/**
+ * @brief reports how many slots past its home slot every key sits
+ *
+ * @param table pointer to table address
+ * @param out stats being filled in
+ */
+static void robin_stats(hash_table_t *table, hash_table_stats_t *out)
+{
+    robin_table_t *robin = (robin_table_t *)table->engine_data;
+
+    for (uint32_t x = 0; x < robin->capacity; x++)
+    {
+        if (0 != robin->probe[x])
+        {
+            hash_table_stats_record(out, robin->probe[x] - 1U, 1);
+            out->bytes_used += robin->slots[x].key_len + 1U;
+        }
+    }
+    out->buckets = robin->capacity;
+    out->bytes_used += sizeof(robin_table_t) +
+                       robin->capacity * (1 + sizeof(robin_slot_t));
+}
+
+/**
+ * @brief reports how far keys sit from their home slot
+ *
+ * @param table pointer to table address
+ * @param max_probe receives the largest distance, may be NULL
+ * @param mean_probe receives the mean distance, may be NULL
+ *
+ * @return int exit code
+ */
+int hash_table_probe_stats(hash_table_t *table, uint32_t *max_probe,
+                           double *mean_probe)
+{
+    int status = FAILURE;
+
+    if (NULL != table && HASH_ENGINE_ROBIN_HOOD == table->engine)
+    {
+        robin_table_t *robin = (robin_table_t *)table->engine_data;
+        uint64_t total = 0;
+        uint32_t longest = 0;
+
+        for (uint32_t x = 0; x < robin->capacity; x++)
+        {
+            if (0 != robin->probe[x])
+            {
+                uint32_t distance = robin->probe[x] - 1U;
+                total += distance;
+                longest = distance > longest ? distance : longest;
+            }
+        }
+
+        if (NULL != max_probe)
+        {
+            *max_probe = longest;
+        }
+        if (NULL != mean_probe)
+        {
+            *mean_probe = 0 != robin->count ? (double)total / robin->count : 0;
+        }
+        status = SUCCESS;
+    }
+
+    return status;
+}
+
+const hash_engine_ops_t robin_engine_ops = {
+    .init = robin_init,
+    .add = robin_add,
+    .lookup = robin_lookup,
+    .remove = robin_remove,
+    .clear = robin_clear,
+    .destroy = robin_destroy,
+    .lookup_batch = robin_lookup_batch,
+    .upsert = robin_upsert,
+    .scan = robin_scan,
+    .stats = robin_stats,
+};
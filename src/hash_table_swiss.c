@@ -0,0 +1,749 @@
+#include <hash_table.h>
+#include "hash_table_internal.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define SWISS_GROUP_WIDTH 16
+#define SWISS_CTRL_EMPTY ((int8_t)-128)
+#define SWISS_CTRL_DELETED ((int8_t)-2)
+#define SWISS_SLOT_ALIGN 64
+#define SWISS_INLINE_KEY 36
+
+/**
+ * @brief structure of a swiss engine slot
+ *
+ * A slot fills one 64 byte cache line. Keys shorter than SWISS_INLINE_KEY
+ * are copied into key_inline, so a hit reads the control group and that
+ * one line; longer keys go to the heap. The full hash lets rebuilds, scans
+ * and stats place keys without hashing them again.
+ *
+ * @param key           pointer to the saved keyvalue string, either
+ *                      key_inline or a heap copy
+ * @param data          saved data pointer
+ * @param hash          full hash of the key
+ * @param key_len       number of bytes in key, excluding the terminator
+ * @param key_inline    storage for keys shorter than SWISS_INLINE_KEY
+ */
+typedef struct swiss_slot_t
+{
+    char *key;
+    void *data;
+    uint64_t hash;
+    uint32_t key_len;
+    char key_inline[SWISS_INLINE_KEY];
+} swiss_slot_t;
+
+/**
+ * @brief storage of the swiss engine
+ *
+ * ctrl holds one byte per slot: SWISS_CTRL_EMPTY, SWISS_CTRL_DELETED or,
+ * for a full slot, the low 7 bits of the key hash. Slots are grouped in
+ * runs of SWISS_GROUP_WIDTH that are probed together.
+ *
+ * @param ctrl          control bytes, one per slot
+ * @param slots         the key/data slots
+ * @param capacity      number of slots, a power of two multiple of 16
+ * @param count         number of full slots
+ * @param growth_left   empty slots that may still be filled before the
+ *                      table has to be rebuilt
+ */
+typedef struct swiss_table_t
+{
+    int8_t *ctrl;
+    swiss_slot_t *slots;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t growth_left;
+} swiss_table_t;
+
+/**
+ * @brief bitmask of the slots in a group whose control byte equals value
+ *
+ * @param ctrl first control byte of the group
+ * @param value control byte to search for
+ *
+ * @return bit i set when slot i of the group matches
+ */
+static inline uint32_t swiss_group_match(const int8_t *ctrl, int8_t value)
+{
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+    uint32_t mask = 0;
+    for (uint32_t x = 0; x < SWISS_GROUP_WIDTH; x++)
+    {
+        mask |= (uint32_t)(ctrl[x] == value) << x;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief bitmask of the slots in a group that are empty or deleted; both
+ *        markers have the high bit set while full slots never do
+ *
+ * @param ctrl first control byte of the group
+ *
+ * @return bit i set when slot i of the group is free
+ */
+static inline uint32_t swiss_group_match_free(const int8_t *ctrl)
+{
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(
+        _mm_loadu_si128((const __m128i *)ctrl));
+#else
+    uint32_t mask = 0;
+    for (uint32_t x = 0; x < SWISS_GROUP_WIDTH; x++)
+    {
+        mask |= (uint32_t)(ctrl[x] < 0) << x;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief number of full slots allowed in a table of the given capacity
+ */
+static inline uint32_t swiss_max_load(uint32_t capacity)
+{
+    return capacity - capacity / 8;
+}
+
+/**
+ * @brief frees the key of a full slot unless it is stored inline
+ *
+ * @param table pointer to table address
+ * @param slot slot whose key is freed
+ */
+static inline void swiss_key_free(hash_table_t *table, swiss_slot_t *slot)
+{
+    if (slot->key != slot->key_inline)
+    {
+        hash_table_key_free(table, slot->key);
+    }
+}
+
+/**
+ * @brief allocates empty storage of the given capacity
+ *
+ * @param swiss storage to fill in
+ * @param capacity number of slots, a power of two multiple of 16
+ *
+ * @return int exit code
+ */
+static int swiss_alloc(swiss_table_t *swiss, uint32_t capacity)
+{
+    int status = SUCCESS;
+
+    swiss->ctrl = (int8_t *)malloc(capacity);
+    swiss->slots = (swiss_slot_t *)aligned_alloc(
+        SWISS_SLOT_ALIGN, capacity * sizeof(swiss_slot_t));
+    if (NULL == swiss->ctrl || NULL == swiss->slots)
+    {
+        free(swiss->ctrl);
+        free(swiss->slots);
+        status = FAILURE;
+    }
+    else
+    {
+        memset(swiss->ctrl, SWISS_CTRL_EMPTY, capacity);
+        swiss->capacity = capacity;
+        swiss->count = 0;
+        swiss->growth_left = swiss_max_load(capacity);
+    }
+
+    return status;
+}
+
+/**
+ * @brief finds the first empty or deleted slot on the probe sequence of hash
+ *
+ * Groups are visited in triangular order, which reaches every group of a
+ * power of two sized table. The load limit guarantees one exists.
+ *
+ * @param swiss storage to search
+ * @param hash hash of the key being inserted
+ *
+ * @return slot index
+ */
+static uint32_t swiss_find_free(const swiss_table_t *swiss, uint64_t hash)
+{
+    uint32_t group_mask = swiss->capacity / SWISS_GROUP_WIDTH - 1;
+    uint32_t group = (uint32_t)(hash >> 7) & group_mask;
+    uint32_t match = 0;
+
+    for (uint32_t step = 1;; step++)
+    {
+        match = swiss_group_match_free(swiss->ctrl + group * SWISS_GROUP_WIDTH);
+        if (0 != match)
+        {
+            break;
+        }
+        group = (group + step) & group_mask;
+    }
+
+    return group * SWISS_GROUP_WIDTH + (uint32_t)__builtin_ctz(match);
+}
+
+/**
+ * @brief finds the slot holding key
+ *
+ * The probe also notes the first free slot it passes, which is where
+ * swiss_find_free would place key, so a miss can be followed by an insert
+ * without probing again.
+ *
+ * @param swiss storage to search
+ * @param key key being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param free_slot when not NULL, receives the first free slot on the probe
+ *                  sequence if key is not present
+ * @param groups when not NULL, receives the number of groups probed
+ *
+ * @return slot index, or capacity when key is not present
+ */
+static uint32_t swiss_find(const swiss_table_t *swiss, const char *key,
+                           uint32_t len, uint64_t hash, uint32_t *free_slot,
+                           uint32_t *groups)
+{
+    uint32_t group_mask = swiss->capacity / SWISS_GROUP_WIDTH - 1;
+    uint32_t group = (uint32_t)(hash >> 7) & group_mask;
+    int8_t h2 = (int8_t)(hash & 0x7f);
+    uint32_t index = swiss->capacity;
+    uint32_t first_free = swiss->capacity;
+    uint32_t probed = 0;
+
+    for (uint32_t step = 1; index == swiss->capacity; step++)
+    {
+        const int8_t *ctrl = swiss->ctrl + group * SWISS_GROUP_WIDTH;
+        probed++;
+        uint32_t match = swiss_group_match(ctrl, h2);
+        if (NULL != free_slot && first_free == swiss->capacity)
+        {
+            uint32_t free_match = swiss_group_match_free(ctrl);
+            if (0 != free_match)
+            {
+                first_free = group * SWISS_GROUP_WIDTH +
+                             (uint32_t)__builtin_ctz(free_match);
+            }
+        }
+        while (0 != match)
+        {
+            uint32_t slot = group * SWISS_GROUP_WIDTH +
+                            (uint32_t)__builtin_ctz(match);
+            if (swiss->slots[slot].hash == hash &&
+                swiss->slots[slot].key_len == len &&
+                memcmp(key, swiss->slots[slot].key, len) == 0)
+            {
+                index = slot;
+                break;
+            }
+            match &= match - 1;
+        }
+
+        // an empty slot ends every probe sequence that reached this group
+        if (index == swiss->capacity &&
+            0 != swiss_group_match(ctrl, SWISS_CTRL_EMPTY))
+        {
+            break;
+        }
+        group = (group + step) & group_mask;
+    }
+
+    if (NULL != free_slot)
+    {
+        *free_slot = first_free;
+    }
+    if (NULL != groups)
+    {
+        *groups = probed;
+    }
+
+    return index;
+}
+
+/**
+ * @brief rebuilds the storage, dropping deleted markers and doubling the
+ *        capacity when more than half of the load limit is in use
+ *
+ * @param table pointer to table address
+ *
+ * @return int exit code
+ */
+static int swiss_rebuild(hash_table_t *table)
+{
+    int status = SUCCESS;
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    swiss_table_t rebuilt = {0};
+    uint32_t capacity = swiss->capacity;
+
+    if (swiss->count >= swiss_max_load(capacity) / 2)
+    {
+        capacity *= 2;
+    }
+
+    if (0 == capacity || SUCCESS != swiss_alloc(&rebuilt, capacity))
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        for (uint32_t x = 0; x < swiss->capacity; x++)
+        {
+            if (swiss->ctrl[x] >= 0)
+            {
+                swiss_slot_t *moved = NULL;
+                uint64_t hash = swiss->slots[x].hash;
+                uint32_t slot = swiss_find_free(&rebuilt, hash);
+                rebuilt.ctrl[slot] = (int8_t)(hash & 0x7f);
+                moved = &rebuilt.slots[slot];
+                *moved = swiss->slots[x];
+                if (swiss->slots[x].key == swiss->slots[x].key_inline)
+                {
+                    moved->key = moved->key_inline;
+                }
+            }
+        }
+        rebuilt.count = swiss->count;
+        rebuilt.growth_left = swiss_max_load(capacity) - swiss->count;
+
+        free(swiss->ctrl);
+        free(swiss->slots);
+        *swiss = rebuilt;
+        table->size = capacity;
+    }
+
+    return status;
+}
+
+/**
+ * @brief allocates swiss storage with room for size entries
+ *
+ * @param table pointer to table address
+ * @param size number of entries to reserve room for
+ *
+ * @return int exit code
+ */
+static int swiss_init(hash_table_t *table, uint32_t size)
+{
+    int status = SUCCESS;
+    uint32_t capacity = SWISS_GROUP_WIDTH;
+    swiss_table_t *swiss = (swiss_table_t *)calloc(1, sizeof(swiss_table_t));
+
+    while (capacity != 0 && swiss_max_load(capacity) < size)
+    {
+        capacity *= 2;
+    }
+
+    if (NULL == swiss || 0 == capacity || SUCCESS != swiss_alloc(swiss, capacity))
+    {
+        free(swiss);
+        status = FAILURE;
+    }
+    else
+    {
+        table->engine_data = swiss;
+        table->size = capacity;
+    }
+
+    return status;
+}
+
+/**
+ * @brief stores data in a free slot on the key's probe sequence, rebuilding
+ *        first when that would use up the last empty slot
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param slot first free slot on the key's probe sequence
+ *
+ * @return index of the filled slot, capacity on failure
+ */
+static uint32_t swiss_insert(hash_table_t *table, void *data, const char *key,
+                             uint32_t len, uint64_t hash, uint32_t slot)
+{
+    int status = SUCCESS;
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    char *key_copy = NULL;
+
+    if (len >= SWISS_INLINE_KEY)
+    {
+        key_copy = hash_table_key_copy(table, key, len);
+    }
+
+    if (len >= SWISS_INLINE_KEY && NULL == key_copy)
+    {
+        status = FAILURE;
+    }
+    else if (0 == swiss->growth_left && SWISS_CTRL_EMPTY == swiss->ctrl[slot])
+    {
+        status = swiss_rebuild(table);
+        slot = swiss_find_free(swiss, hash);
+    }
+
+    if (SUCCESS != status)
+    {
+        hash_table_key_free(table, key_copy);
+        slot = swiss->capacity;
+    }
+    else
+    {
+        swiss_slot_t *filled = &swiss->slots[slot];
+        if (SWISS_CTRL_EMPTY == swiss->ctrl[slot])
+        {
+            swiss->growth_left--;
+        }
+        if (NULL == key_copy)
+        {
+            memcpy(filled->key_inline, key, len);
+            filled->key_inline[len] = '\0';
+            key_copy = filled->key_inline;
+        }
+        swiss->ctrl[slot] = (int8_t)(hash & 0x7f);
+        filled->key = key_copy;
+        filled->data = data;
+        filled->hash = hash;
+        filled->key_len = len;
+        swiss->count++;
+    }
+
+    return slot;
+}
+
+/**
+ * @brief stores data in the first free slot on the key's probe sequence
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int exit code
+ */
+static int swiss_add(hash_table_t *table, void *data, const char *key,
+                     uint32_t len, uint64_t hash)
+{
+    int status = SUCCESS;
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    uint32_t slot = swiss_insert(table, data, key, len, hash,
+                                 swiss_find_free(swiss, hash));
+
+    if (slot == swiss->capacity)
+    {
+        status = FAILURE;
+    }
+
+    return status;
+}
+
+/**
+ * @brief returns the data slot of key, filling the free slot found by the
+ *        same probe when key is not present
+ *
+ * @param table pointer to table address
+ * @param key key for data to be stored at
+ * @param len number of bytes in key
+ * @param hash hash of key
+ * @param data data to store when key is not present
+ * @param inserted set to non-zero when key was added
+ *
+ * @return pointer to the slot's data, NULL on allocation failure
+ */
+static void **swiss_upsert(hash_table_t *table, const char *key, uint32_t len,
+                           uint64_t hash, void *data, int *inserted)
+{
+    void **value = NULL;
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    uint32_t free_slot = swiss->capacity;
+    uint32_t slot = swiss_find(swiss, key, len, hash, &free_slot, NULL);
+
+    *inserted = 0;
+    if (slot == swiss->capacity)
+    {
+        slot = swiss_insert(table, data, key, len, hash, free_slot);
+        *inserted = slot != swiss->capacity;
+    }
+    if (slot != swiss->capacity)
+    {
+        value = &swiss->slots[slot].data;
+    }
+
+    return value;
+}
+
+/**
+ * @brief looks up key through the control bytes of its probe sequence
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return void * data
+ */
+static void *swiss_lookup(hash_table_t *table, const char *key, uint32_t len,
+                          uint64_t hash)
+{
+    void *data = NULL;
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    uint32_t groups = 0;
+    uint32_t slot = swiss_find(swiss, key, len, hash, NULL, &groups);
+
+    if (slot != swiss->capacity)
+    {
+        data = swiss->slots[slot].data;
+    }
+    hash_table_count_lookups(table, 1, slot != swiss->capacity, groups);
+
+    return data;
+}
+
+/**
+ * @brief looks up a group of keys in stages: every first probe group's
+ *        control bytes are prefetched, then the first matching slot of each,
+ *        then that slot's key when it is too long to be stored inline,
+ *        before the probes are run
+ *
+ * @param table pointer to table address
+ * @param keys keys being searched for
+ * @param lens number of bytes in each key
+ * @param hashes hash of each key
+ * @param n number of keys, at most HASH_TABLE_BATCH
+ * @param out data stored at each key, NULL when missing
+ */
+static void swiss_lookup_batch(hash_table_t *table, const char *const *keys,
+                               const uint32_t *lens, const uint64_t *hashes,
+                               uint32_t n, void **out)
+{
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    uint32_t group_mask = swiss->capacity / SWISS_GROUP_WIDTH - 1;
+    uint32_t first[HASH_TABLE_BATCH];
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        uint32_t group = (uint32_t)(hashes[x] >> 7) & group_mask;
+        __builtin_prefetch(swiss->ctrl + group * SWISS_GROUP_WIDTH);
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        uint32_t group = (uint32_t)(hashes[x] >> 7) & group_mask;
+        int8_t h2 = (int8_t)(hashes[x] & 0x7f);
+        uint32_t match =
+            swiss_group_match(swiss->ctrl + group * SWISS_GROUP_WIDTH, h2);
+        first[x] = swiss->capacity;
+        if (0 != match)
+        {
+            first[x] = group * SWISS_GROUP_WIDTH +
+                       (uint32_t)__builtin_ctz(match);
+            __builtin_prefetch(&swiss->slots[first[x]]);
+        }
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        if (first[x] != swiss->capacity &&
+            swiss->slots[first[x]].key_len >= SWISS_INLINE_KEY)
+        {
+            __builtin_prefetch(swiss->slots[first[x]].key);
+        }
+    }
+    for (uint32_t x = 0; x < n; x++)
+    {
+        out[x] = swiss_lookup(table, keys[x], lens[x], hashes[x]);
+    }
+}
+
+/**
+ * @brief frees the slot holding key
+ *
+ * The slot goes back to empty when its group still has an empty slot, since
+ * no probe sequence can have passed through such a group. Otherwise it is
+ * marked deleted so later probes keep walking past it.
+ *
+ * @param table pointer to table address
+ * @param key key of data to be removed
+ * @param len number of bytes in key
+ * @param hash hash of key
+ *
+ * @return int
+ */
+static int swiss_remove(hash_table_t *table, const char *key, uint32_t len,
+                        uint64_t hash)
+{
+    int status = SUCCESS;
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    uint32_t slot = swiss_find(swiss, key, len, hash, NULL, NULL);
+
+    if (slot == swiss->capacity)
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        const int8_t *group = swiss->ctrl + (slot & ~(SWISS_GROUP_WIDTH - 1));
+        swiss_key_free(table, &swiss->slots[slot]);
+        if (0 != swiss_group_match(group, SWISS_CTRL_EMPTY))
+        {
+            swiss->ctrl[slot] = SWISS_CTRL_EMPTY;
+            swiss->growth_left++;
+        }
+        else
+        {
+            swiss->ctrl[slot] = SWISS_CTRL_DELETED;
+        }
+        swiss->count--;
+    }
+
+    return status;
+}
+
+/**
+ * @brief visits every key whose probe sequence starts at the group the
+ *        cursor points at
+ *
+ * Treating a key's home group as its bucket gives the swiss engine the
+ * same resize behaviour as chaining: a key keeps the low bits of its home
+ * group when the group count doubles or halves. Such keys always sit
+ * before the first group of their probe sequence with an empty slot, so
+ * only that stretch is walked, checking each slot's hash for its home
+ * group.
+ *
+ * @param table pointer to table address
+ * @param cursor current cursor
+ * @param callback function called for every visited entry
+ * @param context pointer passed through to callback
+ * @param emitted incremented for every visited entry
+ *
+ * @return next cursor, 0 once every group was visited
+ */
+static uint64_t swiss_scan(hash_table_t *table, uint64_t cursor,
+                           HASH_SCAN_F callback, void *context,
+                           uint32_t *emitted)
+{
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    uint32_t group_mask = swiss->capacity / SWISS_GROUP_WIDTH - 1;
+    uint32_t home = (uint32_t)cursor & group_mask;
+    uint32_t group = home;
+
+    for (uint32_t step = 1; step <= group_mask + 1; step++)
+    {
+        const int8_t *ctrl = swiss->ctrl + group * SWISS_GROUP_WIDTH;
+        for (uint32_t x = 0; x < SWISS_GROUP_WIDTH; x++)
+        {
+            swiss_slot_t *slot = &swiss->slots[group * SWISS_GROUP_WIDTH + x];
+            if (ctrl[x] < 0)
+            {
+                continue;
+            }
+
+            if (((uint32_t)(slot->hash >> 7) & group_mask) == home)
+            {
+                callback(slot->key, slot->key_len, slot->data, context);
+                (*emitted)++;
+            }
+        }
+
+        if (0 != swiss_group_match(ctrl, SWISS_CTRL_EMPTY))
+        {
+            break;
+        }
+        group = (group + step) & group_mask;
+    }
+
+    return hash_table_cursor_next(cursor, group_mask);
+}
+
+/**
+ * @brief frees every key and marks every slot empty
+ *
+ * @param table pointer to table address
+ */
+static void swiss_clear(hash_table_t *table)
+{
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+
+    // arena keys are released by hash_table_clear without visiting slots
+    for (uint32_t x = 0; NULL == table->key_arena && x < swiss->capacity; x++)
+    {
+        if (swiss->ctrl[x] >= 0)
+        {
+            swiss_key_free(table, &swiss->slots[x]);
+        }
+    }
+    memset(swiss->ctrl, SWISS_CTRL_EMPTY, swiss->capacity);
+    swiss->count = 0;
+    swiss->growth_left = swiss_max_load(swiss->capacity);
+}
+
+/**
+ * @brief reports how many groups past its home group every key sits
+ *
+ * @param table pointer to table address
+ * @param out stats being filled in
+ */
+static void swiss_stats(hash_table_t *table, hash_table_stats_t *out)
+{
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+    uint32_t group_mask = swiss->capacity / SWISS_GROUP_WIDTH - 1;
+
+    for (uint32_t x = 0; x < swiss->capacity; x++)
+    {
+        if (swiss->ctrl[x] >= 0)
+        {
+            uint32_t group =
+                (uint32_t)(swiss->slots[x].hash >> 7) & group_mask;
+            uint32_t distance = 0;
+
+            // replay the probe sequence up to the key's group
+            while (group != x / SWISS_GROUP_WIDTH)
+            {
+                distance++;
+                group = (group + distance) & group_mask;
+            }
+            hash_table_stats_record(out, distance, 1);
+            if (swiss->slots[x].key_len >= SWISS_INLINE_KEY)
+            {
+                out->bytes_used += swiss->slots[x].key_len + 1U;
+            }
+        }
+    }
+    out->buckets = swiss->capacity;
+    out->bytes_used += sizeof(swiss_table_t) +
+                       swiss->capacity * (1 + sizeof(swiss_slot_t));
+}
+
+/**
+ * @brief frees the swiss storage
+ *
+ * @param table pointer to table address
+ */
+static void swiss_destroy(hash_table_t *table)
+{
+    swiss_table_t *swiss = (swiss_table_t *)table->engine_data;
+
+    swiss_clear(table);
+    free(swiss->ctrl);
+    free(swiss->slots);
+    free(swiss);
+    table->engine_data = NULL;
+}
+
+const hash_engine_ops_t swiss_engine_ops = {
+    .init = swiss_init,
+    .add = swiss_add,
+    .lookup = swiss_lookup,
+    .remove = swiss_remove,
+    .clear = swiss_clear,
+    .destroy = swiss_destroy,
+    .lookup_batch = swiss_lookup_batch,
+    .upsert = swiss_upsert,
+    .scan = swiss_scan,
+    .stats = swiss_stats,
+};
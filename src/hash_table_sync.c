@@ -0,0 +1,236 @@
+#include <hash_table.h>
+#include <pthread.h>
+#include "hash_table_internal.h"
+
+#define CACHE_LINE 64
+
+/**
+ * @brief one lock stripe, padded to its own cache line so threads working
+ *        on different stripes never share a line
+ *
+ * @param lock      mutex guarding every bucket that maps to this stripe
+ * @param count     number of entries stored in this stripe's buckets
+ */
+typedef struct hash_stripe_t
+{
+    _Alignas(CACHE_LINE) pthread_mutex_t lock;
+    uint32_t count;
+} hash_stripe_t;
+
+/**
+ * @brief lock stripes of a striped table
+ *
+ * Bucket b is guarded by stripe b & (count - 1). Because the bucket count
+ * never drops below the stripe count, and both are powers of two, every
+ * key of a bucket maps to the same stripe before and after a resize.
+ *
+ * @param stripes   the lock stripes
+ * @param count     number of stripes, a power of two
+ */
+typedef struct stripe_set_t
+{
+    hash_stripe_t *stripes;
+    uint32_t count;
+} stripe_set_t;
+
+/**
+ * @brief allocates the lock stripes of a striped table
+ *
+ * @param table pointer to table address
+ * @param stripes number of stripes, a power of two
+ *
+ * @return int exit code
+ */
+int hash_table_sync_init(hash_table_t *table, uint32_t stripes)
+{
+    int status = SUCCESS;
+    stripe_set_t *sync = (stripe_set_t *)calloc(1, sizeof(stripe_set_t));
+
+    if (NULL != sync)
+    {
+        sync->stripes = (hash_stripe_t *)aligned_alloc(
+            CACHE_LINE, stripes * sizeof(hash_stripe_t));
+    }
+
+    if (NULL == sync || NULL == sync->stripes)
+    {
+        free(sync);
+        status = FAILURE;
+    }
+    else
+    {
+        sync->count = stripes;
+        for (uint32_t x = 0; x < stripes; x++)
+        {
+            pthread_mutex_init(&sync->stripes[x].lock, NULL);
+            sync->stripes[x].count = 0;
+        }
+        table->sync_data = sync;
+    }
+
+    return status;
+}
+
+/**
+ * @brief frees the lock stripes of a striped table
+ *
+ * @param table pointer to table address
+ */
+void hash_table_sync_destroy(hash_table_t *table)
+{
+    stripe_set_t *sync = (stripe_set_t *)table->sync_data;
+
+    if (NULL != sync)
+    {
+        for (uint32_t x = 0; x < sync->count; x++)
+        {
+            pthread_mutex_destroy(&sync->stripes[x].lock);
+        }
+        free(sync->stripes);
+        free(sync);
+        table->sync_data = NULL;
+    }
+}
+
+/**
+ * @brief locks every stripe in index order and refreshes table->count
+ *
+ * @param table pointer to table address
+ */
+void hash_table_sync_lock_all(hash_table_t *table)
+{
+    stripe_set_t *sync = (stripe_set_t *)table->sync_data;
+    uint32_t total = 0;
+
+    for (uint32_t x = 0; x < sync->count; x++)
+    {
+        pthread_mutex_lock(&sync->stripes[x].lock);
+        total += sync->stripes[x].count;
+    }
+    table->count = total;
+}
+
+/**
+ * @brief unlocks every stripe locked by hash_table_sync_lock_all
+ *
+ * @param table pointer to table address
+ */
+void hash_table_sync_unlock_all(hash_table_t *table)
+{
+    stripe_set_t *sync = (stripe_set_t *)table->sync_data;
+
+    for (uint32_t x = sync->count; x > 0; x--)
+    {
+        pthread_mutex_unlock(&sync->stripes[x - 1].lock);
+    }
+}
+
+/**
+ * @brief zeroes every stripe's entry count after the table was cleared
+ *        under hash_table_sync_lock_all
+ *
+ * @param table pointer to table address
+ */
+void hash_table_sync_clear_counts(hash_table_t *table)
+{
+    stripe_set_t *sync = (stripe_set_t *)table->sync_data;
+
+    for (uint32_t x = 0; x < sync->count; x++)
+    {
+        sync->stripes[x].count = 0;
+    }
+}
+
+/**
+ * @brief resizes a striped table under every stripe lock when its exact
+ *        entry count has left the configured load factor range
+ *
+ * @param table pointer to table address
+ */
+static void hash_table_sync_resize(hash_table_t *table)
+{
+    uint32_t new_size = 0;
+
+    hash_table_sync_lock_all(table);
+
+    new_size = table->size;
+    while (table->count > new_size * table->max_load_factor &&
+           new_size <= UINT32_MAX / 2)
+    {
+        new_size *= 2;
+    }
+    if (new_size == table->size &&
+        table->count < table->size * table->min_load_factor)
+    {
+        while (new_size / 2 >= table->min_size &&
+               table->count < (new_size / 2) * table->max_load_factor / 2)
+        {
+            new_size /= 2;
+        }
+    }
+
+    if (new_size != table->size)
+    {
+        hash_table_chained_resize(table, new_size);
+    }
+
+    hash_table_sync_unlock_all(table);
+}
+
+/**
+ * @brief locks the stripe guarding hash
+ *
+ * @param table pointer to table address
+ * @param hash hash of the key about to be accessed
+ *
+ * @return stripe index to pass to hash_table_sync_unlock
+ */
+uint32_t hash_table_sync_lock(hash_table_t *table, uint64_t hash)
+{
+    stripe_set_t *sync = (stripe_set_t *)table->sync_data;
+    uint32_t stripe = (uint32_t)hash & (sync->count - 1);
+
+    pthread_mutex_lock(&sync->stripes[stripe].lock);
+
+    return stripe;
+}
+
+/**
+ * @brief applies an entry count change to a stripe and unlocks it
+ *
+ * Resizing is checked only when the stripe's count crosses its share of
+ * the growth or shrink threshold, so a table that stays within its load
+ * factor range never takes more than one lock per operation.
+ *
+ * @param table pointer to table address
+ * @param stripe stripe index returned by hash_table_sync_lock
+ * @param delta change in the number of entries, -1, 0 or 1
+ */
+void hash_table_sync_unlock(hash_table_t *table, uint32_t stripe, int delta)
+{
+    stripe_set_t *sync = (stripe_set_t *)table->sync_data;
+    hash_stripe_t *locked = &sync->stripes[stripe];
+    double share = (double)table->size / sync->count;
+    uint32_t before = locked->count;
+    int resize = 0;
+
+    locked->count += delta;
+    if (delta > 0)
+    {
+        double limit = share * table->max_load_factor;
+        resize = before <= limit && locked->count > limit;
+    }
+    else if (delta < 0)
+    {
+        double limit = share * table->min_load_factor;
+        resize = before >= limit && locked->count < limit &&
+                 table->size / 2 >= table->min_size;
+    }
+
+    pthread_mutex_unlock(&locked->lock);
+
+    if (resize)
+    {
+        hash_table_sync_resize(table);
+    }
+}
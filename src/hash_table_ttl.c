@@ -0,0 +1,362 @@
+#include <hash_table.h>
+#include <arena.h>
+#include <time.h>
+#include "hash_table_internal.h"
+
+#define TTL_TIMERS_PER_CHUNK 1024
+#define TTL_MAX_TICKS 0x7fffffffU
+#define TTL_SLOT_MASK (HASH_TTL_SLOTS - 1)
+
+/**
+ * @brief reads the monotonic clock
+ *
+ * @return milliseconds since an arbitrary point
+ */
+static uint64_t ttl_clock_ms(void)
+{
+    struct timespec now = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief pushes a timer onto a slot
+ *
+ * @param ttl pointer to wheel address
+ * @param level level of the slot
+ * @param slot index of the slot within its level
+ * @param timer timer to push
+ */
+static inline void ttl_push(hash_ttl_t *ttl, uint32_t level, uint32_t slot,
+                            hash_timer_t *timer)
+{
+    timer->next = ttl->slots[level][slot];
+    ttl->slots[level][slot] = timer;
+    ttl->occupied[level][slot / 64] |= 1ULL << (slot % 64);
+}
+
+/**
+ * @brief takes every timer off a slot
+ *
+ * @param ttl pointer to wheel address
+ * @param level level of the slot
+ * @param slot index of the slot within its level
+ *
+ * @return list of the slot's timers
+ */
+static inline hash_timer_t *ttl_take(hash_ttl_t *ttl, uint32_t level,
+                                     uint32_t slot)
+{
+    hash_timer_t *timers = ttl->slots[level][slot];
+
+    ttl->slots[level][slot] = NULL;
+    ttl->occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+    return timers;
+}
+
+/**
+ * @brief files a timer under the lowest level whose span covers the
+ *        distance from now to its tick
+ *
+ * Overdue timers go to the slot of now, which fires next.
+ *
+ * @param ttl pointer to wheel address
+ * @param timer timer to place
+ */
+static void ttl_place(hash_ttl_t *ttl, hash_timer_t *timer)
+{
+    uint32_t expires = timer->expires;
+    uint32_t distance = expires - ttl->now;
+    uint32_t level = 0;
+
+    if ((int32_t)distance < 0)
+    {
+        expires = ttl->now;
+        distance = 0;
+    }
+    while (level + 1 < HASH_TTL_LEVELS &&
+           distance >= 1U << (HASH_TTL_SLOT_BITS * (level + 1)))
+    {
+        level++;
+    }
+
+    ttl_push(ttl, level,
+             (expires >> (HASH_TTL_SLOT_BITS * level)) & TTL_SLOT_MASK, timer);
+}
+
+/**
+ * @brief returns a timer to the slab
+ *
+ * @param ttl pointer to wheel address
+ * @param timer timer to release
+ */
+static inline void ttl_release(hash_ttl_t *ttl, hash_timer_t *timer)
+{
+    slab_free(ttl->slab, timer);
+    ttl->timers--;
+}
+
+/**
+ * @brief distance from a level 0 slot to the next non-empty one, or to the
+ *        end of the level when there is none
+ *
+ * @param ttl pointer to wheel address
+ * @param slot level 0 slot to start after
+ *
+ * @return number of ticks to the next slot worth visiting
+ */
+static uint32_t ttl_next_slot(const hash_ttl_t *ttl, uint32_t slot)
+{
+    uint32_t next = slot + 1;
+
+    while (next < HASH_TTL_SLOTS)
+    {
+        uint64_t bits = ttl->occupied[0][next / 64] >> (next % 64);
+        if (0 != bits)
+        {
+            next += (uint32_t)__builtin_ctzll(bits);
+            break;
+        }
+        next = (next / 64 + 1) * 64;
+    }
+
+    return next - slot;
+}
+
+/**
+ * @brief takes the slots of every level now has just reached the start of,
+ *        so their timers are placed again closer to level 0
+ *
+ * @param ttl pointer to wheel address
+ */
+static void ttl_cascade(hash_ttl_t *ttl)
+{
+    for (uint32_t level = 1;
+         level < HASH_TTL_LEVELS &&
+         0 == (ttl->now & ((1U << (HASH_TTL_SLOT_BITS * level)) - 1));
+         level++)
+    {
+        ttl->cascade[level] = ttl_take(
+            ttl, level,
+            (ttl->now >> (HASH_TTL_SLOT_BITS * level)) & TTL_SLOT_MASK);
+    }
+}
+
+/**
+ * @brief allocates an empty timer wheel starting at tick 0
+ *
+ * @param tick_ms milliseconds per tick
+ *
+ * @return hash_ttl_t pointer, NULL on allocation failure
+ */
+hash_ttl_t *hash_table_ttl_init(uint32_t tick_ms)
+{
+    hash_ttl_t *ttl = (hash_ttl_t *)calloc(1, sizeof(hash_ttl_t));
+
+    if (NULL != ttl)
+    {
+        ttl->tick_ms = tick_ms;
+        ttl->epoch_ms = ttl_clock_ms();
+        ttl->slab = slab_init(sizeof(hash_timer_t), TTL_TIMERS_PER_CHUNK);
+        if (NULL == ttl->slab)
+        {
+            free(ttl);
+            ttl = NULL;
+        }
+    }
+
+    return ttl;
+}
+
+/**
+ * @brief frees a timer wheel and every timer in it
+ *
+ * @param ttl_addr pointer to wheel address
+ */
+void hash_table_ttl_destroy(hash_ttl_t **ttl_addr)
+{
+    if (NULL != ttl_addr && NULL != *ttl_addr)
+    {
+        slab_destroy(&(*ttl_addr)->slab);
+        free(*ttl_addr);
+        *ttl_addr = NULL;
+    }
+}
+
+/**
+ * @brief drops every timer, for a table being cleared
+ *
+ * @param ttl pointer to wheel address
+ */
+void hash_table_ttl_clear(hash_ttl_t *ttl)
+{
+    if (NULL != ttl)
+    {
+        slab_clear(ttl->slab);
+        memset(ttl->slots, 0, sizeof(ttl->slots));
+        memset(ttl->occupied, 0, sizeof(ttl->occupied));
+        memset(ttl->cascade, 0, sizeof(ttl->cascade));
+        ttl->timers = 0;
+    }
+}
+
+/**
+ * @brief current tick of the monotonic clock
+ *
+ * @param ttl pointer to wheel address
+ *
+ * @return ticks since the wheel was created, wrapping around
+ */
+uint32_t hash_table_ttl_tick(const hash_ttl_t *ttl)
+{
+    return (uint32_t)((ttl_clock_ms() - ttl->epoch_ms) / ttl->tick_ms);
+}
+
+/**
+ * @brief tick an entry added now with a TTL expires at
+ *
+ * The current tick has partly gone by already, so one tick more than the
+ * TTL rounded up makes sure the entry lives at least ttl_ms.
+ *
+ * @param ttl pointer to wheel address
+ * @param ttl_ms lifetime in milliseconds, non-zero
+ *
+ * @return expiry tick, never 0
+ */
+uint32_t hash_table_ttl_deadline(const hash_ttl_t *ttl, uint32_t ttl_ms)
+{
+    uint64_t ticks = ((uint64_t)ttl_ms + ttl->tick_ms - 1) / ttl->tick_ms + 1;
+    uint32_t expires = hash_table_ttl_tick(ttl) +
+                       (uint32_t)(ticks < TTL_MAX_TICKS ? ticks :
+                                                          TTL_MAX_TICKS);
+
+    return 0 != expires ? expires : 1;
+}
+
+/**
+ * @brief sets the expiry tick of an entry, arming a timer when none due by
+ *        then is pending
+ *
+ * An entry with a TTL always has a timer due no later than its expiry, so
+ * restarting a TTL to a later tick costs no allocation: the old timer is
+ * placed again when it fires.
+ *
+ * @param ttl pointer to wheel address
+ * @param node entry to schedule
+ * @param expires expiry tick, 0 to take the entry's TTL away
+ *
+ * @return int exit code, the entry keeps its old expiry on failure
+ */
+int hash_table_ttl_schedule(hash_ttl_t *ttl, node_t *node, uint32_t expires)
+{
+    int status = SUCCESS;
+    uint32_t previous = node->expires;
+
+    if (0 != expires &&
+        (0 == previous || (int32_t)(expires - previous) < 0))
+    {
+        hash_timer_t *timer = (hash_timer_t *)slab_alloc(ttl->slab);
+        if (NULL == timer)
+        {
+            status = FAILURE;
+        }
+        else
+        {
+            timer->node = node;
+            timer->expires = expires;
+            ttl_place(ttl, timer);
+            ttl->timers++;
+        }
+    }
+
+    if (SUCCESS == status)
+    {
+        node->expires = expires;
+    }
+
+    return status;
+}
+
+/**
+ * @brief advances the wheel towards the current tick until an expired
+ *        entry turns up
+ *
+ * Every placed, dropped or fired timer and every move of now costs one
+ * unit of budget. Empty level 0 slots are skipped by their bitmap, so a
+ * move of now covers every tick up to the next timer or the next slot of
+ * level 1.
+ *
+ * @param ttl pointer to wheel address
+ * @param budget units of work left, decremented for the work done
+ *
+ * @return an expired entry for the caller to unlink and free, NULL once
+ *         the wheel has caught up or the budget is spent
+ */
+node_t *hash_table_ttl_pop(hash_ttl_t *ttl, uint32_t *budget)
+{
+    node_t *due = NULL;
+    uint32_t target = hash_table_ttl_tick(ttl);
+    uint32_t level = 1;
+
+    while (NULL == due && 0 != *budget)
+    {
+        uint32_t slot = ttl->now & TTL_SLOT_MASK;
+
+        while (level < HASH_TTL_LEVELS && NULL == ttl->cascade[level])
+        {
+            level++;
+        }
+
+        if (level < HASH_TTL_LEVELS)
+        {
+            hash_timer_t *timer = ttl->cascade[level];
+            ttl->cascade[level] = timer->next;
+            ttl_place(ttl, timer);
+        }
+        else if (NULL != ttl->slots[0][slot])
+        {
+            hash_timer_t *timer = ttl->slots[0][slot];
+            node_t *node = timer->node;
+            ttl->slots[0][slot] = timer->next;
+            if (NULL == timer->next)
+            {
+                ttl->occupied[0][slot / 64] &= ~(1ULL << (slot % 64));
+            }
+
+            if (0 == node->expires)
+            {
+                // removed, or its TTL taken away
+                ttl_release(ttl, timer);
+            }
+            else if ((int32_t)(target - node->expires) >= 0)
+            {
+                ttl_release(ttl, timer);
+                due = node;
+            }
+            else
+            {
+                // the TTL was restarted since the timer was armed
+                timer->expires = node->expires;
+                ttl_place(ttl, timer);
+            }
+        }
+        else if (ttl->now != target)
+        {
+            uint32_t step = ttl_next_slot(ttl, slot);
+            ttl->now += step < target - ttl->now ? step : target - ttl->now;
+            if (0 == (ttl->now & TTL_SLOT_MASK))
+            {
+                ttl_cascade(ttl);
+                level = 1;
+            }
+        }
+        else
+        {
+            break;
+        }
+        (*budget)--;
+    }
+
+    return due;
+}
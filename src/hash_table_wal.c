@@ -0,0 +1,1265 @@
+#include <hash_table_wal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WAL_MAGIC 0x00314c4157544854ULL
+#define WAL_VERSION 1
+#define WAL_OP_ADD 1
+#define WAL_OP_REMOVE 2
+#define WAL_DEFAULT_INTERVAL_MS 10
+#define WAL_DEFAULT_BUFFER (1024 * 1024)
+#define WAL_DEFAULT_COMPACT_MIN (64ULL * 1024 * 1024)
+#define WAL_SCRATCH_SIZE 1024
+#define WAL_COPY_CHUNK (64 * 1024)
+#define WAL_TAIL_ROUNDS 4
+#define WAL_STOP_COMPACTOR 1
+#define WAL_STOP_WRITER 2
+
+/**
+ * @brief header at offset 0 of a log file
+ *
+ * @param magic         WAL_MAGIC
+ * @param version       WAL_VERSION
+ * @param value_size    bytes of data logged with every add
+ */
+typedef struct wal_header_t
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t value_size;
+} wal_header_t;
+
+/**
+ * @brief header of one log record, followed by the key bytes and, for an
+ *        add, the value bytes
+ *
+ * @param check     checksum of the rest of the record, so a record torn by
+ *                  a crash is recognized on replay
+ * @param op        WAL_OP_ADD or WAL_OP_REMOVE
+ * @param key_len   number of bytes in the key
+ * @param value_len number of value bytes, value_size for an add and 0 for
+ *                  a remove
+ */
+typedef struct wal_record_t
+{
+    uint32_t check;
+    uint32_t op;
+    uint32_t key_len;
+    uint32_t value_len;
+} wal_record_t;
+
+/**
+ * @brief surviving records of a log being compacted
+ *
+ * @param records   start of every surviving record in the mapped log
+ * @param count     number of records collected
+ */
+typedef struct wal_survivors_t
+{
+    const char **records;
+    uint32_t count;
+} wal_survivors_t;
+
+/**
+ * @brief checksum of a record, seeded with its header fields so a header
+ *        torn from its payload fails too
+ *
+ * @param record record header
+ * @param payload key bytes followed by value bytes
+ *
+ * @return 32 bit checksum
+ */
+static uint32_t wal_check(const wal_record_t *record, const char *payload)
+{
+    uint64_t seed[2] = {((uint64_t)record->key_len << 32) | record->op,
+                        WAL_MAGIC ^ record->value_len};
+
+    return (uint32_t)hash_func_wy(
+        payload, (size_t)record->key_len + record->value_len, seed);
+}
+
+/**
+ * @brief reads the record at offset of a log image
+ *
+ * @param image log bytes
+ * @param length number of bytes in image
+ * @param offset start of the record
+ * @param value_size value bytes of the log's adds
+ * @param record receives the record header
+ *
+ * @return size of the record, 0 when it is torn, corrupt or past the end
+ */
+static size_t wal_record_at(const char *image, size_t length, size_t offset,
+                            uint32_t value_size, wal_record_t *record)
+{
+    size_t size = 0;
+
+    if (offset <= length && length - offset >= sizeof(wal_record_t))
+    {
+        memcpy(record, image + offset, sizeof(wal_record_t));
+        uint64_t payload = (uint64_t)record->key_len + record->value_len;
+        if (((WAL_OP_ADD == record->op && value_size == record->value_len) ||
+             (WAL_OP_REMOVE == record->op && 0 == record->value_len)) &&
+            payload <= length - offset - sizeof(wal_record_t) &&
+            record->check ==
+                wal_check(record, image + offset + sizeof(wal_record_t)))
+        {
+            size = sizeof(wal_record_t) + (size_t)payload;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * @brief writes every byte of buffer, retrying short and interrupted
+ *        writes
+ *
+ * @return int exit code
+ */
+static int wal_write_all(int fd, const char *buffer, size_t size)
+{
+    int status = SUCCESS;
+
+    while (SUCCESS == status && size > 0)
+    {
+        ssize_t done = write(fd, buffer, size);
+        if (done > 0)
+        {
+            buffer += done;
+            size -= (size_t)done;
+        }
+        else if (done < 0 && EINTR != errno)
+        {
+            status = FAILURE;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief appends bytes [start, end) of one file to another
+ *
+ * @return int exit code
+ */
+static int wal_copy_range(int from, uint64_t start, uint64_t end, int to)
+{
+    int status = SUCCESS;
+    char *chunk = NULL;
+
+    if (start < end)
+    {
+        chunk = (char *)malloc(WAL_COPY_CHUNK);
+        status = NULL != chunk ? SUCCESS : FAILURE;
+    }
+    while (SUCCESS == status && start < end)
+    {
+        size_t want = end - start < WAL_COPY_CHUNK ? (size_t)(end - start) :
+                                                     WAL_COPY_CHUNK;
+        ssize_t got = pread(from, chunk, want, (off_t)start);
+        if (got > 0)
+        {
+            status = wal_write_all(to, chunk, (size_t)got);
+            start += (uint64_t)got;
+        }
+        else if (0 == got || EINTR != errno)
+        {
+            status = FAILURE;
+        }
+    }
+    free(chunk);
+
+    return status;
+}
+
+/**
+ * @brief path of the file a compaction writes before renaming it over the
+ *        log
+ *
+ * @return malloc'd path, NULL on allocation failure
+ */
+static char *wal_temporary(const char *path)
+{
+    char *temporary = (char *)malloc(strlen(path) + sizeof(".compact"));
+
+    if (NULL != temporary)
+    {
+        sprintf(temporary, "%s.compact", path);
+    }
+
+    return temporary;
+}
+
+/**
+ * @brief fsyncs the directory holding path, so a rename into it survives
+ *        a crash
+ *
+ * @return int exit code
+ */
+static int wal_sync_directory(const char *path)
+{
+    int status = FAILURE;
+    const char *slash = strrchr(path, '/');
+    char *directory = strdup(NULL != slash ? path : ".");
+
+    if (NULL != directory)
+    {
+        if (NULL != slash)
+        {
+            directory[slash - path + 1] = '\0';
+        }
+        int fd = open(directory, O_RDONLY);
+        if (fd >= 0)
+        {
+            status = 0 == fsync(fd) ? SUCCESS : FAILURE;
+            close(fd);
+        }
+        free(directory);
+    }
+
+    return status;
+}
+
+/**
+ * @brief copies logged value bytes into a malloc'd block, the default
+ *        WAL_LOAD_F
+ */
+static void *wal_load_copy(const void *value, uint32_t size, void *context)
+{
+    void *data = malloc(0 != size ? size : 1);
+
+    (void)context;
+    if (NULL != data && 0 != size)
+    {
+        memcpy(data, value, size);
+    }
+
+    return data;
+}
+
+/**
+ * @brief applies the records of a log image to the table
+ *
+ * Removed entries were created by the replay itself, so their data is
+ * released with the table's free function.
+ *
+ * @param wal pointer to log address
+ * @param image log bytes, starting with the header
+ * @param length number of bytes in image
+ * @param end receives the end of the last intact record
+ *
+ * @return int exit code
+ */
+static int wal_replay(hash_table_wal_t *wal, const char *image, size_t length,
+                      size_t *end)
+{
+    int status = SUCCESS;
+    size_t offset = sizeof(wal_header_t);
+    size_t size = 0;
+    wal_record_t record = {0};
+    WAL_LOAD_F load = NULL != wal->opts.load ? wal->opts.load : wal_load_copy;
+
+    while (SUCCESS == status &&
+           0 != (size = wal_record_at(image, length, offset,
+                                      wal->opts.value_size, &record)))
+    {
+        const char *key = image + offset + sizeof(wal_record_t);
+        if (WAL_OP_ADD == record.op)
+        {
+            void *data = load(key + record.key_len, record.value_len,
+                              wal->opts.load_context);
+            status = NULL != data ? hash_table_add_n(wal->table, data, key,
+                                                     record.key_len) :
+                                    FAILURE;
+            if (SUCCESS != status && NULL != data)
+            {
+                wal->table->customfree(data);
+            }
+        }
+        else
+        {
+            void *data = hash_table_lookup_n(wal->table, key, record.key_len);
+            if (SUCCESS == hash_table_remove_n(wal->table, key,
+                                               record.key_len))
+            {
+                wal->table->customfree(data);
+            }
+        }
+        offset += size;
+    }
+    *end = offset;
+
+    return status;
+}
+
+/**
+ * @brief replays an existing log into the table and cuts off a torn tail,
+ *        or starts a new log
+ *
+ * @param wal pointer to log address
+ *
+ * @return int exit code
+ */
+static int wal_recover(hash_table_wal_t *wal)
+{
+    int status = SUCCESS;
+    struct stat info = {0};
+    wal_header_t header = {WAL_MAGIC, WAL_VERSION, wal->opts.value_size};
+    size_t end = sizeof(wal_header_t);
+
+    if (0 != fstat(wal->fd, &info))
+    {
+        status = FAILURE;
+    }
+    else if ((size_t)info.st_size < sizeof(wal_header_t))
+    {
+        // nothing logged yet, or a crash while the header was written
+        if (0 != ftruncate(wal->fd, 0) ||
+            SUCCESS != wal_write_all(wal->fd, (const char *)&header,
+                                     sizeof(header)) ||
+            0 != fsync(wal->fd))
+        {
+            status = FAILURE;
+        }
+    }
+    else
+    {
+        const char *image = (const char *)mmap(NULL, (size_t)info.st_size,
+                                               PROT_READ, MAP_PRIVATE,
+                                               wal->fd, 0);
+        if (MAP_FAILED == image)
+        {
+            status = FAILURE;
+        }
+        else
+        {
+            memcpy(&header, image, sizeof(header));
+            status = WAL_MAGIC == header.magic &&
+                             WAL_VERSION == header.version &&
+                             wal->opts.value_size == header.value_size ?
+                         wal_replay(wal, image, (size_t)info.st_size, &end) :
+                         FAILURE;
+            munmap((void *)image, (size_t)info.st_size);
+        }
+        if (SUCCESS == status && end < (size_t)info.st_size &&
+            (0 != ftruncate(wal->fd, (off_t)end) || 0 != fsync(wal->fd)))
+        {
+            status = FAILURE;
+        }
+    }
+
+    wal->file_bytes = end;
+    wal->compacted_bytes = end;
+
+    return status;
+}
+
+/**
+ * @brief writes the buffered records out, swapping in the spare buffer so
+ *        appends carry on meanwhile
+ *
+ * Called by the writer with the lock held; the lock is released while
+ * the records are written and fsynced.
+ *
+ * @param wal pointer to log address
+ */
+static void wal_flush(hash_table_wal_t *wal)
+{
+    char *records = wal->buffer;
+    size_t size = wal->used;
+    size_t capacity = wal->capacity;
+    uint64_t target = wal->appended;
+    int sync = wal->sync_requested || WAL_FSYNC_NONE != wal->opts.fsync;
+    int status = SUCCESS;
+
+    wal->buffer = wal->spare;
+    wal->capacity = wal->spare_capacity;
+    wal->spare = records;
+    wal->spare_capacity = capacity;
+    wal->used = 0;
+    wal->sync_requested = 0;
+    pthread_cond_broadcast(&wal->flushed);
+    pthread_mutex_unlock(&wal->lock);
+
+    status = wal_write_all(wal->fd, records, size);
+    if (SUCCESS == status && sync && 0 != fdatasync(wal->fd))
+    {
+        status = FAILURE;
+    }
+
+    pthread_mutex_lock(&wal->lock);
+    if (SUCCESS == status)
+    {
+        wal->written = target;
+        wal->file_bytes += size;
+        if (sync)
+        {
+            wal->synced = target;
+        }
+    }
+    else if (!wal->error)
+    {
+        wal->error = 1;
+        wal->rollback = wal->appended;
+    }
+    pthread_cond_broadcast(&wal->flushed);
+}
+
+/**
+ * @brief replaces the log with the file a compaction prepared, after
+ *        copying the records written since the compaction's last copy
+ *
+ * Called by the writer with the lock held, so no other write to the log
+ * is in flight; the lock is released while the records are copied.
+ *
+ * @param wal pointer to log address
+ */
+static void wal_swap(hash_table_wal_t *wal)
+{
+    int swap_fd = wal->swap_fd;
+    uint64_t from = wal->swap_from;
+    uint64_t to = wal->file_bytes;
+    char *temporary = wal_temporary(wal->path);
+    int status = NULL != temporary ? SUCCESS : FAILURE;
+
+    pthread_mutex_unlock(&wal->lock);
+    if (SUCCESS == status)
+    {
+        status = wal_copy_range(wal->fd, from, to, swap_fd);
+    }
+    if (SUCCESS == status &&
+        (0 != fsync(swap_fd) || 0 != rename(temporary, wal->path)))
+    {
+        status = FAILURE;
+    }
+    if (SUCCESS == status)
+    {
+        // the rename is in place either way, this only makes it durable
+        wal_sync_directory(wal->path);
+        close(wal->fd);
+    }
+    else
+    {
+        close(swap_fd);
+        if (NULL != temporary)
+        {
+            remove(temporary);
+        }
+    }
+    free(temporary);
+
+    pthread_mutex_lock(&wal->lock);
+    if (SUCCESS == status)
+    {
+        wal->fd = swap_fd;
+        wal->file_bytes = wal->swap_bytes + (to - from);
+        wal->compacted_bytes = wal->file_bytes;
+    }
+    wal->swap_fd = -1;
+    wal->swap_status = status;
+    pthread_cond_broadcast(&wal->flushed);
+}
+
+/**
+ * @brief writer thread: flushes the buffer every flush_interval_ms, or as
+ *        soon as an append, a sync or a compaction asks for it
+ */
+static void *wal_writer(void *arg)
+{
+    hash_table_wal_t *wal = (hash_table_wal_t *)arg;
+    struct timespec deadline = {0};
+
+    pthread_mutex_lock(&wal->lock);
+    while (WAL_STOP_WRITER != wal->stop || 0 != wal->used ||
+           wal->sync_requested)
+    {
+        if (0 == wal->used && !wal->sync_requested && -1 == wal->swap_fd &&
+            WAL_STOP_WRITER != wal->stop)
+        {
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)wal->opts.flush_interval_ms * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&wal->wake, &wal->lock, &deadline);
+        }
+        if (-1 != wal->swap_fd)
+        {
+            wal_swap(wal);
+        }
+        if (wal->error)
+        {
+            // the callers of buffered records fail and undo their changes
+            wal->used = 0;
+            wal->sync_requested = 0;
+        }
+        else if (0 != wal->used || wal->sync_requested)
+        {
+            wal_flush(wal);
+        }
+    }
+    pthread_mutex_unlock(&wal->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief scan callback collecting the record pointers of a scratch table
+ */
+static void wal_survivor(const char *key, uint32_t len, void *data,
+                         void *context)
+{
+    wal_survivors_t *survivors = (wal_survivors_t *)context;
+
+    (void)key;
+    (void)len;
+    survivors->records[survivors->count++] = (const char *)data;
+}
+
+/**
+ * @brief orders record pointers by their position in the log
+ */
+static int wal_compare_records(const void *left, const void *right)
+{
+    const char *a = *(const char *const *)left;
+    const char *b = *(const char *const *)right;
+
+    return (a > b) - (a < b);
+}
+
+/**
+ * @brief replays the first length bytes of the log into a scratch table
+ *        mapping every live key to its add record, and writes those
+ *        records, in log order, to a new file
+ *
+ * @param wal pointer to log address
+ * @param image log bytes
+ * @param length number of bytes of image already written when the
+ *               compaction started
+ * @param out new log file
+ * @param bytes receives the number of bytes written to out
+ *
+ * @return int exit code
+ */
+static int wal_rewrite(hash_table_wal_t *wal, const char *image,
+                       size_t length, FILE *out, uint64_t *bytes)
+{
+    int status = SUCCESS;
+    hash_table_t *scratch = hash_table_init(WAL_SCRATCH_SIZE, NULL);
+    wal_header_t header = {WAL_MAGIC, WAL_VERSION, wal->opts.value_size};
+    wal_survivors_t survivors = {0};
+    wal_record_t record = {0};
+    size_t offset = sizeof(wal_header_t);
+    size_t size = 0;
+    uint64_t cursor = 0;
+
+    status = NULL != scratch ? SUCCESS : FAILURE;
+    while (SUCCESS == status && offset < length)
+    {
+        size = wal_record_at(image, length, offset, wal->opts.value_size,
+                             &record);
+        const char *key = image + offset + sizeof(wal_record_t);
+        if (0 == size)
+        {
+            status = FAILURE;
+        }
+        else if (WAL_OP_ADD == record.op)
+        {
+            status = hash_table_add_n(scratch, (void *)(image + offset), key,
+                                      record.key_len);
+        }
+        else
+        {
+            hash_table_remove_n(scratch, key, record.key_len);
+        }
+        offset += size;
+    }
+
+    if (SUCCESS == status)
+    {
+        survivors.records = (const char **)malloc(
+            ((size_t)scratch->count + 1) * sizeof(const char *));
+        status = NULL != survivors.records ? SUCCESS : FAILURE;
+    }
+    if (SUCCESS == status)
+    {
+        do
+        {
+            cursor = hash_table_scan(scratch, cursor, UINT32_MAX,
+                                     wal_survivor, &survivors);
+        } while (0 != cursor);
+        qsort(survivors.records, survivors.count, sizeof(const char *),
+              wal_compare_records);
+
+        status = 1 == fwrite(&header, sizeof(header), 1, out) ? SUCCESS :
+                                                                 FAILURE;
+        *bytes = sizeof(header);
+    }
+    for (uint32_t x = 0; SUCCESS == status && x < survivors.count; x++)
+    {
+        size = wal_record_at(image, length,
+                             (size_t)(survivors.records[x] - image),
+                             wal->opts.value_size, &record);
+        status = 1 == fwrite(survivors.records[x], size, 1, out) ? SUCCESS :
+                                                                    FAILURE;
+        *bytes += size;
+    }
+
+    free(survivors.records);
+    hash_table_destroy(&scratch);
+
+    return status;
+}
+
+/**
+ * @brief compacts the log: rewrites the part already written when the
+ *        compaction started, copies what was written since in a few rounds
+ *        and hands the new file to the writer to finish and swap in
+ *
+ * @param wal pointer to log address
+ * @param prefix bytes in the log file when the compaction started
+ *
+ * @return int exit code
+ */
+static int wal_compact(hash_table_wal_t *wal, uint64_t prefix)
+{
+    int status = SUCCESS;
+    char *temporary = wal_temporary(wal->path);
+    int input = open(wal->path, O_RDONLY);
+    int output = -1;
+    const char *image = MAP_FAILED;
+    FILE *out = NULL;
+    uint64_t bytes = 0;
+    uint64_t copied = prefix;
+
+    if (NULL == temporary || input < 0)
+    {
+        status = FAILURE;
+    }
+    if (SUCCESS == status)
+    {
+        image = (const char *)mmap(NULL, (size_t)prefix, PROT_READ,
+                                   MAP_PRIVATE, input, 0);
+        out = fopen(temporary, "wb");
+        status = MAP_FAILED != image && NULL != out ? SUCCESS : FAILURE;
+    }
+    if (SUCCESS == status)
+    {
+        status = wal_rewrite(wal, image, (size_t)prefix, out, &bytes);
+    }
+    if (NULL != out && (0 != fclose(out) || SUCCESS != status))
+    {
+        status = FAILURE;
+    }
+
+    // records written while the log was being rewritten
+    if (SUCCESS == status)
+    {
+        // readable too, a later compaction's tail is copied out of it
+        output = open(temporary, O_RDWR | O_APPEND);
+        status = output >= 0 ? SUCCESS : FAILURE;
+    }
+    for (uint32_t round = 0; SUCCESS == status && round < WAL_TAIL_ROUNDS;
+         round++)
+    {
+        pthread_mutex_lock(&wal->lock);
+        uint64_t end = wal->file_bytes;
+        pthread_mutex_unlock(&wal->lock);
+        status = wal_copy_range(input, copied, end, output);
+        bytes += end - copied;
+        copied = end;
+    }
+
+    if (SUCCESS == status)
+    {
+        pthread_mutex_lock(&wal->lock);
+        wal->swap_fd = output;
+        wal->swap_from = copied;
+        wal->swap_bytes = bytes;
+        pthread_cond_signal(&wal->wake);
+        while (-1 != wal->swap_fd)
+        {
+            pthread_cond_wait(&wal->flushed, &wal->lock);
+        }
+        status = wal->swap_status;
+        pthread_mutex_unlock(&wal->lock);
+    }
+    else
+    {
+        if (output >= 0)
+        {
+            close(output);
+        }
+        if (NULL != temporary)
+        {
+            remove(temporary);
+        }
+    }
+
+    if (MAP_FAILED != image)
+    {
+        munmap((void *)image, (size_t)prefix);
+    }
+    if (input >= 0)
+    {
+        close(input);
+    }
+    free(temporary);
+
+    return status;
+}
+
+/**
+ * @brief compaction thread: compacts the log whenever asked to
+ */
+static void *wal_compactor(void *arg)
+{
+    hash_table_wal_t *wal = (hash_table_wal_t *)arg;
+
+    pthread_mutex_lock(&wal->lock);
+    while (0 == wal->stop)
+    {
+        if (wal->compact_completed == wal->compact_requested)
+        {
+            pthread_cond_wait(&wal->compact_wake, &wal->lock);
+        }
+        else
+        {
+            uint64_t ticket = wal->compact_requested;
+            uint64_t prefix = wal->file_bytes;
+            pthread_mutex_unlock(&wal->lock);
+            int status = wal_compact(wal, prefix);
+            pthread_mutex_lock(&wal->lock);
+            wal->compact_completed = ticket;
+            wal->compact_status = status;
+            wal->compactions += SUCCESS == status;
+            if (SUCCESS != status && prefix > wal->compacted_bytes)
+            {
+                // wait for the log to double again before the next try,
+                // instead of retrying on every append
+                wal->compacted_bytes = prefix;
+            }
+            pthread_cond_broadcast(&wal->compact_done);
+        }
+    }
+    pthread_mutex_unlock(&wal->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief releases a log whose threads are not running
+ *
+ * @param wal pointer to log address
+ */
+static void wal_free(hash_table_wal_t *wal)
+{
+    if (wal->fd >= 0)
+    {
+        close(wal->fd);
+    }
+    pthread_cond_destroy(&wal->compact_done);
+    pthread_cond_destroy(&wal->compact_wake);
+    pthread_cond_destroy(&wal->flushed);
+    pthread_cond_destroy(&wal->wake);
+    pthread_mutex_destroy(&wal->lock);
+    free(wal->spare);
+    free(wal->buffer);
+    free(wal->path);
+    free(wal);
+}
+
+/**
+ * @brief opens a write-ahead log for a table, replaying it first
+ *
+ * @param path log file
+ * @param table table to replay into and record changes of
+ * @param opts log options, NULL selects every default
+ *
+ * @return hash_table_wal_t pointer to the open log, NULL on failure or
+ *         when the file is not a log written with the same value_size
+ */
+hash_table_wal_t *hash_table_wal_open(const char *path, hash_table_t *table,
+                                      const hash_table_wal_opts_t *opts)
+{
+    hash_table_wal_t *wal = NULL;
+    int status = FAILURE;
+
+    if (NULL != path && NULL != table)
+    {
+        wal = (hash_table_wal_t *)calloc(1, sizeof(hash_table_wal_t));
+    }
+
+    if (NULL != wal)
+    {
+        if (NULL != opts)
+        {
+            wal->opts = *opts;
+        }
+        if (0 == wal->opts.flush_interval_ms)
+        {
+            wal->opts.flush_interval_ms = WAL_DEFAULT_INTERVAL_MS;
+        }
+        if (0 == wal->opts.buffer_size)
+        {
+            wal->opts.buffer_size = WAL_DEFAULT_BUFFER;
+        }
+        if (0 == wal->opts.compact_min_bytes)
+        {
+            wal->opts.compact_min_bytes = WAL_DEFAULT_COMPACT_MIN;
+        }
+        wal->table = table;
+        wal->swap_fd = -1;
+        pthread_mutex_init(&wal->lock, NULL);
+        pthread_cond_init(&wal->wake, NULL);
+        pthread_cond_init(&wal->flushed, NULL);
+        pthread_cond_init(&wal->compact_wake, NULL);
+        pthread_cond_init(&wal->compact_done, NULL);
+        wal->path = strdup(path);
+        wal->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+        wal->capacity = wal->opts.buffer_size;
+        wal->spare_capacity = wal->opts.buffer_size;
+        wal->buffer = (char *)malloc(wal->capacity);
+        wal->spare = (char *)malloc(wal->spare_capacity);
+        status = NULL != wal->path && wal->fd >= 0 && NULL != wal->buffer &&
+                         NULL != wal->spare ?
+                     wal_recover(wal) :
+                     FAILURE;
+    }
+
+    if (SUCCESS == status &&
+        0 != pthread_create(&wal->writer, NULL, wal_writer, wal))
+    {
+        status = FAILURE;
+    }
+    else if (SUCCESS == status &&
+             0 != pthread_create(&wal->compactor, NULL, wal_compactor, wal))
+    {
+        pthread_mutex_lock(&wal->lock);
+        wal->stop = WAL_STOP_WRITER;
+        pthread_cond_signal(&wal->wake);
+        pthread_mutex_unlock(&wal->lock);
+        pthread_join(wal->writer, NULL);
+        status = FAILURE;
+    }
+
+    if (NULL != wal && SUCCESS != status)
+    {
+        wal_free(wal);
+        wal = NULL;
+    }
+
+    return wal;
+}
+
+/**
+ * @brief waits, lock held, until the buffer has room for size more bytes,
+ *        growing it when a single record does not fit
+ *
+ * @param wal pointer to log address
+ * @param size bytes of the record about to be appended
+ *
+ * @return int exit code, FAILURE once the log has failed
+ */
+static int wal_reserve(hash_table_wal_t *wal, size_t size)
+{
+    int status = SUCCESS;
+
+    while (!wal->error && 0 != wal->used && wal->used + size > wal->capacity)
+    {
+        pthread_cond_signal(&wal->wake);
+        pthread_cond_wait(&wal->flushed, &wal->lock);
+    }
+
+    if (wal->error)
+    {
+        status = FAILURE;
+    }
+    else if (size > wal->capacity)
+    {
+        char *grown = (char *)realloc(wal->buffer, size);
+        if (NULL == grown)
+        {
+            status = FAILURE;
+        }
+        else
+        {
+            wal->buffer = grown;
+            wal->capacity = size;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief appends a record to the reserved buffer, lock held, and wakes the
+ *        writer or the compaction thread when they are due
+ *
+ * @param wal pointer to log address
+ * @param op WAL_OP_ADD or WAL_OP_REMOVE
+ * @param key key bytes
+ * @param len number of bytes in key
+ * @param data data whose first value_size bytes an add logs
+ *
+ * @return position of the end of the record, for wal_commit
+ */
+static uint64_t wal_append(hash_table_wal_t *wal, uint32_t op,
+                           const void *key, uint32_t len, const void *data)
+{
+    wal_record_t record = {0, op, len,
+                           WAL_OP_ADD == op ? wal->opts.value_size : 0};
+    char *out = wal->buffer + wal->used;
+    size_t size = sizeof(wal_record_t) + len + record.value_len;
+
+    memcpy(out + sizeof(wal_record_t), key, len);
+    if (0 != record.value_len)
+    {
+        memcpy(out + sizeof(wal_record_t) + len, data, record.value_len);
+    }
+    record.check = wal_check(&record, out + sizeof(wal_record_t));
+    memcpy(out, &record, sizeof(wal_record_t));
+    wal->used += size;
+    wal->appended += size;
+
+    if (WAL_FSYNC_COMMIT == wal->opts.fsync || wal->used >= wal->capacity / 2)
+    {
+        pthread_cond_signal(&wal->wake);
+    }
+    if (wal->compact_requested == wal->compact_completed &&
+        wal->file_bytes >= wal->opts.compact_min_bytes &&
+        wal->file_bytes >= 2 * wal->compacted_bytes)
+    {
+        wal->compact_requested++;
+        pthread_cond_signal(&wal->compact_wake);
+    }
+
+    return wal->appended;
+}
+
+/**
+ * @brief waits, lock held, until a record is fsynced when the policy is
+ *        WAL_FSYNC_COMMIT; the lock is released meanwhile, so the records
+ *        of other callers join the same fsync
+ *
+ * @param wal pointer to log address
+ * @param end position returned by wal_append
+ *
+ * @return int exit code, FAILURE when the log failed before the record
+ *         was fsynced
+ */
+static int wal_commit(hash_table_wal_t *wal, uint64_t end)
+{
+    while (WAL_FSYNC_COMMIT == wal->opts.fsync && !wal->error &&
+           wal->synced < end)
+    {
+        pthread_cond_wait(&wal->flushed, &wal->lock);
+    }
+
+    return wal->error && wal->synced < end ? FAILURE : SUCCESS;
+}
+
+/**
+ * @brief undoes, lock held, the change to the table of an add or remove
+ *        whose commit failed
+ *
+ * Every caller with a record past the last fsync is waiting in
+ * wal_commit when the log fails, so the records are undone newest first,
+ * each caller waiting for the ones appended after its own. The key may be
+ * stored more than once: its entries are taken out and added back in
+ * order, without the added data or with the removed data in front, which
+ * leaves the other entries as they were.
+ *
+ * @param wal pointer to log address
+ * @param op WAL_OP_ADD or WAL_OP_REMOVE
+ * @param key key bytes
+ * @param len number of bytes in key
+ * @param data data added, or data removed
+ * @param end position returned by wal_append
+ */
+static void wal_undo(hash_table_wal_t *wal, uint32_t op, const void *key,
+                     uint32_t len, void *data, uint64_t end)
+{
+    void **entries = NULL;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+    void *entry = NULL;
+
+    while (wal->rollback != end)
+    {
+        pthread_cond_wait(&wal->flushed, &wal->lock);
+    }
+
+    if (WAL_OP_REMOVE == op)
+    {
+        entries = (void **)malloc(sizeof(void *));
+        capacity = NULL != entries ? 1 : 0;
+        count = capacity;
+        if (NULL != entries)
+        {
+            entries[0] = data;
+        }
+    }
+    while (NULL != (entry = hash_table_lookup_n(wal->table, key, len)))
+    {
+        if (count == capacity)
+        {
+            void **grown = (void **)realloc(
+                entries, (capacity ? 2 * capacity : 4) * sizeof(void *));
+            if (NULL == grown)
+            {
+                break;
+            }
+            entries = grown;
+            capacity = capacity ? 2 * capacity : 4;
+        }
+        hash_table_remove_n(wal->table, key, len);
+        entries[count++] = entry;
+    }
+
+    for (uint32_t x = count; WAL_OP_ADD == op && x > 0; x--)
+    {
+        if (data == entries[x - 1])
+        {
+            memmove(&entries[x - 1], &entries[x],
+                    (count - x) * sizeof(void *));
+            count--;
+            break;
+        }
+    }
+    for (uint32_t x = 0; x < count; x++)
+    {
+        hash_table_add_n(wal->table, entries[x], key, len);
+    }
+    free(entries);
+
+    wal->rollback = end - sizeof(wal_record_t) - len -
+                    (WAL_OP_ADD == op ? wal->opts.value_size : 0);
+    pthread_cond_broadcast(&wal->flushed);
+}
+
+/**
+ * @brief adds an item to the table and logs it
+ *
+ * @param wal pointer to log address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ *
+ * @return int exit code. FAILURE leaves the table as it was: memory ran
+ *         out or the log has failed. A log failing while a
+ *         WAL_FSYNC_COMMIT caller waits for the fsync undoes the add,
+ *         though its record may still be in the file and be replayed;
+ *         data is not kept by the table either way
+ */
+int hash_table_wal_add(hash_table_wal_t *wal, void *data, char *key)
+{
+    return hash_table_wal_add_n(wal, data, key,
+                                NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief adds an item under a key of len bytes to the table and logs it
+ *
+ * The table is changed and the record appended under the log's lock, so
+ * the log holds the changes in the order the table saw them.
+ *
+ * @param wal pointer to log address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ *
+ * @return int exit code. FAILURE leaves the table as it was: memory ran
+ *         out or the log has failed. A log failing while a
+ *         WAL_FSYNC_COMMIT caller waits for the fsync undoes the add,
+ *         though its record may still be in the file and be replayed;
+ *         data is not kept by the table either way
+ */
+int hash_table_wal_add_n(hash_table_wal_t *wal, void *data, const void *key,
+                         size_t len)
+{
+    int status = FAILURE;
+
+    if (NULL != wal && NULL != data && NULL != key && len < UINT32_MAX)
+    {
+        pthread_mutex_lock(&wal->lock);
+        status = wal_reserve(wal, sizeof(wal_record_t) + len +
+                                      wal->opts.value_size);
+        if (SUCCESS == status)
+        {
+            status = hash_table_add_n(wal->table, data, key, len);
+        }
+        if (SUCCESS == status)
+        {
+            uint64_t end = wal_append(wal, WAL_OP_ADD, key, (uint32_t)len,
+                                      data);
+            status = wal_commit(wal, end);
+            if (SUCCESS != status)
+            {
+                wal_undo(wal, WAL_OP_ADD, key, (uint32_t)len, data, end);
+            }
+        }
+        pthread_mutex_unlock(&wal->lock);
+    }
+
+    return status;
+}
+
+/**
+ * @brief removes an item from the table and logs it
+ *
+ * @param wal pointer to log address
+ * @param key key of data to be removed
+ *
+ * @return int exit code. FAILURE leaves the table as it was: the key was
+ *         not present or the log has failed. A log failing while a
+ *         WAL_FSYNC_COMMIT caller waits for the fsync puts the entry
+ *         back, though the record may still be in the file and be
+ *         replayed
+ */
+int hash_table_wal_remove(hash_table_wal_t *wal, char *key)
+{
+    return hash_table_wal_remove_n(wal, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief removes an item stored under a key of len bytes and logs it
+ *
+ * @param wal pointer to log address
+ * @param key key bytes of data to be removed
+ * @param len number of bytes in key
+ *
+ * @return int exit code. FAILURE leaves the table as it was: the key was
+ *         not present or the log has failed. A log failing while a
+ *         WAL_FSYNC_COMMIT caller waits for the fsync puts the entry
+ *         back, though the record may still be in the file and be
+ *         replayed
+ */
+int hash_table_wal_remove_n(hash_table_wal_t *wal, const void *key,
+                            size_t len)
+{
+    int status = FAILURE;
+    void *data = NULL;
+
+    if (NULL != wal && NULL != key && len < UINT32_MAX)
+    {
+        pthread_mutex_lock(&wal->lock);
+        status = wal_reserve(wal, sizeof(wal_record_t) + len);
+        if (SUCCESS == status)
+        {
+            data = hash_table_lookup_n(wal->table, key, len);
+            status = hash_table_remove_n(wal->table, key, len);
+        }
+        if (SUCCESS == status)
+        {
+            uint64_t end = wal_append(wal, WAL_OP_REMOVE, key, (uint32_t)len,
+                                      NULL);
+            status = wal_commit(wal, end);
+            if (SUCCESS != status)
+            {
+                wal_undo(wal, WAL_OP_REMOVE, key, (uint32_t)len, data, end);
+            }
+        }
+        pthread_mutex_unlock(&wal->lock);
+    }
+
+    return status;
+}
+
+/**
+ * @brief waits until every record logged so far has been fsynced,
+ *        whatever the fsync policy
+ *
+ * @param wal pointer to log address
+ *
+ * @return int exit code
+ */
+int hash_table_wal_sync(hash_table_wal_t *wal)
+{
+    int status = FAILURE;
+
+    if (NULL != wal)
+    {
+        pthread_mutex_lock(&wal->lock);
+        uint64_t target = wal->appended;
+        while (!wal->error && wal->synced < target)
+        {
+            wal->sync_requested = 1;
+            pthread_cond_signal(&wal->wake);
+            pthread_cond_wait(&wal->flushed, &wal->lock);
+        }
+        status = wal->error ? FAILURE : SUCCESS;
+        pthread_mutex_unlock(&wal->lock);
+    }
+
+    return status;
+}
+
+/**
+ * @brief asks the compaction thread to rewrite the log and waits for it
+ *
+ * @param wal pointer to log address
+ *
+ * @return int exit code
+ */
+int hash_table_wal_compact(hash_table_wal_t *wal)
+{
+    int status = FAILURE;
+
+    if (NULL != wal)
+    {
+        pthread_mutex_lock(&wal->lock);
+        uint64_t ticket = ++wal->compact_requested;
+        pthread_cond_signal(&wal->compact_wake);
+        while (wal->compact_completed < ticket)
+        {
+            pthread_cond_wait(&wal->compact_done, &wal->lock);
+        }
+        status = wal->compact_status;
+        pthread_mutex_unlock(&wal->lock);
+    }
+
+    return status;
+}
+
+/**
+ * @brief writes and fsyncs every record, stops the log's threads and
+ *        closes the file; the table is left as it is
+ *
+ * The compaction thread is stopped first, since a compaction in progress
+ * needs the writer to swap its file in.
+ *
+ * @param wal_addr pointer to log address
+ *
+ * @return int exit code, FAILURE when a record could not be written
+ */
+int hash_table_wal_close(hash_table_wal_t **wal_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != wal_addr && NULL != *wal_addr)
+    {
+        hash_table_wal_t *wal = *wal_addr;
+
+        pthread_mutex_lock(&wal->lock);
+        wal->stop = WAL_STOP_COMPACTOR;
+        pthread_cond_signal(&wal->compact_wake);
+        pthread_mutex_unlock(&wal->lock);
+        pthread_join(wal->compactor, NULL);
+
+        pthread_mutex_lock(&wal->lock);
+        wal->stop = WAL_STOP_WRITER;
+        pthread_cond_signal(&wal->wake);
+        pthread_mutex_unlock(&wal->lock);
+        pthread_join(wal->writer, NULL);
+
+        status = !wal->error && 0 == fsync(wal->fd) ? SUCCESS : FAILURE;
+        wal_free(wal);
+        *wal_addr = NULL;
+    }
+
+    return status;
+}
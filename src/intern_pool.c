@@ -0,0 +1,314 @@
+#include <intern_pool.h>
+#include <arena.h>
+#include <stddef.h>
+
+#define INTERN_BYTES_CHUNK (64 * 1024)
+#define INTERN_FIRST_CHUNK_BITS 10
+#define INTERN_MIN_SIZE 16
+
+/**
+ * @brief finds the directory chunk and offset of a symbol
+ *
+ * Chunk c starts at symbol (1024 << c) - 1024, so adding 1024 to the
+ * symbol turns its highest set bit into the chunk number.
+ *
+ * @param symbol symbol to place
+ * @param offset receives the symbol's index inside its chunk
+ *
+ * @return chunk number
+ */
+static inline uint32_t intern_chunk_of(uint32_t symbol, uint64_t *offset)
+{
+    uint64_t index = (uint64_t)symbol + (1U << INTERN_FIRST_CHUNK_BITS);
+    uint32_t chunk = 63 - (uint32_t)__builtin_clzll(index) -
+                     INTERN_FIRST_CHUNK_BITS;
+
+    *offset = index - ((uint64_t)1 << (chunk + INTERN_FIRST_CHUNK_BITS));
+    return chunk;
+}
+
+/**
+ * @brief initializes a pool
+ *
+ * @param size number of distinct strings to reserve room for
+ * @param shared non-zero to allow intern_pool_intern and every lookup from
+ *               several threads at once
+ *
+ * @return intern_pool_t pointer to allocated pool, NULL on failure
+ */
+intern_pool_t *intern_pool_init(uint32_t size, int shared)
+{
+    intern_pool_t *pool = (intern_pool_t *)calloc(1, sizeof(intern_pool_t));
+    hash_table_opts_t opts = {.engine = HASH_ENGINE_SWISS};
+
+    if (shared)
+    {
+        opts = (hash_table_opts_t){.sync = HASH_SYNC_RCU};
+    }
+
+    if (NULL != pool)
+    {
+        pool->shared = shared;
+        pool->table = hash_table_init_ex(
+            size > INTERN_MIN_SIZE ? size : INTERN_MIN_SIZE, NULL, &opts);
+        pool->bytes = arena_init(INTERN_BYTES_CHUNK);
+        if (NULL == pool->table || NULL == pool->bytes ||
+            0 != pthread_mutex_init(&pool->lock, NULL))
+        {
+            hash_table_destroy(&pool->table);
+            arena_destroy(&pool->bytes);
+            free(pool);
+            pool = NULL;
+        }
+    }
+
+    return pool;
+}
+
+/**
+ * @brief stores a new string and publishes its symbol
+ *
+ * The directory slot is filled before the string is added to the table,
+ * so a symbol found through the table always resolves.
+ *
+ * @param pool pointer to pool address, locked when shared
+ * @param str string bytes
+ * @param len number of bytes in str
+ *
+ * @return the string's entry, NULL on failure
+ */
+static intern_entry_t *intern_insert(intern_pool_t *pool, const char *str,
+                                     uint32_t len)
+{
+    intern_entry_t *entry = NULL;
+    uint32_t symbol = pool->count;
+    uint64_t offset = 0;
+    uint32_t chunk = intern_chunk_of(symbol, &offset);
+    const char **slots = NULL;
+
+    if (chunk < INTERN_POOL_CHUNKS)
+    {
+        slots = pool->chunks[chunk];
+        if (NULL == slots)
+        {
+            slots = (const char **)calloc(
+                (size_t)1 << (chunk + INTERN_FIRST_CHUNK_BITS),
+                sizeof(const char *));
+            __atomic_store_n(&pool->chunks[chunk], slots, __ATOMIC_RELEASE);
+        }
+    }
+    if (NULL != slots)
+    {
+        entry = (intern_entry_t *)arena_alloc(
+            pool->bytes, sizeof(intern_entry_t) + (size_t)len + 1);
+    }
+
+    if (NULL != entry)
+    {
+        entry->symbol = symbol;
+        entry->len = len;
+        memcpy(entry->bytes, str, len);
+        entry->bytes[len] = '\0';
+        __atomic_store_n(&slots[offset], entry->bytes, __ATOMIC_RELEASE);
+        if (SUCCESS == hash_table_add_n(pool->table, entry, str, len))
+        {
+            __atomic_store_n(&pool->count, symbol + 1, __ATOMIC_RELEASE);
+        }
+        else
+        {
+            // the arena keeps the bytes, but the symbol is handed out again
+            __atomic_store_n(&slots[offset], NULL, __ATOMIC_RELEASE);
+            entry = NULL;
+        }
+    }
+
+    return entry;
+}
+
+/**
+ * @brief finds the entry of a string, interning it first when it is new
+ *
+ * A string already in the pool is found without taking the lock; only a
+ * miss locks and looks again before inserting, so two threads interning
+ * the same new string agree on one entry.
+ *
+ * @param pool pointer to pool address
+ * @param str string bytes
+ * @param len number of bytes in str
+ *
+ * @return the string's entry, NULL on failure
+ */
+static intern_entry_t *intern_entry(intern_pool_t *pool, const char *str,
+                                    size_t len)
+{
+    intern_entry_t *entry = NULL;
+
+    if (NULL != pool && NULL != str && len < UINT32_MAX)
+    {
+        entry = (intern_entry_t *)hash_table_lookup_n(pool->table, str, len);
+        if (NULL == entry && pool->shared)
+        {
+            pthread_mutex_lock(&pool->lock);
+            entry = (intern_entry_t *)hash_table_lookup_n(pool->table, str,
+                                                          len);
+            if (NULL == entry)
+            {
+                entry = intern_insert(pool, str, (uint32_t)len);
+            }
+            pthread_mutex_unlock(&pool->lock);
+        }
+        else if (NULL == entry)
+        {
+            entry = intern_insert(pool, str, (uint32_t)len);
+        }
+    }
+
+    return entry;
+}
+
+/**
+ * @brief returns the canonical copy of a string, interning it first when
+ *        it is new
+ *
+ * @param pool pointer to pool address
+ * @param str string bytes, may hold NUL bytes
+ * @param len number of bytes in str
+ *
+ * @return canonical NUL terminated copy of str, valid until the pool is
+ *         destroyed; NULL on failure
+ */
+const char *intern_pool_intern(intern_pool_t *pool, const char *str,
+                               size_t len)
+{
+    intern_entry_t *entry = intern_entry(pool, str, len);
+
+    return NULL != entry ? entry->bytes : NULL;
+}
+
+/**
+ * @brief returns the symbol of a string, interning it first when it is new
+ *
+ * @param pool pointer to pool address
+ * @param str string bytes, may hold NUL bytes
+ * @param len number of bytes in str
+ *
+ * @return the string's symbol, INTERN_POOL_NO_SYMBOL on failure
+ */
+uint32_t intern_pool_symbol(intern_pool_t *pool, const char *str, size_t len)
+{
+    intern_entry_t *entry = intern_entry(pool, str, len);
+
+    return NULL != entry ? entry->symbol : INTERN_POOL_NO_SYMBOL;
+}
+
+/**
+ * @brief returns the canonical copy of a string without interning it
+ *
+ * @param pool pointer to pool address
+ * @param str string bytes
+ * @param len number of bytes in str
+ *
+ * @return canonical copy of str, NULL when it was never interned
+ */
+const char *intern_pool_lookup(intern_pool_t *pool, const char *str,
+                               size_t len)
+{
+    intern_entry_t *entry = NULL;
+
+    if (NULL != pool && NULL != str)
+    {
+        entry = (intern_entry_t *)hash_table_lookup_n(pool->table, str, len);
+    }
+
+    return NULL != entry ? entry->bytes : NULL;
+}
+
+/**
+ * @brief returns the canonical string of a symbol
+ *
+ * @param pool pointer to pool address
+ * @param symbol symbol returned by intern_pool_symbol
+ * @param len receives the number of bytes in the string, may be NULL
+ *
+ * @return canonical string, NULL for unknown symbols
+ */
+const char *intern_pool_string(intern_pool_t *pool, uint32_t symbol,
+                               uint32_t *len)
+{
+    const char *interned = NULL;
+    uint64_t offset = 0;
+    uint32_t chunk = intern_chunk_of(symbol, &offset);
+    const char **slots = NULL;
+
+    if (NULL != pool && chunk < INTERN_POOL_CHUNKS)
+    {
+        slots = __atomic_load_n(&pool->chunks[chunk], __ATOMIC_ACQUIRE);
+    }
+    if (NULL != slots)
+    {
+        interned = __atomic_load_n(&slots[offset], __ATOMIC_ACQUIRE);
+    }
+    if (NULL != interned && NULL != len)
+    {
+        *len = ((const intern_entry_t *)(interned -
+                                         offsetof(intern_entry_t, bytes)))
+                   ->len;
+    }
+
+    return interned;
+}
+
+/**
+ * @brief returns the symbol of a canonical pointer in constant time
+ *
+ * @param interned pointer returned by intern_pool_intern or
+ *                 intern_pool_string, never any other string
+ *
+ * @return the string's symbol
+ */
+uint32_t intern_pool_symbol_of(const char *interned)
+{
+    return ((const intern_entry_t *)(interned -
+                                     offsetof(intern_entry_t, bytes)))
+        ->symbol;
+}
+
+/**
+ * @brief number of strings interned
+ *
+ * @param pool pointer to pool address
+ *
+ * @return number of distinct strings, 0 for a NULL pool
+ */
+uint32_t intern_pool_count(intern_pool_t *pool)
+{
+    return NULL != pool ? __atomic_load_n(&pool->count, __ATOMIC_ACQUIRE) : 0;
+}
+
+/**
+ * @brief destroys the pool and every canonical string
+ *
+ * @param pool_addr pointer to pool address
+ *
+ * @return int exit code
+ */
+int intern_pool_destroy(intern_pool_t **pool_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != pool_addr && NULL != *pool_addr)
+    {
+        hash_table_destroy(&(*pool_addr)->table);
+        arena_destroy(&(*pool_addr)->bytes);
+        for (uint32_t x = 0; x < INTERN_POOL_CHUNKS; x++)
+        {
+            free((*pool_addr)->chunks[x]);
+        }
+        pthread_mutex_destroy(&(*pool_addr)->lock);
+        free(*pool_addr);
+        *pool_addr = NULL;
+        status = SUCCESS;
+    }
+
+    return status;
+}
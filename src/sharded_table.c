@@ -0,0 +1,729 @@
+#include <sharded_table.h>
+
+#define SHARD_MIN_SIZE 16
+
+/**
+ * @brief an entry being moved by a merge
+ *
+ * @param key   key bytes, owned by the shard being merged
+ * @param data  data stored at key
+ * @param len   number of bytes in key
+ * @param home  home shard of key
+ */
+typedef struct shard_entry_t
+{
+    const char *key;
+    void *data;
+    uint32_t len;
+    uint32_t home;
+} shard_entry_t;
+
+/**
+ * @brief the entries of one shard, collected by a scan
+ *
+ * @param table     table being merged
+ * @param entries   the entries, in scan order
+ * @param count     number of entries collected
+ * @param capacity  room in entries, the number of entries of the shard
+ */
+typedef struct shard_list_t
+{
+    sharded_table_t *table;
+    shard_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+} shard_list_t;
+
+/**
+ * @brief one private shard's entries, ordered by home shard, during a
+ *        merge
+ *
+ * @param entries   the shard's entries, grouped by home shard
+ * @param offsets   shard_count + 1 offsets; the entries of home shard h
+ *                  run from offsets[h] to offsets[h + 1]
+ */
+typedef struct shard_part_t
+{
+    shard_entry_t *entries;
+    uint32_t *offsets;
+} shard_part_t;
+
+/**
+ * @brief work of one merge thread
+ *
+ * @param table     table being merged
+ * @param parts     partitioned entries of every shard
+ * @param built     new shard tables, one per home shard
+ * @param worker    index of the thread; it handles every shard index equal
+ *                  to it modulo threads
+ * @param threads   number of merge threads
+ * @param thread    the worker's thread, unused by worker 0
+ * @param started   non-zero while thread is running
+ * @param status    FAILURE once an allocation or add failed
+ */
+typedef struct merge_context_t
+{
+    sharded_table_t *table;
+    shard_part_t *parts;
+    hash_table_t **built;
+    uint32_t worker;
+    uint32_t threads;
+    pthread_t thread;
+    int started;
+    int status;
+} merge_context_t;
+
+/**
+ * @brief initializes a sharded table
+ *
+ * @param shard_count number of shards, typically the number of cores
+ * @param size number of entries to reserve room for over all shards
+ * @param customfree pointer to the user defined free function
+ * @param mode how the shards are shared between threads
+ * @param opts options of every shard table, NULL selects every default;
+ *             sync must be HASH_SYNC_NONE, the shards bring their own
+ *
+ * @return sharded_table_t pointer to allocated table, NULL on failure
+ */
+sharded_table_t *sharded_table_init(uint32_t shard_count, uint32_t size,
+                                    FREE_F customfree, shard_mode_t mode,
+                                    const hash_table_opts_t *opts)
+{
+    sharded_table_t *table = NULL;
+    uint32_t shard_size = 0 != shard_count ? size / shard_count : 0;
+
+    if (0 != shard_count && (NULL == opts || HASH_SYNC_NONE == opts->sync))
+    {
+        table = (sharded_table_t *)calloc(1, sizeof(sharded_table_t));
+    }
+
+    if (NULL != table)
+    {
+        table->shards = (sharded_table_shard_t *)aligned_alloc(
+            _Alignof(sharded_table_shard_t),
+            (size_t)shard_count * sizeof(sharded_table_shard_t));
+        if (NULL == table->shards)
+        {
+            free(table);
+            table = NULL;
+        }
+    }
+
+    if (NULL != table)
+    {
+        table->shard_count = shard_count;
+        table->mode = mode;
+        table->customfree = customfree;
+        if (NULL != opts)
+        {
+            table->opts = *opts;
+        }
+        hash_func_random_seed(table->seed);
+        for (uint32_t x = 0; x < shard_count; x++)
+        {
+            pthread_mutex_init(&table->shards[x].lock, NULL);
+            table->shards[x].table = hash_table_init_ex(
+                shard_size > SHARD_MIN_SIZE ? shard_size : SHARD_MIN_SIZE,
+                customfree, &table->opts);
+        }
+        for (uint32_t x = 0; NULL != table && x < shard_count; x++)
+        {
+            if (NULL == table->shards[x].table)
+            {
+                sharded_table_destroy(&table);
+            }
+        }
+    }
+
+    return table;
+}
+
+/**
+ * @brief returns the home shard of a key of len bytes
+ *
+ * The high half of the hash is mapped onto the shards by a multiply and
+ * shift, which needs no division and works for any shard count.
+ *
+ * @param table pointer to table address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return shard index, below shard_count
+ */
+uint32_t sharded_table_shard_of(const sharded_table_t *table, const void *key,
+                                size_t len)
+{
+    uint64_t hash = hash_func_wy(key, len, table->seed);
+
+    return (uint32_t)(((hash >> 32) * table->shard_count) >> 32);
+}
+
+/**
+ * @brief locks the home shard of a key, when the table locks its shards
+ *
+ * @param table pointer to table address
+ * @param key key bytes
+ * @param len number of bytes in key
+ *
+ * @return the key's shard
+ */
+static sharded_table_shard_t *shard_enter(sharded_table_t *table,
+                                          const void *key, size_t len)
+{
+    sharded_table_shard_t *shard =
+        &table->shards[sharded_table_shard_of(table, key, len)];
+
+    if (SHARD_MODE_LOCKED == table->mode)
+    {
+        pthread_mutex_lock(&shard->lock);
+    }
+
+    return shard;
+}
+
+/**
+ * @brief releases what shard_enter locked
+ *
+ * @param table pointer to table address
+ * @param shard shard returned by shard_enter
+ */
+static void shard_leave(sharded_table_t *table, sharded_table_shard_t *shard)
+{
+    if (SHARD_MODE_LOCKED == table->mode)
+    {
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+/**
+ * @brief adds an item to the key's home shard
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ *
+ * @return int exit code, FAILURE on a SHARD_MODE_PRIVATE table
+ */
+int sharded_table_add(sharded_table_t *table, void *data, char *key)
+{
+    return sharded_table_add_n(table, data, key,
+                               NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief adds an item under a key of len bytes to the key's home shard
+ *
+ * @param table pointer to table address
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ *
+ * @return int exit code, FAILURE on a SHARD_MODE_PRIVATE table
+ */
+int sharded_table_add_n(sharded_table_t *table, void *data, const void *key,
+                        size_t len)
+{
+    int status = FAILURE;
+
+    if (NULL != table && NULL != key && SHARD_MODE_PRIVATE != table->mode)
+    {
+        sharded_table_shard_t *shard = shard_enter(table, key, len);
+        status = hash_table_add_n(shard->table, data, key, len);
+        shard_leave(table, shard);
+    }
+
+    return status;
+}
+
+/**
+ * @brief adds an item to the calling thread's private shard of a
+ *        SHARD_MODE_PRIVATE table
+ *
+ * @param table pointer to table address
+ * @param shard the caller's shard; no other thread may use it until
+ *              sharded_table_merge
+ * @param data data to be stored at that key value
+ * @param key key for data to be stored at
+ *
+ * @return int exit code
+ */
+int sharded_table_add_local(sharded_table_t *table, uint32_t shard,
+                            void *data, char *key)
+{
+    return sharded_table_add_local_n(table, shard, data, key,
+                                     NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief adds an item under a key of len bytes to the calling thread's
+ *        private shard, see sharded_table_add_local
+ *
+ * @param table pointer to table address
+ * @param shard the caller's shard
+ * @param data data to be stored at that key value
+ * @param key key bytes for data to be stored at
+ * @param len number of bytes in key
+ *
+ * @return int exit code
+ */
+int sharded_table_add_local_n(sharded_table_t *table, uint32_t shard,
+                              void *data, const void *key, size_t len)
+{
+    int status = FAILURE;
+
+    if (NULL != table && SHARD_MODE_PRIVATE == table->mode &&
+        shard < table->shard_count)
+    {
+        status = hash_table_add_n(table->shards[shard].table, data, key, len);
+    }
+
+    return status;
+}
+
+/**
+ * @brief scan callback appending every entry of a shard, with its home
+ *        shard, to a shard_list_t
+ */
+static void merge_collect(const char *key, uint32_t len, void *data,
+                          void *context)
+{
+    shard_list_t *list = (shard_list_t *)context;
+
+    if (list->count < list->capacity)
+    {
+        list->entries[list->count++] = (shard_entry_t){
+            key, data, len, sharded_table_shard_of(list->table, key, len)};
+    }
+}
+
+/**
+ * @brief groups the entries of one shard by home shard
+ *
+ * A counting sort: one pass counts the entries per home shard, a second
+ * places them, so the build step reads each home shard's entries as one
+ * run.
+ *
+ * @param table pointer to table address
+ * @param source shard being partitioned
+ * @param part receives the grouped entries
+ *
+ * @return int exit code
+ */
+static int merge_partition(sharded_table_t *table, uint32_t source,
+                           shard_part_t *part)
+{
+    int status = SUCCESS;
+    hash_table_t *shard = table->shards[source].table;
+    shard_list_t list = {.table = table, .capacity = shard->count};
+    uint64_t cursor = 0;
+
+    part->offsets = (uint32_t *)calloc(table->shard_count + 1,
+                                       sizeof(uint32_t));
+    if (0 != list.capacity)
+    {
+        list.entries = (shard_entry_t *)malloc(list.capacity *
+                                               sizeof(shard_entry_t));
+        part->entries = (shard_entry_t *)malloc(list.capacity *
+                                                sizeof(shard_entry_t));
+    }
+
+    if (NULL == part->offsets ||
+        (0 != list.capacity && (NULL == list.entries || NULL == part->entries)))
+    {
+        status = FAILURE;
+    }
+    else
+    {
+        do
+        {
+            cursor = hash_table_scan(shard, cursor, list.capacity,
+                                     merge_collect, &list);
+        } while (0 != cursor);
+
+        for (uint32_t x = 0; x < list.count; x++)
+        {
+            part->offsets[list.entries[x].home + 1]++;
+        }
+        for (uint32_t x = 0; x < table->shard_count; x++)
+        {
+            part->offsets[x + 1] += part->offsets[x];
+        }
+        // offsets[h] walks through home shard h's run while placing, ending
+        // at the start of the next run; shift back afterwards
+        for (uint32_t x = 0; x < list.count; x++)
+        {
+            part->entries[part->offsets[list.entries[x].home]++] =
+                list.entries[x];
+        }
+        for (uint32_t x = table->shard_count; x > 0; x--)
+        {
+            part->offsets[x] = part->offsets[x - 1];
+        }
+        part->offsets[0] = 0;
+    }
+
+    free(list.entries);
+
+    return status;
+}
+
+/**
+ * @brief builds one home shard from its entries in every partitioned
+ *        shard, into a table sized for all of them up front
+ *
+ * @param table pointer to table address
+ * @param parts partitioned entries of every shard
+ * @param home shard being built
+ * @param built receives the new shard table
+ *
+ * @return int exit code
+ */
+static int merge_build(sharded_table_t *table, shard_part_t *parts,
+                       uint32_t home, hash_table_t **built)
+{
+    int status = SUCCESS;
+    uint32_t total = 0;
+
+    for (uint32_t x = 0; x < table->shard_count; x++)
+    {
+        total += parts[x].offsets[home + 1] - parts[x].offsets[home];
+    }
+
+    *built = hash_table_init_ex(total > SHARD_MIN_SIZE ? total :
+                                                         SHARD_MIN_SIZE,
+                                table->customfree, &table->opts);
+    if (NULL == *built)
+    {
+        status = FAILURE;
+    }
+
+    for (uint32_t x = 0; SUCCESS == status && x < table->shard_count; x++)
+    {
+        for (uint32_t y = parts[x].offsets[home];
+             SUCCESS == status && y < parts[x].offsets[home + 1]; y++)
+        {
+            shard_entry_t *entry = &parts[x].entries[y];
+            status = hash_table_add_n(*built, entry->data, entry->key,
+                                      entry->len);
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief thread body partitioning every shard assigned to one worker
+ */
+static void *merge_partition_worker(void *arg)
+{
+    merge_context_t *context = (merge_context_t *)arg;
+
+    for (uint32_t x = context->worker; x < context->table->shard_count;
+         x += context->threads)
+    {
+        if (SUCCESS != merge_partition(context->table, x, &context->parts[x]))
+        {
+            context->status = FAILURE;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief thread body building every home shard assigned to one worker
+ */
+static void *merge_build_worker(void *arg)
+{
+    merge_context_t *context = (merge_context_t *)arg;
+
+    for (uint32_t x = context->worker;
+         SUCCESS == context->status && x < context->table->shard_count;
+         x += context->threads)
+    {
+        context->status = merge_build(context->table, context->parts, x,
+                                      &context->built[x]);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief runs a merge step on every worker, the caller acting as worker 0
+ *        and as any worker whose thread could not be started
+ *
+ * @param contexts one context per worker
+ * @param threads number of workers
+ * @param body thread body of the step
+ *
+ * @return int exit code
+ */
+static int merge_run(merge_context_t *contexts, uint32_t threads,
+                     void *(*body)(void *))
+{
+    int status = SUCCESS;
+
+    for (uint32_t x = 1; x < threads; x++)
+    {
+        contexts[x].started = 0 == pthread_create(&contexts[x].thread, NULL,
+                                                  body, &contexts[x]);
+    }
+    body(&contexts[0]);
+    for (uint32_t x = 1; x < threads; x++)
+    {
+        if (contexts[x].started)
+        {
+            pthread_join(contexts[x].thread, NULL);
+        }
+        else
+        {
+            body(&contexts[x]);
+        }
+    }
+
+    for (uint32_t x = 0; x < threads; x++)
+    {
+        if (SUCCESS != contexts[x].status)
+        {
+            status = FAILURE;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief moves every key of a SHARD_MODE_PRIVATE table to its home shard
+ *        and switches the table to SHARD_MODE_LOCKED
+ *
+ * @param table pointer to table address
+ * @param threads number of threads to merge with, 0 or 1 for the caller
+ *                only
+ *
+ * @return int exit code; on failure the table is left unmerged
+ */
+int sharded_table_merge(sharded_table_t *table, uint32_t threads)
+{
+    int status = FAILURE;
+    shard_part_t *parts = NULL;
+    hash_table_t **built = NULL;
+    merge_context_t *contexts = NULL;
+
+    if (NULL != table && SHARD_MODE_PRIVATE == table->mode)
+    {
+        threads = threads < table->shard_count ? threads : table->shard_count;
+        threads = 0 != threads ? threads : 1;
+        parts = (shard_part_t *)calloc(table->shard_count,
+                                       sizeof(shard_part_t));
+        built = (hash_table_t **)calloc(table->shard_count,
+                                        sizeof(hash_table_t *));
+        contexts = (merge_context_t *)calloc(threads,
+                                             sizeof(merge_context_t));
+    }
+
+    if (NULL != parts && NULL != built && NULL != contexts)
+    {
+        for (uint32_t x = 0; x < threads; x++)
+        {
+            contexts[x] = (merge_context_t){.table = table,
+                                            .parts = parts,
+                                            .built = built,
+                                            .worker = x,
+                                            .threads = threads,
+                                            .status = SUCCESS};
+        }
+        status = merge_run(contexts, threads, merge_partition_worker);
+        if (SUCCESS == status)
+        {
+            status = merge_run(contexts, threads, merge_build_worker);
+        }
+
+        // the new shards only reference entries of the old ones until here
+        for (uint32_t x = 0; x < table->shard_count; x++)
+        {
+            if (SUCCESS == status)
+            {
+                hash_table_destroy(&table->shards[x].table);
+                table->shards[x].table = built[x];
+            }
+            else
+            {
+                hash_table_destroy(&built[x]);
+            }
+            free(parts[x].entries);
+            free(parts[x].offsets);
+        }
+        if (SUCCESS == status)
+        {
+            table->mode = SHARD_MODE_LOCKED;
+        }
+    }
+
+    free(contexts);
+    free(built);
+    free(parts);
+
+    return status;
+}
+
+/**
+ * @brief looks up an item in the key's home shard
+ *
+ * @param table pointer to table address
+ * @param key key for data being searched for
+ *
+ * @return void * data, NULL when missing or on a SHARD_MODE_PRIVATE table
+ */
+void *sharded_table_lookup(sharded_table_t *table, char *key)
+{
+    return sharded_table_lookup_n(table, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief looks up an item by a key of len bytes in the key's home shard
+ *
+ * Locked tables lock the shard for lookups too: a chained shard moves
+ * buckets of an ongoing resize on every lookup.
+ *
+ * @param table pointer to table address
+ * @param key key bytes for data being searched for
+ * @param len number of bytes in key
+ *
+ * @return void * data, NULL when missing or on a SHARD_MODE_PRIVATE table
+ */
+void *sharded_table_lookup_n(sharded_table_t *table, const void *key,
+                             size_t len)
+{
+    void *data = NULL;
+
+    if (NULL != table && NULL != key && SHARD_MODE_PRIVATE != table->mode)
+    {
+        sharded_table_shard_t *shard = shard_enter(table, key, len);
+        data = hash_table_lookup_n(shard->table, key, len);
+        shard_leave(table, shard);
+    }
+
+    return data;
+}
+
+/**
+ * @brief removes an item from the key's home shard
+ *
+ * @param table pointer to table address
+ * @param key key of data to be removed
+ *
+ * @return int exit code, FAILURE on a SHARD_MODE_PRIVATE table
+ */
+int sharded_table_remove(sharded_table_t *table, char *key)
+{
+    return sharded_table_remove_n(table, key, NULL != key ? strlen(key) : 0);
+}
+
+/**
+ * @brief removes an item stored under a key of len bytes
+ *
+ * @param table pointer to table address
+ * @param key key bytes of data to be removed
+ * @param len number of bytes in key
+ *
+ * @return int exit code, FAILURE on a SHARD_MODE_PRIVATE table
+ */
+int sharded_table_remove_n(sharded_table_t *table, const void *key,
+                           size_t len)
+{
+    int status = FAILURE;
+
+    if (NULL != table && NULL != key && SHARD_MODE_PRIVATE != table->mode)
+    {
+        sharded_table_shard_t *shard = shard_enter(table, key, len);
+        status = hash_table_remove_n(shard->table, key, len);
+        shard_leave(table, shard);
+    }
+
+    return status;
+}
+
+/**
+ * @brief counts the entries of every shard
+ *
+ * @param table pointer to table address
+ *
+ * @return number of entries, 0 for a NULL table
+ */
+uint64_t sharded_table_count(sharded_table_t *table)
+{
+    uint64_t count = 0;
+
+    for (uint32_t x = 0; NULL != table && x < table->shard_count; x++)
+    {
+        if (SHARD_MODE_LOCKED == table->mode)
+        {
+            pthread_mutex_lock(&table->shards[x].lock);
+        }
+        count += table->shards[x].table->count;
+        if (SHARD_MODE_LOCKED == table->mode)
+        {
+            pthread_mutex_unlock(&table->shards[x].lock);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief clears every shard
+ *
+ * @param table pointer to table address
+ *
+ * @return int exit code
+ */
+int sharded_table_clear(sharded_table_t *table)
+{
+    int status = FAILURE;
+
+    if (NULL != table)
+    {
+        status = SUCCESS;
+        for (uint32_t x = 0; x < table->shard_count; x++)
+        {
+            if (SHARD_MODE_LOCKED == table->mode)
+            {
+                pthread_mutex_lock(&table->shards[x].lock);
+            }
+            hash_table_clear(table->shards[x].table);
+            if (SHARD_MODE_LOCKED == table->mode)
+            {
+                pthread_mutex_unlock(&table->shards[x].lock);
+            }
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief destroys the table and every shard
+ *
+ * @param table_addr pointer to table address
+ *
+ * @return int exit code
+ */
+int sharded_table_destroy(sharded_table_t **table_addr)
+{
+    int status = FAILURE;
+
+    if (NULL != table_addr && NULL != *table_addr)
+    {
+        for (uint32_t x = 0; x < (*table_addr)->shard_count; x++)
+        {
+            hash_table_destroy(&(*table_addr)->shards[x].table);
+            pthread_mutex_destroy(&(*table_addr)->shards[x].lock);
+        }
+        free((*table_addr)->shards);
+        free(*table_addr);
+        *table_addr = NULL;
+        status = SUCCESS;
+    }
+
+    return status;
+}
@@ -0,0 +1,159 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <arena.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_SIZE 256
+#define OBJECTS 100
+
+arena_t *arena = NULL;
+slab_t *slab = NULL;
+
+int init_suite1(void)
+{
+    return 0;
+}
+
+int clean_suite1(void)
+{
+    return 0;
+}
+
+void test_arena_init()
+{
+    CU_ASSERT(NULL == arena_init(0));
+
+    arena = arena_init(CHUNK_SIZE);
+    CU_ASSERT_FATAL(NULL != arena);
+    CU_ASSERT(NULL == arena->head);
+    CU_ASSERT(CHUNK_SIZE == arena->chunk_size);
+}
+
+void test_arena_alloc()
+{
+    char *first = NULL;
+    char *second = NULL;
+    char *large = NULL;
+
+    CU_ASSERT(NULL == arena_alloc(NULL, 8));
+    CU_ASSERT(NULL == arena_alloc(arena, 0));
+
+    first = (char *)arena_alloc(arena, 5);
+    second = (char *)arena_alloc(arena, 5);
+    CU_ASSERT_FATAL(NULL != first && NULL != second);
+    // allocations are 16 byte aligned and bumped out of the same chunk
+    CU_ASSERT(0 == (uintptr_t)first % 16);
+    CU_ASSERT(second == first + 16);
+    memcpy(first, "four", 5);
+    memcpy(second, "five", 5);
+    CU_ASSERT(0 == strcmp("four", first));
+
+    // oversized requests get their own chunk, the current chunk stays in use
+    large = (char *)arena_alloc(arena, 4 * CHUNK_SIZE);
+    CU_ASSERT_FATAL(NULL != large);
+    memset(large, 'x', 4 * CHUNK_SIZE);
+    CU_ASSERT((char *)arena_alloc(arena, 5) == second + 16);
+
+    // fill past the first chunk
+    for (int x = 0; x < OBJECTS; x++)
+    {
+        CU_ASSERT(NULL != arena_alloc(arena, 32));
+    }
+    CU_ASSERT(arena->allocated > 5 * CHUNK_SIZE);
+    CU_ASSERT(0 == strcmp("five", second));
+}
+
+void test_arena_clear()
+{
+    CU_ASSERT(FAILURE == arena_clear(NULL));
+    CU_ASSERT(SUCCESS == arena_clear(arena));
+    CU_ASSERT(CHUNK_SIZE == arena->allocated);
+    CU_ASSERT(NULL == arena->head->next);
+    CU_ASSERT(0 == arena->head->used);
+    CU_ASSERT(NULL != arena_alloc(arena, 8));
+}
+
+void test_arena_destroy()
+{
+    arena_t *invalid_arena = NULL;
+
+    CU_ASSERT(FAILURE == arena_destroy(&invalid_arena));
+    CU_ASSERT(SUCCESS == arena_destroy(&arena));
+    CU_ASSERT(NULL == arena);
+}
+
+void test_slab_alloc_free()
+{
+    void *objects[OBJECTS] = {0};
+
+    CU_ASSERT(NULL == slab_init(24, 0));
+    slab = slab_init(24, 8);
+    CU_ASSERT_FATAL(NULL != slab);
+    CU_ASSERT(32 == slab->object_size);
+
+    for (int x = 0; x < OBJECTS; x++)
+    {
+        objects[x] = slab_alloc(slab);
+        CU_ASSERT_FATAL(NULL != objects[x]);
+        memset(objects[x], x, 24);
+    }
+    for (int x = 0; x < OBJECTS; x++)
+    {
+        CU_ASSERT(x == ((unsigned char *)objects[x])[23]);
+    }
+
+    // freed objects are handed out again, most recent first
+    slab_free(slab, objects[10]);
+    slab_free(slab, objects[20]);
+    CU_ASSERT(objects[20] == slab_alloc(slab));
+    CU_ASSERT(objects[10] == slab_alloc(slab));
+
+    CU_ASSERT(SUCCESS == slab_clear(slab));
+    CU_ASSERT(NULL == slab->free_list);
+    CU_ASSERT(NULL != slab_alloc(slab));
+
+    CU_ASSERT(SUCCESS == slab_destroy(&slab));
+    CU_ASSERT(NULL == slab);
+    CU_ASSERT(FAILURE == slab_destroy(&slab));
+}
+
+int main(void)
+{
+    CU_TestInfo suite1_tests[] = {
+        {"Testing arena_init():", test_arena_init},
+
+        {"Testing arena_alloc():", test_arena_alloc},
+
+        {"Testing arena_clear():", test_arena_clear},
+
+        {"Testing arena_destroy():", test_arena_destroy},
+
+        {"Testing slab_alloc() and slab_free():", test_slab_alloc_free},
+
+        CU_TEST_INFO_NULL};
+
+    CU_SuiteInfo suites[] = {
+        {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        CU_SUITE_INFO_NULL};
+
+    if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        return CU_get_error();
+    }
+
+    if (0 != CU_register_suites(suites))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_basic_show_failures(CU_get_failure_list());
+    int num_failed = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    puts("\n");
+    return num_failed;
+}
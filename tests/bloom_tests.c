@@ -0,0 +1,151 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <bloom.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPACITY 10000
+#define ABSENT_KEYS 100000
+
+bloom_t *bloom = NULL;
+
+int init_suite1(void)
+{
+    return 0;
+}
+
+int clean_suite1(void)
+{
+    return 0;
+}
+
+void test_bloom_init()
+{
+    CU_ASSERT(NULL == bloom_init(CAPACITY, 0));
+    CU_ASSERT(NULL == bloom_init(CAPACITY, 1));
+    CU_ASSERT(NULL == bloom_init(CAPACITY, -0.5));
+
+    bloom = bloom_init(CAPACITY, 0.01);
+    CU_ASSERT_FATAL(NULL != bloom);
+    CU_ASSERT(0 == bloom->count);
+    CU_ASSERT(CAPACITY == bloom->capacity);
+    // about 10 bits and 7 hashes per key at 1%
+    CU_ASSERT(7 == bloom->hashes);
+    CU_ASSERT(bloom->block_count * 512 >= 10 * CAPACITY);
+    CU_ASSERT(0 == ((uintptr_t)bloom->blocks & 63));
+}
+
+void test_bloom_add_contains()
+{
+    char key[32] = {0};
+
+    CU_ASSERT(FAILURE == bloom_add(NULL, "key", 3));
+    CU_ASSERT(FAILURE == bloom_add(bloom, NULL, 3));
+    CU_ASSERT(0 == bloom_contains(NULL, "key", 3));
+    CU_ASSERT(0 == bloom_contains(bloom, "key", 3));
+
+    // a key that was added always passes
+    for (int x = 0; x < CAPACITY; x++)
+    {
+        snprintf(key, sizeof(key), "key:%d", x);
+        CU_ASSERT(SUCCESS == bloom_add(bloom, key, strlen(key)));
+    }
+    CU_ASSERT(CAPACITY == bloom->count);
+    for (int x = 0; x < CAPACITY; x++)
+    {
+        snprintf(key, sizeof(key), "key:%d", x);
+        CU_ASSERT(0 != bloom_contains(bloom, key, strlen(key)));
+    }
+
+    bloom_add_hash(bloom, 0x0123456789abcdefULL);
+    CU_ASSERT(0 != bloom_contains_hash(bloom, 0x0123456789abcdefULL));
+}
+
+void test_bloom_false_positives()
+{
+    double rates[] = {0.1, 0.01, 0.001};
+    char key[32] = {0};
+
+    // the measured rate stays near the one the filter was sized for
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    {
+        bloom_t *sized = bloom_init(CAPACITY, rates[r]);
+        uint32_t passed = 0;
+        CU_ASSERT_FATAL(NULL != sized);
+
+        for (int x = 0; x < CAPACITY; x++)
+        {
+            snprintf(key, sizeof(key), "key:%d", x);
+            bloom_add(sized, key, strlen(key));
+        }
+        for (int x = 0; x < ABSENT_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "absent:%d", x);
+            passed += 0 != bloom_contains(sized, key, strlen(key));
+        }
+        CU_ASSERT((double)passed / ABSENT_KEYS <= 2 * rates[r]);
+        CU_ASSERT(SUCCESS == bloom_destroy(&sized));
+    }
+}
+
+void test_bloom_clear()
+{
+    char key[32] = {0};
+
+    CU_ASSERT(FAILURE == bloom_clear(NULL));
+    CU_ASSERT(SUCCESS == bloom_clear(bloom));
+    CU_ASSERT(0 == bloom->count);
+    for (int x = 0; x < CAPACITY; x++)
+    {
+        snprintf(key, sizeof(key), "key:%d", x);
+        CU_ASSERT(0 == bloom_contains(bloom, key, strlen(key)));
+    }
+}
+
+void test_bloom_destroy()
+{
+    CU_ASSERT(SUCCESS == bloom_destroy(&bloom));
+    CU_ASSERT(NULL == bloom);
+    CU_ASSERT(FAILURE == bloom_destroy(&bloom));
+    CU_ASSERT(FAILURE == bloom_destroy(NULL));
+}
+
+int main(void)
+{
+    CU_TestInfo suite1_tests[] = {
+        {"Testing bloom_init():", test_bloom_init},
+
+        {"Testing bloom_add() and bloom_contains():", test_bloom_add_contains},
+
+        {"Testing the false positive rate:", test_bloom_false_positives},
+
+        {"Testing bloom_clear():", test_bloom_clear},
+
+        {"Testing bloom_destroy():", test_bloom_destroy},
+
+        CU_TEST_INFO_NULL};
+
+    CU_SuiteInfo suites[] = {
+        {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        CU_SUITE_INFO_NULL};
+
+    if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        return CU_get_error();
+    }
+
+    if (0 != CU_register_suites(suites))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_basic_show_failures(CU_get_failure_list());
+    int num_failed = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    puts("\n");
+    return num_failed;
+}
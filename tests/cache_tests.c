@@ -0,0 +1,333 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <cache.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 10
+#define MANY_KEYS 5000
+
+cache_t *cache = NULL;
+int data[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+int freed = 0;
+int evicted = 0;
+
+int init_suite1(void)
+{
+    return 0;
+}
+
+int clean_suite1(void)
+{
+    return 0;
+}
+
+/**
+ * @brief counts frees instead of freeing the static data array
+ */
+static void count_free(void *mem_addr)
+{
+    (void)mem_addr;
+    freed++;
+}
+
+/**
+ * @brief counts evictions and checks each evicted key still holds its data
+ */
+static void count_evict(const char *key, uint32_t len, void *evicted_data,
+                        void *context)
+{
+    (void)context;
+    CU_ASSERT(strlen(key) == len);
+    CU_ASSERT(&data[atoi(key + 4)] == evicted_data);
+    evicted++;
+}
+
+void test_cache_init()
+{
+    cache_opts_t opts = {.policy = (cache_policy_t)3};
+
+    CU_ASSERT(NULL == cache_init(0, NULL));
+    CU_ASSERT(NULL == cache_init_ex(SIZE, NULL, &opts));
+
+    cache = cache_init(SIZE, count_free);
+    CU_ASSERT_FATAL(NULL != cache);
+    CU_ASSERT(NULL != cache->index);
+    CU_ASSERT(CACHE_POLICY_LRU == cache->policy);
+    CU_ASSERT(SIZE == cache->max_entries);
+    CU_ASSERT(0 == cache->count);
+}
+
+void test_cache_put_get()
+{
+    char key[64] = {0};
+
+    CU_ASSERT(FAILURE == cache_put(NULL, &data[0], "key:0", 1));
+    CU_ASSERT(FAILURE == cache_put(cache, NULL, "key:0", 1));
+    CU_ASSERT(FAILURE == cache_put(cache, &data[0], NULL, 1));
+    CU_ASSERT(NULL == cache_get(NULL, "key:0"));
+    CU_ASSERT(NULL == cache_get(cache, NULL));
+
+    for (int x = 0; x < SIZE; x++)
+    {
+        snprintf(key, sizeof(key), "key:%d", x);
+        CU_ASSERT(SUCCESS == cache_put(cache, &data[x], key, 1));
+    }
+    CU_ASSERT(SIZE == cache->count);
+    CU_ASSERT(&data[3] == cache_get(cache, "key:3"));
+    CU_ASSERT(NULL == cache_get(cache, "key:10"));
+
+    // key:0 is now the least recently used; key:3 was just used
+    CU_ASSERT(&data[0] == cache_get(cache, "key:0"));
+    CU_ASSERT(SUCCESS == cache_put(cache, &data[0], "key:10", 1));
+    CU_ASSERT(SIZE == cache->count);
+    CU_ASSERT(1 == freed);
+    CU_ASSERT(NULL == cache_get(cache, "key:1"));
+    CU_ASSERT(&data[0] == cache_get(cache, "key:0"));
+    CU_ASSERT(&data[3] == cache_get(cache, "key:3"));
+
+    // putting an existing key frees the data it replaces
+    CU_ASSERT(SUCCESS == cache_put(cache, &data[9], "key:3", 1));
+    CU_ASSERT(2 == freed);
+    CU_ASSERT(&data[9] == cache_get(cache, "key:3"));
+    CU_ASSERT(SUCCESS == cache_put(cache, &data[9], "key:3", 1));
+    CU_ASSERT(2 == freed);
+    CU_ASSERT(SIZE == cache->count);
+}
+
+void test_cache_remove()
+{
+    CU_ASSERT(FAILURE == cache_remove(NULL, "key:3"));
+    CU_ASSERT(FAILURE == cache_remove(cache, "key:1"));
+    CU_ASSERT(SUCCESS == cache_remove(cache, "key:3"));
+    CU_ASSERT(3 == freed);
+    CU_ASSERT(NULL == cache_get(cache, "key:3"));
+    CU_ASSERT(SIZE - 1 == cache->count);
+
+    // the least recently used of the rest goes first
+    CU_ASSERT(SUCCESS == cache_evict(cache));
+    CU_ASSERT(NULL == cache_get(cache, "key:2"));
+    CU_ASSERT(SIZE - 2 == cache->count);
+}
+
+void test_cache_max_bytes()
+{
+    cache_opts_t opts = {.max_bytes = 100};
+    cache_t *sized = cache_init_ex(0, count_free, &opts);
+    char key[64] = {0};
+    cache_stats_t stats = {0};
+    CU_ASSERT_FATAL(NULL != sized);
+
+    // an entry larger than the whole cache is refused
+    CU_ASSERT(FAILURE == cache_put(sized, &data[0], "huge", 101));
+
+    for (int x = 0; x < SIZE; x++)
+    {
+        snprintf(key, sizeof(key), "key:%d", x);
+        CU_ASSERT(SUCCESS == cache_put(sized, &data[x], key, 10));
+    }
+    CU_ASSERT(SUCCESS == cache_stats(sized, &stats));
+    CU_ASSERT(SIZE == stats.count);
+    CU_ASSERT(100 == stats.bytes);
+
+    // one large entry pushes out as many small ones as it needs
+    freed = 0;
+    CU_ASSERT(SUCCESS == cache_put(sized, &data[0], "big", 35));
+    CU_ASSERT(SUCCESS == cache_stats(sized, &stats));
+    CU_ASSERT(4 == stats.evictions);
+    CU_ASSERT(4 == freed);
+    CU_ASSERT(95 == stats.bytes);
+    CU_ASSERT(NULL == cache_get(sized, "key:3"));
+    CU_ASSERT(&data[4] == cache_get(sized, "key:4"));
+
+    // growing an entry in place evicts others, never the entry itself
+    CU_ASSERT(SUCCESS == cache_put(sized, &data[0], "big", 100));
+    CU_ASSERT(SUCCESS == cache_stats(sized, &stats));
+    CU_ASSERT(1 == stats.count);
+    CU_ASSERT(100 == stats.bytes);
+    CU_ASSERT(&data[0] == cache_get(sized, "big"));
+
+    CU_ASSERT(SUCCESS == cache_destroy(&sized));
+}
+
+void test_cache_slru()
+{
+    cache_opts_t opts = {.policy = CACHE_POLICY_SLRU};
+    cache_t *slru = cache_init_ex(SIZE, count_free, &opts);
+    char key[64] = {0};
+    CU_ASSERT_FATAL(NULL != slru);
+
+    // a working set used twice is protected
+    for (int x = 0; x < 5; x++)
+    {
+        snprintf(key, sizeof(key), "hot:%d", x);
+        CU_ASSERT(SUCCESS == cache_put(slru, &data[x], key, 1));
+        CU_ASSERT(&data[x] == cache_get(slru, key));
+    }
+    CU_ASSERT(5 == slru->segments[1].count);
+
+    // a long scan of keys read once only churns probation
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "scan:%d", x);
+        CU_ASSERT(SUCCESS == cache_put(slru, &data[x % 10], key, 1));
+    }
+    CU_ASSERT(SIZE == slru->count);
+    for (int x = 0; x < 5; x++)
+    {
+        snprintf(key, sizeof(key), "hot:%d", x);
+        CU_ASSERT(&data[x] == cache_get(slru, key));
+    }
+
+    // the protected segment keeps to 4/5 of the capacity
+    for (int x = 0; x < SIZE; x++)
+    {
+        snprintf(key, sizeof(key), "warm:%d", x);
+        CU_ASSERT(SUCCESS == cache_put(slru, &data[x], key, 1));
+        CU_ASSERT(&data[x] == cache_get(slru, key));
+    }
+    CU_ASSERT(SIZE - SIZE / 5 == slru->segments[1].count);
+    CU_ASSERT(SIZE == slru->count);
+
+    CU_ASSERT(SUCCESS == cache_destroy(&slru));
+}
+
+void test_cache_lfu()
+{
+    cache_opts_t opts = {.policy = CACHE_POLICY_LFU,
+                         .on_evict = count_evict};
+    cache_t *lfu = cache_init_ex(SIZE, count_free, &opts);
+    char key[64] = {0};
+    cache_stats_t stats = {0};
+    CU_ASSERT_FATAL(NULL != lfu);
+
+    // key:x is used x more times after it is put
+    for (int x = 0; x < SIZE; x++)
+    {
+        snprintf(key, sizeof(key), "key:%d", x);
+        CU_ASSERT(SUCCESS == cache_put(lfu, &data[x], key, 1));
+        for (int y = 0; y < x; y++)
+        {
+            CU_ASSERT(&data[x] == cache_get(lfu, key));
+        }
+    }
+    CU_ASSERT(1 == lfu->lowest->frequency);
+    CU_ASSERT(NULL == lfu->lowest->prev);
+
+    // new keys are never evicted by their own put, so each one pushes out
+    // the previous new key before touching the frequently used ones
+    freed = 0;
+    evicted = 0;
+    for (int x = 0; x < SIZE; x++)
+    {
+        snprintf(key, sizeof(key), "new:%d", x);
+        CU_ASSERT(SUCCESS == cache_put(lfu, &data[x], key, 1));
+    }
+    CU_ASSERT(0 == freed);
+    CU_ASSERT(10 == evicted);
+    CU_ASSERT(NULL == cache_get(lfu, "key:0"));
+    for (int x = 1; x < SIZE; x++)
+    {
+        snprintf(key, sizeof(key), "key:%d", x);
+        CU_ASSERT(&data[x] == cache_get(lfu, key));
+    }
+
+    // ties are broken by recency
+    CU_ASSERT(SUCCESS == cache_evict(lfu));
+    CU_ASSERT(NULL == cache_get(lfu, "new:9"));
+    CU_ASSERT(SUCCESS == cache_evict(lfu));
+    CU_ASSERT(NULL == cache_get(lfu, "key:1"));
+
+    CU_ASSERT(SUCCESS == cache_stats(lfu, &stats));
+    CU_ASSERT(SIZE - 2 == stats.count);
+    CU_ASSERT(12 == stats.evictions);
+    CU_ASSERT(SUCCESS == cache_destroy(&lfu));
+}
+
+void test_cache_stats()
+{
+    cache_stats_t stats = {0};
+
+    CU_ASSERT(FAILURE == cache_stats(NULL, &stats));
+    CU_ASSERT(FAILURE == cache_stats(cache, NULL));
+    CU_ASSERT(SUCCESS == cache_stats(cache, &stats));
+    CU_ASSERT(SIZE - 2 == stats.count);
+    CU_ASSERT(SIZE - 2 == stats.bytes);
+    CU_ASSERT(2 == stats.evictions);
+    CU_ASSERT(5 == stats.hits);
+    CU_ASSERT(4 == stats.misses);
+}
+
+void test_cache_clear()
+{
+    cache_stats_t stats = {0};
+
+    freed = 0;
+    CU_ASSERT(FAILURE == cache_clear(NULL));
+    CU_ASSERT(SUCCESS == cache_clear(cache));
+    CU_ASSERT(SIZE - 2 == freed);
+    CU_ASSERT(SUCCESS == cache_stats(cache, &stats));
+    CU_ASSERT(0 == stats.count);
+    CU_ASSERT(0 == stats.bytes);
+    CU_ASSERT(NULL == cache_get(cache, "key:0"));
+    CU_ASSERT(FAILURE == cache_evict(cache));
+    CU_ASSERT(SUCCESS == cache_put(cache, &data[1], "key:1", 1));
+}
+
+void test_cache_destroy()
+{
+    freed = 0;
+    CU_ASSERT(SUCCESS == cache_destroy(&cache));
+    CU_ASSERT(1 == freed);
+    CU_ASSERT(NULL == cache);
+    CU_ASSERT(FAILURE == cache_destroy(&cache));
+    CU_ASSERT(FAILURE == cache_destroy(NULL));
+}
+
+int main(void)
+{
+    CU_TestInfo suite1_tests[] = {
+        {"Testing cache_init():", test_cache_init},
+
+        {"Testing cache_put() and cache_get():", test_cache_put_get},
+
+        {"Testing cache_remove() and cache_evict():", test_cache_remove},
+
+        {"Testing a cache limited in bytes:", test_cache_max_bytes},
+
+        {"Testing the segmented LRU policy:", test_cache_slru},
+
+        {"Testing the LFU policy:", test_cache_lfu},
+
+        {"Testing cache_stats():", test_cache_stats},
+
+        {"Testing cache_clear():", test_cache_clear},
+
+        {"Testing cache_destroy():", test_cache_destroy},
+
+        CU_TEST_INFO_NULL};
+
+    CU_SuiteInfo suites[] = {
+        {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        CU_SUITE_INFO_NULL};
+
+    if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        return CU_get_error();
+    }
+
+    if (0 != CU_register_suites(suites))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_basic_show_failures(CU_get_failure_list());
+    int num_failed = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    puts("\n");
+    return num_failed;
+}
@@ -0,0 +1,238 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <hash_map_u64.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 10
+#define MANY_KEYS 50000
+
+hash_map_u64_t *map = NULL;
+
+int init_suite1(void)
+{
+    return 0;
+}
+
+int clean_suite1(void)
+{
+    return 0;
+}
+
+void test_hash_map_u64_init()
+{
+    map = hash_map_u64_init(SIZE);
+    CU_ASSERT_FATAL(NULL != map);
+    CU_ASSERT(NULL != map->entries);
+    CU_ASSERT(0 == map->count);
+    // the slot array is a power of two with room for size keys
+    CU_ASSERT(0 == (map->capacity & (map->capacity - 1)));
+    CU_ASSERT(SIZE <= map->capacity);
+}
+
+void test_hash_map_u64_put_get()
+{
+    uint64_t value = 0;
+
+    CU_ASSERT(FAILURE == hash_map_u64_put(NULL, 1, 1));
+    CU_ASSERT(FAILURE == hash_map_u64_get(NULL, 1, &value));
+    CU_ASSERT(FAILURE == hash_map_u64_get(map, 1, &value));
+
+    CU_ASSERT(SUCCESS == hash_map_u64_put(map, 1, 100));
+    CU_ASSERT(SUCCESS == hash_map_u64_put(map, UINT64_MAX, 200));
+    CU_ASSERT(SUCCESS == hash_map_u64_get(map, 1, &value));
+    CU_ASSERT(100 == value);
+    CU_ASSERT(SUCCESS == hash_map_u64_get(map, UINT64_MAX, &value));
+    CU_ASSERT(200 == value);
+    CU_ASSERT(SUCCESS == hash_map_u64_get(map, 1, NULL));
+    CU_ASSERT(2 == map->count);
+
+    // putting an existing key replaces its value
+    CU_ASSERT(SUCCESS == hash_map_u64_put(map, 1, 101));
+    CU_ASSERT(SUCCESS == hash_map_u64_get(map, 1, &value));
+    CU_ASSERT(101 == value);
+    CU_ASSERT(2 == map->count);
+
+    // key 0 is stored beside the slot array
+    CU_ASSERT(FAILURE == hash_map_u64_get(map, 0, &value));
+    CU_ASSERT(SUCCESS == hash_map_u64_put(map, 0, 7));
+    CU_ASSERT(SUCCESS == hash_map_u64_get(map, 0, &value));
+    CU_ASSERT(7 == value);
+    CU_ASSERT(3 == map->count);
+
+    // growing keeps every key
+    for (uint64_t x = 2; x < MANY_KEYS; x++)
+    {
+        CU_ASSERT(SUCCESS == hash_map_u64_put(map, x, x * 3));
+    }
+    CU_ASSERT(MANY_KEYS + 1 == map->count);
+    CU_ASSERT(map->count <= map->capacity - map->capacity / 4);
+    for (uint64_t x = 2; x < MANY_KEYS; x++)
+    {
+        CU_ASSERT(SUCCESS == hash_map_u64_get(map, x, &value));
+        CU_ASSERT(x * 3 == value);
+    }
+    CU_ASSERT(FAILURE == hash_map_u64_get(map, MANY_KEYS, &value));
+}
+
+void test_hash_map_u64_get_or_insert()
+{
+    hash_map_u64_t *counts = hash_map_u64_init(0);
+    uint64_t *slot = NULL;
+    uint64_t value = 0;
+    CU_ASSERT_FATAL(NULL != counts);
+
+    CU_ASSERT(NULL == hash_map_u64_get_or_insert(NULL, 1, 0));
+
+    // count occurrences in place, one probe per id
+    for (uint64_t x = 0; x < 3000; x++)
+    {
+        slot = hash_map_u64_get_or_insert(counts, x % 1000, 0);
+        CU_ASSERT_FATAL(NULL != slot);
+        (*slot)++;
+    }
+    CU_ASSERT(1000 == counts->count);
+    for (uint64_t x = 0; x < 1000; x++)
+    {
+        CU_ASSERT(SUCCESS == hash_map_u64_get(counts, x, &value));
+        CU_ASSERT(3 == value);
+    }
+
+    // an existing key keeps its value
+    slot = hash_map_u64_get_or_insert(counts, 5, 99);
+    CU_ASSERT_FATAL(NULL != slot);
+    CU_ASSERT(3 == *slot);
+
+    CU_ASSERT(SUCCESS == hash_map_u64_destroy(&counts));
+}
+
+void test_hash_map_u64_remove()
+{
+    uint64_t value = 0;
+
+    CU_ASSERT(FAILURE == hash_map_u64_remove(NULL, 1, NULL));
+    CU_ASSERT(FAILURE == hash_map_u64_remove(map, MANY_KEYS, NULL));
+
+    CU_ASSERT(SUCCESS == hash_map_u64_remove(map, 0, &value));
+    CU_ASSERT(7 == value);
+    CU_ASSERT(FAILURE == hash_map_u64_remove(map, 0, &value));
+    CU_ASSERT(FAILURE == hash_map_u64_get(map, 0, NULL));
+
+    // removing shifts later keys back, every other key must stay reachable
+    for (uint64_t x = 2; x < MANY_KEYS; x += 2)
+    {
+        CU_ASSERT(SUCCESS == hash_map_u64_remove(map, x, &value));
+        CU_ASSERT(x * 3 == value);
+    }
+    CU_ASSERT(MANY_KEYS / 2 + 1 == map->count);
+    for (uint64_t x = 2; x < MANY_KEYS; x++)
+    {
+        CU_ASSERT((x % 2 ? SUCCESS : FAILURE) ==
+                  hash_map_u64_get(map, x, &value));
+    }
+
+    // freed slots are reused
+    for (uint64_t x = 2; x < MANY_KEYS; x += 2)
+    {
+        CU_ASSERT(SUCCESS == hash_map_u64_put(map, x, x));
+    }
+    CU_ASSERT(MANY_KEYS == map->count);
+}
+
+void test_hash_map_u64_next()
+{
+    hash_map_u64_t *small = hash_map_u64_init(0);
+    uint64_t cursor = 0;
+    uint64_t key = 0;
+    uint64_t value = 0;
+    uint64_t key_sum = 0;
+    uint64_t value_sum = 0;
+    uint32_t visited = 0;
+    CU_ASSERT_FATAL(NULL != small);
+
+    CU_ASSERT(FAILURE == hash_map_u64_next(small, &cursor, &key, &value));
+    CU_ASSERT(FAILURE == hash_map_u64_next(NULL, &cursor, &key, &value));
+
+    for (uint64_t x = 0; x < 100; x++)
+    {
+        CU_ASSERT(SUCCESS == hash_map_u64_put(small, x, x + 1));
+    }
+    cursor = 0;
+    while (SUCCESS == hash_map_u64_next(small, &cursor, &key, &value))
+    {
+        key_sum += key;
+        value_sum += value;
+        visited++;
+    }
+    CU_ASSERT(100 == visited);
+    CU_ASSERT(99 * 100 / 2 == key_sum);
+    CU_ASSERT(100 * 101 / 2 == value_sum);
+
+    CU_ASSERT(SUCCESS == hash_map_u64_destroy(&small));
+}
+
+void test_hash_map_u64_clear()
+{
+    uint32_t capacity = map->capacity;
+
+    CU_ASSERT(FAILURE == hash_map_u64_clear(NULL));
+    CU_ASSERT(SUCCESS == hash_map_u64_clear(map));
+    CU_ASSERT(0 == map->count);
+    CU_ASSERT(capacity == map->capacity);
+    CU_ASSERT(FAILURE == hash_map_u64_get(map, 1, NULL));
+    CU_ASSERT(SUCCESS == hash_map_u64_put(map, 1, 1));
+}
+
+void test_hash_map_u64_destroy()
+{
+    CU_ASSERT(SUCCESS == hash_map_u64_destroy(&map));
+    CU_ASSERT(NULL == map);
+    CU_ASSERT(FAILURE == hash_map_u64_destroy(&map));
+    CU_ASSERT(FAILURE == hash_map_u64_destroy(NULL));
+}
+
+int main(void)
+{
+    CU_TestInfo suite1_tests[] = {
+        {"Testing hash_map_u64_init():", test_hash_map_u64_init},
+
+        {"Testing hash_map_u64_put() and hash_map_u64_get():",
+         test_hash_map_u64_put_get},
+
+        {"Testing hash_map_u64_get_or_insert():",
+         test_hash_map_u64_get_or_insert},
+
+        {"Testing hash_map_u64_remove():", test_hash_map_u64_remove},
+
+        {"Testing hash_map_u64_next():", test_hash_map_u64_next},
+
+        {"Testing hash_map_u64_clear():", test_hash_map_u64_clear},
+
+        {"Testing hash_map_u64_destroy():", test_hash_map_u64_destroy},
+
+        CU_TEST_INFO_NULL};
+
+    CU_SuiteInfo suites[] = {
+        {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        CU_SUITE_INFO_NULL};
+
+    if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        return CU_get_error();
+    }
+
+    if (0 != CU_register_suites(suites))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_basic_show_failures(CU_get_failure_list());
+    int num_failed = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    puts("\n");
+    return num_failed;
+}
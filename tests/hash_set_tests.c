@@ -0,0 +1,297 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <hash_set.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 10
+#define MANY_KEYS 20000
+
+hash_set_t *set = NULL;
+
+int init_suite1(void)
+{
+    return 0;
+}
+
+int clean_suite1(void)
+{
+    return 0;
+}
+
+/**
+ * @brief builds a set of the keys "key:first" up to "key:last - 1"
+ */
+static hash_set_t *make_range(uint32_t first, uint32_t last)
+{
+    hash_set_t *range = hash_set_init(0);
+    char key[64] = {0};
+
+    for (uint32_t x = first; NULL != range && x < last; x++)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT(SUCCESS == hash_set_add(range, key));
+    }
+
+    return range;
+}
+
+/**
+ * @brief checks a set holds exactly the keys "key:first" up to
+ *        "key:last - 1"
+ */
+static void check_range(const hash_set_t *range, uint32_t first,
+                        uint32_t last)
+{
+    char key[64] = {0};
+
+    CU_ASSERT_FATAL(NULL != range);
+    CU_ASSERT(last - first == range->count);
+    for (uint32_t x = first; x < last; x++)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT(hash_set_contains(range, key));
+    }
+}
+
+void test_hash_set_init()
+{
+    set = hash_set_init(SIZE);
+    CU_ASSERT_FATAL(NULL != set);
+    CU_ASSERT(0 == set->count);
+    // the slot array is a power of two multiple of the group width
+    CU_ASSERT(0 == (set->capacity & (set->capacity - 1)));
+    CU_ASSERT(0 == set->capacity % 16);
+    CU_ASSERT(SIZE <= set->growth_left);
+    // a slot is a key pointer, a length and a hash, with no data pointer
+    CU_ASSERT(16 == sizeof(hash_set_slot_t));
+}
+
+void test_hash_set_add_contains()
+{
+    char key[64] = {0};
+
+    CU_ASSERT(FAILURE == hash_set_add(NULL, "key"));
+    CU_ASSERT(FAILURE == hash_set_add(set, NULL));
+    CU_ASSERT(!hash_set_contains(NULL, "key"));
+    CU_ASSERT(!hash_set_contains(set, NULL));
+    CU_ASSERT(!hash_set_contains(set, "key"));
+
+    CU_ASSERT(SUCCESS == hash_set_add(set, "key"));
+    CU_ASSERT(FAILURE == hash_set_add(set, "key"));
+    CU_ASSERT(hash_set_contains(set, "key"));
+    CU_ASSERT(1 == set->count);
+
+    // keys are byte strings: embedded NUL bytes and the empty key count
+    CU_ASSERT(SUCCESS == hash_set_add_n(set, "a\0b", 3));
+    CU_ASSERT(SUCCESS == hash_set_add_n(set, "a\0c", 3));
+    CU_ASSERT(SUCCESS == hash_set_add_n(set, "", 0));
+    CU_ASSERT(hash_set_contains_n(set, "a\0b", 3));
+    CU_ASSERT(!hash_set_contains_n(set, "a", 1));
+    CU_ASSERT(hash_set_contains(set, ""));
+    CU_ASSERT(4 == set->count);
+
+    // the set keeps its own copy of every key
+    snprintf(key, sizeof(key), "copied");
+    CU_ASSERT(SUCCESS == hash_set_add(set, key));
+    memset(key, 'x', 6);
+    CU_ASSERT(hash_set_contains(set, "copied"));
+
+    // growing keeps every key
+    for (uint32_t x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT(SUCCESS == hash_set_add(set, key));
+    }
+    CU_ASSERT(MANY_KEYS + 5 == set->count);
+    CU_ASSERT(set->count <= set->capacity - set->capacity / 8);
+    for (uint32_t x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT(hash_set_contains(set, key));
+    }
+    CU_ASSERT(!hash_set_contains(set, "key:20000"));
+}
+
+void test_hash_set_remove()
+{
+    char key[64] = {0};
+    uint32_t capacity = set->capacity;
+
+    CU_ASSERT(FAILURE == hash_set_remove(NULL, "key"));
+    CU_ASSERT(FAILURE == hash_set_remove(set, "missing"));
+    CU_ASSERT(SUCCESS == hash_set_remove(set, "key"));
+    CU_ASSERT(FAILURE == hash_set_remove(set, "key"));
+    CU_ASSERT(SUCCESS == hash_set_remove_n(set, "a\0b", 3));
+    CU_ASSERT(hash_set_contains_n(set, "a\0c", 3));
+
+    for (uint32_t x = 0; x < MANY_KEYS; x += 2)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT(SUCCESS == hash_set_remove(set, key));
+    }
+    CU_ASSERT(MANY_KEYS / 2 + 3 == set->count);
+    for (uint32_t x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT((x % 2) == (uint32_t)!!hash_set_contains(set, key));
+    }
+
+    // adding and removing in turn reuses slots instead of growing
+    for (uint32_t x = 0; x < 4 * MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "churn:%u", x);
+        CU_ASSERT(SUCCESS == hash_set_add(set, key));
+        CU_ASSERT(SUCCESS == hash_set_remove(set, key));
+    }
+    CU_ASSERT(capacity == set->capacity);
+    CU_ASSERT(MANY_KEYS / 2 + 3 == set->count);
+    // removed key bytes are reclaimed once they outweigh the live ones
+    CU_ASSERT(set->dead_bytes <= set->live_bytes + 64 * 1024);
+    CU_ASSERT(hash_set_contains(set, "key:1"));
+    CU_ASSERT(hash_set_contains(set, "copied"));
+}
+
+void test_hash_set_next()
+{
+    uint64_t cursor = 0;
+    const char *key = NULL;
+    uint32_t len = 0;
+    uint32_t seen = 0;
+    uint32_t empty = 0;
+
+    CU_ASSERT(FAILURE == hash_set_next(NULL, &cursor, &key, &len));
+    CU_ASSERT(FAILURE == hash_set_next(set, NULL, &key, &len));
+
+    while (SUCCESS == hash_set_next(set, &cursor, &key, &len))
+    {
+        CU_ASSERT(hash_set_contains_n(set, key, len));
+        empty += 0 == len;
+        seen++;
+    }
+    CU_ASSERT(set->count == seen);
+    CU_ASSERT(1 == empty);
+    CU_ASSERT(FAILURE == hash_set_next(set, &cursor, &key, NULL));
+}
+
+void test_hash_set_operations()
+{
+    // a holds keys 0 to 999, b holds keys 500 to 9999
+    hash_set_t *a = make_range(0, 1000);
+    hash_set_t *b = make_range(500, 10000);
+    hash_set_t *empty = hash_set_init(0);
+    hash_set_t *result = NULL;
+    CU_ASSERT_FATAL(NULL != a && NULL != b && NULL != empty);
+
+    CU_ASSERT(NULL == hash_set_union(NULL, b));
+    CU_ASSERT(NULL == hash_set_intersection(a, NULL));
+    CU_ASSERT(NULL == hash_set_difference(NULL, NULL));
+    CU_ASSERT(0 == hash_set_intersection_count(a, NULL));
+
+    result = hash_set_union(a, b);
+    check_range(result, 0, 10000);
+    hash_set_destroy(&result);
+    result = hash_set_union(b, a);
+    check_range(result, 0, 10000);
+    hash_set_destroy(&result);
+
+    // the smaller set is walked whichever side it is passed on
+    result = hash_set_intersection(a, b);
+    check_range(result, 500, 1000);
+    hash_set_destroy(&result);
+    result = hash_set_intersection(b, a);
+    check_range(result, 500, 1000);
+    hash_set_destroy(&result);
+    CU_ASSERT(500 == hash_set_intersection_count(a, b));
+    CU_ASSERT(500 == hash_set_intersection_count(b, a));
+
+    result = hash_set_difference(a, b);
+    check_range(result, 0, 500);
+    CU_ASSERT(!hash_set_contains(result, "key:500"));
+    hash_set_destroy(&result);
+    result = hash_set_difference(b, a);
+    check_range(result, 1000, 10000);
+    hash_set_destroy(&result);
+
+    // the results own their keys, so they outlive their operands
+    result = hash_set_union(a, empty);
+    check_range(result, 0, 1000);
+    hash_set_destroy(&a);
+    check_range(result, 0, 1000);
+    hash_set_destroy(&result);
+
+    result = hash_set_intersection(b, empty);
+    CU_ASSERT(NULL != result && 0 == result->count);
+    hash_set_destroy(&result);
+    CU_ASSERT(0 == hash_set_intersection_count(empty, b));
+    result = hash_set_difference(empty, b);
+    CU_ASSERT(NULL != result && 0 == result->count);
+    hash_set_destroy(&result);
+
+    hash_set_destroy(&b);
+    hash_set_destroy(&empty);
+}
+
+void test_hash_set_clear()
+{
+    CU_ASSERT(FAILURE == hash_set_clear(NULL));
+    CU_ASSERT(SUCCESS == hash_set_clear(set));
+    CU_ASSERT(0 == set->count);
+    CU_ASSERT(0 == set->live_bytes);
+    CU_ASSERT(!hash_set_contains(set, "key:1"));
+    CU_ASSERT(SUCCESS == hash_set_add(set, "key:1"));
+    CU_ASSERT(hash_set_contains(set, "key:1"));
+}
+
+void test_hash_set_destroy()
+{
+    CU_ASSERT(SUCCESS == hash_set_destroy(&set));
+    CU_ASSERT(NULL == set);
+    CU_ASSERT(FAILURE == hash_set_destroy(&set));
+    CU_ASSERT(FAILURE == hash_set_destroy(NULL));
+}
+
+int main(void)
+{
+    CU_TestInfo suite1_tests[] = {
+        {"Testing hash_set_init():", test_hash_set_init},
+
+        {"Testing hash_set_add() and hash_set_contains():",
+         test_hash_set_add_contains},
+
+        {"Testing hash_set_remove():", test_hash_set_remove},
+
+        {"Testing hash_set_next():", test_hash_set_next},
+
+        {"Testing set operations:", test_hash_set_operations},
+
+        {"Testing hash_set_clear():", test_hash_set_clear},
+
+        {"Testing hash_set_destroy():", test_hash_set_destroy},
+
+        CU_TEST_INFO_NULL};
+
+    CU_SuiteInfo suites[] = {
+        {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        CU_SUITE_INFO_NULL};
+
+    if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        return CU_get_error();
+    }
+
+    if (0 != CU_register_suites(suites))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_basic_show_failures(CU_get_failure_list());
+    int num_failed = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    puts("\n");
+    return num_failed;
+}
@@ -1,11 +1,18 @@
 #include <CUnit/Basic.h>
 #include <CUnit/CUnit.h>
+#include <bloom.h>
 #include <hash_table.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #define SIZE 10
+#define MANY_KEYS 5000
+#define THREADS 4
+#define STATS_READERS 72
+#define STATS_ROUNDS 2
 hash_table_t *hash_table = NULL;
 int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
 int properly_implemented_free = 1;
@@ -28,7 +35,9 @@ void test_hash_table_init()
     hash_table = hash_table_init(SIZE, NULL);
     CU_ASSERT_FATAL(NULL != hash_table);
     CU_ASSERT(NULL != hash_table->table); // NOLINT
-    CU_ASSERT(SIZE == hash_table->size);
+    // bucket count is rounded up to a power of two for mask indexing
+    CU_ASSERT(SIZE <= hash_table->size);
+    CU_ASSERT(0 == (hash_table->size & (hash_table->size - 1)));
     // Ensure that free is substituted in the event that a custom
     // free function isnt supplied
     CU_ASSERT(free == hash_table->customfree);
@@ -170,6 +179,1790 @@ void test_hash_table_destroy()
     CU_ASSERT(FAILURE == exit_code);
 }
 
+void test_hash_table_init_ex()
+{
+    hash_table_opts_t opts = {.max_load_factor = 2.0, .rehash_step = 4};
+    hash_table_t *table = hash_table_init_ex(SIZE, NULL, &opts);
+    CU_ASSERT_FATAL(NULL != table);
+    CU_ASSERT(HASH_ENGINE_CHAINED == table->engine);
+    CU_ASSERT(16 == table->size);
+    CU_ASSERT(0 == table->count);
+    CU_ASSERT(HASH_FUNC_WY == table->hash_func);
+    CU_ASSERT(0 != table->seed[0] || 0 != table->seed[1]);
+    CU_ASSERT(2.0 == table->max_load_factor);
+    CU_ASSERT(0.1 == table->min_load_factor);
+    CU_ASSERT(4 == table->rehash_step);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+    // defaults
+    table = hash_table_init_ex(SIZE, NULL, NULL);
+    CU_ASSERT_FATAL(NULL != table);
+    CU_ASSERT(1.0 == table->max_load_factor);
+    CU_ASSERT(1 == table->rehash_step);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+    // shrinking must not immediately trigger growth again
+    opts.min_load_factor = 1.5;
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &opts));
+    opts.min_load_factor = 0;
+    opts.max_load_factor = -1.0;
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &opts));
+    opts.max_load_factor = 0;
+    opts.hash_func = (hash_func_t)42;
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &opts));
+    CU_ASSERT(NULL == hash_table_init_ex(0, NULL, NULL));
+}
+
+void test_hash_table_rehash()
+{
+    char key[32] = {0};
+    int seen_rehash = 0;
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    CU_ASSERT_FATAL(NULL != table);
+
+    // grow: every key must stay reachable while buckets are being moved
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "grow:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[x % 10], key));
+        if (NULL != table->rehash_table)
+        {
+            seen_rehash = 1;
+            CU_ASSERT((void *)&data[0] == hash_table_lookup(table, "grow:0"));
+        }
+    }
+    CU_ASSERT(1 == seen_rehash);
+    CU_ASSERT(MANY_KEYS == table->count);
+    CU_ASSERT(table->size >= MANY_KEYS / 2);
+    CU_ASSERT(table->count <= 2 * table->size * table->max_load_factor);
+
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "grow:%d", x);
+        CU_ASSERT((void *)&data[x % 10] == hash_table_lookup(table, key));
+    }
+
+    // duplicates added mid-rehash still resolve to the oldest entry
+    CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[9], "grow:0"));
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        CU_ASSERT((void *)&data[0] == hash_table_lookup(table, "grow:0"));
+    }
+    CU_ASSERT(SUCCESS == hash_table_remove(table, "grow:0"));
+    CU_ASSERT((void *)&data[9] == hash_table_lookup(table, "grow:0"));
+
+    // shrink back down, but never below the initial size
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "grow:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_remove(table, key));
+    }
+    CU_ASSERT(0 == table->count);
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        hash_table_lookup(table, "grow:1");
+    }
+    CU_ASSERT(table->size < MANY_KEYS / 2);
+    CU_ASSERT(table->size >= SIZE);
+
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+void test_hash_table_hash_funcs()
+{
+    char key[32] = {0};
+    uint8_t message[15] = {0};
+    const uint64_t sip_key[2] = {0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+    const uint64_t seed_a[2] = {1, 2};
+    const uint64_t seed_b[2] = {3, 4};
+
+    // SipHash-2-4 reference vector: key 00..0f, message 00..0e
+    for (int x = 0; x < 15; x++)
+    {
+        message[x] = (uint8_t)x;
+    }
+    CU_ASSERT(0xa129ca6149be45e5ULL == hash_func_sip(message, 15, sip_key));
+
+    // seeds change the hash, equal seeds reproduce it
+    CU_ASSERT(hash_func_wy("tenant:1234:a", 13, seed_a) ==
+              hash_func_wy("tenant:1234:a", 13, seed_a));
+    CU_ASSERT(hash_func_wy("tenant:1234:a", 13, seed_a) !=
+              hash_func_wy("tenant:1234:a", 13, seed_b));
+    CU_ASSERT(hash_func_sip("tenant:1234:a", 13, seed_a) !=
+              hash_func_sip("tenant:1234:a", 13, seed_b));
+    CU_ASSERT(hash_func_wy("tenant:1234:a", 13, seed_a) !=
+              hash_func_wy("tenant:1234:b", 13, seed_a));
+    CU_ASSERT(hash_func_poly31("ab", 2, seed_a) == 'a' * 31 + 'b');
+
+    for (hash_func_t func = HASH_FUNC_WY; func <= HASH_FUNC_POLY31; func++)
+    {
+        hash_table_opts_t opts = {.hash_func = func, .seed = {5, 6}};
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &opts);
+        CU_ASSERT_FATAL(NULL != table);
+        CU_ASSERT(hash_func_get(func) == table->hash);
+        CU_ASSERT(5 == table->seed[0] && 6 == table->seed[1]);
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "tenant:%d:%d", x % 7, x);
+            CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[x % 10], key));
+        }
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "tenant:%d:%d", x % 7, x);
+            CU_ASSERT((void *)&data[x % 10] == hash_table_lookup(table, key));
+        }
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+}
+
+void test_hash_table_node_keys()
+{
+    const char *long_key = "tenant:1234:session:0123456789abcdef";
+    hash_table_opts_t opts = {.hash_func = HASH_FUNC_POLY31};
+    hash_table_t *table = hash_table_init_ex(1, NULL, &opts);
+    CU_ASSERT_FATAL(NULL != table);
+    CU_ASSERT(64 >= sizeof(node_t));
+
+    // short keys live inside the node, long ones on the heap
+    CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[1], "short"));
+    CU_ASSERT(SUCCESS ==
+              hash_table_add(table, (void *)&data[2], (char *)long_key));
+    node_t *first = table->table[0];
+    CU_ASSERT_FATAL(NULL != first && NULL != first->next);
+    CU_ASSERT(first->key == first->key_inline);
+    CU_ASSERT(5 == first->key_len);
+    CU_ASSERT(table->hash("short", 5, table->seed) == first->hash);
+    CU_ASSERT(first->next->key != first->next->key_inline);
+    CU_ASSERT(strlen(long_key) == first->next->key_len);
+    CU_ASSERT(0 == strcmp(long_key, first->next->key));
+
+    // "Aa" and "BB" share a poly31 hash and a length, only the bytes differ
+    CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[3], "Aa"));
+    CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[4], "BB"));
+    CU_ASSERT((void *)&data[3] == hash_table_lookup(table, "Aa"));
+    CU_ASSERT((void *)&data[4] == hash_table_lookup(table, "BB"));
+    CU_ASSERT((void *)&data[2] == hash_table_lookup(table, (char *)long_key));
+    CU_ASSERT(NULL == hash_table_lookup(table, "tenant:1234:session"));
+
+    CU_ASSERT(SUCCESS == hash_table_remove(table, "Aa"));
+    CU_ASSERT(NULL == hash_table_lookup(table, "Aa"));
+    CU_ASSERT((void *)&data[4] == hash_table_lookup(table, "BB"));
+    CU_ASSERT(SUCCESS == hash_table_remove(table, (char *)long_key));
+    CU_ASSERT(NULL == hash_table_lookup(table, (char *)long_key));
+
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+void test_hash_table_slab()
+{
+    char key[64] = {0};
+    hash_table_opts_t opts = {.use_slab = 1};
+
+    for (int engine = HASH_ENGINE_CHAINED; engine <= HASH_ENGINE_CUCKOO;
+         engine++)
+    {
+        opts.engine = (hash_engine_t)engine;
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &opts);
+        CU_ASSERT_FATAL(NULL != table);
+        CU_ASSERT(NULL != table->node_slab);
+        CU_ASSERT(NULL != table->key_arena);
+
+        // mix of inline and arena allocated keys
+        for (int round = 0; round < 2; round++)
+        {
+            for (int x = 0; x < MANY_KEYS; x++)
+            {
+                snprintf(key, sizeof(key), (x % 2) ? "slab:%d" :
+                         "slab:a-key-long-enough-for-the-arena:%d", x);
+                CU_ASSERT(SUCCESS ==
+                          hash_table_add(table, (void *)&data[x % 10], key));
+            }
+            for (int x = 0; x < MANY_KEYS; x += 3)
+            {
+                snprintf(key, sizeof(key), (x % 2) ? "slab:%d" :
+                         "slab:a-key-long-enough-for-the-arena:%d", x);
+                CU_ASSERT(SUCCESS == hash_table_remove(table, key));
+            }
+            for (int x = 0; x < MANY_KEYS; x++)
+            {
+                snprintf(key, sizeof(key), (x % 2) ? "slab:%d" :
+                         "slab:a-key-long-enough-for-the-arena:%d", x);
+                CU_ASSERT(((x % 3) ? (void *)&data[x % 10] : NULL) ==
+                          hash_table_lookup(table, key));
+            }
+            CU_ASSERT(SUCCESS == hash_table_clear(table));
+            CU_ASSERT(NULL == hash_table_lookup(table, "slab:1"));
+        }
+
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+}
+
+void test_hash_table_concurrent_init()
+{
+    hash_table_opts_t opts = {.sync = HASH_SYNC_STRIPED, .lock_stripes = 16};
+    hash_table_t *table = hash_table_init_concurrent(SIZE, NULL);
+
+    CU_ASSERT_FATAL(NULL != table);
+    CU_ASSERT(HASH_SYNC_STRIPED == table->sync);
+    CU_ASSERT(NULL != table->sync_data);
+    // the bucket count is raised to the default stripe count
+    CU_ASSERT(64 <= table->size);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+    table = hash_table_init_ex(SIZE, NULL, &opts);
+    CU_ASSERT_FATAL(NULL != table);
+    CU_ASSERT(16 == table->size);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+    opts.lock_stripes = 12;
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &opts));
+    opts.lock_stripes = 0;
+    opts.use_slab = 1;
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &opts));
+    opts.use_slab = 0;
+    opts.engine = HASH_ENGINE_SWISS;
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &opts));
+}
+
+/**
+ * @brief adds, looks up and removes keys owned by one thread while the
+ *        other threads do the same with theirs
+ */
+static void *concurrent_worker(void *arg)
+{
+    hash_table_t *table = ((void **)arg)[0];
+    int id = *(int *)((void **)arg)[1];
+    char key[64] = {0};
+    int failures = 0;
+
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "thread:%d:%d", id, x);
+        failures += SUCCESS != hash_table_add(table, (void *)&data[id], key);
+    }
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "thread:%d:%d", id, x);
+        failures += (void *)&data[id] != hash_table_lookup(table, key);
+        if (0 != x % 4)
+        {
+            failures += SUCCESS != hash_table_remove(table, key);
+        }
+    }
+
+    return failures ? (void *)table : NULL;
+}
+
+void test_hash_table_concurrent()
+{
+    hash_table_t *table = hash_table_init_concurrent(SIZE, NULL);
+    pthread_t threads[THREADS];
+    void *args[THREADS][2];
+    int ids[THREADS];
+    char key[64] = {0};
+
+    CU_ASSERT_FATAL(NULL != table);
+
+    for (int round = 0; round < 2; round++)
+    {
+        for (int x = 0; x < THREADS; x++)
+        {
+            ids[x] = x;
+            args[x][0] = table;
+            args[x][1] = &ids[x];
+            CU_ASSERT_FATAL(0 == pthread_create(&threads[x], NULL,
+                                                concurrent_worker, args[x]));
+        }
+        for (int x = 0; x < THREADS; x++)
+        {
+            void *result = NULL;
+            pthread_join(threads[x], &result);
+            CU_ASSERT(NULL == result);
+        }
+
+        // the table grew and shrank along the way; every key that was
+        // kept is still there
+        for (int id = 0; id < THREADS; id++)
+        {
+            for (int x = 0; x < MANY_KEYS; x++)
+            {
+                snprintf(key, sizeof(key), "thread:%d:%d", id, x);
+                CU_ASSERT(((0 == x % 4) ? (void *)&data[id] : NULL) ==
+                          hash_table_lookup(table, key));
+            }
+        }
+        CU_ASSERT(SUCCESS == hash_table_clear(table));
+        CU_ASSERT(0 == table->count);
+        CU_ASSERT(NULL == hash_table_lookup(table, "thread:0:0"));
+    }
+
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+/**
+ * @brief looks up the stable keys of an RCU table until told to stop,
+ *        counting every lookup that did not find its key
+ */
+static void *rcu_reader(void *arg)
+{
+    hash_table_t *table = ((void **)arg)[0];
+    int *stop = ((void **)arg)[1];
+    char key[64] = {0};
+    intptr_t misses = 0;
+
+    while (!__atomic_load_n(stop, __ATOMIC_ACQUIRE))
+    {
+        for (int x = 0; x < MANY_KEYS; x += 7)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            misses += (void *)&data[x % 10] != hash_table_lookup(table, key);
+        }
+    }
+
+    return (void *)misses;
+}
+
+void test_hash_table_rcu()
+{
+    hash_table_opts_t opts = {.sync = HASH_SYNC_RCU};
+    hash_table_t *table = hash_table_init_ex(SIZE, NULL, &opts);
+    pthread_t threads[THREADS];
+    void *args[2];
+    int stop = 0;
+    char key[64] = {0};
+
+    CU_ASSERT_FATAL(NULL != table);
+    CU_ASSERT(HASH_SYNC_RCU == table->sync);
+    CU_ASSERT(NULL == table->table);
+
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "stable:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[x % 10], key));
+    }
+
+    args[0] = table;
+    args[1] = &stop;
+    for (int x = 0; x < THREADS; x++)
+    {
+        CU_ASSERT_FATAL(0 == pthread_create(&threads[x], NULL, rcu_reader,
+                                            args));
+    }
+
+    // grow and shrink the table under the readers, replacing every bucket
+    // array and unlinking thousands of nodes
+    for (int round = 0; round < 3; round++)
+    {
+        for (int x = 0; x < 4 * MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "churn:a-key-too-long-to-be-inline:%d",
+                     x);
+            CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[0], key));
+        }
+        for (int x = 0; x < 4 * MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "churn:a-key-too-long-to-be-inline:%d",
+                     x);
+            CU_ASSERT(SUCCESS == hash_table_remove(table, key));
+        }
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+    for (int x = 0; x < THREADS; x++)
+    {
+        void *misses = NULL;
+        pthread_join(threads[x], &misses);
+        CU_ASSERT(NULL == misses);
+    }
+
+    CU_ASSERT(MANY_KEYS == table->count);
+    CU_ASSERT(NULL ==
+              hash_table_lookup(table, "churn:a-key-too-long-to-be-inline:1"));
+    CU_ASSERT(SUCCESS == hash_table_clear(table));
+    CU_ASSERT(NULL == hash_table_lookup(table, "stable:0"));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+    opts.use_slab = 1;
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &opts));
+    opts.use_slab = 0;
+    opts.engine = HASH_ENGINE_SWISS;
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &opts));
+}
+
+void test_hash_table_lookup_batch()
+{
+    hash_table_opts_t configs[] = {
+        {.engine = HASH_ENGINE_CHAINED},
+        {.engine = HASH_ENGINE_CHAINED, .rehash_step = 1},
+        {.engine = HASH_ENGINE_SWISS},
+        {.engine = HASH_ENGINE_ROBIN_HOOD},
+        {.engine = HASH_ENGINE_CUCKOO},
+        {.sync = HASH_SYNC_STRIPED},
+        {.sync = HASH_SYNC_RCU},
+        {.engine = HASH_ENGINE_CUCKOO, .sync = HASH_SYNC_RCU},
+    };
+    char *keys[3 * MANY_KEYS / 10 + 1] = {0};
+    void *out[3 * MANY_KEYS / 10 + 1] = {0};
+    size_t n = sizeof(keys) / sizeof(keys[0]);
+
+    // a mix of present, missing, long and NULL keys
+    for (size_t x = 0; x + 1 < n; x++)
+    {
+        keys[x] = (char *)malloc(64);
+        snprintf(keys[x], 64, (x % 3) ? "batch:%zu" :
+                 "batch:a-key-long-enough-to-live-outside-the-node:%zu", x);
+    }
+    free(keys[n / 2]);
+    keys[n / 2] = NULL;
+
+    for (size_t config = 0; config < sizeof(configs) / sizeof(configs[0]);
+         config++)
+    {
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &configs[config]);
+        CU_ASSERT_FATAL(NULL != table);
+
+        for (size_t x = 0; x < n; x += 2)
+        {
+            if (NULL != keys[x])
+            {
+                hash_table_add(table, (void *)&data[x % 10], keys[x]);
+            }
+        }
+
+        CU_ASSERT(SUCCESS == hash_table_lookup_batch(table, keys, n, out));
+        for (size_t x = 0; x < n; x++)
+        {
+            CU_ASSERT(out[x] == hash_table_lookup(table, keys[x]));
+            CU_ASSERT(out[x] == ((0 == x % 2 && NULL != keys[x]) ?
+                                 (void *)&data[x % 10] : NULL));
+        }
+
+        CU_ASSERT(SUCCESS == hash_table_lookup_batch(table, keys, 0, out));
+        CU_ASSERT(FAILURE == hash_table_lookup_batch(NULL, keys, n, out));
+        CU_ASSERT(FAILURE == hash_table_lookup_batch(table, NULL, n, out));
+        CU_ASSERT(FAILURE == hash_table_lookup_batch(table, keys, n, NULL));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+
+    for (size_t x = 0; x < n; x++)
+    {
+        free(keys[x]);
+    }
+}
+
+void test_hash_table_binary_keys()
+{
+    unsigned char uuid[16] = {0x12, 0x3e, 0x45, 0x67, 0xe8, 0x9b, 0x12, 0xd3,
+                              0xa4, 0x56, 0x42, 0x66, 0x14, 0x17, 0x40, 0x00};
+    unsigned char other[16] = {0};
+    char long_key[40] = {0};
+
+    for (int engine = HASH_ENGINE_CHAINED; engine <= HASH_ENGINE_CUCKOO;
+         engine++)
+    {
+        hash_table_opts_t opts = {.engine = (hash_engine_t)engine};
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &opts);
+        CU_ASSERT_FATAL(NULL != table);
+
+        CU_ASSERT(FAILURE == hash_table_add_n(NULL, &data[0], uuid, 16));
+        CU_ASSERT(FAILURE == hash_table_add_n(table, NULL, uuid, 16));
+        CU_ASSERT(FAILURE == hash_table_add_n(table, &data[0], NULL, 16));
+        CU_ASSERT(NULL == hash_table_lookup_n(table, NULL, 16));
+        CU_ASSERT(FAILURE == hash_table_remove_n(table, NULL, 16));
+
+        // keys with embedded NUL bytes differ only past the first NUL
+        memcpy(other, uuid, sizeof(other));
+        other[15] = 0x01;
+        CU_ASSERT(SUCCESS == hash_table_add_n(table, &data[1], uuid, 16));
+        CU_ASSERT(SUCCESS == hash_table_add_n(table, &data[2], other, 16));
+        CU_ASSERT(&data[1] == hash_table_lookup_n(table, uuid, 16));
+        CU_ASSERT(&data[2] == hash_table_lookup_n(table, other, 16));
+        CU_ASSERT(NULL == hash_table_lookup_n(table, uuid, 15));
+
+        // a prefix of a longer key is a different key
+        memset(long_key, 0, sizeof(long_key));
+        CU_ASSERT(SUCCESS == hash_table_add_n(table, &data[3], long_key,
+                                              sizeof(long_key)));
+        CU_ASSERT(NULL == hash_table_lookup_n(table, long_key, 0));
+        CU_ASSERT(SUCCESS == hash_table_add_n(table, &data[4], long_key, 0));
+        CU_ASSERT(&data[4] == hash_table_lookup(table, ""));
+        CU_ASSERT(&data[3] ==
+                  hash_table_lookup_n(table, long_key, sizeof(long_key)));
+
+        // string keys are their strlen bytes
+        CU_ASSERT(SUCCESS == hash_table_add_n(table, &data[5], "route", 5));
+        CU_ASSERT(&data[5] == hash_table_lookup(table, "route"));
+        CU_ASSERT(SUCCESS == hash_table_remove(table, "route"));
+        CU_ASSERT(NULL == hash_table_lookup_n(table, "route", 5));
+
+        CU_ASSERT(SUCCESS == hash_table_remove_n(table, uuid, 16));
+        CU_ASSERT(FAILURE == hash_table_remove_n(table, uuid, 16));
+        CU_ASSERT(&data[2] == hash_table_lookup_n(table, other, 16));
+        CU_ASSERT(3 == table->count);
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+}
+
+void test_hash_table_put()
+{
+    hash_table_opts_t configs[] = {
+        {.engine = HASH_ENGINE_CHAINED},
+        {.engine = HASH_ENGINE_SWISS},
+        {.engine = HASH_ENGINE_ROBIN_HOOD},
+        {.engine = HASH_ENGINE_CUCKOO},
+        {.sync = HASH_SYNC_STRIPED},
+        {.sync = HASH_SYNC_RCU},
+        {.engine = HASH_ENGINE_CUCKOO, .sync = HASH_SYNC_RCU},
+    };
+    char key[64] = {0};
+    void *old = NULL;
+
+    for (size_t config = 0; config < sizeof(configs) / sizeof(configs[0]);
+         config++)
+    {
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &configs[config]);
+        CU_ASSERT_FATAL(NULL != table);
+
+        CU_ASSERT(FAILURE == hash_table_put(NULL, &data[0], "key", &old));
+        CU_ASSERT(FAILURE == hash_table_put(table, NULL, "key", &old));
+        CU_ASSERT(FAILURE == hash_table_put(table, &data[0], NULL, &old));
+
+        // each key is stored once, later puts replace and hand back the data
+        for (int round = 0; round < 3; round++)
+        {
+            for (int x = 0; x < MANY_KEYS; x++)
+            {
+                snprintf(key, sizeof(key), (x % 2) ? "put:%d" :
+                         "put:a-key-long-enough-for-the-heap:%d", x);
+                old = &data[9];
+                CU_ASSERT(SUCCESS == hash_table_put(table,
+                                                    (void *)&data[round], key,
+                                                    &old));
+                CU_ASSERT(old == (round ? (void *)&data[round - 1] : NULL));
+            }
+            CU_ASSERT(MANY_KEYS == table->count ||
+                      HASH_SYNC_STRIPED == table->sync);
+        }
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), (x % 2) ? "put:%d" :
+                     "put:a-key-long-enough-for-the-heap:%d", x);
+            CU_ASSERT(&data[2] == hash_table_lookup(table, key));
+            CU_ASSERT(SUCCESS == hash_table_remove(table, key));
+            CU_ASSERT(NULL == hash_table_lookup(table, key));
+        }
+
+        CU_ASSERT(SUCCESS == hash_table_put_n(table, &data[1], "bin\0ary", 7,
+                                              NULL));
+        CU_ASSERT(&data[1] == hash_table_lookup_n(table, "bin\0ary", 7));
+        CU_ASSERT(NULL == hash_table_lookup(table, "bin"));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+}
+
+void test_hash_table_get_or_insert()
+{
+    char key[64] = {0};
+    int counters[MANY_KEYS / 10] = {0};
+
+    for (int engine = HASH_ENGINE_CHAINED; engine <= HASH_ENGINE_CUCKOO;
+         engine++)
+    {
+        hash_table_opts_t opts = {.engine = (hash_engine_t)engine};
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &opts);
+        CU_ASSERT_FATAL(NULL != table);
+        memset(counters, 0, sizeof(counters));
+
+        CU_ASSERT(NULL == hash_table_get_or_insert(NULL, "key", NULL));
+        CU_ASSERT(NULL == hash_table_get_or_insert(table, NULL, NULL));
+
+        // count how often each of a few hundred words shows up
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "word:%d", x % (MANY_KEYS / 10));
+            void **slot = hash_table_get_or_insert(table, key, NULL);
+            CU_ASSERT_FATAL(NULL != slot);
+            if (NULL == *slot)
+            {
+                *slot = &counters[x % (MANY_KEYS / 10)];
+            }
+            (*(int *)*slot)++;
+        }
+        CU_ASSERT(MANY_KEYS / 10 == table->count);
+        for (int x = 0; x < MANY_KEYS / 10; x++)
+        {
+            snprintf(key, sizeof(key), "word:%d", x);
+            CU_ASSERT(10 == counters[x]);
+            CU_ASSERT(&counters[x] == hash_table_lookup(table, key));
+        }
+
+        // a default value is stored when the key is added
+        void **slot = hash_table_get_or_insert_n(table, "new", 3, &data[4]);
+        CU_ASSERT(NULL != slot && &data[4] == *slot);
+        CU_ASSERT(slot == hash_table_get_or_insert(table, "new", &data[5]));
+        CU_ASSERT(&data[4] == hash_table_lookup(table, "new"));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+
+    hash_table_t *table = hash_table_init_concurrent(SIZE, NULL);
+    CU_ASSERT(NULL == hash_table_get_or_insert(table, "key", &data[0]));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+/**
+ * @brief counts the visits of every "stable:N" key in the int array
+ *        passed as context
+ */
+static void scan_count(const char *key, uint32_t len, void *data,
+                       void *context)
+{
+    (void)data;
+    if (len > 7 && 0 == strncmp(key, "stable:", 7))
+    {
+        ((int *)context)[atoi(key + 7)]++;
+    }
+}
+
+void test_hash_table_scan()
+{
+    hash_table_opts_t configs[] = {
+        {.engine = HASH_ENGINE_CHAINED},
+        {.engine = HASH_ENGINE_CHAINED, .rehash_step = 1},
+        {.engine = HASH_ENGINE_SWISS},
+        {.engine = HASH_ENGINE_ROBIN_HOOD},
+        {.engine = HASH_ENGINE_CUCKOO},
+        {.sync = HASH_SYNC_STRIPED},
+        {.sync = HASH_SYNC_RCU},
+        {.engine = HASH_ENGINE_CUCKOO, .sync = HASH_SYNC_RCU},
+    };
+    static int seen[MANY_KEYS];
+    char key[64] = {0};
+
+    for (size_t config = 0; config < sizeof(configs) / sizeof(configs[0]);
+         config++)
+    {
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &configs[config]);
+        uint64_t cursor = 0;
+        int churn = 0;
+        CU_ASSERT_FATAL(NULL != table);
+
+        CU_ASSERT(0 == hash_table_scan(NULL, 0, 10, scan_count, seen));
+        CU_ASSERT(0 == hash_table_scan(table, 0, 10, NULL, seen));
+
+        for (int x = 0; x < MANY_KEYS / 2; x++)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT(SUCCESS == hash_table_add(table, &data[x % 10], key));
+        }
+
+        // without resizes every entry is visited exactly once
+        memset(seen, 0, sizeof(seen));
+        do
+        {
+            cursor = hash_table_scan(table, cursor, 16, scan_count, seen);
+        } while (0 != cursor);
+        for (int x = 0; x < MANY_KEYS / 2; x++)
+        {
+            CU_ASSERT(1 == seen[x]);
+        }
+
+        // grow the table to many times its size and shrink it back while
+        // the scan is running
+        memset(seen, 0, sizeof(seen));
+        do
+        {
+            cursor = hash_table_scan(table, cursor, 7, scan_count, seen);
+            for (int x = 0; x < 300 && churn < 8 * MANY_KEYS; x++, churn++)
+            {
+                snprintf(key, sizeof(key), "churn:%d", churn);
+                hash_table_add(table, &data[0], key);
+            }
+            for (int x = 0; x < 300 && churn >= 8 * MANY_KEYS &&
+                            churn < 16 * MANY_KEYS;
+                 x++, churn++)
+            {
+                snprintf(key, sizeof(key), "churn:%d", churn - 8 * MANY_KEYS);
+                hash_table_remove(table, key);
+            }
+        } while (0 != cursor);
+        // cuckoo adds move other keys between buckets, which the cursor
+        // cannot account for
+        for (int x = 0;
+             HASH_ENGINE_CUCKOO != configs[config].engine && x < MANY_KEYS / 2;
+             x++)
+        {
+            CU_ASSERT(seen[x] >= 1);
+        }
+
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+}
+
+void test_hash_table_snapshot()
+{
+    const char *path = "hash_table_tests.snapshot";
+    hash_table_opts_t configs[] = {
+        {.engine = HASH_ENGINE_CHAINED},
+        {.engine = HASH_ENGINE_SWISS, .hash_func = HASH_FUNC_SIP},
+        {.sync = HASH_SYNC_STRIPED},
+    };
+    unsigned char uuid[16] = {0x12, 0x3e, 0x00, 0x67, 0xe8, 0x9b, 0x12, 0xd3,
+                              0xa4, 0x56, 0x42, 0x66, 0x14, 0x17, 0x40, 0x00};
+    static int values[MANY_KEYS];
+    hash_table_stats_t stats = {0};
+    char key[64] = {0};
+    FILE *garbage = NULL;
+
+    CU_ASSERT(NULL == hash_table_open_mapped(NULL));
+    CU_ASSERT(NULL == hash_table_open_mapped("no/such/snapshot"));
+    garbage = fopen(path, "wb");
+    CU_ASSERT_FATAL(NULL != garbage);
+    for (int x = 0; x < 100; x++)
+    {
+        fputs("not a snapshot", garbage);
+    }
+    fclose(garbage);
+    CU_ASSERT(NULL == hash_table_open_mapped(path));
+
+    for (size_t config = 0; config < sizeof(configs) / sizeof(configs[0]);
+         config++)
+    {
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &configs[config]);
+        hash_table_t *mapped = NULL;
+        hash_table_t *copy = NULL;
+        char *batch_keys[3] = {"stable:1", "missing", "stable:4999"};
+        void *out[3] = {NULL};
+        int seen[MANY_KEYS] = {0};
+        uint64_t cursor = 0;
+        CU_ASSERT_FATAL(NULL != table);
+
+        CU_ASSERT(FAILURE == hash_table_save(NULL, path, sizeof(int)));
+        CU_ASSERT(FAILURE == hash_table_save(table, NULL, sizeof(int)));
+
+        // an empty table still makes a valid snapshot
+        CU_ASSERT(SUCCESS == hash_table_save(table, path, sizeof(int)));
+        mapped = hash_table_open_mapped(path);
+        CU_ASSERT_FATAL(NULL != mapped);
+        CU_ASSERT(0 == mapped->count);
+        CU_ASSERT(NULL == hash_table_lookup(mapped, "stable:1"));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&mapped));
+
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            values[x] = x * 3;
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT(SUCCESS == hash_table_add(table, &values[x], key));
+        }
+        CU_ASSERT(SUCCESS == hash_table_add_n(table, &values[7], uuid, 16));
+        CU_ASSERT(SUCCESS == hash_table_save(table, path, sizeof(int)));
+
+        // the snapshot holds copies; the live table can change afterwards
+        values[7] = -1;
+        mapped = hash_table_open_mapped(path);
+        CU_ASSERT_FATAL(NULL != mapped);
+        CU_ASSERT(HASH_ENGINE_MAPPED == mapped->engine);
+        CU_ASSERT(MANY_KEYS + 1 == mapped->count);
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            int *value = (int *)hash_table_lookup(mapped, key);
+            CU_ASSERT_FATAL(NULL != value);
+            CU_ASSERT(x * 3 == *value);
+        }
+        CU_ASSERT(21 == *(int *)hash_table_lookup_n(mapped, uuid, 16));
+        CU_ASSERT(NULL == hash_table_lookup_n(mapped, uuid, 15));
+        CU_ASSERT(NULL == hash_table_lookup(mapped, "missing"));
+
+        CU_ASSERT(SUCCESS ==
+                  hash_table_lookup_batch(mapped, batch_keys, 3, out));
+        CU_ASSERT(NULL != out[0] && 3 == *(int *)out[0]);
+        CU_ASSERT(NULL == out[1]);
+        CU_ASSERT(NULL != out[2] && 3 * 4999 == *(int *)out[2]);
+
+        CU_ASSERT(SUCCESS == hash_table_stats(mapped, &stats));
+        CU_ASSERT(MANY_KEYS + 1 == stats.count);
+        CU_ASSERT(mapped->size == stats.buckets);
+        CU_ASSERT(MANY_KEYS + 6 == stats.lookups);
+        CU_ASSERT(MANY_KEYS + 3 == stats.hits);
+        CU_ASSERT(stats.probes >= stats.hits);
+
+        do
+        {
+            cursor = hash_table_scan(mapped, cursor, 100, scan_count, seen);
+        } while (0 != cursor);
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            CU_ASSERT(1 == seen[x]);
+        }
+
+        // read-only
+        CU_ASSERT(FAILURE == hash_table_add(mapped, &data[0], "new"));
+        CU_ASSERT(FAILURE == hash_table_put(mapped, &data[0], "stable:1", NULL));
+        CU_ASSERT(NULL == hash_table_get_or_insert(mapped, "stable:1", NULL));
+        CU_ASSERT(FAILURE == hash_table_remove(mapped, "stable:1"));
+        CU_ASSERT(FAILURE == hash_table_clear(mapped));
+        CU_ASSERT(MANY_KEYS + 1 == mapped->count);
+
+        // a mapped table can be saved again, here as a key set
+        CU_ASSERT(SUCCESS == hash_table_save(mapped, path, 0));
+        copy = hash_table_open_mapped(path);
+        CU_ASSERT_FATAL(NULL != copy);
+        CU_ASSERT(MANY_KEYS + 1 == copy->count);
+        CU_ASSERT(0 == strcmp("stable:42",
+                              (char *)hash_table_lookup(copy, "stable:42")));
+        CU_ASSERT(NULL == hash_table_lookup(copy, "stable:5000"));
+
+        CU_ASSERT(SUCCESS == hash_table_destroy(&copy));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&mapped));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+        values[7] = 21;
+    }
+
+    remove(path);
+}
+
+/**
+ * @brief overwrites size bytes at offset of a snapshot file
+ */
+static void snapshot_patch(const char *path, long offset, const void *value,
+                           size_t size)
+{
+    FILE *file = fopen(path, "r+b");
+
+    if (NULL != file)
+    {
+        if (0 == fseek(file, offset, SEEK_SET))
+        {
+            fwrite(value, size, 1, file);
+        }
+        fclose(file);
+    }
+}
+
+void test_hash_table_snapshot_corrupt()
+{
+    // offsets of the header fields, see mapped_header_t
+    const long count_at = 36;
+    const long stride_at = 44;
+    const long bucket_at = 48;
+    const long entry_at = 56;
+    const long value_at = 64;
+    const long key_at = 72;
+    const char *path = "hash_table_tests.snapshot";
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    hash_table_t *mapped = NULL;
+    uint64_t key_offset = 0;
+    uint64_t offset = 0;
+    uint32_t stride = 0;
+    uint32_t count = UINT32_MAX;
+    char key[64] = {0};
+    FILE *file = NULL;
+    CU_ASSERT_FATAL(NULL != table);
+
+    for (int x = 0; x < 100; x++)
+    {
+        snprintf(key, sizeof(key), "corrupt:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_add(table, &data[x % 10], key));
+    }
+    CU_ASSERT(SUCCESS == hash_table_save(table, path, sizeof(int)));
+    file = fopen(path, "rb");
+    CU_ASSERT_FATAL(NULL != file);
+    CU_ASSERT(0 == fseek(file, stride_at, SEEK_SET));
+    CU_ASSERT(1 == fread(&stride, sizeof(stride), 1, file));
+    CU_ASSERT(0 == fseek(file, key_at, SEEK_SET));
+    CU_ASSERT(1 == fread(&key_offset, sizeof(key_offset), 1, file));
+    fclose(file);
+
+    // a huge count with entry and value offsets picked so that each
+    // section end wraps around onto the start of the next one
+    snapshot_patch(path, count_at, &count, sizeof(count));
+    offset = key_offset - (uint64_t)count * stride;
+    snapshot_patch(path, value_at, &offset, sizeof(offset));
+    offset -= (uint64_t)count * 24;
+    snapshot_patch(path, entry_at, &offset, sizeof(offset));
+    CU_ASSERT(NULL == hash_table_open_mapped(path));
+
+    // a bucket offset whose end wraps to a small number
+    CU_ASSERT(SUCCESS == hash_table_save(table, path, sizeof(int)));
+    offset = UINT64_MAX - 7;
+    snapshot_patch(path, bucket_at, &offset, sizeof(offset));
+    CU_ASSERT(NULL == hash_table_open_mapped(path));
+
+    // the unpatched file still opens
+    CU_ASSERT(SUCCESS == hash_table_save(table, path, sizeof(int)));
+    mapped = hash_table_open_mapped(path);
+    CU_ASSERT_FATAL(NULL != mapped);
+    CU_ASSERT(data[3] == *(int *)hash_table_lookup(mapped, "corrupt:13"));
+
+    CU_ASSERT(SUCCESS == hash_table_destroy(&mapped));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    remove(path);
+}
+
+void test_hash_table_freeze()
+{
+    hash_table_opts_t configs[] = {
+        {.engine = HASH_ENGINE_CHAINED, .hash_func = HASH_FUNC_POLY31},
+        {.engine = HASH_ENGINE_SWISS},
+        {.engine = HASH_ENGINE_ROBIN_HOOD},
+        {.engine = HASH_ENGINE_CUCKOO},
+        {.sync = HASH_SYNC_RCU},
+    };
+    unsigned char uuid[16] = {0x12, 0x3e, 0x00, 0x67, 0xe8, 0x9b, 0x12, 0xd3,
+                              0xa4, 0x56, 0x42, 0x66, 0x14, 0x17, 0x40, 0x00};
+    char key[64] = {0};
+
+    CU_ASSERT(NULL == hash_table_freeze(NULL));
+
+    for (size_t config = 0; config < sizeof(configs) / sizeof(configs[0]);
+         config++)
+    {
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &configs[config]);
+        hash_table_t *frozen = NULL;
+        char *batch_keys[4] = {"stable:0", "missing", NULL, "stable:4999"};
+        void *out[4] = {NULL};
+        int seen[MANY_KEYS] = {0};
+        uint64_t cursor = 0;
+        CU_ASSERT_FATAL(NULL != table);
+
+        // an empty table freezes into an empty table
+        frozen = hash_table_freeze(table);
+        CU_ASSERT_FATAL(NULL != frozen);
+        CU_ASSERT(0 == frozen->count);
+        CU_ASSERT(NULL == hash_table_lookup(frozen, "stable:0"));
+        CU_ASSERT(0 == hash_table_scan(frozen, 0, 10, scan_count, seen));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&frozen));
+
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT(SUCCESS == hash_table_add(table, &data[x % 10], key));
+        }
+        CU_ASSERT(SUCCESS == hash_table_add_n(table, &data[3], uuid, 16));
+        CU_ASSERT(SUCCESS == hash_table_add(table, &data[9], ""));
+
+        frozen = hash_table_freeze(table);
+        CU_ASSERT_FATAL(NULL != frozen);
+        CU_ASSERT(HASH_ENGINE_FROZEN == frozen->engine);
+        CU_ASSERT(MANY_KEYS + 2 == frozen->count);
+
+        // the frozen copy does not follow the source table
+        CU_ASSERT(SUCCESS == hash_table_remove(table, "stable:1"));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT(&data[x % 10] == hash_table_lookup(frozen, key));
+            snprintf(key, sizeof(key), "stable:%d", x + MANY_KEYS);
+            CU_ASSERT(NULL == hash_table_lookup(frozen, key));
+        }
+        CU_ASSERT(&data[3] == hash_table_lookup_n(frozen, uuid, 16));
+        CU_ASSERT(NULL == hash_table_lookup_n(frozen, uuid, 15));
+        CU_ASSERT(&data[9] == hash_table_lookup(frozen, ""));
+
+        CU_ASSERT(SUCCESS ==
+                  hash_table_lookup_batch(frozen, batch_keys, 4, out));
+        CU_ASSERT(&data[0] == out[0]);
+        CU_ASSERT(NULL == out[1]);
+        CU_ASSERT(NULL == out[2]);
+        CU_ASSERT(&data[4999 % 10] == out[3]);
+
+        do
+        {
+            cursor = hash_table_scan(frozen, cursor, 64, scan_count, seen);
+        } while (0 != cursor);
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            CU_ASSERT(1 == seen[x]);
+        }
+
+        // read-only
+        CU_ASSERT(FAILURE == hash_table_add(frozen, &data[0], "new"));
+        CU_ASSERT(FAILURE == hash_table_put(frozen, &data[0], "stable:1", NULL));
+        CU_ASSERT(NULL == hash_table_get_or_insert(frozen, "stable:1", NULL));
+        CU_ASSERT(FAILURE == hash_table_remove(frozen, "stable:1"));
+        CU_ASSERT(FAILURE == hash_table_clear(frozen));
+        CU_ASSERT(&data[1] == hash_table_lookup(frozen, "stable:1"));
+
+        CU_ASSERT(SUCCESS == hash_table_destroy(&frozen));
+    }
+}
+
+void test_hash_table_freeze_duplicates()
+{
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    hash_table_t *frozen = NULL;
+    CU_ASSERT_FATAL(NULL != table);
+
+    // hash_table_add keeps both copies and lookups return the first
+    CU_ASSERT(SUCCESS == hash_table_add(table, &data[1], "twice"));
+    CU_ASSERT(SUCCESS == hash_table_add(table, &data[2], "twice"));
+    CU_ASSERT(SUCCESS == hash_table_add(table, &data[3], "once"));
+
+    frozen = hash_table_freeze(table);
+    CU_ASSERT_FATAL(NULL != frozen);
+    CU_ASSERT(2 == frozen->count);
+    CU_ASSERT(&data[1] == hash_table_lookup(frozen, "twice"));
+    CU_ASSERT(&data[3] == hash_table_lookup(frozen, "once"));
+
+    CU_ASSERT(SUCCESS == hash_table_destroy(&frozen));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+void test_hash_table_robin_hood()
+{
+    hash_table_opts_t opts = {.engine = HASH_ENGINE_ROBIN_HOOD};
+    hash_table_t *table = hash_table_init_ex(MANY_KEYS, NULL, &opts);
+    hash_table_t *chained = hash_table_init(SIZE, NULL);
+    uint32_t capacity = 0;
+    uint32_t max_probe = 0;
+    double mean_probe = 0;
+    char key[64] = {0};
+    int status = SUCCESS;
+    CU_ASSERT_FATAL(NULL != table && NULL != chained);
+
+    CU_ASSERT(FAILURE == hash_table_probe_stats(NULL, &max_probe, NULL));
+    CU_ASSERT(FAILURE == hash_table_probe_stats(chained, &max_probe, NULL));
+    CU_ASSERT(SUCCESS == hash_table_probe_stats(table, &max_probe,
+                                                &mean_probe));
+    CU_ASSERT(0 == max_probe);
+    CU_ASSERT(0 == mean_probe);
+
+    // fill to the 90% load limit without growing
+    capacity = table->size;
+    for (uint32_t x = 0; x < capacity - capacity / 10; x++)
+    {
+        snprintf(key, sizeof(key), "stable:%u", x);
+        CU_ASSERT(SUCCESS == hash_table_add(table, &data[x % 10], key));
+    }
+    CU_ASSERT(capacity == table->size);
+    CU_ASSERT(SUCCESS == hash_table_probe_stats(table, &max_probe,
+                                                &mean_probe));
+    CU_ASSERT(max_probe < 64);
+    CU_ASSERT(mean_probe < 8);
+
+    // removing shifts keys back, so no removed key leaves a longer probe
+    for (uint32_t x = 0; x < capacity - capacity / 10; x += 2)
+    {
+        snprintf(key, sizeof(key), "stable:%u", x);
+        CU_ASSERT(SUCCESS == hash_table_remove(table, key));
+        CU_ASSERT(FAILURE == hash_table_remove(table, key));
+    }
+    for (uint32_t x = 0; x < capacity - capacity / 10; x++)
+    {
+        snprintf(key, sizeof(key), "stable:%u", x);
+        CU_ASSERT((x % 2 ? &data[x % 10] : NULL) ==
+                  hash_table_lookup(table, key));
+    }
+    CU_ASSERT(SUCCESS == hash_table_probe_stats(table, NULL, &mean_probe));
+    CU_ASSERT(mean_probe < 2);
+
+    // the next key past the load limit doubles the slot array
+    for (uint32_t x = 0; x <= capacity; x++)
+    {
+        snprintf(key, sizeof(key), "grow:%u", x);
+        CU_ASSERT(SUCCESS == hash_table_add(table, &data[0], key));
+    }
+    CU_ASSERT(2 * capacity == table->size);
+    CU_ASSERT(&data[3] == hash_table_lookup(table, "stable:3"));
+
+    // copies of one key share a home slot; a nearly empty table refuses
+    // more copies than fit within the longest probe instead of growing
+    CU_ASSERT(SUCCESS == hash_table_clear(table));
+    for (int x = 0; x < 300 && SUCCESS == status; x++)
+    {
+        status = hash_table_add(table, &data[x % 10], "same");
+    }
+    CU_ASSERT(FAILURE == status);
+    CU_ASSERT(2 * capacity == table->size);
+    CU_ASSERT(&data[0] == hash_table_lookup(table, "same"));
+    CU_ASSERT(SUCCESS == hash_table_remove(table, "same"));
+    CU_ASSERT(&data[1] == hash_table_lookup(table, "same"));
+
+    CU_ASSERT(SUCCESS == hash_table_destroy(&chained));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+void test_hash_table_cuckoo()
+{
+    hash_table_opts_t opts = {.engine = HASH_ENGINE_CUCKOO};
+    hash_table_t *table = hash_table_init_ex(MANY_KEYS, NULL, &opts);
+    hash_table_stats_t stats = {0};
+    pthread_t threads[THREADS];
+    void *args[2];
+    int stop = 0;
+    uint32_t capacity = 0;
+    char key[64] = {0};
+    int status = SUCCESS;
+    int copies = 0;
+    CU_ASSERT_FATAL(NULL != table);
+
+    // fill to the load limit without growing, moving keys to make room
+    capacity = table->size;
+    for (uint32_t x = 0; x < capacity - capacity / 16; x++)
+    {
+        snprintf(key, sizeof(key), "stable:%u", x);
+        CU_ASSERT(SUCCESS == hash_table_add(table, &data[x % 10], key));
+    }
+    CU_ASSERT(capacity == table->size);
+
+    // every key is in its first or second bucket, each one cache line
+    CU_ASSERT(SUCCESS == hash_table_stats(table, &stats));
+    CU_ASSERT(capacity / 4 == stats.buckets);
+    CU_ASSERT(stats.longest <= 1);
+    CU_ASSERT(stats.histogram[0] + stats.histogram[1] == table->count);
+    CU_ASSERT(stats.histogram[1] > 0);
+
+    for (uint32_t x = 0; x < capacity - capacity / 16; x += 2)
+    {
+        snprintf(key, sizeof(key), "stable:%u", x);
+        CU_ASSERT(SUCCESS == hash_table_remove(table, key));
+        CU_ASSERT(FAILURE == hash_table_remove(table, key));
+    }
+    for (uint32_t x = 0; x < capacity - capacity / 16; x++)
+    {
+        snprintf(key, sizeof(key), "stable:%u", x);
+        CU_ASSERT((x % 2 ? &data[x % 10] : NULL) ==
+                  hash_table_lookup(table, key));
+    }
+
+    // a lookup never searches more than two buckets
+    CU_ASSERT(SUCCESS == hash_table_stats(table, &stats));
+    CU_ASSERT(stats.probes <= 2 * stats.lookups);
+
+    // growing splits every bucket in two and keeps each key reachable
+    for (uint32_t x = 0; x <= capacity; x++)
+    {
+        snprintf(key, sizeof(key), "grow:%u", x);
+        CU_ASSERT(SUCCESS == hash_table_add(table, &data[0], key));
+    }
+    CU_ASSERT(2 * capacity == table->size);
+    CU_ASSERT(&data[3] == hash_table_lookup(table, "stable:3"));
+    CU_ASSERT(&data[0] == hash_table_lookup(table, "grow:0"));
+
+    // copies of one key share both buckets; once the eight slots are full
+    // a nearly empty table refuses more instead of growing
+    CU_ASSERT(SUCCESS == hash_table_clear(table));
+    while (SUCCESS == status)
+    {
+        status = hash_table_add(table, &data[copies % 10], "same");
+        copies += SUCCESS == status;
+    }
+    CU_ASSERT(8 == copies);
+    CU_ASSERT(2 * capacity == table->size);
+    CU_ASSERT(NULL != hash_table_lookup(table, "same"));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+    // lookups run without locks while adds move keys between buckets
+    opts.sync = HASH_SYNC_RCU;
+    table = hash_table_init_ex(SIZE, NULL, &opts);
+    CU_ASSERT_FATAL(NULL != table);
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "stable:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[x % 10], key));
+    }
+
+    args[0] = table;
+    args[1] = &stop;
+    for (int x = 0; x < THREADS; x++)
+    {
+        CU_ASSERT_FATAL(0 == pthread_create(&threads[x], NULL, rcu_reader,
+                                            args));
+    }
+    for (int round = 0; round < 3; round++)
+    {
+        for (int x = 0; x < 4 * MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "churn:%d", x);
+            CU_ASSERT(SUCCESS == hash_table_add(table, (void *)&data[0], key));
+        }
+        for (int x = 0; x < 4 * MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "churn:%d", x);
+            CU_ASSERT(SUCCESS == hash_table_remove(table, key));
+        }
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+    for (int x = 0; x < THREADS; x++)
+    {
+        void *misses = NULL;
+        pthread_join(threads[x], &misses);
+        CU_ASSERT(NULL == misses);
+    }
+
+    CU_ASSERT(MANY_KEYS == table->count);
+    CU_ASSERT(SUCCESS == hash_table_clear(table));
+    CU_ASSERT(NULL == hash_table_lookup(table, "stable:0"));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+void test_hash_table_bloom()
+{
+    hash_table_opts_t bad = {.sync = HASH_SYNC_STRIPED, .bloom_fp_rate = 0.01};
+    hash_table_stats_t stats = {0};
+    char key[64] = {0};
+    char *keys[2 * MANY_KEYS] = {0};
+    void *out[2 * MANY_KEYS] = {0};
+
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &bad));
+    bad = (hash_table_opts_t){.bloom_fp_rate = 1};
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &bad));
+
+    for (int engine = 0; engine <= HASH_ENGINE_CUCKOO; engine++)
+    {
+        hash_table_opts_t opts = {.engine = (hash_engine_t)engine,
+                                  .bloom_fp_rate = 0.01};
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &opts);
+        CU_ASSERT_FATAL(NULL != table);
+        CU_ASSERT_FATAL(NULL != table->bloom);
+
+        // the filter is rebuilt larger as the table outgrows it
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT(SUCCESS == hash_table_add(table, &data[x % 10], key));
+        }
+        CU_ASSERT(table->bloom->capacity >= MANY_KEYS);
+
+        // misses are answered by the filter without a bucket probe
+        for (int x = 0; x < 2 * MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT((x < MANY_KEYS ? &data[x % 10] : NULL) ==
+                      hash_table_lookup(table, key));
+        }
+        CU_ASSERT(SUCCESS == hash_table_stats(table, &stats));
+        CU_ASSERT(MANY_KEYS == stats.misses);
+        CU_ASSERT(stats.filtered > MANY_KEYS * 95 / 100);
+        CU_ASSERT(stats.filtered <= stats.misses);
+
+        for (int x = 0; x < 2 * MANY_KEYS; x++)
+        {
+            keys[x] = strdup(x % 2 ? "absent" : "stable:1");
+        }
+        CU_ASSERT(SUCCESS == hash_table_lookup_batch(table, keys,
+                                                     2 * MANY_KEYS, out));
+        for (int x = 0; x < 2 * MANY_KEYS; x++)
+        {
+            CU_ASSERT((x % 2 ? NULL : &data[1]) == out[x]);
+            free(keys[x]);
+        }
+
+        // removed keys are dropped from the filter once enough pile up
+        for (int x = 0; x < MANY_KEYS; x += 2)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT(SUCCESS == hash_table_remove(table, key));
+        }
+        CU_ASSERT(table->bloom_stale < MANY_KEYS / 2);
+        CU_ASSERT(table->bloom->count < MANY_KEYS);
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT((x % 2 ? &data[x % 10] : NULL) ==
+                      hash_table_lookup(table, key));
+        }
+
+        // keys added by put and get_or_insert pass the filter too
+        CU_ASSERT(SUCCESS == hash_table_put(table, &data[2], "put", NULL));
+        CU_ASSERT(NULL != hash_table_get_or_insert(table, "slot", &data[3]));
+        CU_ASSERT(&data[2] == hash_table_lookup(table, "put"));
+        CU_ASSERT(&data[3] == hash_table_lookup(table, "slot"));
+
+        CU_ASSERT(SUCCESS == hash_table_clear(table));
+        CU_ASSERT(0 == table->bloom->count);
+        CU_ASSERT(NULL == hash_table_lookup(table, "put"));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+}
+
+/**
+ * @brief looks up every stable key of a table once, half of them hits
+ */
+static void *stats_reader(void *arg)
+{
+    char key[64] = {0};
+
+    for (int x = 0; x < 2 * MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "stable:%d", x);
+        hash_table_lookup((hash_table_t *)arg, key);
+    }
+
+    return NULL;
+}
+
+void test_hash_table_stats()
+{
+    hash_table_opts_t configs[] = {
+        {.engine = HASH_ENGINE_CHAINED},
+        {.engine = HASH_ENGINE_SWISS},
+        {.engine = HASH_ENGINE_ROBIN_HOOD},
+        {.engine = HASH_ENGINE_CUCKOO},
+        {.sync = HASH_SYNC_STRIPED},
+        {.sync = HASH_SYNC_RCU},
+        {.engine = HASH_ENGINE_CUCKOO, .sync = HASH_SYNC_RCU},
+    };
+    hash_table_stats_t stats = {0};
+    char key[64] = {0};
+    char *batch[3] = {"stable:1", "stable:2", "missing"};
+    void *out[3] = {NULL};
+
+    CU_ASSERT(FAILURE == hash_table_stats(NULL, &stats));
+
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+    {
+        hash_table_t *table = hash_table_init_ex(SIZE, NULL, &configs[c]);
+        hash_table_t *frozen = NULL;
+        pthread_t threads[STATS_READERS];
+        uint64_t readers = HASH_SYNC_NONE == configs[c].sync ?
+                               THREADS :
+                               STATS_ROUNDS * STATS_READERS;
+        uint64_t entries = 0;
+        uint64_t buckets = 0;
+        CU_ASSERT_FATAL(NULL != table);
+        CU_ASSERT(FAILURE == hash_table_stats(table, NULL));
+
+        CU_ASSERT(SUCCESS == hash_table_stats(table, &stats));
+        CU_ASSERT(0 == stats.count);
+        CU_ASSERT(0 == stats.lookups);
+        CU_ASSERT(0 == stats.longest);
+        CU_ASSERT(0 == stats.mean_probes);
+        CU_ASSERT(stats.bytes_used > sizeof(hash_table_t));
+
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "stable:%d", x);
+            CU_ASSERT(SUCCESS ==
+                      hash_table_add(table, (void *)&data[x % 10], key));
+        }
+        CU_ASSERT(SUCCESS == hash_table_stats(table, &stats));
+        CU_ASSERT(MANY_KEYS == stats.count);
+        CU_ASSERT(stats.buckets >= SIZE);
+        CU_ASSERT(stats.load_factor == (double)MANY_KEYS / stats.buckets);
+        CU_ASSERT(stats.bytes_used > MANY_KEYS * strlen("stable:0"));
+        for (uint32_t x = 0; x < HASH_TABLE_STATS_BINS; x++)
+        {
+            entries += (uint64_t)x * stats.histogram[x];
+            buckets += stats.histogram[x];
+        }
+        if (HASH_ENGINE_CHAINED == configs[c].engine)
+        {
+            // every bucket holds one chain, of at most longest entries
+            CU_ASSERT(stats.buckets == buckets);
+            CU_ASSERT(stats.longest >= 1);
+            CU_ASSERT(stats.longest < HASH_TABLE_STATS_BINS - 1 ?
+                          MANY_KEYS == entries :
+                          MANY_KEYS >= entries);
+        }
+        else
+        {
+            // every entry has one probe length
+            CU_ASSERT(MANY_KEYS == buckets);
+        }
+
+        // only synchronized tables may be read by several threads at once.
+        // More readers than counter slots share slot 0, and the second
+        // round takes over the slots the first one gave back
+        for (int x = 0; HASH_SYNC_NONE == configs[c].sync && x < THREADS;
+             x++)
+        {
+            stats_reader(table);
+        }
+        for (int round = 0;
+             HASH_SYNC_NONE != configs[c].sync && round < STATS_ROUNDS;
+             round++)
+        {
+            for (int x = 0; x < STATS_READERS; x++)
+            {
+                CU_ASSERT_FATAL(0 == pthread_create(&threads[x], NULL,
+                                                    stats_reader, table));
+            }
+            for (int x = 0; x < STATS_READERS; x++)
+            {
+                pthread_join(threads[x], NULL);
+            }
+        }
+        CU_ASSERT(SUCCESS == hash_table_lookup_batch(table, batch, 3, out));
+        CU_ASSERT(SUCCESS == hash_table_stats(table, &stats));
+        CU_ASSERT(readers * 2 * MANY_KEYS + 3 == stats.lookups);
+        CU_ASSERT(readers * MANY_KEYS + 2 == stats.hits);
+        CU_ASSERT(readers * MANY_KEYS + 1 == stats.misses);
+        // a hit examines at least the entry holding its key
+        CU_ASSERT(stats.probes >= stats.hits);
+        CU_ASSERT(stats.mean_probes == (double)stats.probes / stats.lookups);
+        CU_ASSERT(stats.mean_probes < 4);
+
+        // copies start out with counters of their own
+        frozen = hash_table_freeze(table);
+        CU_ASSERT_FATAL(NULL != frozen);
+        CU_ASSERT(&data[3] == hash_table_lookup(frozen, "stable:3"));
+        CU_ASSERT(NULL == hash_table_lookup(frozen, "missing"));
+        CU_ASSERT(SUCCESS == hash_table_stats(frozen, &stats));
+        CU_ASSERT(MANY_KEYS == stats.count);
+        CU_ASSERT(MANY_KEYS == stats.histogram[0]);
+        CU_ASSERT(0 == stats.longest);
+        CU_ASSERT(2 == stats.lookups);
+        CU_ASSERT(1 == stats.hits);
+        CU_ASSERT(2 == stats.probes);
+
+        CU_ASSERT(SUCCESS == hash_table_destroy(&frozen));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    }
+}
+
+void test_hash_table_build()
+{
+    // enough keys for hash_table_build to split them over THREADS threads
+    uint32_t n = 4 * 16384 + 7;
+    char **keys = (char **)calloc(n, sizeof(char *));
+    void **values = (void **)calloc(n, sizeof(void *));
+    hash_table_opts_t swiss = {.engine = HASH_ENGINE_SWISS};
+    hash_table_opts_t bloom = {.bloom_fp_rate = 0.01};
+    hash_table_opts_t *configs[] = {NULL, &swiss, &bloom};
+    hash_table_stats_t stats = {0};
+    char key[64] = {0};
+    CU_ASSERT_FATAL(NULL != keys && NULL != values);
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        // every third key is too long to be inlined, and one key in 1000
+        // repeats the key 500 before it with other data
+        uint32_t id = 500 == x % 1000 ? x - 500 : x;
+        snprintf(key, sizeof(key),
+                 id % 3 ? "build:%u" : "a key too long for a node:%u", id);
+        keys[x] = strdup(key);
+        values[x] = &data[id == x ? x % 10 : 9];
+    }
+
+    for (uint32_t config = 0; config < 3; config++)
+    {
+        for (uint32_t threads = 0; threads <= THREADS; threads += THREADS)
+        {
+            hash_table_t *table = hash_table_build(keys, values, n, NULL,
+                                                   configs[config], threads);
+            CU_ASSERT_FATAL(NULL != table);
+            CU_ASSERT(n == table->count);
+            // a repeated key is stored twice and finds its first data
+            for (uint32_t x = 0; x < n; x++)
+            {
+                CU_ASSERT(&data[x % 10] == hash_table_lookup(table, keys[x]));
+            }
+            CU_ASSERT(NULL == hash_table_lookup(table, "build:missing"));
+            CU_ASSERT(SUCCESS == hash_table_stats(table, &stats));
+            CU_ASSERT(n == stats.count);
+            CU_ASSERT(stats.load_factor <= 1);
+
+            // the built table takes adds and removes like any other
+            CU_ASSERT(SUCCESS == hash_table_remove(table, keys[1]));
+            CU_ASSERT(SUCCESS == hash_table_remove(table, keys[3]));
+            CU_ASSERT(NULL == hash_table_lookup(table, keys[1]));
+            CU_ASSERT(SUCCESS == hash_table_add(table, &data[9], "added"));
+            CU_ASSERT(SUCCESS == hash_table_add(table, &data[8], keys[3]));
+            CU_ASSERT(&data[9] == hash_table_lookup(table, "added"));
+            CU_ASSERT(&data[8] == hash_table_lookup(table, keys[3]));
+            CU_ASSERT(SUCCESS == hash_table_clear(table));
+            CU_ASSERT(NULL == hash_table_lookup(table, keys[2]));
+            CU_ASSERT(SUCCESS == hash_table_add(table, &data[7], keys[2]));
+            CU_ASSERT(&data[7] == hash_table_lookup(table, keys[2]));
+            CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+        }
+    }
+
+    // small and empty inputs build on the calling thread
+    hash_table_t *table = hash_table_build(keys, values, 2, NULL, NULL,
+                                           THREADS);
+    CU_ASSERT_FATAL(NULL != table);
+    CU_ASSERT(2 == table->count);
+    CU_ASSERT(&data[1] == hash_table_lookup(table, keys[1]));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    table = hash_table_build(keys, values, 0, NULL, NULL, 0);
+    CU_ASSERT_FATAL(NULL != table);
+    CU_ASSERT(0 == table->count);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+    CU_ASSERT(NULL == hash_table_build(NULL, values, n, NULL, NULL, 0));
+    CU_ASSERT(NULL == hash_table_build(keys, NULL, n, NULL, NULL, 0));
+    values[n / 2] = NULL;
+    CU_ASSERT(NULL == hash_table_build(keys, values, n, NULL, NULL, THREADS));
+    CU_ASSERT(NULL == hash_table_build(keys, values, n, NULL, &swiss, 0));
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        free(keys[x]);
+    }
+    free(keys);
+    free(values);
+}
+
+static uint32_t ttl_freed = 0;
+
+/**
+ * @brief free function counting the data expiry hands back
+ */
+static void ttl_free(void *data)
+{
+    ttl_freed++;
+    free(data);
+}
+
+/**
+ * @brief malloc'd copy of an int, for entries expiry frees
+ */
+static int *ttl_value(int value)
+{
+    int *copy = (int *)malloc(sizeof(int));
+    if (NULL != copy)
+    {
+        *copy = value;
+    }
+    return copy;
+}
+
+/**
+ * @brief scan callback freeing the data of the entries visited
+ */
+static void ttl_free_scanned(const char *key, uint32_t len, void *data,
+                             void *context)
+{
+    (void)key;
+    (void)len;
+    (void)context;
+    free(data);
+}
+
+/**
+ * @brief scan callback counting the entries visited
+ */
+static void ttl_count(const char *key, uint32_t len, void *data,
+                      void *context)
+{
+    (void)key;
+    (void)len;
+    (void)data;
+    (*(uint32_t *)context)++;
+}
+
+/**
+ * @brief sleeps for at least ms milliseconds
+ */
+static void ttl_sleep_ms(long ms)
+{
+    struct timespec pause = {ms / 1000, (ms % 1000) * 1000000L};
+    while (0 != nanosleep(&pause, &pause))
+    {
+    }
+}
+
+void test_hash_table_ttl()
+{
+    hash_table_opts_t opts = {.ttl_tick_ms = 1};
+    hash_table_opts_t bad_engine = {.engine = HASH_ENGINE_SWISS,
+                                    .ttl_tick_ms = 1};
+    hash_table_opts_t bad_sync = {.sync = HASH_SYNC_STRIPED,
+                                  .ttl_tick_ms = 1};
+    hash_table_t *plain = hash_table_init(SIZE, NULL);
+    hash_table_t *table = hash_table_init_ex(SIZE, ttl_free, &opts);
+    void *old = &old;
+    uint32_t reclaimed = 0;
+    uint32_t visited = 0;
+    uint64_t cursor = 0;
+    char key[64] = {0};
+    CU_ASSERT_FATAL(NULL != plain && NULL != table);
+
+    // TTLs need an unsynchronized chained table, and force its slab
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &bad_engine));
+    CU_ASSERT(NULL == hash_table_init_ex(SIZE, NULL, &bad_sync));
+    CU_ASSERT(NULL != table->node_slab);
+    CU_ASSERT(FAILURE == hash_table_add_ttl(plain, &data[1], "key", 10));
+    CU_ASSERT(FAILURE == hash_table_put_ttl(plain, &data[1], "key", 10,
+                                            NULL));
+    CU_ASSERT(NULL == hash_table_get_or_insert_ttl(plain, "key", NULL, 10));
+    CU_ASSERT(0 == hash_table_expire(plain, 100));
+    CU_ASSERT(0 == hash_table_expire(NULL, 100));
+    CU_ASSERT(FAILURE == hash_table_add_ttl(table, NULL, "key", 10));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&plain));
+
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "session:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_add_ttl(table, ttl_value(x), key,
+                                                0 == x % 2 ? 100 : 3600000));
+    }
+    CU_ASSERT(SUCCESS == hash_table_add(table, ttl_value(-1), "forever"));
+    CU_ASSERT(SUCCESS == hash_table_add_ttl(table, ttl_value(1), "dup", 100));
+    CU_ASSERT(SUCCESS == hash_table_add_ttl(table, ttl_value(2), "dup", 0));
+    CU_ASSERT(1 == *(int *)hash_table_lookup(table, "dup"));
+    CU_ASSERT(SUCCESS == hash_table_add_ttl(table, ttl_value(3), "kept", 100));
+    CU_ASSERT(SUCCESS == hash_table_add_ttl(table, ttl_value(4), "refreshed",
+                                            200));
+    CU_ASSERT(MANY_KEYS + 5 == table->count);
+    CU_ASSERT(0 == hash_table_expire(table, UINT32_MAX));
+
+    // restarting TTLs keeps entries alive past their first deadline, and
+    // a TTL of 0 takes it away
+    CU_ASSERT(SUCCESS == hash_table_put_ttl(table, ttl_value(5), "kept", 0,
+                                            &old));
+    CU_ASSERT(3 == *(int *)old);
+    free(old);
+    for (int x = 0; x < 6; x++)
+    {
+        void **slot = hash_table_get_or_insert_ttl(table, "refreshed",
+                                                   NULL, 10);
+        CU_ASSERT_FATAL(NULL != slot && NULL != *slot);
+        CU_ASSERT(SUCCESS == hash_table_put_ttl(table, *slot, "refreshed",
+                                                200, &old));
+        ttl_sleep_ms(50);
+    }
+    ttl_sleep_ms(50);
+
+    // expired entries are no longer found, but counted until reclaimed
+    CU_ASSERT(MANY_KEYS + 5 == table->count);
+    CU_ASSERT(NULL == hash_table_lookup(table, "session:0"));
+    CU_ASSERT(1 == *(int *)hash_table_lookup(table, "session:1"));
+    CU_ASSERT(2 == *(int *)hash_table_lookup(table, "dup"));
+    CU_ASSERT(5 == *(int *)hash_table_lookup(table, "kept"));
+    CU_ASSERT(4 == *(int *)hash_table_lookup(table, "refreshed"));
+    CU_ASSERT(-1 == *(int *)hash_table_lookup(table, "forever"));
+    CU_ASSERT(FAILURE == hash_table_remove(table, "session:2"));
+    do
+    {
+        cursor = hash_table_scan(table, cursor, 100, ttl_count, &visited);
+    } while (0 != cursor);
+    CU_ASSERT(MANY_KEYS / 2 + 4 == visited);
+
+    // a put on an expired key adds a fresh entry
+    CU_ASSERT(SUCCESS == hash_table_put_ttl(table, ttl_value(7), "session:4",
+                                            3600000, &old));
+    CU_ASSERT(NULL == old);
+    CU_ASSERT(7 == *(int *)hash_table_lookup(table, "session:4"));
+
+    // reclaiming is bounded by the budget and frees every expired entry
+    reclaimed = hash_table_expire(table, 1);
+    CU_ASSERT(reclaimed <= 1);
+    for (int x = 0; x < 1000 && reclaimed < MANY_KEYS / 2 + 1; x++)
+    {
+        reclaimed += hash_table_expire(table, 64);
+    }
+    CU_ASSERT(MANY_KEYS / 2 + 1 == reclaimed);
+    CU_ASSERT(MANY_KEYS / 2 + 1 == ttl_freed);
+    CU_ASSERT(MANY_KEYS / 2 + 5 == table->count);
+    CU_ASSERT(0 == hash_table_expire(table, UINT32_MAX));
+    CU_ASSERT(7 == *(int *)hash_table_lookup(table, "session:4"));
+    for (int x = 1; x < MANY_KEYS; x += 2)
+    {
+        snprintf(key, sizeof(key), "session:%d", x);
+        int *value = (int *)hash_table_lookup(table, key);
+        CU_ASSERT_FATAL(NULL != value);
+        CU_ASSERT(x == *value);
+    }
+
+    // clearing drops the pending timers with the entries
+    cursor = 0;
+    do
+    {
+        cursor = hash_table_scan(table, cursor, 100, ttl_free_scanned, NULL);
+    } while (0 != cursor);
+    CU_ASSERT(SUCCESS == hash_table_clear(table));
+    CU_ASSERT(0 == hash_table_expire(table, UINT32_MAX));
+    CU_ASSERT(SUCCESS == hash_table_add_ttl(table, ttl_value(8), "again", 1));
+    ttl_sleep_ms(10);
+    CU_ASSERT(NULL == hash_table_lookup(table, "again"));
+    CU_ASSERT(1 == hash_table_expire(table, UINT32_MAX));
+    CU_ASSERT(0 == table->count);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+void test_hash_table_swiss_init()
+{
+    hash_table_t *swiss_table = hash_table_init_swiss(SIZE, NULL);
+    CU_ASSERT_FATAL(NULL != swiss_table);
+    CU_ASSERT(HASH_ENGINE_SWISS == swiss_table->engine);
+    CU_ASSERT(NULL != swiss_table->engine_data);
+    CU_ASSERT(NULL == swiss_table->table);
+    CU_ASSERT(free == swiss_table->customfree);
+    // capacity is a power of two multiple of the 16 slot probe group
+    CU_ASSERT(SIZE <= swiss_table->size);
+    CU_ASSERT(0 == swiss_table->size % 16);
+    CU_ASSERT(0 == (swiss_table->size & (swiss_table->size - 1)));
+
+    CU_ASSERT(NULL == hash_table_init_swiss(0, NULL));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&swiss_table));
+}
+
+void test_hash_table_swiss_operations()
+{
+    char key[32] = {0};
+    char sized_key[64] = {0};
+    hash_table_t *swiss_table = hash_table_init_swiss(SIZE, NULL);
+    CU_ASSERT_FATAL(NULL != swiss_table);
+
+    // keys on both sides of the inline key limit, moved by every rebuild
+    memset(sized_key, 'k', sizeof(sized_key));
+    for (size_t len = 1; len <= sizeof(sized_key); len++)
+    {
+        CU_ASSERT(SUCCESS == hash_table_add_n(swiss_table, &data[len % 10],
+                                              sized_key, len));
+    }
+
+    // grow well past the initial capacity
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "swiss:%d", x);
+        CU_ASSERT(SUCCESS ==
+                  hash_table_add(swiss_table, (void *)&data[x % 10], key));
+    }
+    CU_ASSERT(MANY_KEYS < swiss_table->size);
+
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "swiss:%d", x);
+        CU_ASSERT((void *)&data[x % 10] == hash_table_lookup(swiss_table, key));
+    }
+    for (size_t len = 1; len <= sizeof(sized_key); len++)
+    {
+        CU_ASSERT(&data[len % 10] ==
+                  hash_table_lookup_n(swiss_table, sized_key, len));
+        CU_ASSERT(SUCCESS == hash_table_remove_n(swiss_table, sized_key, len));
+    }
+    CU_ASSERT(NULL == hash_table_lookup(swiss_table, "swiss:missing"));
+
+    // remove every other key, the rest must stay reachable
+    for (int x = 0; x < MANY_KEYS; x += 2)
+    {
+        snprintf(key, sizeof(key), "swiss:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_remove(swiss_table, key));
+        CU_ASSERT(FAILURE == hash_table_remove(swiss_table, key));
+    }
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "swiss:%d", x);
+        CU_ASSERT(((x % 2) ? (void *)&data[x % 10] : NULL) ==
+                  hash_table_lookup(swiss_table, key));
+    }
+
+    // removed slots are reused
+    for (int x = 0; x < MANY_KEYS; x += 2)
+    {
+        snprintf(key, sizeof(key), "swiss:%d", x);
+        CU_ASSERT(SUCCESS ==
+                  hash_table_add(swiss_table, (void *)&data[0], key));
+        CU_ASSERT((void *)&data[0] == hash_table_lookup(swiss_table, key));
+    }
+
+    CU_ASSERT(SUCCESS == hash_table_clear(swiss_table));
+    CU_ASSERT(NULL == hash_table_lookup(swiss_table, "swiss:1"));
+    CU_ASSERT(SUCCESS ==
+              hash_table_add(swiss_table, (void *)&data[1], "swiss:1"));
+    CU_ASSERT((void *)&data[1] == hash_table_lookup(swiss_table, "swiss:1"));
+
+    CU_ASSERT(SUCCESS == hash_table_destroy(&swiss_table));
+    CU_ASSERT(NULL == swiss_table);
+}
+
 int main(void)
 {
     CU_TestInfo suite1_tests[] = {
@@ -185,10 +1978,68 @@ int main(void)
 
         {"Testing hash_table_destroy():", test_hash_table_destroy},
 
+        {"Testing hash_table_init_ex():", test_hash_table_init_ex},
+
+        {"Testing incremental rehash:", test_hash_table_rehash},
+
+        {"Testing hash functions:", test_hash_table_hash_funcs},
+
+        {"Testing inline keys and cached hashes:", test_hash_table_node_keys},
+
+        {"Testing slab allocated tables:", test_hash_table_slab},
+
+        {"Testing hash_table_init_concurrent():",
+         test_hash_table_concurrent_init},
+
+        {"Testing concurrent access:", test_hash_table_concurrent},
+
+        {"Testing lock-free lookups:", test_hash_table_rcu},
+
+        {"Testing hash_table_lookup_batch():", test_hash_table_lookup_batch},
+
+        {"Testing binary keys:", test_hash_table_binary_keys},
+
+        {"Testing hash_table_put():", test_hash_table_put},
+
+        {"Testing hash_table_get_or_insert():", test_hash_table_get_or_insert},
+
+        {"Testing hash_table_scan():", test_hash_table_scan},
+
+        {"Testing hash_table_save() and hash_table_open_mapped():",
+         test_hash_table_snapshot},
+
+        {"Testing hash_table_open_mapped() on corrupted offsets:",
+         test_hash_table_snapshot_corrupt},
+
+        {"Testing hash_table_freeze():", test_hash_table_freeze},
+
+        {"Testing the robin hood engine:", test_hash_table_robin_hood},
+
+        {"Testing the cuckoo engine:", test_hash_table_cuckoo},
+
+        {"Testing bloom filtered lookups:", test_hash_table_bloom},
+
+        {"Testing hash_table_stats():", test_hash_table_stats},
+
+        {"Testing hash_table_freeze() with duplicate keys:",
+         test_hash_table_freeze_duplicates},
+
+        {"Testing hash_table_build():", test_hash_table_build},
+
+        {"Testing entry TTLs:", test_hash_table_ttl},
+
+        CU_TEST_INFO_NULL};
+
+    CU_TestInfo suite2_tests[] = {
+        {"Testing hash_table_init_swiss():", test_hash_table_swiss_init},
+
+        {"Testing swiss engine operations:", test_hash_table_swiss_operations},
+
         CU_TEST_INFO_NULL};
 
     CU_SuiteInfo suites[] = {
         {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        {"Suite-2:", init_suite1, clean_suite1, .pTests = suite2_tests},
         CU_SUITE_INFO_NULL};
 
     if (CUE_SUCCESS != CU_initialize_registry())
@@ -0,0 +1,591 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <fcntl.h>
+#include <hash_table_wal.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SIZE 10
+#define MANY_KEYS 5000
+#define THREADS 4
+#define KEYS_PER_THREAD 5000
+
+static const char *path = "hash_table_wal_tests.log";
+static int values[MANY_KEYS];
+
+/**
+ * @brief an adder of the concurrent compaction test
+ *
+ * @param wal       log the adder writes through
+ * @param worker    index of the adder
+ */
+typedef struct adder_t
+{
+    hash_table_wal_t *wal;
+    uint32_t worker;
+} adder_t;
+
+int init_suite1(void)
+{
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        values[x] = x;
+    }
+    remove(path);
+    return 0;
+}
+
+int clean_suite1(void)
+{
+    remove(path);
+    return 0;
+}
+
+/**
+ * @brief scan callback freeing the data replayed into a table
+ */
+static void free_data(const char *key, uint32_t len, void *data,
+                      void *context)
+{
+    (void)key;
+    (void)len;
+    (void)context;
+    free(data);
+}
+
+/**
+ * @brief destroys a table together with the data replayed into it
+ */
+static void destroy_replayed(hash_table_t **table_addr)
+{
+    uint64_t cursor = 0;
+
+    do
+    {
+        cursor = hash_table_scan(*table_addr, cursor, UINT32_MAX, free_data,
+                                 NULL);
+    } while (0 != cursor);
+    hash_table_destroy(table_addr);
+}
+
+/**
+ * @brief size of the log file
+ */
+static long log_size(void)
+{
+    struct stat info = {0};
+
+    return 0 == stat(path, &info) ? (long)info.st_size : -1;
+}
+
+/**
+ * @brief adds the adder's own keys, returning the number of failed adds
+ */
+static void *adder(void *arg)
+{
+    adder_t *adder = (adder_t *)arg;
+    char key[64] = {0};
+    uintptr_t failures = 0;
+
+    for (uint32_t x = 0; x < KEYS_PER_THREAD; x++)
+    {
+        snprintf(key, sizeof(key), "worker:%u:%u", adder->worker, x);
+        failures += SUCCESS != hash_table_wal_add(
+                                   adder->wal, &values[x % MANY_KEYS], key);
+    }
+
+    return (void *)failures;
+}
+
+void test_hash_table_wal_open()
+{
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    hash_table_wal_opts_t opts = {.value_size = sizeof(int)};
+    hash_table_wal_t *wal = NULL;
+    FILE *garbage = NULL;
+    CU_ASSERT_FATAL(NULL != table);
+
+    CU_ASSERT(NULL == hash_table_wal_open(NULL, table, &opts));
+    CU_ASSERT(NULL == hash_table_wal_open(path, NULL, &opts));
+    CU_ASSERT(NULL == hash_table_wal_open("no/such/dir/log", table, &opts));
+    CU_ASSERT(FAILURE == hash_table_wal_close(NULL));
+    CU_ASSERT(FAILURE == hash_table_wal_close(&wal));
+    CU_ASSERT(FAILURE == hash_table_wal_add(NULL, &values[1], "key"));
+    CU_ASSERT(FAILURE == hash_table_wal_sync(NULL));
+    CU_ASSERT(FAILURE == hash_table_wal_compact(NULL));
+
+    // a missing log is created, holding just its header
+    wal = hash_table_wal_open(path, table, &opts);
+    CU_ASSERT_FATAL(NULL != wal);
+    CU_ASSERT(0 == table->count);
+    CU_ASSERT(FAILURE == hash_table_wal_add(wal, NULL, "key"));
+    CU_ASSERT(FAILURE == hash_table_wal_remove(wal, "key"));
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+    CU_ASSERT(NULL == wal);
+    CU_ASSERT(log_size() > 0);
+
+    // logs written with another value size, or not logs at all, are refused
+    opts.value_size = sizeof(double);
+    CU_ASSERT(NULL == hash_table_wal_open(path, table, &opts));
+    garbage = fopen(path, "wb");
+    CU_ASSERT_FATAL(NULL != garbage);
+    for (int x = 0; x < 100; x++)
+    {
+        fputs("not a log", garbage);
+    }
+    fclose(garbage);
+    CU_ASSERT(NULL == hash_table_wal_open(path, table, NULL));
+
+    remove(path);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+}
+
+void test_hash_table_wal_replay()
+{
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    hash_table_t *replayed = hash_table_init(SIZE, NULL);
+    hash_table_wal_opts_t opts = {.value_size = sizeof(int)};
+    hash_table_wal_t *wal = hash_table_wal_open(path, table, &opts);
+    char key[64] = {0};
+    CU_ASSERT_FATAL(NULL != table && NULL != replayed && NULL != wal);
+
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "replay:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[x], key));
+    }
+    for (int x = 0; x < MANY_KEYS; x += 3)
+    {
+        snprintf(key, sizeof(key), "replay:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_wal_remove(wal, key));
+    }
+    snprintf(key, sizeof(key), "replay:%d", 0);
+    CU_ASSERT(FAILURE == hash_table_wal_remove(wal, key));
+
+    // duplicates and binary keys replay in order
+    CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[1], "twice"));
+    CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[2], "twice"));
+    CU_ASSERT(SUCCESS == hash_table_wal_add_n(wal, &values[7], "a\0b", 3));
+    CU_ASSERT(SUCCESS == hash_table_wal_remove_n(wal, "replay:1", 8));
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+
+    wal = hash_table_wal_open(path, replayed, &opts);
+    CU_ASSERT_FATAL(NULL != wal);
+    CU_ASSERT(table->count == replayed->count);
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "replay:%d", x);
+        int *data = (int *)hash_table_lookup(replayed, key);
+        if (0 == x % 3 || 1 == x)
+        {
+            CU_ASSERT(NULL == data);
+        }
+        else
+        {
+            CU_ASSERT_FATAL(NULL != data);
+            CU_ASSERT(x == *data);
+        }
+    }
+    CU_ASSERT(1 == *(int *)hash_table_lookup(replayed, "twice"));
+    CU_ASSERT(7 == *(int *)hash_table_lookup_n(replayed, "a\0b", 3));
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+
+    destroy_replayed(&replayed);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    remove(path);
+}
+
+void test_hash_table_wal_torn_tail()
+{
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    hash_table_wal_opts_t opts = {.value_size = sizeof(int)};
+    hash_table_wal_t *wal = hash_table_wal_open(path, table, &opts);
+    char key[64] = {0};
+    FILE *log = NULL;
+    long intact = 0;
+    CU_ASSERT_FATAL(NULL != table && NULL != wal);
+
+    for (int x = 0; x < 100; x++)
+    {
+        snprintf(key, sizeof(key), "torn:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[x], key));
+    }
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    intact = log_size();
+
+    // a crash in the middle of a write leaves part of a record behind
+    log = fopen(path, "ab");
+    CU_ASSERT_FATAL(NULL != log);
+    fwrite("\x01\x02\x03\x04\x01\x00\x00\x00\x09\x00", 10, 1, log);
+    fclose(log);
+
+    table = hash_table_init(SIZE, NULL);
+    wal = hash_table_wal_open(path, table, &opts);
+    CU_ASSERT_FATAL(NULL != table && NULL != wal);
+    CU_ASSERT(100 == table->count);
+    CU_ASSERT(intact == log_size());
+    CU_ASSERT(42 == *(int *)hash_table_lookup(table, "torn:42"));
+
+    // appends carry on after the cut; the table owns its data now
+    int *after = (int *)malloc(sizeof(int));
+    CU_ASSERT_FATAL(NULL != after);
+    *after = 5;
+    CU_ASSERT(SUCCESS == hash_table_wal_add(wal, after, "after"));
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+    destroy_replayed(&table);
+
+    table = hash_table_init(SIZE, NULL);
+    wal = hash_table_wal_open(path, table, &opts);
+    CU_ASSERT_FATAL(NULL != table && NULL != wal);
+    CU_ASSERT(101 == table->count);
+    CU_ASSERT(5 == *(int *)hash_table_lookup(table, "after"));
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+    destroy_replayed(&table);
+    remove(path);
+}
+
+void test_hash_table_wal_fsync()
+{
+    wal_fsync_t policies[] = {WAL_FSYNC_NONE, WAL_FSYNC_INTERVAL,
+                              WAL_FSYNC_COMMIT};
+    char key[64] = {0};
+    char long_key[300] = {0};
+
+    memset(long_key, 'k', sizeof(long_key));
+
+    for (size_t policy = 0; policy < sizeof(policies) / sizeof(policies[0]);
+         policy++)
+    {
+        hash_table_t *table = hash_table_init(SIZE, NULL);
+        hash_table_wal_opts_t opts = {.fsync = policies[policy],
+                                      .flush_interval_ms = 1,
+                                      .buffer_size = 256,
+                                      .value_size = sizeof(int)};
+        hash_table_wal_t *wal = hash_table_wal_open(path, table, &opts);
+        CU_ASSERT_FATAL(NULL != table && NULL != wal);
+
+        // a small buffer makes appends wait for the writer, and a key
+        // larger than the buffer grows it
+        for (int x = 0; x < 200; x++)
+        {
+            snprintf(key, sizeof(key), "fsync:%d", x);
+            CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[x], key));
+        }
+        CU_ASSERT(SUCCESS == hash_table_wal_add_n(wal, &values[9], long_key,
+                                                  sizeof(long_key)));
+        CU_ASSERT(SUCCESS == hash_table_wal_sync(wal));
+        CU_ASSERT(wal->synced == wal->appended);
+        CU_ASSERT(wal->written == wal->appended);
+        if (WAL_FSYNC_COMMIT == policies[policy])
+        {
+            CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[3], "last"));
+            CU_ASSERT(wal->synced == wal->appended);
+        }
+        CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+
+        table = hash_table_init(SIZE, NULL);
+        wal = hash_table_wal_open(path, table, &opts);
+        CU_ASSERT_FATAL(NULL != table && NULL != wal);
+        CU_ASSERT(201 + (WAL_FSYNC_COMMIT == policies[policy]) ==
+                  table->count);
+        CU_ASSERT(9 == *(int *)hash_table_lookup_n(table, long_key,
+                                                   sizeof(long_key)));
+        CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+        destroy_replayed(&table);
+        remove(path);
+    }
+}
+
+void test_hash_table_wal_compact()
+{
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    hash_table_t *replayed = hash_table_init(SIZE, NULL);
+    hash_table_wal_opts_t opts = {.value_size = sizeof(int)};
+    hash_table_wal_t *wal = hash_table_wal_open(path, table, &opts);
+    char key[64] = {0};
+    long before = 0;
+    CU_ASSERT_FATAL(NULL != table && NULL != replayed && NULL != wal);
+
+    // every key is added, replaced several times, and a third removed
+    for (int round = 0; round < 4; round++)
+    {
+        for (int x = 0; x < MANY_KEYS; x++)
+        {
+            snprintf(key, sizeof(key), "compact:%d", x);
+            hash_table_wal_remove(wal, key);
+            CU_ASSERT(SUCCESS == hash_table_wal_add(
+                                     wal, &values[(x + round) % MANY_KEYS],
+                                     key));
+        }
+    }
+    for (int x = 0; x < MANY_KEYS; x += 3)
+    {
+        snprintf(key, sizeof(key), "compact:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_wal_remove(wal, key));
+    }
+    CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[1], "twice"));
+    CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[2], "twice"));
+    CU_ASSERT(SUCCESS == hash_table_wal_sync(wal));
+    before = log_size();
+
+    CU_ASSERT(SUCCESS == hash_table_wal_compact(wal));
+    CU_ASSERT(1 == wal->compactions);
+    CU_ASSERT(log_size() < before / 4);
+
+    // the log keeps working after the swap
+    CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[11], "late"));
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+
+    wal = hash_table_wal_open(path, replayed, &opts);
+    CU_ASSERT_FATAL(NULL != wal);
+    CU_ASSERT(table->count == replayed->count);
+    for (int x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "compact:%d", x);
+        int *data = (int *)hash_table_lookup(replayed, key);
+        if (0 == x % 3)
+        {
+            CU_ASSERT(NULL == data);
+        }
+        else
+        {
+            CU_ASSERT_FATAL(NULL != data);
+            CU_ASSERT((x + 3) % MANY_KEYS == *data);
+        }
+    }
+    int *first = (int *)hash_table_lookup(replayed, "twice");
+    CU_ASSERT_FATAL(NULL != first);
+    CU_ASSERT(1 == *first);
+    CU_ASSERT(SUCCESS == hash_table_remove(replayed, "twice"));
+    CU_ASSERT(2 == *(int *)hash_table_lookup(replayed, "twice"));
+    free(first);
+    CU_ASSERT(11 == *(int *)hash_table_lookup(replayed, "late"));
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+
+    destroy_replayed(&replayed);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    remove(path);
+}
+
+void test_hash_table_wal_compact_failure()
+{
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    hash_table_wal_opts_t opts = {.flush_interval_ms = 1,
+                                  .value_size = sizeof(int),
+                                  .compact_min_bytes = 4096};
+    hash_table_wal_t *wal = hash_table_wal_open(path, table, &opts);
+    char temporary[256] = {0};
+    char blocker[300] = {0};
+    char key[64] = {0};
+    FILE *file = NULL;
+    CU_ASSERT_FATAL(NULL != table && NULL != wal);
+
+    // a directory, which a failed compaction cannot remove, where the
+    // compaction writes its new log fails every compaction
+    snprintf(temporary, sizeof(temporary), "%s.compact", path);
+    snprintf(blocker, sizeof(blocker), "%s/blocker", temporary);
+    CU_ASSERT_FATAL(0 == mkdir(temporary, 0700));
+    file = fopen(blocker, "w");
+    CU_ASSERT_FATAL(NULL != file);
+    fclose(file);
+    CU_ASSERT(FAILURE == hash_table_wal_compact(wal));
+    CU_ASSERT(0 == wal->compactions);
+
+    // the log grows 64 times past compact_min_bytes; each failure waits
+    // for it to double again instead of retrying on the next append
+    for (int x = 0; x < MANY_KEYS * 4; x++)
+    {
+        snprintf(key, sizeof(key), "failing:%d", x);
+        CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[x % MANY_KEYS],
+                                                key));
+        if (0 == x % 1000)
+        {
+            CU_ASSERT(SUCCESS == hash_table_wal_sync(wal));
+        }
+    }
+    CU_ASSERT(SUCCESS == hash_table_wal_sync(wal));
+    CU_ASSERT(wal->file_bytes >= 64 * opts.compact_min_bytes);
+    CU_ASSERT(wal->compact_requested <= 10);
+    CU_ASSERT(0 == wal->compactions);
+
+    // once the cause is gone, compaction works again
+    CU_ASSERT(0 == remove(blocker));
+    CU_ASSERT(0 == rmdir(temporary));
+    CU_ASSERT(SUCCESS == hash_table_wal_compact(wal));
+    CU_ASSERT(1 == wal->compactions);
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    remove(path);
+}
+
+void test_hash_table_wal_concurrent_compact()
+{
+    hash_table_t *table = hash_table_init(SIZE, NULL);
+    hash_table_t *replayed = hash_table_init(SIZE, NULL);
+    hash_table_wal_opts_t opts = {.value_size = sizeof(int),
+                                  .flush_interval_ms = 1,
+                                  .buffer_size = 4096,
+                                  .compact_min_bytes = 64 * 1024};
+    hash_table_wal_t *wal = hash_table_wal_open(path, table, &opts);
+    pthread_t threads[THREADS];
+    adder_t adders[THREADS];
+    char key[64] = {0};
+    CU_ASSERT_FATAL(NULL != table && NULL != replayed && NULL != wal);
+
+    for (uint32_t x = 0; x < THREADS; x++)
+    {
+        adders[x] = (adder_t){wal, x};
+        CU_ASSERT_FATAL(0 == pthread_create(&threads[x], NULL, adder,
+                                            &adders[x]));
+    }
+    // compactions run while the adders append, both asked for and started
+    // once the log crosses compact_min_bytes
+    for (int x = 0; x < 3; x++)
+    {
+        CU_ASSERT(SUCCESS == hash_table_wal_compact(wal));
+    }
+    for (uint32_t x = 0; x < THREADS; x++)
+    {
+        void *failures = NULL;
+        pthread_join(threads[x], &failures);
+        CU_ASSERT(NULL == failures);
+    }
+    CU_ASSERT(wal->compactions >= 3);
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+
+    // no record appended during a compaction was lost by it
+    wal = hash_table_wal_open(path, replayed, &opts);
+    CU_ASSERT_FATAL(NULL != wal);
+    CU_ASSERT(THREADS * KEYS_PER_THREAD == replayed->count);
+    for (uint32_t worker = 0; worker < THREADS; worker++)
+    {
+        for (uint32_t x = 0; x < KEYS_PER_THREAD; x++)
+        {
+            snprintf(key, sizeof(key), "worker:%u:%u", worker, x);
+            int *data = (int *)hash_table_lookup(replayed, key);
+            CU_ASSERT_FATAL(NULL != data);
+            CU_ASSERT((int)(x % MANY_KEYS) == *data);
+        }
+    }
+    CU_ASSERT(SUCCESS == hash_table_wal_close(&wal));
+
+    destroy_replayed(&replayed);
+    CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+    remove(path);
+}
+
+void test_hash_table_wal_failure()
+{
+    hash_table_wal_opts_t opts = {.fsync = WAL_FSYNC_COMMIT,
+                                  .flush_interval_ms = 1,
+                                  .value_size = sizeof(int)};
+
+    // an add, a remove, then adders racing, each on a log whose next write
+    // fails, leave the table as it was
+    for (int attempt = 0; attempt < 3; attempt++)
+    {
+        hash_table_t *table = hash_table_init(SIZE, NULL);
+        hash_table_wal_t *wal = hash_table_wal_open(path, table, &opts);
+        pthread_t threads[THREADS];
+        adder_t adders[THREADS];
+        CU_ASSERT_FATAL(NULL != table && NULL != wal);
+
+        CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[1], "dup"));
+        CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[2], "dup"));
+        CU_ASSERT(SUCCESS == hash_table_wal_add(wal, &values[3], "kept"));
+
+        int full = open("/dev/full", O_WRONLY);
+        CU_ASSERT_FATAL(-1 != full);
+        CU_ASSERT_FATAL(-1 != dup2(full, wal->fd));
+        close(full);
+
+        if (0 == attempt)
+        {
+            CU_ASSERT(FAILURE == hash_table_wal_add(wal, &values[4], "dup"));
+        }
+        else if (1 == attempt)
+        {
+            CU_ASSERT(FAILURE == hash_table_wal_remove(wal, "dup"));
+        }
+        else
+        {
+            for (uint32_t x = 0; x < THREADS; x++)
+            {
+                adders[x] = (adder_t){wal, x};
+                CU_ASSERT_FATAL(0 == pthread_create(&threads[x], NULL,
+                                                    adder, &adders[x]));
+            }
+            for (uint32_t x = 0; x < THREADS; x++)
+            {
+                void *failures = NULL;
+                pthread_join(threads[x], &failures);
+                CU_ASSERT(KEYS_PER_THREAD == (uintptr_t)failures);
+            }
+        }
+        CU_ASSERT(FAILURE == hash_table_wal_add(wal, &values[5], "late"));
+        CU_ASSERT(3 == table->count);
+        CU_ASSERT(&values[3] == hash_table_lookup(table, "kept"));
+
+        // the key stored twice keeps its entries in order
+        CU_ASSERT(&values[1] == hash_table_lookup(table, "dup"));
+        CU_ASSERT(SUCCESS == hash_table_remove(table, "dup"));
+        CU_ASSERT(&values[2] == hash_table_lookup(table, "dup"));
+
+        CU_ASSERT(FAILURE == hash_table_wal_close(&wal));
+        CU_ASSERT(SUCCESS == hash_table_destroy(&table));
+        remove(path);
+    }
+}
+
+int main(void)
+{
+    CU_TestInfo suite1_tests[] = {
+        {"Testing hash_table_wal_open():", test_hash_table_wal_open},
+
+        {"Testing log replay:", test_hash_table_wal_replay},
+
+        {"Testing a torn log tail:", test_hash_table_wal_torn_tail},
+
+        {"Testing fsync policies:", test_hash_table_wal_fsync},
+
+        {"Testing hash_table_wal_compact():", test_hash_table_wal_compact},
+
+        {"Testing a failing compaction:", test_hash_table_wal_compact_failure},
+
+        {"Testing compaction under concurrent adds:",
+         test_hash_table_wal_concurrent_compact},
+
+        {"Testing a failing log:", test_hash_table_wal_failure},
+
+        CU_TEST_INFO_NULL};
+
+    CU_SuiteInfo suites[] = {
+        {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        CU_SUITE_INFO_NULL};
+
+    if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        return CU_get_error();
+    }
+
+    if (0 != CU_register_suites(suites))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_basic_show_failures(CU_get_failure_list());
+    int num_failed = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    puts("\n");
+    return num_failed;
+}
@@ -0,0 +1,230 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <intern_pool.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 10
+#define MANY_STRINGS 5000
+#define THREADS 4
+#define ROUNDS 5
+
+intern_pool_t *pool = NULL;
+
+/**
+ * @brief a producer of the multi-threaded test
+ *
+ * @param pool      pool the producer interns into
+ * @param worker    index of the producer
+ * @param interned  canonical pointer the producer got for every string
+ */
+typedef struct producer_t
+{
+    intern_pool_t *pool;
+    uint32_t worker;
+    const char *interned[MANY_STRINGS];
+} producer_t;
+
+int init_suite1(void)
+{
+    return 0;
+}
+
+int clean_suite1(void)
+{
+    return 0;
+}
+
+/**
+ * @brief interns every string several times, each producer starting at a
+ *        different string, returning the number of failed interns
+ */
+static void *producer(void *arg)
+{
+    producer_t *producer = (producer_t *)arg;
+    char str[64] = {0};
+    uintptr_t failures = 0;
+
+    for (uint32_t round = 0; round < ROUNDS; round++)
+    {
+        for (uint32_t x = 0; x < MANY_STRINGS; x++)
+        {
+            uint32_t index = (x + producer->worker * 997) % MANY_STRINGS;
+            snprintf(str, sizeof(str), "symbol:%u", index);
+            const char *interned = intern_pool_intern(producer->pool, str,
+                                                      strlen(str));
+            failures += NULL == interned ||
+                        (0 != round && interned != producer->interned[index]);
+            producer->interned[index] = interned;
+        }
+    }
+
+    return (void *)failures;
+}
+
+void test_intern_pool_init()
+{
+    pool = intern_pool_init(SIZE, 0);
+    CU_ASSERT_FATAL(NULL != pool);
+    CU_ASSERT(NULL != pool->table);
+    CU_ASSERT(0 == intern_pool_count(pool));
+    CU_ASSERT(0 == intern_pool_count(NULL));
+}
+
+void test_intern_pool_intern()
+{
+    char str[64] = "event";
+    const char *first = NULL;
+
+    CU_ASSERT(NULL == intern_pool_intern(NULL, "event", 5));
+    CU_ASSERT(NULL == intern_pool_intern(pool, NULL, 5));
+    CU_ASSERT(NULL == intern_pool_lookup(pool, "event", 5));
+
+    // equal strings share one canonical copy, whatever buffer they came in
+    first = intern_pool_intern(pool, "event", 5);
+    CU_ASSERT_FATAL(NULL != first);
+    CU_ASSERT(first == intern_pool_intern(pool, str, strlen(str)));
+    CU_ASSERT(first == intern_pool_lookup(pool, str, 5));
+    CU_ASSERT(first != str);
+    CU_ASSERT(0 == strcmp(first, "event"));
+    memset(str, 'x', 5);
+    CU_ASSERT(0 == strcmp(first, "event"));
+
+    // lengths and embedded NUL bytes tell strings apart
+    CU_ASSERT(first != intern_pool_intern(pool, "events", 5 + 1));
+    CU_ASSERT(first != intern_pool_intern(pool, "eve", 3));
+    CU_ASSERT(intern_pool_intern(pool, "a\0b", 3) !=
+              intern_pool_intern(pool, "a\0c", 3));
+    CU_ASSERT(NULL != intern_pool_intern(pool, "", 0));
+    CU_ASSERT(6 == intern_pool_count(pool));
+
+    // canonical pointers survive the table growing
+    for (uint32_t x = 0; x < MANY_STRINGS; x++)
+    {
+        snprintf(str, sizeof(str), "symbol:%u", x);
+        CU_ASSERT(NULL != intern_pool_intern(pool, str, strlen(str)));
+    }
+    CU_ASSERT(MANY_STRINGS + 6 == intern_pool_count(pool));
+    CU_ASSERT(first == intern_pool_intern(pool, "event", 5));
+}
+
+void test_intern_pool_symbols()
+{
+    char str[64] = {0};
+    uint32_t len = 0;
+
+    CU_ASSERT(INTERN_POOL_NO_SYMBOL == intern_pool_symbol(NULL, "event", 5));
+    CU_ASSERT(NULL == intern_pool_string(NULL, 0, &len));
+    CU_ASSERT(NULL == intern_pool_string(pool, MANY_STRINGS + 6, &len));
+    CU_ASSERT(NULL == intern_pool_string(pool, INTERN_POOL_NO_SYMBOL, &len));
+
+    // symbols count up from 0 in the order strings were first interned
+    CU_ASSERT(0 == intern_pool_symbol(pool, "event", 5));
+    CU_ASSERT(5 == intern_pool_symbol(pool, "", 0));
+    for (uint32_t x = 0; x < MANY_STRINGS; x++)
+    {
+        snprintf(str, sizeof(str), "symbol:%u", x);
+        uint32_t symbol = intern_pool_symbol(pool, str, strlen(str));
+        const char *interned = intern_pool_string(pool, symbol, &len);
+        CU_ASSERT(x + 6 == symbol);
+        CU_ASSERT_FATAL(NULL != interned);
+        CU_ASSERT(strlen(str) == len);
+        CU_ASSERT(0 == strcmp(str, interned));
+        CU_ASSERT(symbol == intern_pool_symbol_of(interned));
+        CU_ASSERT(interned == intern_pool_lookup(pool, str, strlen(str)));
+    }
+    CU_ASSERT(MANY_STRINGS + 6 == intern_pool_count(pool));
+    CU_ASSERT(0 == intern_pool_symbol_of(intern_pool_string(pool, 0, NULL)));
+}
+
+void test_intern_pool_shared()
+{
+    intern_pool_t *shared = intern_pool_init(0, 1);
+    pthread_t threads[THREADS];
+    producer_t *producers = (producer_t *)calloc(THREADS,
+                                                 sizeof(producer_t));
+    char str[64] = {0};
+    CU_ASSERT_FATAL(NULL != shared && NULL != producers);
+
+    for (uint32_t x = 0; x < THREADS; x++)
+    {
+        producers[x].pool = shared;
+        producers[x].worker = x;
+        CU_ASSERT_FATAL(0 == pthread_create(&threads[x], NULL, producer,
+                                            &producers[x]));
+    }
+    for (uint32_t x = 0; x < THREADS; x++)
+    {
+        void *failures = NULL;
+        pthread_join(threads[x], &failures);
+        CU_ASSERT(NULL == failures);
+    }
+
+    // every producer got the same canonical copy of every string
+    CU_ASSERT(MANY_STRINGS == intern_pool_count(shared));
+    for (uint32_t x = 0; x < MANY_STRINGS; x++)
+    {
+        snprintf(str, sizeof(str), "symbol:%u", x);
+        const char *interned = intern_pool_lookup(shared, str, strlen(str));
+        CU_ASSERT_FATAL(NULL != interned);
+        for (uint32_t y = 0; y < THREADS; y++)
+        {
+            CU_ASSERT(interned == producers[y].interned[x]);
+        }
+        CU_ASSERT(interned ==
+                  intern_pool_string(shared, intern_pool_symbol_of(interned),
+                                     NULL));
+    }
+
+    free(producers);
+    CU_ASSERT(SUCCESS == intern_pool_destroy(&shared));
+}
+
+void test_intern_pool_destroy()
+{
+    CU_ASSERT(SUCCESS == intern_pool_destroy(&pool));
+    CU_ASSERT(NULL == pool);
+    CU_ASSERT(FAILURE == intern_pool_destroy(&pool));
+    CU_ASSERT(FAILURE == intern_pool_destroy(NULL));
+}
+
+int main(void)
+{
+    CU_TestInfo suite1_tests[] = {
+        {"Testing intern_pool_init():", test_intern_pool_init},
+
+        {"Testing intern_pool_intern():", test_intern_pool_intern},
+
+        {"Testing intern pool symbols:", test_intern_pool_symbols},
+
+        {"Testing a shared intern pool:", test_intern_pool_shared},
+
+        {"Testing intern_pool_destroy():", test_intern_pool_destroy},
+
+        CU_TEST_INFO_NULL};
+
+    CU_SuiteInfo suites[] = {
+        {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        CU_SUITE_INFO_NULL};
+
+    if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        return CU_get_error();
+    }
+
+    if (0 != CU_register_suites(suites))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_basic_show_failures(CU_get_failure_list());
+    int num_failed = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    puts("\n");
+    return num_failed;
+}
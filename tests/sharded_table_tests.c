@@ -0,0 +1,348 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <pthread.h>
+#include <sharded_table.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHARDS 8
+#define THREADS 4
+#define MANY_KEYS 20000
+
+int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+sharded_table_t *sharded = NULL;
+
+/**
+ * @brief a worker of the multi-threaded tests
+ *
+ * @param table     table the worker adds to
+ * @param worker    index of the worker
+ */
+typedef struct worker_t
+{
+    sharded_table_t *table;
+    uint32_t worker;
+} worker_t;
+
+int init_suite1(void)
+{
+    return 0;
+}
+
+int clean_suite1(void)
+{
+    return 0;
+}
+
+/**
+ * @brief adds every key whose index belongs to the worker, returning the
+ *        number of failed adds
+ */
+static void *locked_writer(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    char key[64] = {0};
+    uintptr_t failures = 0;
+
+    for (uint32_t x = worker->worker; x < MANY_KEYS; x += THREADS)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        failures += SUCCESS !=
+                    sharded_table_add(worker->table, &data[x % 10], key);
+    }
+
+    return (void *)failures;
+}
+
+/**
+ * @brief adds every key whose home shard the worker owns
+ */
+static void *owned_writer(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    char key[64] = {0};
+    uintptr_t failures = 0;
+
+    for (uint32_t x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        if (worker->worker ==
+            sharded_table_shard_of(worker->table, key, strlen(key)) % THREADS)
+        {
+            failures += SUCCESS !=
+                        sharded_table_add(worker->table, &data[x % 10], key);
+        }
+    }
+
+    return (void *)failures;
+}
+
+/**
+ * @brief adds every key whose index belongs to the worker into the
+ *        worker's private shard
+ */
+static void *private_writer(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    char key[64] = {0};
+    uintptr_t failures = 0;
+
+    for (uint32_t x = worker->worker; x < MANY_KEYS; x += THREADS)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        failures += SUCCESS != sharded_table_add_local(worker->table,
+                                                       worker->worker,
+                                                       &data[x % 10], key);
+    }
+
+    return (void *)failures;
+}
+
+/**
+ * @brief keys of one shard found outside their home shard
+ *
+ * @param table     table being checked
+ * @param shard     shard being scanned
+ * @param count     number of keys whose home is another shard
+ */
+typedef struct misplaced_t
+{
+    sharded_table_t *table;
+    uint32_t shard;
+    uint32_t count;
+} misplaced_t;
+
+/**
+ * @brief scan callback counting keys outside their home shard
+ */
+static void count_misplaced(const char *key, uint32_t len, void *data,
+                            void *context)
+{
+    misplaced_t *misplaced = (misplaced_t *)context;
+
+    (void)data;
+    misplaced->count += misplaced->shard !=
+                        sharded_table_shard_of(misplaced->table, key, len);
+}
+
+/**
+ * @brief runs one writer per thread against a table
+ */
+static void run_writers(sharded_table_t *table, void *(*writer)(void *))
+{
+    pthread_t threads[THREADS];
+    worker_t workers[THREADS];
+
+    for (uint32_t x = 0; x < THREADS; x++)
+    {
+        workers[x] = (worker_t){table, x};
+        CU_ASSERT_FATAL(0 == pthread_create(&threads[x], NULL, writer,
+                                            &workers[x]));
+    }
+    for (uint32_t x = 0; x < THREADS; x++)
+    {
+        void *failures = NULL;
+        pthread_join(threads[x], &failures);
+        CU_ASSERT(NULL == failures);
+    }
+}
+
+/**
+ * @brief checks every key is stored once, with its data
+ */
+static void check_keys(sharded_table_t *table)
+{
+    char key[64] = {0};
+
+    CU_ASSERT(MANY_KEYS == sharded_table_count(table));
+    for (uint32_t x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT(&data[x % 10] == sharded_table_lookup(table, key));
+    }
+}
+
+void test_sharded_table_init()
+{
+    hash_table_opts_t striped = {.sync = HASH_SYNC_STRIPED};
+
+    CU_ASSERT(NULL == sharded_table_init(0, 100, NULL, SHARD_MODE_LOCKED,
+                                         NULL));
+    CU_ASSERT(NULL == sharded_table_init(SHARDS, 100, NULL,
+                                         SHARD_MODE_LOCKED, &striped));
+
+    sharded = sharded_table_init(SHARDS, MANY_KEYS, NULL, SHARD_MODE_LOCKED,
+                                 NULL);
+    CU_ASSERT_FATAL(NULL != sharded);
+    CU_ASSERT(SHARDS == sharded->shard_count);
+    CU_ASSERT(0 == sharded_table_count(sharded));
+    // every shard sits on cache lines of its own
+    CU_ASSERT(0 == sizeof(sharded_table_shard_t) % 64);
+    CU_ASSERT(0 == (uintptr_t)sharded->shards % 64);
+    for (uint32_t x = 0; x < SHARDS; x++)
+    {
+        CU_ASSERT(NULL != sharded->shards[x].table);
+        CU_ASSERT(0 == (uintptr_t)sharded->shards[x].table % 64);
+    }
+}
+
+void test_sharded_table_operations()
+{
+    char key[64] = {0};
+
+    CU_ASSERT(FAILURE == sharded_table_add(NULL, &data[0], "key"));
+    CU_ASSERT(FAILURE == sharded_table_add(sharded, &data[0], NULL));
+    CU_ASSERT(NULL == sharded_table_lookup(sharded, "key"));
+    CU_ASSERT(FAILURE == sharded_table_remove(sharded, "key"));
+    CU_ASSERT(FAILURE == sharded_table_add_local(sharded, 0, &data[0],
+                                                 "key"));
+
+    for (uint32_t x = 0; x < MANY_KEYS; x++)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT(SUCCESS == sharded_table_add(sharded, &data[x % 10], key));
+        CU_ASSERT(sharded_table_shard_of(sharded, key, strlen(key)) <
+                  SHARDS);
+    }
+    check_keys(sharded);
+
+    // the keys are spread over every shard
+    for (uint32_t x = 0; x < SHARDS; x++)
+    {
+        CU_ASSERT(sharded->shards[x].table->count > MANY_KEYS / SHARDS / 2);
+    }
+
+    for (uint32_t x = 0; x < MANY_KEYS; x += 2)
+    {
+        snprintf(key, sizeof(key), "key:%u", x);
+        CU_ASSERT(SUCCESS == sharded_table_remove(sharded, key));
+        CU_ASSERT(FAILURE == sharded_table_remove(sharded, key));
+    }
+    CU_ASSERT(MANY_KEYS / 2 == sharded_table_count(sharded));
+    CU_ASSERT(NULL == sharded_table_lookup(sharded, "key:0"));
+    CU_ASSERT(&data[1] == sharded_table_lookup(sharded, "key:1"));
+}
+
+void test_sharded_table_clear()
+{
+    CU_ASSERT(FAILURE == sharded_table_clear(NULL));
+    CU_ASSERT(SUCCESS == sharded_table_clear(sharded));
+    CU_ASSERT(0 == sharded_table_count(sharded));
+    CU_ASSERT(NULL == sharded_table_lookup(sharded, "key:1"));
+}
+
+void test_sharded_table_locked()
+{
+    run_writers(sharded, locked_writer);
+    check_keys(sharded);
+}
+
+void test_sharded_table_owned()
+{
+    sharded_table_t *owned = sharded_table_init(SHARDS, MANY_KEYS, NULL,
+                                                SHARD_MODE_OWNED, NULL);
+    CU_ASSERT_FATAL(NULL != owned);
+
+    run_writers(owned, owned_writer);
+    check_keys(owned);
+    CU_ASSERT(SUCCESS == sharded_table_destroy(&owned));
+}
+
+void test_sharded_table_merge()
+{
+    hash_table_opts_t opts = {.engine = HASH_ENGINE_SWISS};
+    sharded_table_t *ingest = sharded_table_init(THREADS, MANY_KEYS, NULL,
+                                                 SHARD_MODE_PRIVATE, &opts);
+    misplaced_t misplaced = {0};
+    CU_ASSERT_FATAL(NULL != ingest);
+
+    CU_ASSERT(FAILURE == sharded_table_add_local(ingest, THREADS, &data[0],
+                                                 "key"));
+    CU_ASSERT(FAILURE == sharded_table_add(ingest, &data[0], "key"));
+    CU_ASSERT(FAILURE == sharded_table_merge(NULL, 1));
+
+    run_writers(ingest, private_writer);
+    CU_ASSERT(MANY_KEYS == sharded_table_count(ingest));
+    CU_ASSERT(NULL == sharded_table_lookup(ingest, "key:1"));
+
+    // every key ends up in its home shard, and the table is shared again
+    CU_ASSERT(SUCCESS == sharded_table_merge(ingest, THREADS));
+    CU_ASSERT(SHARD_MODE_LOCKED == ingest->mode);
+    CU_ASSERT(FAILURE == sharded_table_merge(ingest, THREADS));
+    check_keys(ingest);
+    for (uint32_t x = 0; x < THREADS; x++)
+    {
+        CU_ASSERT(HASH_ENGINE_SWISS == ingest->shards[x].table->engine);
+        misplaced = (misplaced_t){ingest, x, 0};
+        CU_ASSERT(0 == hash_table_scan(ingest->shards[x].table, 0,
+                                       MANY_KEYS, count_misplaced,
+                                       &misplaced));
+        CU_ASSERT(0 == misplaced.count);
+    }
+    CU_ASSERT(SUCCESS == sharded_table_destroy(&ingest));
+
+    // merging on the calling thread alone gives the same table
+    ingest = sharded_table_init(SHARDS, MANY_KEYS, NULL, SHARD_MODE_PRIVATE,
+                                NULL);
+    CU_ASSERT_FATAL(NULL != ingest);
+    run_writers(ingest, private_writer);
+    CU_ASSERT(SUCCESS == sharded_table_add_local(ingest, SHARDS - 1,
+                                                 &data[0], "key:0"));
+    CU_ASSERT(SUCCESS == sharded_table_merge(ingest, 0));
+    CU_ASSERT(MANY_KEYS + 1 == sharded_table_count(ingest));
+    CU_ASSERT(SUCCESS == sharded_table_remove(ingest, "key:0"));
+    check_keys(ingest);
+    CU_ASSERT(SUCCESS == sharded_table_destroy(&ingest));
+}
+
+void test_sharded_table_destroy()
+{
+    CU_ASSERT(SUCCESS == sharded_table_destroy(&sharded));
+    CU_ASSERT(NULL == sharded);
+    CU_ASSERT(FAILURE == sharded_table_destroy(&sharded));
+    CU_ASSERT(FAILURE == sharded_table_destroy(NULL));
+}
+
+int main(void)
+{
+    CU_TestInfo suite1_tests[] = {
+        {"Testing sharded_table_init():", test_sharded_table_init},
+
+        {"Testing sharded table operations:", test_sharded_table_operations},
+
+        {"Testing sharded_table_clear():", test_sharded_table_clear},
+
+        {"Testing locked shards:", test_sharded_table_locked},
+
+        {"Testing owned shards:", test_sharded_table_owned},
+
+        {"Testing sharded_table_merge():", test_sharded_table_merge},
+
+        {"Testing sharded_table_destroy():", test_sharded_table_destroy},
+
+        CU_TEST_INFO_NULL};
+
+    CU_SuiteInfo suites[] = {
+        {"Suite-1:", init_suite1, clean_suite1, .pTests = suite1_tests},
+        CU_SUITE_INFO_NULL};
+
+    if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        return CU_get_error();
+    }
+
+    if (0 != CU_register_suites(suites))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_basic_show_failures(CU_get_failure_list());
+    int num_failed = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    puts("\n");
+    return num_failed;
+}